@@ -33,6 +33,7 @@ class Config {
         bool showTouchControls_;
 
         bool scanOnLaunch_;
+        bool analyseLoudness_;
 
         int searchMaxPlaylists_;
         int searchMaxArtists_;
@@ -95,6 +96,10 @@ class Config {
         bool scanOnLaunch();
         bool setScanOnLaunch(const bool);
 
+        // Measure the loudness of new/changed songs when scanning
+        bool analyseLoudness();
+        bool setAnalyseLoudness(const bool);
+
         // Limits for search result entries (-1 indicates no limit)
         int searchMaxPlaylists();
         bool setSearchMaxPlaylists(const int);
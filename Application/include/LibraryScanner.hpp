@@ -32,6 +32,8 @@ class LibraryScanner {
         const SyncDatabase & database;
         // Path to search
         const std::string searchPath;
+        // Whether to measure the loudness of new/changed songs
+        const bool analyseLoudness;
 
         // Vectors of files to add to database
         std::vector<FilePair> addFiles;
@@ -52,9 +54,9 @@ class LibraryScanner {
         Status parseFileUpdate(const FilePair &);
 
     public:
-        // Constructor accepts Database object and path to search
+        // Constructor accepts Database object, path to search and whether to analyse loudness
         // Doesn't actually do anything yet
-        LibraryScanner(const SyncDatabase &, const std::string &);
+        LibraryScanner(const SyncDatabase &, const std::string &, const bool);
 
         // Prepare lists of files to add/edit/remove from database
         Status processFiles();
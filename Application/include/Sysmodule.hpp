@@ -4,6 +4,7 @@
 #include <atomic>
 #include <chrono>
 #include <functional>
+#include "ipc/TriPlayer.hpp"
 #include <mutex>
 #include <queue>
 #include "Types.hpp"
@@ -26,7 +27,7 @@ class Sysmodule {
         std::atomic<Error> error_;
         std::atomic<bool> exit_;
         std::atomic<int> limit_;
-        std::chrono::steady_clock::time_point lastUpdateTime;
+        std::mutex watchMutex;                  // Held while waiting for changes so the connection isn't closed meanwhile
 
         // === Status vars ===
         std::atomic<SongID> currentSong_;
@@ -39,6 +40,7 @@ class Sysmodule {
         std::vector<SongID> queue_;
         std::mutex queueMutex;
         std::atomic<size_t> queueSize_;
+        uint64_t queueVersion_;                 // Version of the queue that queue_ matches (only used on the IPC thread)
         std::atomic<RepeatMode> repeatMode_;
         std::atomic<ShuffleMode> shuffleMode_;
         std::atomic<bool> subQueueChanged_;     // Set true when the whole queue has been updated (not just a single song)
@@ -56,6 +58,8 @@ class Sysmodule {
 
         // Returns if the message was added to the queue
         bool addToIpcQueue(std::function<bool()>);
+        // Waits for the sysmodule's state to change and queues commands to fetch what changed (run on it's own thread)
+        void watchForChanges();
 
     public:
         // Constructor creates a socket and attempts connection to sysmodule
@@ -92,14 +96,17 @@ class Sysmodule {
         double volume();
 
         // The following commands block the calling thread until a response is received
-        bool waitRequestDBLock();
         bool waitReset();
         size_t waitSongIdx();
+        bool waitStats(TriPlayer::Stats &);
 
         // === Send command to sysmodule ===
         // Updates relevant variable when reply received or sets error() true
         // See Common/Protocol.hpp for explanation of functions
 
+        // Updates the song, status, position, volume, repeat, shuffle and song index at once
+        void sendGetState();
+
         // Playback commands
         void sendResume();
         void sendPause();
@@ -117,11 +124,13 @@ class Sysmodule {
         void sendGetSubQueueSize();
 
         void sendAddToSubQueue(const SongID);
+        void sendAddToSubQueue(const std::vector<SongID> &);
         void sendRemoveFromSubQueue(const size_t);
         void sendSkipSubQueueSongs(const size_t);
 
         void sendGetQueue();
         void sendGetQueueSize();
+        void sendGetQueueChanges();
         void sendSetQueue(const std::vector<SongID> &);
 
         void sendGetSongIdx();
@@ -145,7 +154,6 @@ class Sysmodule {
         void sendGetPlayingFrom();
         void sendSetPlayingFrom(const std::string &);
 
-        void sendReleaseDBLock();
         void sendReloadConfig();
 
         // Call to 'join' thread (stops main loop)
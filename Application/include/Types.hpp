@@ -67,6 +67,8 @@ namespace Metadata {
         bool favourite;             // Is the track favourited? (not used)
         std::string path;           // Path of associated file
         unsigned int modified;      // Timestamp file was last modified
+        double loudness;            // Integrated loudness in LUFS (0 if not analysed, 1 if analysis failed)
+        double peak;                // True peak in dBTP
     };
 
     struct PlaylistSong {
@@ -1,6 +1,7 @@
 #ifndef DATABASE_HPP
 #define DATABASE_HPP
 
+#include "LibrarySnapshot.hpp"
 #include "SQLite.hpp"
 #include "Types.hpp"
 #include <vector>
@@ -166,6 +167,12 @@ class Database {
         // Returns a vector of pairs (file path, modified time) for all songs
         // Empty if no songs or error occurred (bool set false on error, true on success)
         std::vector< std::pair<std::string, unsigned int> > getAllSongFileInfo(bool &);
+        // Returns the paths of all songs which haven't had their loudness analysed (sorted)
+        // Empty if no songs or error occurred (bool set false on error, true on success)
+        std::vector<std::string> getUnanalysedSongPaths(bool &);
+        // Returns the information stored in the library snapshot for all songs (album loudness isn't set)
+        // Empty if no songs or error occurred (bool set false on error, true on success)
+        std::vector<LibrarySnapshot::Song> getAllSnapshotSongs(bool &);
         // Returns the id of the artist with the given name (-1 if not found)
         ArtistID getArtistIDForName(const std::string &);
         // Return the id of a song's album
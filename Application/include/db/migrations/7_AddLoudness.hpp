@@ -0,0 +1,13 @@
+#ifndef MIGRATION_7_HPP
+#define MIGRATION_7_HPP
+
+#include "SQLite.hpp"
+#include <string>
+
+// Migration 7
+// Add loudness and true peak columns to Songs
+namespace Migration {
+    std::string migrateTo7(SQLite *);
+};
+
+#endif
\ No newline at end of file
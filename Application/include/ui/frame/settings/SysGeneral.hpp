@@ -8,6 +8,9 @@ namespace Frame::Settings {
     // Contains 'general' sysmodule settings
     class SysGeneral : public Frame {
         private:
+            // Helper to add a read-only statistic
+            void addStat(const std::string &, const std::string &);
+
             // Popuplist overlay
             Aether::PopupList * ovlList;
             // Helper to create popup
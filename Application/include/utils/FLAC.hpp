@@ -0,0 +1,19 @@
+#ifndef UTILS_FLAC_HPP
+#define UTILS_FLAC_HPP
+
+#include "Types.hpp"
+#include <vector>
+
+// Helper functions for reading FLAC files
+namespace Utils::FLAC {
+    // Reads the front cover (or other image) from the file's picture block
+    // Returns an empty vector if none found
+    std::vector<unsigned char> getArt(const std::string &);
+
+    // Reads Vorbis comments and duration of file and returns SongInfo
+    // ID is -1 on success (filled), -2 on success (song has no tags), -3 on failure
+    // Pass path of file
+    Metadata::Song getInfo(const std::string &);
+};
+
+#endif
\ No newline at end of file
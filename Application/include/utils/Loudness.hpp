@@ -0,0 +1,59 @@
+#ifndef UTILS_LOUDNESS_HPP
+#define UTILS_LOUDNESS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Helper functions for measuring loudness (ITU-R BS.1770 / EBU R128)
+namespace Utils::Loudness {
+    // Measures the integrated loudness and true peak of interleaved 16-bit audio.
+    // Samples are K-weighted and their power is gated over 400ms blocks (overlapping by 75%),
+    // while the true peak is found by oversampling by four.
+    class Meter {
+        private:
+            // Coefficients and state of one K-weighting stage for a single channel
+            struct Biquad {
+                double b0, b1, b2, a1, a2;
+                double z1, z2;
+            };
+
+            int channels;                       // Channels in the audio
+            size_t subLength;                   // Frames in a 100ms sub-block
+            std::vector<Biquad> shelf;          // High shelf stage for each channel
+            std::vector<Biquad> highpass;       // High pass stage for each channel
+
+            std::vector< std::vector<float> > weighted;     // Block of K-weighted samples for each channel
+            std::vector< std::vector<float> > history;      // Unweighted samples (prefixed by the end of the last block)
+            float coeffs[12][4];                // Interpolation filter (by tap, then phase)
+            bool oversample;                    // Whether the true peak is interpolated
+            float maxPeak;                      // Largest absolute sample (interpolated or not)
+
+            double subEnergy[4];                // Energy of the last four sub-blocks
+            size_t subCount;                    // Number of sub-blocks completed
+            size_t subFill;                     // Frames added to the current sub-block
+            std::vector<float> blocks;          // Mean square power of each 400ms block
+
+            // Run the kernel over a block of at most 1024 frames
+            void processBlock(const int16_t *, size_t);
+
+        public:
+            // Constructor takes the sample rate and number of channels
+            Meter(long, int);
+
+            // Add the given number of frames of interleaved samples
+            void addSamples(const int16_t *, size_t);
+
+            // Returns the integrated loudness so far (in LUFS, -70 if silent)
+            double loudness();
+            // Returns the true peak so far (in dBTP, no lower than -100)
+            double peak();
+    };
+
+    // Decodes the whole file and measures it, setting the integrated loudness (LUFS) and true peak (dBTP)
+    // Returns true on success, false if the file couldn't be decoded
+    bool analyse(const std::string &, double &, double &);
+};
+
+#endif
\ No newline at end of file
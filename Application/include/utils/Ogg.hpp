@@ -0,0 +1,23 @@
+#ifndef UTILS_OGG_HPP
+#define UTILS_OGG_HPP
+
+#include "Types.hpp"
+#include <vector>
+
+// Helper functions for reading Ogg Vorbis/Opus files
+namespace Utils::Ogg {
+    // Sets the matching field of the song from a single Vorbis comment ("KEY=value")
+    // (FLAC uses the same comments)
+    void parseComment(const std::string &, Metadata::Song &);
+
+    // Reads the front cover from a METADATA_BLOCK_PICTURE comment
+    // Returns an empty vector if none found
+    std::vector<unsigned char> getArt(const std::string &);
+
+    // Reads Vorbis comments and duration of file and returns SongInfo
+    // ID is -1 on success (filled), -2 on success (song has no tags), -3 on failure
+    // Pass path of file
+    Metadata::Song getInfo(const std::string &);
+};
+
+#endif
\ No newline at end of file
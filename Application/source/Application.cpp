@@ -1,4 +1,5 @@
 #include "Application.hpp"
+#include "LibrarySnapshot.hpp"
 #include "Paths.hpp"
 #include "ui/screen/Fullscreen.hpp"
 #include "ui/screen/Home.hpp"
@@ -137,14 +138,19 @@ namespace Main {
 
     void Application::lockDatabase() {
         this->database_->close();
-        this->sysmodule_->waitRequestDBLock();
         this->database_->openReadWrite();
     }
 
     void Application::unlockDatabase() {
         this->database_->close();
-        this->sysmodule_->sendReleaseDBLock();
         this->database_->openReadOnly();
+
+        // Replace the snapshot the sysmodule and overlay read the library from
+        bool ok;
+        std::vector<LibrarySnapshot::Song> songs = this->database_->getAllSnapshotSongs(ok);
+        if (!ok || !LibrarySnapshot(Path::Common::LibraryFile).write(songs)) {
+            Log::writeError("[DB] Couldn't write library snapshot");
+        }
     }
 
     bool Application::hasUpdate() {
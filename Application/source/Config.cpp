@@ -98,6 +98,9 @@ void Config::readConfig() {
     // Metadata::scan_on_launch
     this->scanOnLaunch_ = this->ini->getbool("Metadata", "scan_on_launch");
 
+    // Metadata::analyse_loudness
+    this->analyseLoudness_ = this->ini->getbool("Metadata", "analyse_loudness");
+
     // Search::max_playlists
     this->searchMaxPlaylists_ = this->ini->geti("Search", "max_playlists", -42069);
     if (this->searchMaxPlaylists_ < -1) {
@@ -348,6 +351,20 @@ bool Config::setScanOnLaunch(const bool b) {
     return ok;
 }
 
+bool Config::analyseLoudness() {
+    return this->analyseLoudness_;
+}
+
+bool Config::setAnalyseLoudness(const bool b) {
+    bool ok = this->ini->put("Metadata", "analyse_loudness", (b ? "Yes" : "No"));
+    if (!ok) {
+        Log::writeError("[CONFIG] Failed to set (Metadata) analyse_loudness");
+    } else {
+        this->analyseLoudness_ = b;
+    }
+    return ok;
+}
+
 int Config::searchMaxPlaylists() {
     return this->searchMaxPlaylists_;
 }
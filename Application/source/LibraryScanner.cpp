@@ -4,10 +4,14 @@
 #include "LibraryScanner.hpp"
 #include "Log.hpp"
 #include "Paths.hpp"
+#include <strings.h>
+#include "utils/FLAC.hpp"
 #include "utils/FS.hpp"
 #include "utils/Image.hpp"
+#include "utils/Loudness.hpp"
 #include "utils/MP3.hpp"
 #include "utils/NX.hpp"
+#include "utils/Ogg.hpp"
 #include "utils/Timer.hpp"
 #include "utils/Utils.hpp"
 
@@ -15,19 +19,75 @@
 // For my library 2 threads instead of one sped up scanning by ~5%
 #define SCAN_THREADS 2
 
+// Type of audio file based on it's extension
+enum class FileType {
+    FLAC,
+    MP3,
+    Ogg,
+    Unknown
+};
+
+// Returns the type of the file with the given extension (ignoring case)
+static FileType getFileType(const std::string & ext) {
+    if (strcasecmp(ext.c_str(), ".mp3") == 0) {
+        return FileType::MP3;
+    } else if (strcasecmp(ext.c_str(), ".flac") == 0) {
+        return FileType::FLAC;
+    } else if (strcasecmp(ext.c_str(), ".ogg") == 0 || strcasecmp(ext.c_str(), ".oga") == 0 || strcasecmp(ext.c_str(), ".opus") == 0) {
+        return FileType::Ogg;
+    }
+    return FileType::Unknown;
+}
+
+// Reads tags and data from the file using the reader for it's type
+static Metadata::Song getFileInfo(const std::string & path) {
+    switch (getFileType(Utils::Fs::getExtension(path))) {
+        case FileType::FLAC:
+            return Utils::FLAC::getInfo(path);
+
+        case FileType::Ogg:
+            return Utils::Ogg::getInfo(path);
+
+        default:
+            return Utils::MP3::getInfoFromID3(path);
+    }
+}
+
+// Measures the loudness of the song's file, marking it as failed if it couldn't be decoded
+// (this decodes the whole file, so it takes far longer than reading tags)
+static void analyseFile(Metadata::Song & meta) {
+    if (!Utils::Loudness::analyse(meta.path, meta.loudness, meta.peak)) {
+        meta.loudness = 1.0;
+        meta.peak = 0.0;
+    }
+}
+
 // Comparator for FilePairs returning true if the lhs is before the rhs
 // (this only comapres the path as we don't care about the modified time)
 bool LibraryScanner::FilePairComparator(const FilePair & lhs, const FilePair & rhs) {
     return lhs.path < rhs.path;
 }
 
-LibraryScanner::LibraryScanner(const SyncDatabase & db, const std::string & path) : database(db), searchPath(path) {
+LibraryScanner::LibraryScanner(const SyncDatabase & db, const std::string & path, const bool analyse) : database(db), searchPath(path), analyseLoudness(analyse) {
 
 }
 
 std::string LibraryScanner::parseAlbumArt(const std::string & path) {
     // First attempt to extract image from file
-    std::vector<unsigned char> image = Utils::MP3::getArtFromID3(path);
+    std::vector<unsigned char> image;
+    switch (getFileType(Utils::Fs::getExtension(path))) {
+        case FileType::FLAC:
+            image = Utils::FLAC::getArt(path);
+            break;
+
+        case FileType::Ogg:
+            image = Utils::Ogg::getArt(path);
+            break;
+
+        default:
+            image = Utils::MP3::getArtFromID3(path);
+            break;
+    }
     if (image.empty()) {
         return "";
     }
@@ -56,13 +116,16 @@ std::string LibraryScanner::parseAlbumArt(const std::string & path) {
 
 LibraryScanner::Status LibraryScanner::parseFileAdd(const FilePair & file) {
     // Read tags and data from file (thread-safe)
-    Metadata::Song meta = Utils::MP3::getInfoFromID3(file.path);
+    Metadata::Song meta = getFileInfo(file.path);
     if (meta.ID == -3) {
         Log::writeError("[SCAN] [ADD] Failed to parse file: " + file.path);
         return Status::ErrUnknown;
     }
     meta.path = file.path;
     meta.modified = file.modifiedTime;
+    if (this->analyseLoudness) {
+        analyseFile(meta);
+    }
 
     // Append to metadata vector
     std::scoped_lock<std::mutex> mtx(this->addMutex);
@@ -72,7 +135,7 @@ LibraryScanner::Status LibraryScanner::parseFileAdd(const FilePair & file) {
 
 LibraryScanner::Status LibraryScanner::parseFileUpdate(const FilePair & file) {
     // Read new tags and data from file (thread-safe)
-    Metadata::Song newMeta = Utils::MP3::getInfoFromID3(file.path);
+    Metadata::Song newMeta = getFileInfo(file.path);
     if (newMeta.ID == -3) {
         Log::writeError("[SCAN] [UPDATE] Failed to parse file: " + file.path);
         return Status::ErrUnknown;
@@ -94,6 +157,14 @@ LibraryScanner::Status LibraryScanner::parseFileUpdate(const FilePair & file) {
     meta.discNumber = newMeta.discNumber;
     meta.modified = file.modifiedTime;
 
+    // Previous measurements are stale if the file has changed, so either redo them or mark as not analysed
+    if (this->analyseLoudness) {
+        analyseFile(meta);
+    } else {
+        meta.loudness = 0.0;
+        meta.peak = 0.0;
+    }
+
     // Append to metadata vector
     std::scoped_lock<std::mutex> mtx(this->updateMutex);
     this->updateMeta.push_back(meta);
@@ -107,7 +178,7 @@ LibraryScanner::Status LibraryScanner::processFiles() {
 
     if (Utils::Fs::fileExists(this->searchPath)) {
         for (auto & entry: std::filesystem::recursive_directory_iterator(this->searchPath)) {
-            if (entry.path().extension() == ".mp3") {
+            if (getFileType(entry.path().extension()) != FileType::Unknown) {
                 // Why is this conversion so hard?
                 auto time = entry.last_write_time();
                 auto clock = std::chrono::file_clock::to_sys(time);
@@ -148,14 +219,25 @@ LibraryScanner::Status LibraryScanner::processFiles() {
         }
     });
 
+    // Songs which haven't been analysed are also updated when analysing loudness
+    std::vector<std::string> unanalysed;
+    if (this->analyseLoudness) {
+        unanalysed = this->database->getUnanalysedSongPaths(dbOK);
+        if (!dbOK) {
+            Log::writeError("[SCAN] Couldn't read unanalysed songs from database");
+            Utils::NX::setLowFsPriority(false);
+            return Status::ErrDatabase;
+        }
+    }
+
     // Use another thread to work out what files need updating
-    std::future<void> updateThread = std::async(std::launch::async, [this, &files, &dbFiles]() {
+    std::future<void> updateThread = std::async(std::launch::async, [this, &files, &dbFiles, &unanalysed]() {
         // Check if each file is in the database
-        // If it is and the DB's modified time is smaller, it needs to be updated
+        // If it is and the DB's modified time is smaller (or it needs analysing), it needs to be updated
         for (size_t i = 0; i < files.size(); i++) {
             std::vector<FilePair>::iterator it = std::lower_bound(dbFiles.begin(), dbFiles.end(), files[i], FilePairComparator);
             if (it != dbFiles.end() && (*it).path == files[i].path) {
-                if ((*it).modifiedTime < files[i].modifiedTime) {
+                if ((*it).modifiedTime < files[i].modifiedTime || std::binary_search(unanalysed.begin(), unanalysed.end(), files[i].path)) {
                     this->updateFiles.push_back(files[i]);
                 }
             }
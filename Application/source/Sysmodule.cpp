@@ -1,14 +1,49 @@
+#include <algorithm>
 #include "ipc/TriPlayer.hpp"
 #include <limits>
 #include "Log.hpp"
 #include "Sysmodule.hpp"
+#include <thread>
 #include "utils/NX.hpp"
 
 // Program ID of sysmodule
 #define PROGRAM_ID 0x4200000000000FFF
 
-// Number of seconds between updating state (automatically)
-#define UPDATE_DELAY 0.1
+// Number of milliseconds to wait for a change at a time (also how long exiting can take)
+#define WAIT_TIMEOUT 250
+
+// Converts the sysmodule's status to ours
+static PlaybackStatus toPlaybackStatus(const TriPlayer::Status s) {
+    switch (s) {
+        case TriPlayer::Status::Error:
+            return PlaybackStatus::Error;
+
+        case TriPlayer::Status::Playing:
+            return PlaybackStatus::Playing;
+
+        case TriPlayer::Status::Paused:
+            return PlaybackStatus::Paused;
+
+        case TriPlayer::Status::Stopped:
+            return PlaybackStatus::Stopped;
+    }
+    return PlaybackStatus::Error;
+}
+
+// Converts the sysmodule's repeat mode to ours
+static RepeatMode toRepeatMode(const TriPlayer::Repeat r) {
+    switch (r) {
+        case TriPlayer::Repeat::Off:
+            return RepeatMode::Off;
+
+        case TriPlayer::Repeat::One:
+            return RepeatMode::One;
+
+        case TriPlayer::Repeat::All:
+            return RepeatMode::All;
+    }
+    return RepeatMode::Off;
+}
 
 bool Sysmodule::addToIpcQueue(std::function<bool()> f) {
     if (this->error_ != Error::None) {
@@ -32,11 +67,11 @@ Sysmodule::Sysmodule() {
     this->exit_ = false;
     this->keepPosition = false;
     this->keepVolume = false;
-    this->lastUpdateTime = std::chrono::steady_clock::now();
     this->playingFrom_ = "";
     this->position_ = 0.0;
     this->queueChanged_ = false;
     this->queueSize_ = 0;
+    this->queueVersion_ = 0;
     this->repeatMode_ = RepeatMode::Off;
     this->shuffleMode_ = ShuffleMode::Off;
     this->songIdx_ = 0;
@@ -58,7 +93,7 @@ bool Sysmodule::launch() {
 }
 
 void Sysmodule::reconnect() {
-    std::scoped_lock<std::mutex> mtx(this->ipcMutex);
+    std::scoped_lock<std::mutex, std::mutex> mtx(this->ipcMutex, this->watchMutex);
 
     // Clean up IPC if connected
     if (this->connected_) {
@@ -133,7 +168,55 @@ void Sysmodule::setQueueLimit(int limit) {
     this->limit_ = limit;
 }
 
+void Sysmodule::watchForChanges() {
+    uint64_t sequence = 0;
+    while (!this->exit_) {
+        // Wait until connected
+        if (this->error_ != Error::None) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            sequence = 0;
+            continue;
+        }
+
+        // Get the first sequence number, then wait for changes after it
+        uint32_t changed = 0;
+        bool first = (sequence == 0);
+        std::unique_lock<std::mutex> mtx(this->watchMutex);
+        bool ok = TriPlayer::waitForChange(TriPlayer::Change::All, sequence, (first ? 0 : WAIT_TIMEOUT), changed, sequence);
+        mtx.unlock();
+        if (!ok) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            sequence = 0;
+            continue;
+        }
+
+        // Fetch everything after getting the first sequence number, in case it changed while not being watched
+        if (first) {
+            changed = TriPlayer::Change::All;
+        }
+
+        // Queue commands to fetch whatever changed (everything in the state is fetched at once, usually without IPC)
+        constexpr uint32_t inState = TriPlayer::Change::Song | TriPlayer::Change::Status | TriPlayer::Change::Position | TriPlayer::Change::Volume |
+                                     TriPlayer::Change::Repeat | TriPlayer::Change::Shuffle | TriPlayer::Change::QueueIdx;
+        if (changed & inState) {
+            this->sendGetState();
+        }
+        if (changed & TriPlayer::Change::Queue) {
+            this->sendGetQueueChanges();
+        }
+        if (changed & TriPlayer::Change::SubQueue) {
+            this->sendGetSubQueue();
+        }
+        if (changed & TriPlayer::Change::PlayingFrom) {
+            this->sendGetPlayingFrom();
+        }
+    }
+}
+
 void Sysmodule::process() {
+    // State is only fetched when it changes, which is waited for on another thread
+    std::thread watcher(&Sysmodule::watchForChanges, this);
+
     // Loop until we want to exit
     while (!this->exit_) {
         // Sleep if an error occurred (this way if the app asks it to reconnect it will continue communicating)
@@ -142,8 +225,7 @@ void Sysmodule::process() {
             continue;
         }
 
-        // First process commands on the write queue
-        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        // Process commands on the write queue
         std::unique_lock<std::mutex> mtx(this->ipcMutex);
         while (!this->ipcQueue.empty()) {
             // Get the first command on the queue
@@ -162,26 +244,10 @@ void Sysmodule::process() {
             }
         }
         mtx.unlock();
-
-        // Check if variables need to be updated
-        now = std::chrono::steady_clock::now();
-        if (std::chrono::duration_cast< std::chrono::duration<double> >(now - this->lastUpdateTime).count() > UPDATE_DELAY) {
-            this->sendGetPlayingFrom();
-            this->sendGetPosition();
-            this->sendGetQueueSize();
-            this->sendGetRepeat();
-            this->sendGetShuffle();
-            this->sendGetSong();
-            this->sendGetSongIdx();
-            this->sendGetSubQueueSize();
-            this->sendGetStatus();
-            this->sendGetVolume();
-            this->lastUpdateTime = now;
-
-        } else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(5));
-        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
     }
+
+    watcher.join();
 }
 
 SongID Sysmodule::currentSong() {
@@ -254,11 +320,11 @@ double Sysmodule::volume() {
     return this->volume_;
 }
 
-bool Sysmodule::waitRequestDBLock() {
+bool Sysmodule::waitReset() {
     std::atomic<bool> done = false;
 
     this->addToIpcQueue([&done]() -> bool {
-        bool b = TriPlayer::requestDatabaseLock();
+        bool b = TriPlayer::reset();
         done = true;
         return b;
     });
@@ -270,14 +336,18 @@ bool Sysmodule::waitRequestDBLock() {
             return false;
         }
     }
+
     return true;
 }
 
-bool Sysmodule::waitReset() {
+size_t Sysmodule::waitSongIdx() {
     std::atomic<bool> done = false;
 
-    this->addToIpcQueue([&done]() -> bool {
-        bool b = TriPlayer::reset();
+    // Query song idx
+    this->addToIpcQueue([this, &done]() -> bool {
+        size_t idx;
+        bool b = TriPlayer::getQueueIdx(idx);
+        this->songIdx_ = idx;
         done = true;
         return b;
     });
@@ -286,21 +356,22 @@ bool Sysmodule::waitReset() {
     while (!done) {
         std::this_thread::sleep_for(std::chrono::milliseconds(5));
         if (this->error_ != Error::None) {
-            return false;
+            return std::numeric_limits<size_t>::max();
+            break;
         }
     }
 
-    return true;
+    return this->songIdx_;
 }
 
-size_t Sysmodule::waitSongIdx() {
+bool Sysmodule::waitStats(TriPlayer::Stats & stats) {
     std::atomic<bool> done = false;
+    std::atomic<bool> success = false;
 
-    // Query song idx
-    this->addToIpcQueue([this, &done]() -> bool {
-        size_t idx;
-        bool b = TriPlayer::getQueueIdx(idx);
-        this->songIdx_ = idx;
+    // Query statistics
+    this->addToIpcQueue([&done, &stats, &success]() -> bool {
+        bool b = TriPlayer::getStats(stats);
+        success = b;
         done = true;
         return b;
     });
@@ -309,12 +380,11 @@ size_t Sysmodule::waitSongIdx() {
     while (!done) {
         std::this_thread::sleep_for(std::chrono::milliseconds(5));
         if (this->error_ != Error::None) {
-            return std::numeric_limits<size_t>::max();
-            break;
+            return false;
         }
     }
 
-    return this->songIdx_;
+    return success;
 }
 
 void Sysmodule::sendResume() {
@@ -341,6 +411,32 @@ void Sysmodule::sendNext() {
     });
 }
 
+void Sysmodule::sendGetState() {
+    this->addToIpcQueue([this]() -> bool {
+        TriPlayer::State s;
+        bool b = TriPlayer::getState(s);
+        if (b) {
+            this->currentSong_ = s.songID;
+            this->status_ = toPlaybackStatus(s.status);
+            if (!this->keepPosition) {
+                this->position_ = s.position;
+            }
+            if (!this->keepVolume) {
+                this->volume_ = s.volume;
+            }
+            this->repeatMode_ = toRepeatMode(s.repeat);
+            this->shuffleMode_ = (s.shuffle == TriPlayer::Shuffle::Off ? ShuffleMode::Off : ShuffleMode::On);
+
+            // Update sub-queue if the index changes (the queue is kept up to date by it's changes)
+            if (this->songIdx_ != s.queueIdx) {
+                this->sendGetSubQueue();
+            }
+            this->songIdx_ = s.queueIdx;
+        }
+        return b;
+    });
+}
+
 void Sysmodule::sendGetVolume() {
     this->addToIpcQueue([this]() -> bool {
         double vol;
@@ -386,6 +482,7 @@ void Sysmodule::sendGetSubQueue() {
         if (b) {
             std::scoped_lock<std::mutex> mtx(this->subQueueMutex);
             this->subQueue_ = ids;
+            this->subQueueSize_ = ids.size();
             this->subQueueChanged_ = true;
         }
         return b;
@@ -413,6 +510,15 @@ void Sysmodule::sendAddToSubQueue(const SongID id) {
     });
 }
 
+void Sysmodule::sendAddToSubQueue(const std::vector<SongID> & ids) {
+    // Add them all in one call
+    std::vector<TriPlayer::QueueEdit> edits;
+    edits.push_back({TriPlayer::QueueEditType::AppendSubQueue, static_cast<uint32_t>(ids.size()), 0, 0});
+    this->addToIpcQueue([edits, ids]() -> bool {
+        return TriPlayer::editQueue(edits, ids);
+    });
+}
+
 void Sysmodule::sendRemoveFromSubQueue(const size_t pos) {
     this->addToIpcQueue([pos]() -> bool {
         return TriPlayer::removeFromSubQueue(pos);
@@ -428,16 +534,67 @@ void Sysmodule::sendSkipSubQueueSongs(const size_t n) {
 void Sysmodule::sendGetQueue() {
     this->addToIpcQueue([this]() -> bool {
         std::vector<SongID> ids;
-        bool b = TriPlayer::getQueue(ids);
+        uint64_t version;
+        bool b = TriPlayer::getQueue(ids, version);
         if (b) {
             std::scoped_lock<std::mutex> mtx(this->queueMutex);
             this->queue_ = ids;
+            this->queueSize_ = ids.size();
+            this->queueVersion_ = version;
             this->queueChanged_ = true;
         }
         return b;
     });
 }
 
+void Sysmodule::sendGetQueueChanges() {
+    this->addToIpcQueue([this]() -> bool {
+        std::vector<TriPlayer::QueueChange> changes;
+        uint64_t version;
+        bool resync;
+        bool b = TriPlayer::getQueueChanges(this->queueVersion_, changes, version, resync);
+        if (!b) {
+            return false;
+        }
+
+        // Fetch the whole queue if the sysmodule no longer knows what changed
+        if (resync) {
+            this->sendGetQueue();
+            return true;
+        }
+
+        // Otherwise apply the changes to our copy
+        if (!changes.empty()) {
+            std::scoped_lock<std::mutex> mtx(this->queueMutex);
+            for (const TriPlayer::QueueChange & change : changes) {
+                switch (change.type) {
+                    case TriPlayer::QueueChangeType::Insert:
+                        this->queue_.insert(this->queue_.begin() + std::min<size_t>(change.pos, this->queue_.size()), change.id);
+                        break;
+
+                    case TriPlayer::QueueChangeType::Remove:
+                        if (change.pos < this->queue_.size()) {
+                            this->queue_.erase(this->queue_.begin() + change.pos);
+                        }
+                        break;
+
+                    case TriPlayer::QueueChangeType::Move:
+                        if (change.pos < this->queue_.size() && change.to < this->queue_.size()) {
+                            SongID id = this->queue_[change.pos];
+                            this->queue_.erase(this->queue_.begin() + change.pos);
+                            this->queue_.insert(this->queue_.begin() + change.to, id);
+                        }
+                        break;
+                }
+            }
+            this->queueSize_ = this->queue_.size();
+            this->queueChanged_ = true;
+        }
+        this->queueVersion_ = version;
+        return true;
+    });
+}
+
 void Sysmodule::sendGetQueueSize() {
     this->addToIpcQueue([this]() -> bool {
         size_t size;
@@ -469,9 +626,8 @@ void Sysmodule::sendGetSongIdx() {
         size_t idx;
         bool b = TriPlayer::getQueueIdx(idx);
         if (b) {
-            // Update queues if size changes
+            // Update sub-queue if the index changes (the queue is kept up to date by it's changes)
             if (this->songIdx_ != idx) {
-                this->sendGetQueue();
                 this->sendGetSubQueue();
             }
             this->songIdx_ = idx;
@@ -501,19 +657,7 @@ void Sysmodule::sendGetRepeat() {
         TriPlayer::Repeat r;
         bool b = TriPlayer::getRepeatMode(r);
         if (b) {
-            switch (r) {
-                case TriPlayer::Repeat::Off:
-                    this->repeatMode_ = RepeatMode::Off;
-                    break;
-
-                case TriPlayer::Repeat::One:
-                    this->repeatMode_ = RepeatMode::One;
-                    break;
-
-                case TriPlayer::Repeat::All:
-                    this->repeatMode_ = RepeatMode::All;
-                    break;
-            }
+            this->repeatMode_ = toRepeatMode(r);
         }
         return b;
     });
@@ -559,8 +703,8 @@ void Sysmodule::sendSetShuffle(const ShuffleMode m) {
         TriPlayer::Shuffle s = (m == ShuffleMode::Off ? TriPlayer::Shuffle::Off : TriPlayer::Shuffle::On);
         bool b = TriPlayer::setShuffleMode(s);
         if (b) {
-            // Get queue on change
-            this->sendGetQueue();
+            // Get queue on change (shuffling reorders everything, so this fetches it all)
+            this->sendGetQueueChanges();
             this->shuffleMode_ = m;
         }
         return b;
@@ -583,23 +727,7 @@ void Sysmodule::sendGetStatus() {
         TriPlayer::Status s;
         bool b = TriPlayer::getStatus(s);
         if (b) {
-            switch (s) {
-                case TriPlayer::Status::Error:
-                    this->status_ = PlaybackStatus::Error;
-                    break;
-
-                case TriPlayer::Status::Playing:
-                    this->status_ = PlaybackStatus::Playing;
-                    break;
-
-                case TriPlayer::Status::Paused:
-                    this->status_ = PlaybackStatus::Paused;
-                    break;
-
-                case TriPlayer::Status::Stopped:
-                    this->status_ = PlaybackStatus::Stopped;
-                    break;
-            }
+            this->status_ = toPlaybackStatus(s);
         }
         return b;
     });
@@ -649,12 +777,6 @@ void Sysmodule::sendSetPlayingFrom(const std::string & str) {
     });
 }
 
-void Sysmodule::sendReleaseDBLock() {
-    this->addToIpcQueue([]() -> bool {
-        return TriPlayer::releaseDatabaseLock();
-    });
-}
-
 void Sysmodule::sendReloadConfig() {
     this->addToIpcQueue([]() -> bool {
         return TriPlayer::reloadConfig();
@@ -10,7 +10,7 @@
 #include "utils/Utils.hpp"
 
 // Version of the database (database begins with zero from 'template', so this started at 1)
-#define DB_VERSION 6
+#define DB_VERSION 7
 // Maximum number of spellfixed words to allow per word (i.e. pick the top x words)
 #define SPELLFIX_LIMIT 6
 // Location of template file
@@ -159,6 +159,14 @@ bool Database::migrate() {
                     break;
                 }
                 Log::writeSuccess("[DB] Migrated to version 6");
+
+            case 6:
+                err = Migration::migrateTo7(this->db);
+                if (!err.empty()) {
+                    err = "Migration 7: " + err;
+                    break;
+                }
+                Log::writeSuccess("[DB] Migrated to version 7");
         }
     }
 
@@ -1049,7 +1057,7 @@ bool Database::addSong(Metadata::Song m) {
     }
 
     // Finally add song
-    ok = this->db->prepareQuery("INSERT INTO Songs (path, modified, artist_id, album_id, title, duration, track, disc) VALUES (?, ?, (SELECT id FROM Artists WHERE name = ?), (SELECT id FROM Albums WHERE name = ?), ?, ?, ?, ?);");
+    ok = this->db->prepareQuery("INSERT INTO Songs (path, modified, artist_id, album_id, title, duration, track, disc, loudness, peak) VALUES (?, ?, (SELECT id FROM Artists WHERE name = ?), (SELECT id FROM Albums WHERE name = ?), ?, ?, ?, ?, ?, ?);");
     ok = keepFalse(ok, this->db->bindString(0, m.path));
     ok = keepFalse(ok, this->db->bindInt(1, m.modified));
     ok = keepFalse(ok, this->db->bindString(2, m.artist));
@@ -1058,6 +1066,8 @@ bool Database::addSong(Metadata::Song m) {
     ok = keepFalse(ok, this->db->bindInt(5, m.duration));
     ok = keepFalse(ok, this->db->bindInt(6, m.trackNumber));
     ok = keepFalse(ok, this->db->bindInt(7, m.discNumber));
+    ok = keepFalse(ok, this->db->bindDouble(8, m.loudness));
+    ok = keepFalse(ok, this->db->bindDouble(9, m.peak));
     if (!ok) {
         this->setErrorMsg("[addSong] An error occurred while preparing the statement");
         return false;
@@ -1095,7 +1105,7 @@ bool Database::updateSong(Metadata::Song m) {
     }
 
     // Now update relevant fields
-    ok = this->db->prepareQuery("UPDATE Songs SET modified = ?, artist_id = (SELECT id FROM Artists WHERE name = ?), album_id = (SELECT id FROM Albums WHERE name = ?), title = ?, track = ?, disc = ?, duration = ?, plays = ?, favourite = ?, path = ? WHERE id = ?;");
+    ok = this->db->prepareQuery("UPDATE Songs SET modified = ?, artist_id = (SELECT id FROM Artists WHERE name = ?), album_id = (SELECT id FROM Albums WHERE name = ?), title = ?, track = ?, disc = ?, duration = ?, plays = ?, favourite = ?, path = ?, loudness = ?, peak = ? WHERE id = ?;");
     ok = keepFalse(ok, this->db->bindInt(0, m.modified));
     ok = keepFalse(ok, this->db->bindString(1, m.artist));
     ok = keepFalse(ok, this->db->bindString(2, m.album));
@@ -1106,7 +1116,9 @@ bool Database::updateSong(Metadata::Song m) {
     ok = keepFalse(ok, this->db->bindInt(7, m.plays));
     ok = keepFalse(ok, this->db->bindBool(8, m.favourite));
     ok = keepFalse(ok, this->db->bindString(9, m.path));
-    ok = keepFalse(ok, this->db->bindInt(10, m.ID));
+    ok = keepFalse(ok, this->db->bindDouble(10, m.loudness));
+    ok = keepFalse(ok, this->db->bindDouble(11, m.peak));
+    ok = keepFalse(ok, this->db->bindInt(12, m.ID));
     if (!ok) {
         this->setErrorMsg("[updateSong] An error occurred while preparing the statement");
         return false;
@@ -1345,7 +1357,7 @@ Metadata::Song Database::getSongMetadataForID(SongID id) {
     }
 
     // Query for song info
-    bool ok = this->db->prepareQuery("SELECT Songs.ID, Songs.title, Artists.name, Albums.name, Songs.track, Songs.disc, Songs.duration, Songs.plays, Songs.favourite, Songs.path, Songs.modified FROM Songs JOIN Albums ON Albums.id = Songs.album_id JOIN Artists ON Artists.id = Songs.artist_id WHERE Songs.ID = ?;");
+    bool ok = this->db->prepareQuery("SELECT Songs.ID, Songs.title, Artists.name, Albums.name, Songs.track, Songs.disc, Songs.duration, Songs.plays, Songs.favourite, Songs.path, Songs.modified, Songs.loudness, Songs.peak FROM Songs JOIN Albums ON Albums.id = Songs.album_id JOIN Artists ON Artists.id = Songs.artist_id WHERE Songs.ID = ?;");
     ok = keepFalse(ok, this->db->bindInt(0, id));
     ok = keepFalse(ok, this->db->executeQuery());
     if (!ok) {
@@ -1369,6 +1381,8 @@ Metadata::Song Database::getSongMetadataForID(SongID id) {
     ok = keepFalse(ok, this->db->getString(9, m.path));
     ok = keepFalse(ok, this->db->getInt(10, tmp));
     m.modified = tmp;
+    ok = keepFalse(ok, this->db->getDouble(11, m.loudness));
+    ok = keepFalse(ok, this->db->getDouble(12, m.peak));
 
     if (!ok) {
         this->setErrorMsg("[getSongInfoForID] An error occurred reading from the query results");
@@ -1874,6 +1888,86 @@ std::vector< std::pair<std::string, unsigned int> > Database::getAllSongFileInfo
     return v;
 }
 
+std::vector<std::string> Database::getUnanalysedSongPaths(bool & success) {
+    std::vector<std::string> v;
+
+    // Check we can read
+    if (this->db->connectionType() == SQLite::Connection::None) {
+        this->setErrorMsg("[getUnanalysedSongPaths] No open connection");
+        success = false;
+        return v;
+    }
+
+    // Loudness is left at zero until the song is analysed
+    bool ok = this->db->prepareAndExecuteQuery("SELECT path FROM Songs WHERE loudness = 0 ORDER BY path;");
+    if (!ok) {
+        this->setErrorMsg("[getUnanalysedSongPaths] Unable to query paths of unanalysed songs");
+        success = false;
+        return v;
+    }
+    while (ok && this->db->hasRow()) {
+        std::string path;
+        ok = this->db->getString(0, path);
+        if (ok) {
+            v.push_back(path);
+        }
+        ok = keepFalse(ok, this->db->nextRow());
+    }
+
+    success = true;
+    v.shrink_to_fit();
+    return v;
+}
+
+std::vector<LibrarySnapshot::Song> Database::getAllSnapshotSongs(bool & success) {
+    std::vector<LibrarySnapshot::Song> v;
+
+    // Check we can read
+    if (this->db->connectionType() == SQLite::Connection::None) {
+        this->setErrorMsg("[getAllSnapshotSongs] No open connection");
+        success = false;
+        return v;
+    }
+
+    // Create a struct for each song (loudness is negative once analysed)
+    bool ok = this->db->prepareAndExecuteQuery("SELECT Songs.id, Songs.album_id, Songs.path, Songs.title, Artists.name, Albums.name, Albums.image_path, Songs.duration, Songs.loudness, Songs.peak FROM Songs JOIN Albums ON Albums.id = Songs.album_id JOIN Artists ON Artists.id = Songs.artist_id;");
+    if (!ok) {
+        this->setErrorMsg("[getAllSnapshotSongs] Unable to query information for all songs");
+        success = false;
+        return v;
+    }
+    while (ok && this->db->hasRow()) {
+        LibrarySnapshot::Song s;
+        int duration;
+        double loudness, peak;
+        ok = this->db->getInt(0, s.id);
+        ok = keepFalse(ok, this->db->getInt(1, s.albumID));
+        ok = keepFalse(ok, this->db->getString(2, s.path));
+        ok = keepFalse(ok, this->db->getString(3, s.title));
+        ok = keepFalse(ok, this->db->getString(4, s.artist));
+        ok = keepFalse(ok, this->db->getString(5, s.album));
+        ok = keepFalse(ok, this->db->getString(6, s.imagePath));
+        ok = keepFalse(ok, this->db->getInt(7, duration));
+        ok = keepFalse(ok, this->db->getDouble(8, loudness));
+        ok = keepFalse(ok, this->db->getDouble(9, peak));
+        if (ok) {
+            s.duration = duration;
+            s.analysed = (loudness < 0);
+            s.loudness = loudness;
+            s.peak = peak;
+            s.albumAnalysed = false;
+            s.albumLoudness = 0.0f;
+            s.albumPeak = 0.0f;
+            v.push_back(s);
+        }
+        ok = keepFalse(ok, this->db->nextRow());
+    }
+
+    success = true;
+    v.shrink_to_fit();
+    return v;
+}
+
 ArtistID Database::getArtistIDForName(const std::string & name) {
     int aID = -1;
 
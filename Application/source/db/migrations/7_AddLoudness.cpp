@@ -0,0 +1,25 @@
+#include "db/migrations/7_AddLoudness.hpp"
+
+namespace Migration {
+    std::string migrateTo7(SQLite * db) {
+        // Add integrated loudness in LUFS to Songs (0 indicates it hasn't been analysed, and 1 that it couldn't be)
+        bool ok = db->prepareAndExecuteQuery("ALTER TABLE Songs ADD COLUMN loudness REAL NOT NULL DEFAULT 0;");
+        if (!ok) {
+            return "Unable to add loudness column to Songs";
+        }
+
+        // Add true peak in dBTP to Songs (only valid if loudness is)
+        ok = db->prepareAndExecuteQuery("ALTER TABLE Songs ADD COLUMN peak REAL NOT NULL DEFAULT 0;");
+        if (!ok) {
+            return "Unable to add peak column to Songs";
+        }
+
+        // Bump up version number (only done if everything passes)
+        ok = db->prepareAndExecuteQuery("UPDATE Variables SET value = 7 WHERE name = 'version';");
+        if (!ok) {
+            return "Unable to set version to 7";
+        }
+
+        return "";
+    }
+};
\ No newline at end of file
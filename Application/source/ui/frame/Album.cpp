@@ -194,9 +194,11 @@ namespace Frame {
             b->setTextColour(this->app->theme()->FG());
             b->setCallback([this]() {
                 std::vector<Metadata::Song> v = this->app->database()->getSongMetadataForAlbum(this->metadata.ID);
+                std::vector<SongID> ids;
                 for (size_t i = 0; i < v.size(); i++) {
-                    this->app->sysmodule()->sendAddToSubQueue(v[i].ID);
+                    ids.push_back(v[i].ID);
                 }
+                this->app->sysmodule()->sendAddToSubQueue(ids);
                 this->albumMenu->close();
             });
             this->albumMenu->addButton(b);
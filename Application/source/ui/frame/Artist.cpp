@@ -131,9 +131,11 @@ namespace Frame {
             b->setTextColour(this->app->theme()->FG());
             b->setCallback([this, id]() {
                 std::vector<Metadata::Song> v = this->app->database()->getSongMetadataForArtist(id);
+                std::vector<SongID> ids;
                 for (size_t i = 0; i < v.size(); i++) {
-                    this->app->sysmodule()->sendAddToSubQueue(v[i].ID);
+                    ids.push_back(v[i].ID);
                 }
+                this->app->sysmodule()->sendAddToSubQueue(ids);
                 this->artistMenu->close();
             });
             this->artistMenu->addButton(b);
@@ -224,9 +226,11 @@ namespace Frame {
         b->setTextColour(this->app->theme()->FG());
         b->setCallback([this, id]() {
             std::vector<Metadata::Song> v = this->app->database()->getSongMetadataForAlbum(id);
+            std::vector<SongID> ids;
             for (size_t i = 0; i < v.size(); i++) {
-                this->app->sysmodule()->sendAddToSubQueue(v[i].ID);
+                ids.push_back(v[i].ID);
             }
+            this->app->sysmodule()->sendAddToSubQueue(ids);
             this->albumMenu->close();
         });
         this->albumMenu->addButton(b);
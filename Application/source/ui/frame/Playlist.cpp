@@ -227,9 +227,11 @@ namespace Frame {
             b->setText("Add to Queue");
             b->setTextColour(this->app->theme()->FG());
             b->setCallback([this]() {
+                std::vector<SongID> ids;
                 for (size_t i = 0; i < this->songs.size(); i++) {
-                    this->app->sysmodule()->sendAddToSubQueue(this->songs[i].song.ID);
+                    ids.push_back(this->songs[i].song.ID);
                 }
+                this->app->sysmodule()->sendAddToSubQueue(ids);
                 this->playlistMenu->close();
             });
             this->playlistMenu->addButton(b);
@@ -249,9 +249,11 @@ namespace Frame {
         b->setTextColour(this->app->theme()->FG());
         b->setCallback([this, pos]() {
             std::vector<Metadata::PlaylistSong> v = this->app->database()->getSongMetadataForPlaylist(this->items[pos].meta.ID, Database::SortBy::TitleAsc);
+            std::vector<SongID> ids;
             for (size_t i = 0; i < v.size(); i++) {
-                this->app->sysmodule()->sendAddToSubQueue(v[i].song.ID);
+                ids.push_back(v[i].song.ID);
             }
+            this->app->sysmodule()->sendAddToSubQueue(ids);
             this->menu->close();
         });
         this->menu->addButton(b);
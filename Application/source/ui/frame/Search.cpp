@@ -355,9 +355,11 @@ namespace Frame {
         b->setTextColour(this->app->theme()->FG());
         b->setCallback([this, m]() {
             std::vector<Metadata::PlaylistSong> v = this->app->database()->getSongMetadataForPlaylist(m.ID, Database::SortBy::TitleAsc);
+            std::vector<SongID> ids;
             for (size_t i = 0; i < v.size(); i++) {
-                this->app->sysmodule()->sendAddToSubQueue(v[i].song.ID);
+                ids.push_back(v[i].song.ID);
             }
+            this->app->sysmodule()->sendAddToSubQueue(ids);
             this->menu->close();
         });
         this->menu->addButton(b);
@@ -436,9 +438,11 @@ namespace Frame {
         b->setTextColour(this->app->theme()->FG());
         b->setCallback([this, id]() {
             std::vector<Metadata::Song> v = this->app->database()->getSongMetadataForArtist(id);
+            std::vector<SongID> ids;
             for (size_t i = 0; i < v.size(); i++) {
-                this->app->sysmodule()->sendAddToSubQueue(v[i].ID);
+                ids.push_back(v[i].ID);
             }
+            this->app->sysmodule()->sendAddToSubQueue(ids);
             this->menu->close();
         });
         this->menu->addButton(b);
@@ -514,9 +518,11 @@ namespace Frame {
         b->setTextColour(this->app->theme()->FG());
         b->setCallback([this, id]() {
             std::vector<Metadata::Song> v = this->app->database()->getSongMetadataForAlbum(id);
+            std::vector<SongID> ids;
             for (size_t i = 0; i < v.size(); i++) {
-                this->app->sysmodule()->sendAddToSubQueue(v[i].ID);
+                ids.push_back(v[i].ID);
             }
+            this->app->sysmodule()->sendAddToSubQueue(ids);
             this->menu->close();
         });
         this->menu->addButton(b);
@@ -19,6 +19,14 @@ namespace Frame::Settings {
         });
         this->addComment("This should remain enabled unless you have a really large library that doesn't change and the initial scan takes too long. No support will be given if this option is disabled, as an out-of-date database will cause bad things to happen.");
 
+        // Metadata::analyse_loudness
+        this->addToggle("Analyse Loudness", [cfg]() -> bool {
+            return cfg->analyseLoudness();
+        }, [cfg](bool b) {
+            cfg->setAnalyseLoudness(b);
+        });
+        this->addComment("Measure the loudness of each song when scanning, allowing the sysmodule to play them at a consistent volume. Every song is decoded once (only new or changed songs after that), so the next scan will take much longer.");
+
         // Scan now
         this->addButton("Scan Now", [this]() {
             this->app->popScreen();
@@ -102,6 +102,22 @@ namespace Frame::Settings {
         this->addComment("This only adjusts the sysmodule's log level, not the application's. Each level will log it and the levels below (e.g. Warning will log both Warning and Error messages). Info should only be used for debugging purposes, as it logs a LOT of information and slows down playback.");
         this->list->addElement(new Aether::ListSeparator());
 
+        // Playback statistics (read once when the frame is opened)
+        TriPlayer::Stats stats;
+        if (this->app->sysmodule()->waitStats(stats)) {
+            this->addStat("Output Buffers", std::to_string(stats.bufferCount) + " x " + std::to_string(stats.bufferSize/1024) + " kB");
+            this->addStat("Buffer Underruns", std::to_string(stats.underruns));
+            this->addStat("Lowest Queued Audio", (stats.minQueuedSamples < 0 ? "N/A" : std::to_string(stats.minQueuedSamples) + " samples"));
+            if (stats.decodeSamples > 0) {
+                this->addStat("Decode Time (Median)", std::to_string(stats.decodeP50) + " µs");
+                this->addStat("Decode Time (95%)", std::to_string(stats.decodeP95) + " µs");
+                this->addStat("Decode Time (99%)", std::to_string(stats.decodeP99) + " µs");
+                this->addStat("Decode Time (Max)", std::to_string(stats.decodeMax) + " µs");
+            }
+            this->addComment("Statistics since the sysmodule was started. An underrun occurs when audio is decoded too slowly to keep up, which can be avoided by increasing 'buffer_count' or 'buffer_size' in the sysmodule's config (takes effect after a restart). Decode times are measured per buffer over the last " + std::to_string(stats.decodeSamples) + " buffers.");
+            this->list->addElement(new Aether::ListSeparator());
+        }
+
         // Restart sysmodule
         this->addButton("Restart Sysmodule", [this]() {
             if (this->app->sysmodule()->terminate()) {
@@ -144,6 +160,12 @@ namespace Frame::Settings {
         this->ovlList->setTextColour(this->app->theme()->FG());
     }
 
+    void SysGeneral::addStat(const std::string & name, const std::string & value) {
+        Aether::ListOption * opt = new Aether::ListOption(name, value, nullptr);
+        opt->setColours(this->app->theme()->muted2(), this->app->theme()->FG(), this->app->theme()->accent());
+        this->list->addElement(opt);
+    }
+
     void SysGeneral::showLogLevelList(Aether::ListOption * opt) {
         this->ovlList->setTitleLabel("Logging Level");
         this->ovlList->removeEntries();
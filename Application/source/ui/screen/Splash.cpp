@@ -37,7 +37,7 @@ namespace Screen {
 
         // First create the LibraryScanner object
         this->app->database()->openReadOnly();
-        LibraryScanner scanner = LibraryScanner(this->app->database(), "/music");
+        LibraryScanner scanner = LibraryScanner(this->app->database(), "/music", this->app->config()->analyseLoudness());
 
         // Get files on SD card and analyze what actions need to be taken
         this->currentStage = ScanStage::Files;
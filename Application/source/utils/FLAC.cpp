@@ -0,0 +1,74 @@
+#include <cmath>
+#include <filesystem>
+#include <FLAC/metadata.h>
+#include "Log.hpp"
+#include "utils/FLAC.hpp"
+#include "utils/Ogg.hpp"
+
+namespace Utils::FLAC {
+    std::vector<unsigned char> getArt(const std::string & path) {
+        std::vector<unsigned char> v;
+
+        // Prefer the front cover, but take any image otherwise
+        FLAC__StreamMetadata * pic = nullptr;
+        if (!FLAC__metadata_get_picture(path.c_str(), &pic, FLAC__STREAM_METADATA_PICTURE_TYPE_FRONT_COVER, nullptr, nullptr, -1, -1, -1, -1)) {
+            if (!FLAC__metadata_get_picture(path.c_str(), &pic, static_cast<FLAC__StreamMetadata_Picture_Type>(-1), nullptr, nullptr, -1, -1, -1, -1)) {
+                Log::writeInfo("[FLAC] No suitable art found in: " + path);
+                return v;
+            }
+        }
+
+        std::string mType = pic->data.picture.mime_type;
+        if (mType == "image/jpg" || mType == "image/jpeg" || mType == "image/png") {
+            v.assign(pic->data.picture.data, pic->data.picture.data + pic->data.picture.data_length);
+        } else {
+            Log::writeInfo("[FLAC] No suitable art found in: " + path);
+        }
+        FLAC__metadata_object_delete(pic);
+
+        return v;
+    }
+
+    Metadata::Song getInfo(const std::string & path) {
+        // Default info to return
+        Metadata::Song m;
+        m.ID = -3;
+        m.title = std::filesystem::path(path).stem();      // Title defaults to file name
+        m.artist = "Unknown Artist";                       // Artist defaults to unknown
+        m.album = "Unknown Album";                         // Same for album
+        m.trackNumber = 0;                                 // Initially 0 to indicate not set
+        m.discNumber = 0;                                  // Initially 0 to indicate not set
+        m.duration = 0;
+        m.loudness = 0.0;                                  // Not analysed while reading tags
+        m.peak = 0.0;
+
+        // Duration comes from the stream info (which every file has)
+        FLAC__StreamMetadata info;
+        if (!FLAC__metadata_get_streaminfo(path.c_str(), &info)) {
+            Log::writeError("[FLAC] Unable to open file: " + path);
+            return m;
+        }
+        if (info.data.stream_info.sample_rate > 0) {
+            m.duration = std::round(info.data.stream_info.total_samples/static_cast<double>(info.data.stream_info.sample_rate));
+        }
+
+        // Tags are stored as Vorbis comments
+        FLAC__StreamMetadata * tags = nullptr;
+        if (FLAC__metadata_get_tags(path.c_str(), &tags)) {
+            m.ID = (tags->data.vorbis_comment.num_comments > 0 ? -1 : -2);
+            for (FLAC__uint32 i = 0; i < tags->data.vorbis_comment.num_comments; i++) {
+                FLAC__StreamMetadata_VorbisComment_Entry & entry = tags->data.vorbis_comment.comments[i];
+                Utils::Ogg::parseComment(std::string(reinterpret_cast<char *>(entry.entry), entry.length), m);
+            }
+            FLAC__metadata_object_delete(tags);
+
+        } else {
+            m.ID = -2;
+        }
+
+        if (m.ID == -2) {
+            Log::writeWarning("[FLAC] No tags were found in: " + path);
+        }
+        return m;
+    }
+};
\ No newline at end of file
@@ -0,0 +1,457 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <FLAC/stream_decoder.h>
+#include <filesystem>
+#include "Log.hpp"
+#include <mpg123.h>
+#include <opusfile.h>
+#include <strings.h>
+#include "utils/Loudness.hpp"
+#include <vorbis/vorbisfile.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+constexpr size_t blockFrames = 1024;        // Number of frames run through the kernel at once
+constexpr size_t peakTaps = 12;             // Taps in each phase of the true peak interpolation filter
+constexpr double absoluteGate = -70.0;      // Blocks quieter than this (in LUFS) are always ignored
+constexpr double relativeGate = -10.0;      // Blocks this far below the ungated loudness (in LU) are ignored
+
+namespace Utils::Loudness {
+    // Converts mean square power to loudness and back
+    static double powerToLUFS(const double power) {
+        return -0.691 + 10.0 * std::log10(power);
+    }
+
+    static double LUFSToPower(const double lufs) {
+        return std::pow(10.0, (lufs + 0.691)/10.0);
+    }
+
+    // Returns the sum of the squares of the given samples
+    static double sumSquares(const float * in, const size_t samples) {
+        size_t i = 0;
+        float sum = 0.0f;
+#if defined(__ARM_NEON)
+        float32x4_t vSum = vdupq_n_f32(0.0f);
+        for (; i + 4 <= samples; i += 4) {
+            float32x4_t v = vld1q_f32(in + i);
+            vSum = vmlaq_f32(vSum, v, v);
+        }
+        sum = vaddvq_f32(vSum);
+#elif defined(__SSE2__)
+        __m128 vSum = _mm_setzero_ps();
+        for (; i + 4 <= samples; i += 4) {
+            __m128 v = _mm_loadu_ps(in + i);
+            vSum = _mm_add_ps(vSum, _mm_mul_ps(v, v));
+        }
+        float tmp[4];
+        _mm_storeu_ps(tmp, vSum);
+        sum = tmp[0] + tmp[1] + tmp[2] + tmp[3];
+#endif
+        for (; i < samples; i++) {
+            sum += in[i] * in[i];
+        }
+        return sum;
+    }
+
+    // Returns the largest absolute value when the given samples are oversampled by four
+    // (the previous peakTaps - 1 samples must be readable before the pointer)
+    static float interpolatedPeak(const float * in, const size_t samples, const float (* coeffs)[4]) {
+        size_t i = 0;
+        float peak = 0.0f;
+#if defined(__ARM_NEON)
+        float32x4_t vCoeffs[peakTaps];
+        for (size_t k = 0; k < peakTaps; k++) {
+            vCoeffs[k] = vld1q_f32(coeffs[k]);
+        }
+        float32x4_t vPeak = vdupq_n_f32(0.0f);
+        for (; i < samples; i++) {
+            float32x4_t acc = vmulq_n_f32(vCoeffs[0], in[i]);
+            for (size_t k = 1; k < peakTaps; k++) {
+                acc = vmlaq_n_f32(acc, vCoeffs[k], in[i - k]);
+            }
+            vPeak = vmaxq_f32(vPeak, vabsq_f32(acc));
+        }
+        peak = vmaxvq_f32(vPeak);
+#elif defined(__SSE2__)
+        __m128 vCoeffs[peakTaps];
+        for (size_t k = 0; k < peakTaps; k++) {
+            vCoeffs[k] = _mm_loadu_ps(coeffs[k]);
+        }
+        const __m128 vSign = _mm_set1_ps(-0.0f);
+        __m128 vPeak = _mm_setzero_ps();
+        for (; i < samples; i++) {
+            __m128 acc = _mm_mul_ps(vCoeffs[0], _mm_set1_ps(in[i]));
+            for (size_t k = 1; k < peakTaps; k++) {
+                acc = _mm_add_ps(acc, _mm_mul_ps(vCoeffs[k], _mm_set1_ps(in[i - k])));
+            }
+            vPeak = _mm_max_ps(vPeak, _mm_andnot_ps(vSign, acc));
+        }
+        float tmp[4];
+        _mm_storeu_ps(tmp, vPeak);
+        peak = std::max(std::max(tmp[0], tmp[1]), std::max(tmp[2], tmp[3]));
+#endif
+        for (; i < samples; i++) {
+            for (size_t p = 0; p < 4; p++) {
+                float acc = 0.0f;
+                for (size_t k = 0; k < peakTaps; k++) {
+                    acc += coeffs[k][p] * in[i - k];
+                }
+                peak = std::max(peak, std::fabs(acc));
+            }
+        }
+        return peak;
+    }
+
+    Meter::Meter(long rate, int channels) {
+        this->channels = std::max(channels, 1);
+        this->subLength = std::max(rate/10, 1L);
+
+        // K-weighting is a high shelf (modelling the head) followed by a high pass, with the
+        // coefficients derived for the sample rate (matching those given in BS.1770 at 48kHz)
+        Biquad shelf;
+        double K = std::tan(M_PI * 1681.974450955533/rate);
+        double Q = 0.7071752369554196;
+        double Vh = std::pow(10.0, 3.999843853973347/20.0);
+        double Vb = std::pow(Vh, 0.4996667741545416);
+        double a0 = 1.0 + K/Q + K*K;
+        shelf.b0 = (Vh + Vb*K/Q + K*K)/a0;
+        shelf.b1 = 2.0*(K*K - Vh)/a0;
+        shelf.b2 = (Vh - Vb*K/Q + K*K)/a0;
+        shelf.a1 = 2.0*(K*K - 1.0)/a0;
+        shelf.a2 = (1.0 - K/Q + K*K)/a0;
+        shelf.z1 = shelf.z2 = 0.0;
+
+        Biquad highpass;
+        K = std::tan(M_PI * 38.13547087602444/rate);
+        Q = 0.5003270373238773;
+        a0 = 1.0 + K/Q + K*K;
+        highpass.b0 = 1.0;
+        highpass.b1 = -2.0;
+        highpass.b2 = 1.0;
+        highpass.a1 = 2.0*(K*K - 1.0)/a0;
+        highpass.a2 = (1.0 - K/Q + K*K)/a0;
+        highpass.z1 = highpass.z2 = 0.0;
+
+        this->shelf.assign(this->channels, shelf);
+        this->highpass.assign(this->channels, highpass);
+        this->weighted.assign(this->channels, std::vector<float>(blockFrames));
+        this->history.assign(this->channels, std::vector<float>(peakTaps - 1 + blockFrames, 0.0f));
+
+        // The interpolation filter is a Hann windowed sinc, split into four phases which
+        // each have unity gain at DC
+        const size_t taps = 4 * peakTaps;
+        for (size_t p = 0; p < 4; p++) {
+            float sum = 0.0f;
+            for (size_t k = 0; k < peakTaps; k++) {
+                double n = 4*k + p;
+                double t = (n - (taps - 1)/2.0)/4.0;
+                double sinc = std::sin(M_PI * t)/(M_PI * t);
+                double window = 0.5 - 0.5 * std::cos(2.0 * M_PI * (n + 1.0)/(taps + 1));
+                this->coeffs[k][p] = sinc * window;
+                sum += this->coeffs[k][p];
+            }
+            for (size_t k = 0; k < peakTaps; k++) {
+                this->coeffs[k][p] /= sum;
+            }
+        }
+
+        // Audio sampled at a high enough rate is close enough as is
+        this->oversample = (rate < 96000);
+        this->maxPeak = 0.0f;
+
+        for (size_t i = 0; i < 4; i++) {
+            this->subEnergy[i] = 0.0;
+        }
+        this->subCount = 0;
+        this->subFill = 0;
+    }
+
+    void Meter::processBlock(const int16_t * in, size_t frames) {
+        for (int c = 0; c < this->channels; c++) {
+            // Convert this channel to floats, following on from the end of the last block
+            float * x = this->history[c].data() + peakTaps - 1;
+            float peak = this->maxPeak;
+            for (size_t i = 0; i < frames; i++) {
+                x[i] = in[i * this->channels + c] * (1.0f/32768.0f);
+                peak = std::max(peak, std::fabs(x[i]));
+            }
+            if (this->oversample) {
+                peak = std::max(peak, interpolatedPeak(x, frames, this->coeffs));
+            }
+            this->maxPeak = peak;
+
+            // Apply both K-weighting stages (transposed direct form II, in doubles as the high pass is very low)
+            Biquad s = this->shelf[c];
+            Biquad h = this->highpass[c];
+            float * out = this->weighted[c].data();
+            for (size_t i = 0; i < frames; i++) {
+                double y = s.b0 * x[i] + s.z1;
+                s.z1 = s.b1 * x[i] - s.a1 * y + s.z2;
+                s.z2 = s.b2 * x[i] - s.a2 * y;
+                double o = h.b0 * y + h.z1;
+                h.z1 = h.b1 * y - h.a1 * o + h.z2;
+                h.z2 = h.b2 * y - h.a2 * o;
+                out[i] = o;
+            }
+            this->shelf[c] = s;
+            this->highpass[c] = h;
+
+            // Keep the end of this block for interpolating the start of the next one
+            std::memmove(this->history[c].data(), x + frames - (peakTaps - 1), (peakTaps - 1) * sizeof(float));
+        }
+
+        // Accumulate energy into 100ms sub-blocks, with every four consecutive sub-blocks forming a block
+        size_t pos = 0;
+        while (pos < frames) {
+            size_t num = std::min(frames - pos, this->subLength - this->subFill);
+            double & energy = this->subEnergy[this->subCount % 4];
+            for (int c = 0; c < this->channels; c++) {
+                energy += sumSquares(this->weighted[c].data() + pos, num);
+            }
+            pos += num;
+            this->subFill += num;
+
+            if (this->subFill == this->subLength) {
+                this->subCount++;
+                this->subFill = 0;
+                if (this->subCount >= 4) {
+                    double total = this->subEnergy[0] + this->subEnergy[1] + this->subEnergy[2] + this->subEnergy[3];
+                    this->blocks.push_back(total/(4 * this->subLength));
+                }
+                this->subEnergy[this->subCount % 4] = 0.0;
+            }
+        }
+    }
+
+    void Meter::addSamples(const int16_t * in, size_t frames) {
+        while (frames > 0) {
+            size_t num = std::min(frames, blockFrames);
+            this->processBlock(in, num);
+            in += num * this->channels;
+            frames -= num;
+        }
+    }
+
+    double Meter::loudness() {
+        // Average the blocks above the absolute gate to find the relative gate
+        const double absPower = LUFSToPower(absoluteGate);
+        double sum = 0.0;
+        size_t count = 0;
+        for (float power : this->blocks) {
+            if (power > absPower) {
+                sum += power;
+                count++;
+            }
+        }
+        if (count == 0) {
+            return absoluteGate;
+        }
+
+        // Then average those above both
+        const double relPower = (sum/count) * std::pow(10.0, relativeGate/10.0);
+        sum = 0.0;
+        count = 0;
+        for (float power : this->blocks) {
+            if (power > absPower && power > relPower) {
+                sum += power;
+                count++;
+            }
+        }
+        return (count == 0 ? absoluteGate : powerToLUFS(sum/count));
+    }
+
+    double Meter::peak() {
+        if (this->maxPeak <= 0.0f) {
+            return -100.0;
+        }
+        return std::max(20.0 * std::log10(this->maxPeak), -100.0);
+    }
+
+    // Decodes an MP3 using it's own mpg123 instance (so multiple files can be analysed at once)
+    static bool analyseMP3(const std::string & path, double & loudness, double & peak) {
+        int err;
+        mpg123_handle * mpg = mpg123_new(nullptr, &err);
+        if (mpg == nullptr) {
+            return false;
+        }
+
+        // Always decode to 16-bit samples
+        mpg123_format_none(mpg);
+        const long * rates;
+        size_t count;
+        mpg123_rates(&rates, &count);
+        for (size_t i = 0; i < count; i++) {
+            mpg123_format(mpg, rates[i], MPG123_MONO | MPG123_STEREO, MPG123_ENC_SIGNED_16);
+        }
+
+        long rate;
+        int channels, encoding;
+        bool ok = (mpg123_open(mpg, path.c_str()) == MPG123_OK);
+        if (ok) {
+            ok = (mpg123_getformat(mpg, &rate, &channels, &encoding) == MPG123_OK);
+            if (ok) {
+                Meter meter(rate, channels);
+                std::vector<int16_t> buf(blockFrames * channels);
+                size_t bytes;
+                do {
+                    err = mpg123_read(mpg, reinterpret_cast<unsigned char *>(buf.data()), buf.size() * sizeof(int16_t), &bytes);
+                    meter.addSamples(buf.data(), bytes/(channels * sizeof(int16_t)));
+                } while (err == MPG123_OK);
+
+                ok = (err == MPG123_DONE);
+                loudness = meter.loudness();
+                peak = meter.peak();
+            }
+            mpg123_close(mpg);
+        }
+
+        mpg123_delete(mpg);
+        return ok;
+    }
+
+    // State shared with the FLAC decoder's callbacks
+    struct FLACState {
+        Meter * meter;                  // Created once the stream info is known
+        unsigned int channels;          // Channels in the stream
+        std::vector<int16_t> buf;       // Interleaved samples passed to the meter
+    };
+
+    static void flacMetadata(const FLAC__StreamDecoder *, const FLAC__StreamMetadata * metadata, void * data) {
+        FLACState * state = static_cast<FLACState *>(data);
+        if (metadata->type == FLAC__METADATA_TYPE_STREAMINFO && state->meter == nullptr) {
+            state->channels = metadata->data.stream_info.channels;
+            state->meter = new Meter(metadata->data.stream_info.sample_rate, state->channels);
+        }
+    }
+
+    static FLAC__StreamDecoderWriteStatus flacWrite(const FLAC__StreamDecoder *, const FLAC__Frame * frame, const FLAC__int32 * const buffer[], void * data) {
+        FLACState * state = static_cast<FLACState *>(data);
+        if (state->meter == nullptr || frame->header.channels != state->channels) {
+            return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+        }
+
+        // Interleave the channels, scaling each sample to 16 bits
+        const unsigned int bits = frame->header.bits_per_sample;
+        const unsigned int frames = frame->header.blocksize;
+        state->buf.resize(frames * state->channels);
+        for (unsigned int c = 0; c < state->channels; c++) {
+            for (unsigned int i = 0; i < frames; i++) {
+                FLAC__int32 s = buffer[c][i];
+                state->buf[i * state->channels + c] = (bits > 16 ? s >> (bits - 16) : s << (16 - bits));
+            }
+        }
+
+        state->meter->addSamples(state->buf.data(), frames);
+        return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+    }
+
+    static void flacError(const FLAC__StreamDecoder *, FLAC__StreamDecoderErrorStatus, void *) {
+        // The decoder resyncs by itself, so a damaged frame only costs a gap
+    }
+
+    static bool analyseFLAC(const std::string & path, double & loudness, double & peak) {
+        FLAC__StreamDecoder * decoder = FLAC__stream_decoder_new();
+        if (decoder == nullptr) {
+            return false;
+        }
+
+        FLACState state;
+        state.meter = nullptr;
+        state.channels = 0;
+        bool ok = (FLAC__stream_decoder_init_file(decoder, path.c_str(), flacWrite, flacMetadata, flacError, &state) == FLAC__STREAM_DECODER_INIT_STATUS_OK);
+        if (ok) {
+            ok = FLAC__stream_decoder_process_until_end_of_stream(decoder);
+            FLAC__stream_decoder_finish(decoder);
+        }
+        if (ok && state.meter != nullptr) {
+            loudness = state.meter->loudness();
+            peak = state.meter->peak();
+        } else {
+            ok = false;
+        }
+
+        delete state.meter;
+        FLAC__stream_decoder_delete(decoder);
+        return ok;
+    }
+
+    static bool analyseOpus(const std::string & path, double & loudness, double & peak) {
+        OggOpusFile * of = op_open_file(path.c_str(), nullptr);
+        if (of == nullptr) {
+            return false;
+        }
+
+        // Opus always decodes at 48kHz, and is downmixed to stereo if needed
+        Meter meter(48000, 2);
+        std::vector<int16_t> buf(blockFrames * 2);
+        bool ok = true;
+        int frames;
+        while ((frames = op_read_stereo(of, buf.data(), buf.size())) != 0) {
+            if (frames == OP_HOLE) {
+                continue;
+            } else if (frames < 0) {
+                ok = false;
+                break;
+            }
+            meter.addSamples(buf.data(), frames);
+        }
+        op_free(of);
+
+        loudness = meter.loudness();
+        peak = meter.peak();
+        return ok;
+    }
+
+    static bool analyseVorbis(const std::string & path, double & loudness, double & peak) {
+        OggVorbis_File vf;
+        if (ov_fopen(path.c_str(), &vf) != 0) {
+            return false;
+        }
+
+        const vorbis_info * info = ov_info(&vf, -1);
+        const int channels = info->channels;
+        Meter meter(info->rate, channels);
+        std::vector<int16_t> buf(blockFrames * channels);
+        bool ok = true;
+        int section;
+        long bytes;
+        while ((bytes = ov_read(&vf, reinterpret_cast<char *>(buf.data()), buf.size() * sizeof(int16_t), 0, 2, 1, &section)) != 0) {
+            if (bytes == OV_HOLE) {
+                continue;
+            } else if (bytes < 0 || ov_info(&vf, section)->channels != channels) {
+                ok = false;
+                break;
+            }
+            meter.addSamples(buf.data(), bytes/(channels * sizeof(int16_t)));
+        }
+        ov_clear(&vf);
+
+        loudness = meter.loudness();
+        peak = meter.peak();
+        return ok;
+    }
+
+    bool analyse(const std::string & path, double & loudness, double & peak) {
+        std::string ext = std::filesystem::path(path).extension();
+        bool ok;
+        if (strcasecmp(ext.c_str(), ".mp3") == 0) {
+            ok = analyseMP3(path, loudness, peak);
+        } else if (strcasecmp(ext.c_str(), ".flac") == 0) {
+            ok = analyseFLAC(path, loudness, peak);
+        } else if (strcasecmp(ext.c_str(), ".opus") == 0) {
+            ok = analyseOpus(path, loudness, peak);
+        } else {
+            ok = analyseVorbis(path, loudness, peak);
+        }
+
+        if (!ok) {
+            Log::writeWarning("[LOUDNESS] Unable to analyse: " + path);
+        }
+        return ok;
+    }
+};
\ No newline at end of file
@@ -385,6 +385,8 @@ namespace Utils::MP3 {
         m.album = "Unknown Album";                         // Same for album
         m.trackNumber = 0;                                 // Initially 0 to indicate not set
         m.discNumber = 0;                                  // Initially 0 to indicate not set
+        m.loudness = 0.0;                                  // Not analysed while reading tags
+        m.peak = 0.0;
 
         // Use mpg123 to read ID3 tags
         std::unique_lock<std::mutex> mtx(mutex);
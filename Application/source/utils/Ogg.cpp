@@ -0,0 +1,142 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include "Log.hpp"
+#include <opusfile.h>
+#include <strings.h>
+#include "utils/Ogg.hpp"
+#include <vorbis/vorbisfile.h>
+
+namespace Utils::Ogg {
+    // Returns default info for a file (title is the file name)
+    static Metadata::Song defaultInfo(const std::string & path) {
+        Metadata::Song m;
+        m.ID = -3;
+        m.title = std::filesystem::path(path).stem();
+        m.artist = "Unknown Artist";
+        m.album = "Unknown Album";
+        m.trackNumber = 0;
+        m.discNumber = 0;
+        m.duration = 0;
+        m.loudness = 0.0;
+        m.peak = 0.0;
+        return m;
+    }
+
+    // Returns whether the given extension is for an Opus file
+    static bool isOpus(const std::string & path) {
+        std::string ext = std::filesystem::path(path).extension();
+        return (strcasecmp(ext.c_str(), ".opus") == 0);
+    }
+
+    // Parses the given list of comments into the song
+    static void parseComments(char ** comments, int * lengths, int count, Metadata::Song & m) {
+        m.ID = (count > 0 ? -1 : -2);
+        for (int i = 0; i < count; i++) {
+            parseComment(std::string(comments[i], lengths[i]), m);
+        }
+    }
+
+    void parseComment(const std::string & comment, Metadata::Song & m) {
+        size_t split = comment.find('=');
+        if (split == std::string::npos || split + 1 >= comment.length()) {
+            return;
+        }
+
+        // Keys are case insensitive
+        std::string key = comment.substr(0, split);
+        std::string value = comment.substr(split + 1);
+        if (strcasecmp(key.c_str(), "TITLE") == 0) {
+            m.title = value;
+
+        } else if (strcasecmp(key.c_str(), "ARTIST") == 0) {
+            m.artist = value;
+
+        } else if (strcasecmp(key.c_str(), "ALBUM") == 0) {
+            m.album = value;
+
+        } else if (strcasecmp(key.c_str(), "TRACKNUMBER") == 0) {
+            m.trackNumber = std::atoi(value.c_str());
+
+        } else if (strcasecmp(key.c_str(), "DISCNUMBER") == 0) {
+            m.discNumber = std::atoi(value.c_str());
+        }
+    }
+
+    std::vector<unsigned char> getArt(const std::string & path) {
+        std::vector<unsigned char> v;
+
+        // Both formats store the picture the same way, but need their own library to read it
+        const char * tag = nullptr;
+        OggOpusFile * of = nullptr;
+        OggVorbis_File vf;
+        bool vfOpen = false;
+        if (isOpus(path)) {
+            of = op_open_file(path.c_str(), nullptr);
+            if (of != nullptr) {
+                tag = opus_tags_query(op_tags(of, -1), "METADATA_BLOCK_PICTURE", 0);
+            }
+        } else if (ov_fopen(path.c_str(), &vf) == 0) {
+            vfOpen = true;
+            tag = vorbis_comment_query(ov_comment(&vf, -1), "METADATA_BLOCK_PICTURE", 0);
+        }
+
+        // Parse the base64 encoded picture
+        if (tag != nullptr) {
+            OpusPictureTag pic;
+            opus_picture_tag_init(&pic);
+            if (opus_picture_tag_parse(&pic, tag) == 0) {
+                if (pic.format == OP_PIC_FORMAT_JPEG || pic.format == OP_PIC_FORMAT_PNG) {
+                    v.assign(pic.data, pic.data + pic.data_length);
+                }
+            }
+            opus_picture_tag_clear(&pic);
+        }
+        if (v.empty()) {
+            Log::writeInfo("[OGG] No suitable art found in: " + path);
+        }
+
+        if (of != nullptr) {
+            op_free(of);
+        }
+        if (vfOpen) {
+            ov_clear(&vf);
+        }
+        return v;
+    }
+
+    Metadata::Song getInfo(const std::string & path) {
+        Metadata::Song m = defaultInfo(path);
+
+        if (isOpus(path)) {
+            OggOpusFile * of = op_open_file(path.c_str(), nullptr);
+            if (of == nullptr) {
+                Log::writeError("[OGG] Unable to open file: " + path);
+                return m;
+            }
+
+            const OpusTags * tags = op_tags(of, -1);
+            parseComments(tags->user_comments, tags->comment_lengths, tags->comments, m);
+            m.duration = std::round(op_pcm_total(of, -1)/48000.0);
+            op_free(of);
+
+        } else {
+            OggVorbis_File vf;
+            if (ov_fopen(path.c_str(), &vf) != 0) {
+                Log::writeError("[OGG] Unable to open file: " + path);
+                return m;
+            }
+
+            vorbis_comment * tags = ov_comment(&vf, -1);
+            parseComments(tags->user_comments, tags->comment_lengths, tags->comments, m);
+            m.duration = std::round(ov_time_total(&vf, -1));
+            ov_clear(&vf);
+        }
+
+        if (m.ID == -2) {
+            Log::writeWarning("[OGG] No tags were found in: " + path);
+        }
+        return m;
+    }
+};
\ No newline at end of file
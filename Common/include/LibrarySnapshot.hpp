@@ -0,0 +1,65 @@
+#ifndef LIBRARYSNAPSHOT_HPP
+#define LIBRARYSNAPSHOT_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A LibrarySnapshot is a compact, read-only copy of the songs in the database, written by the application
+// whenever it changes the database. The sysmodule and overlay look songs up in it instead of opening the
+// database, so they don't need SQLite (or to wait for the application to release the database).
+//
+// The file starts with a header, followed by a hash table of IDs, a fixed size entry for each song and
+// a pool of (deduplicated) strings which entries refer to by offset. A song is found by reading its
+// slot(s) in the hash table, its entry and then its strings, so nothing is kept in memory between lookups
+// and the file is never held open (allowing the application to replace it at any time).
+class LibrarySnapshot {
+    public:
+        // Information stored about each song
+        struct Song {
+            int id;                     // ID of the song in the database
+            int albumID;                // ID of the song's album
+            std::string path;           // Path to the song's file
+            std::string title;          // Title of the song
+            std::string artist;         // Name of the song's artist
+            std::string album;          // Name of the song's album
+            std::string imagePath;      // Path to the album's art (blank if it has none)
+            unsigned int duration;      // Length in seconds
+            bool analysed;              // Whether the loudness and peak below have been measured
+            float loudness;             // Loudness of the song (LUFS)
+            float peak;                 // True peak of the song (dBTP)
+            bool albumAnalysed;         // Whether any of the album's songs have been measured
+            float albumLoudness;        // Loudness of the album (the average power of it's songs, weighted by duration)
+            float albumPeak;            // Largest true peak of the album's songs
+        };
+
+        // Which strings to read when looking up a song (those not read are left blank)
+        enum Fields : uint32_t {
+            Path      = 1 << 0,
+            Title     = 1 << 1,
+            Artist    = 1 << 2,
+            Album     = 1 << 3,
+            ImagePath = 1 << 4,
+            All       = 0x1F
+        };
+
+    private:
+        std::string path;               // Path to the snapshot
+
+    public:
+        // Constructor takes the path to the snapshot (it doesn't need to exist yet)
+        LibrarySnapshot(const std::string &);
+
+        // Looks up the song with the given ID, reading the requested strings. Returns false if the
+        // snapshot couldn't be read (i.e. while it's being replaced) or the song isn't in it.
+        bool getSong(const int, Song &, const uint32_t = Fields::All);
+
+        // Returns the number incremented each time the snapshot is written (0 if it couldn't be read)
+        uint64_t generation();
+
+        // Writes a new snapshot containing the given songs, replacing the current one. Album loudness and peak are
+        // calculated from the songs, and the generation is one more than the current snapshot's. Returns false on an error.
+        bool write(const std::vector<Song> &);
+};
+
+#endif
\ No newline at end of file
@@ -14,6 +14,7 @@ namespace Path {
 
         extern const std::string DatabaseFile;
         extern const std::string DatabaseBackupFile;
+        extern const std::string LibraryFile;
     };
 
     // Application specific paths
@@ -37,6 +38,9 @@ namespace Path {
     namespace Sys {
         extern const std::string ConfigFile;
         extern const std::string LogFile;
+        extern const std::string StateFile;
+
+        extern const std::string SeekIndexFolder;
     };
 };
 
@@ -88,6 +88,7 @@ class SQLite {
         // Parameters have order: (column number (starting from 0), data)
         // Returns true if successful, false on an error
         bool bindBool(int, const bool);
+        bool bindDouble(int, const double);
         bool bindInt(int, const int);
         bool bindString(int, const std::string &);
 
@@ -98,6 +99,7 @@ class SQLite {
         // Parameters have order: (column number (starting from 0), reference to fill with data)
         // Returns true if successful, false on an error
         bool getBool(int, bool &);
+        bool getDouble(int, double &);
         bool getInt(int, int &);
         bool getString(int, std::string &);
         // Returns true if currently viewing a row, false otherwise
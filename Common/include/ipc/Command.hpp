@@ -1,6 +1,8 @@
 #ifndef IPC_COMMAND_HPP
 #define IPC_COMMAND_HPP
 
+#include <cstdint>
+
 // This file contain the IDs of susmodule commands, along with a description of what they do
 // Note that the client can only send commands to the sysmodule, not the other way around!
 namespace Ipc {
@@ -26,9 +28,9 @@ namespace Ipc {
         RemoveFromSubQueue, // Remove song from 'sub-queue'                     // Position of song to remove                       // Nothing
         SkipSubQueueSongs,  // Skip forward given number of songs + play        // Number of songs to skip                          // Number of songs skipped
 
-        GetQueue,           // Get play queue                                   // First index and number to get                    // Sequence of IDs matching queue
+        GetQueue,           // Get play queue                                   // First index, number and format [Ipc::IDFormat]   // Sequence of IDs matching queue, number returned, queue version, queue size and size of IDs (bytes)
         QueueSize,          // Get number of songs in queue                     // Nothing                                          // Number of songs in queue
-        SetQueue,           // Set play queue songs (will clear)                // Sequence of IDs to add to queue                  // Number of songs added to queue
+        SetQueue,           // Set play queue songs (will clear)                // Number + format [Ipc::IDFormat], sequence of IDs // Number of songs added to queue
 
         QueueIdx,           // Get position of current song in queue            // Nothing                                          // Position of currently playing song in queue
         SetQueueIdx,        // Set index of current song in queue               // Position to move to                              // The new queue index
@@ -49,12 +51,32 @@ namespace Ipc {
         GetPlayingFrom,     // Returns text saying what's in the queue          // Nothing                                          // 'Playing from' string
         SetPlayingFrom,     // Set 'playing from' text (allows 100 chars)       // String to set                                    // Nothing
 
-        RequestDBLock,      // Requests exclusive access to DB (blocks)         // Nothing                                          // Nothing
-        ReleaseDBLock,      // Releases exclusive access to DB                  // Nothing                                          // Nothing
+        RequestDBLock,      // Does nothing (DB is no longer used by sysmodule) // Nothing                                          // Nothing
+        ReleaseDBLock,      // Does nothing (as above)                          // Nothing                                          // Nothing
 
         ReloadConfig,       // Get the sysmodule to update it's config          // Nothing                                          // Nothing
         Reset,              // Reinitialize sysmodule (except ipc service)      // Nothing                                          // Version of sysmodule (string)
-        Quit                // Properly terminate the sysmodule                 // Nothing                                          // Nothing
+        Quit,               // Properly terminate the sysmodule                 // Nothing                                          // Nothing
+
+        GetStats,           // Get playback statistics                          // Nothing                                          // Statistics [TriPlayer::Stats]
+
+        GetShuffleSeed,     // Get the seed of the queue's shuffle              // Nothing                                          // Seed [uint64_t] (0 if not shuffled)
+        SetShuffleSeed,     // Shuffle using a seed (i.e. to restore an order)  // Seed [uint64_t]                                  // Nothing
+
+        EditQueue,          // Apply edits to the queue/sub-queue atomically    // Sequence of edits [TriPlayer::QueueEdit + IDs]   // Nothing
+        GetQueueChanges,    // Get changes made to the queue since a version    // Version and maximum number of changes to get     // Sequence of changes [TriPlayer::QueueChange], version after them, number returned and whether to resync
+
+        WaitForChange,      // Wait for state to change (reply is held)         // Sequence, timeout (ms), mask [TriPlayer::Change] // Sequence to wait from next and bits which changed
+        GetState,           // Get a snapshot of the playback state             // Nothing                                          // State [TriPlayer::State]
+        GetStateMemory,     // Get memory the state is published in             // Nothing                                          // Copy handle to shared memory [Ipc::SharedState]
+
+        Features,           // Negotiate optional features (after Version)      // Features the client supports [Ipc::Feature]      // Features supported by both
+        GetLockStats        // Get how much each lock has been waited on        // Whether to reset the counts after [bool]         // Stats for each lock [TriPlayer::LockStats]
+    };
+
+    // Optional features (bits) negotiated using Command::Features
+    namespace Feature {
+        constexpr uint32_t CompactIDs = 1 << 0;     // Lists of IDs can be sent as Ipc::IDFormat::Compact
     };
 };
 
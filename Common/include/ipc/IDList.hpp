@@ -0,0 +1,35 @@
+#ifndef IPC_IDLIST_HPP
+#define IPC_IDLIST_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Lists of song IDs can be sent in a compact form instead of 4 bytes per ID. Queues are usually made
+// from an album or the library, so neighbouring IDs tend to be close together or consecutive. Each ID is
+// stored as the (zigzag encoded) difference from the previous one in a varint, with the lowest bit
+// set if it's followed by a varint containing the number of IDs after it that each increase by one.
+namespace Ipc {
+    // Format of a list of IDs
+    enum class IDFormat : uint32_t {
+        Raw,                // Sequence of 4 byte IDs
+        Compact             // Sequence of variable length deltas/runs (see above)
+    };
+
+    namespace IDList {
+        // Append the given IDs in the compact format, stopping before the output would be larger than the given number
+        // of bytes. Returns the number of IDs encoded.
+        size_t encode(const std::vector<int> & IDs, std::vector<uint8_t> & out, const size_t maxBytes = SIZE_MAX);
+
+        // Decode the given number of IDs from the compact format onto the end of the vector
+        // Returns false if the data is malformed or doesn't contain exactly that many IDs
+        bool decode(const uint8_t * data, const size_t size, const size_t count, std::vector<int> & out);
+        // As above, but passes each ID to the function as it's decoded instead of storing them all (so a long list
+        // doesn't need memory for every ID). IDs are passed before the whole list is checked, so to only act on a
+        // valid list decode it twice, first with a function that does nothing.
+        bool decode(const uint8_t * data, const size_t size, const size_t count, const std::function<void(int)> & func);
+    };
+};
+
+#endif
\ No newline at end of file
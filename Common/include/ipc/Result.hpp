@@ -8,6 +8,7 @@ namespace Ipc {
         Ok,                 // Everything excuted as expected
         BadInput,           // Input was not what was expected
         SubQueueFull,       // The sysmodule's subqueue is full
+        QueueFull,          // The sysmodule's queue is full
         Unknown             // An unexpected error occurred
     };
 };
@@ -0,0 +1,48 @@
+#ifndef IPC_SHAREDSTATE_HPP
+#define IPC_SHAREDSTATE_HPP
+
+#include <atomic>
+#include <cstring>
+#include "ipc/TriPlayer.hpp"
+
+// The sysmodule publishes it's state in memory shared with clients, so it can be read without
+// any IPC. The state is guarded by a sequence lock: the sequence number is odd while the state is
+// being written, so a reader copies the state and tries again if the number was odd or changed meanwhile.
+namespace Ipc {
+    // Size of the shared memory (must be a multiple of the page size)
+    constexpr size_t SharedStateSize = 0x1000;
+
+    // Layout of the shared memory
+    struct SharedState {
+        std::atomic<uint32_t> sequence;     // Increased before and after each write (odd while writing)
+        TriPlayer::State state;             // Latest state
+    };
+
+    // Write the state (only one thread may write at a time)
+    inline void writeSharedState(SharedState * shared, const TriPlayer::State & state) {
+        uint32_t seq = shared->sequence.load(std::memory_order_relaxed);
+        shared->sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&shared->state, &state, sizeof(TriPlayer::State));
+        shared->sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // Copy the state, returning false if it was being written during each of the given number of attempts
+    inline bool readSharedState(const SharedState * shared, TriPlayer::State & state, const size_t attempts) {
+        for (size_t i = 0; i < attempts; i++) {
+            uint32_t before = shared->sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+
+            std::memcpy(&state, &shared->state, sizeof(TriPlayer::State));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (shared->sequence.load(std::memory_order_relaxed) == before) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+#endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef IPC_TRIPLAYER_HPP
 #define IPC_TRIPLAYER_HPP
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -32,6 +33,103 @@ namespace TriPlayer {
         Error       // A fatal error occurred
     };
 
+    // State which can be waited on using waitForChange(), as bits to combine into a mask
+    namespace Change {
+        constexpr uint32_t Song         = (1 << 0);     // Currently playing song
+        constexpr uint32_t Status       = (1 << 1);     // Playback status
+        constexpr uint32_t Position     = (1 << 2);     // Position in the song (at most every 100ms while playing)
+        constexpr uint32_t Volume       = (1 << 3);     // Volume (including muting)
+        constexpr uint32_t Repeat       = (1 << 4);     // Repeat mode
+        constexpr uint32_t Shuffle      = (1 << 5);     // Shuffle mode
+        constexpr uint32_t Queue        = (1 << 6);     // Songs in the main queue
+        constexpr uint32_t QueueIdx     = (1 << 7);     // Index of the current song in the main queue
+        constexpr uint32_t SubQueue     = (1 << 8);     // Songs in the sub-queue
+        constexpr uint32_t PlayingFrom  = (1 << 9);     // 'Playback source' text
+        constexpr uint32_t All          = (1 << 10) - 1;
+    };
+
+    // Type of a queue edit
+    enum class QueueEditType : uint32_t {
+        Insert,             // Insert songs into the queue
+        Remove,             // Remove a range of songs from the queue
+        Move,               // Move a range of songs in the queue
+        AppendSubQueue,     // Add songs to the end of the sub-queue
+        RemoveSubQueue,     // Remove a range of songs from the sub-queue
+        MoveSubQueue        // Move a range of songs in the sub-queue
+    };
+
+    // An edit to the queue or sub-queue, which is sent followed by the IDs it inserts (if any)
+    struct QueueEdit {
+        QueueEditType type;     // Type of edit
+        uint32_t count;         // Number of songs inserted, removed or moved
+        uint64_t pos;           // Position of the first song edited (or inserted before), unused when appending
+        uint64_t to;            // Position the first song moved ends up at (only used when moving)
+    };
+
+    // Type of a change made to the queue
+    enum class QueueChangeType : uint32_t {
+        Insert,             // A song was inserted
+        Remove,             // A song was removed
+        Move                // A song was moved
+    };
+
+    // A change made to the queue, each of which increases it's version by one
+    struct QueueChange {
+        QueueChangeType type;   // Type of change
+        int32_t id;             // ID inserted (only used for insertions)
+        uint64_t pos;           // Position inserted at, removed from or moved from
+        uint64_t to;            // Position moved to (only used for moves)
+    };
+
+    // Snapshot of the playback state (see getState())
+    struct State {
+        int32_t songID;             // ID of the current song (-1 if there isn't one)
+        Status status;              // Playback status
+        double position;            // Position in the song (0.0 to 100.0)
+        double volume;              // Volume (0.0 to 100.0)
+        Repeat repeat;              // Repeat mode
+        Shuffle shuffle;            // Shuffle mode
+        uint64_t queueSize;         // Number of songs in the main queue
+        uint64_t queueIdx;          // Index of the current song in the main queue
+        uint64_t subQueueSize;      // Number of songs in the sub-queue
+        uint64_t queueVersion;      // Version of the main queue (see getQueueChanges())
+        uint64_t changeSequence;    // Sequence number of the latest change (see waitForChange())
+    };
+
+    // Playback statistics
+    struct Stats {
+        uint32_t bufferCount;       // Number of output buffers
+        uint32_t bufferSize;        // Size of each output buffer (in bytes)
+        uint32_t underruns;         // Number of times output ran out of audio part way through a song
+        int32_t minQueuedSamples;   // Fewest samples left to play when a buffer was queued (negative if not measured)
+        uint32_t decodeSamples;     // Number of buffers the decode times below were measured over
+        uint32_t decodeP50;         // Time taken to decode a buffer (in microseconds) at the 50th,
+        uint32_t decodeP95;         // 95th and 99th percentile, along with the longest time
+        uint32_t decodeP99;
+        uint32_t decodeMax;
+    };
+
+    // The sysmodule's locks, in the order getLockStats() returns them
+    enum class Lock {
+        Queue,              // Main queue
+        SubQueue,           // Sub-queue
+        Source,             // Source being played
+        Change,             // Last seen state
+        Database,           // Database access (unused since the library snapshot replaced it, always zero)
+        Combos,             // Button combos
+        Stats,              // Playback statistics
+        Count               // Number of locks
+    };
+
+    // How much a lock has been waited on
+    struct LockStats {
+        uint32_t acquired;          // Number of times it was locked
+        uint32_t contended;         // Number of those which had to wait for another thread
+        uint64_t waitTotal;         // Total time spent waiting (in microseconds)
+        uint32_t waitMax;           // Longest wait (in microseconds)
+        uint32_t padding;
+    };
+
     // Initialize and connect to the sysmodule
     // Common reasons of failure are either it's not running or there's a version mismatch
     bool initialize();
@@ -73,8 +171,14 @@ namespace TriPlayer {
     // Get a list of song IDs in the main queue
     // The main queue is set when playing an album, playlist, etc
     bool getQueue(std::vector<int> & outIDs);
+    // Same as above, but also get the version of the queue the IDs are from
+    bool getQueue(std::vector<int> & outIDs, uint64_t & outVersion);
     // Get the number of songs in the main queue
     bool getQueueSize(size_t & outCount);
+    // Get the changes made to the main queue since the given version (to apply to a copy of it), along with the version
+    // they bring it up to. The sysmodule only remembers recent changes, so if outResync is set they're not known and
+    // the whole queue must be fetched again using getQueue().
+    bool getQueueChanges(const uint64_t sinceVersion, std::vector<QueueChange> & outChanges, uint64_t & outVersion, bool & outResync);
     // Set the IDs in the main queue
     bool setQueue(const std::vector<int> & IDs);
 
@@ -85,6 +189,11 @@ namespace TriPlayer {
     // Remove the track at the given index from the queue
     bool removeFromQueue(const size_t pos);
 
+    // Apply the given edits to the queue and sub-queue in order, all at once. Edits which insert/append take their IDs
+    // from the second vector, in the same order as the edits. If any edit is out of bounds or would overfill a queue,
+    // nothing is changed. This is much faster than making many separate calls.
+    bool editQueue(const std::vector<QueueEdit> & edits, const std::vector<int> & IDs);
+
     // Get the TriPlayer::Repeat mode of the sysmodule
     bool getRepeatMode(Repeat & outMode);
     // Set the TriPlayer::Repeat mode
@@ -94,6 +203,11 @@ namespace TriPlayer {
     bool getShuffleMode(Shuffle & outMode);
     // Set the TriPlayer::Shuffle mode
     bool setShuffleMode(const Shuffle mode);
+    // Get the seed of the current shuffle (0 if not shuffled), which can be saved to restore the order later
+    bool getShuffleSeed(uint64_t & outSeed);
+    // Shuffle using the given seed. The order matches the one the seed came from as long as the queue is the same,
+    // and the song at the current index is the one that was current when that shuffle was made
+    bool setShuffleSeed(const uint64_t seed);
 
     // Get the currently playing song's ID
     bool getSongID(int & outID);
@@ -111,9 +225,9 @@ namespace TriPlayer {
     bool setPlayingFromText(const std::string & text);
 
     // Request exclusive access to the database file
-    // This may block for a while depending on what the sysmodule is doing
+    // No longer needed as the sysmodule reads the library snapshot instead (it returns immediately)
     bool requestDatabaseLock();
-    // Release previously requested access to database
+    // Release previously requested access to database (also no longer needed)
     bool releaseDatabaseLock();
 
     // Request the sysmodule to re-read it's config file
@@ -122,6 +236,23 @@ namespace TriPlayer {
     bool reset();
     // Safely terminate the sysmodule, freeing the IPC service
     bool stopSysmodule();
+
+    // Get statistics about audio output and decoding since the sysmodule started
+    bool getStats(Stats & outStats);
+    // Get how much each of the sysmodule's locks has been waited on (see Lock), optionally resetting the counts after
+    bool getLockStats(std::vector<LockStats> & outStats, const bool reset);
+
+    // Get a snapshot of the playback state. When possible this is read from memory shared with the sysmodule,
+    // which needs no IPC so it can be called every frame. Otherwise it's requested with a single IPC call.
+    bool getState(State & outState);
+    // Returns true if getState() reads from shared memory
+    bool stateShared();
+
+    // Wait until any of the state in the mask (see TriPlayer::Change) changes after the given sequence number, or until
+    // the timeout (in ms) passes. outChanged is set to the bits which changed (zero if timed out) and outSequence to the
+    // number to pass next time. Start with a sequence of zero, which only returns changes made after the first call.
+    // Waiting (i.e. a non-zero timeout) uses it's own connection so other calls made meanwhile from other threads aren't blocked.
+    bool waitForChange(const uint32_t mask, const uint64_t sinceSequence, const uint64_t timeout, uint32_t & outChanged, uint64_t & outSequence);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "LibrarySnapshot.hpp"
+#include <thread>
+#include <unordered_map>
+#include "utils/FS.hpp"
+
+// Identifies a snapshot ("TRLS") and the version of it's layout
+#define SNAPSHOT_MAGIC 0x534C5254
+#define SNAPSHOT_VERSION 1
+// Number of hash table slots read at once when searching for an ID
+#define SLOTS_PER_READ 4
+// Number of times to try replacing the snapshot (it can't be while a reader has it open)
+#define REPLACE_ATTEMPTS 20
+
+// Layout of the file (all values are little endian, as on the console)
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t generation;
+    uint32_t songs;             // Number of entries
+    uint32_t slots;             // Number of hash table slots (a power of two, at least twice the number of songs)
+    uint32_t stringsOffset;     // Offset of the string pool from the start of the file
+    uint32_t stringsSize;       // Size of the string pool
+};
+
+struct Slot {
+    int32_t id;                 // ID of song (ignored if empty)
+    uint32_t entry;             // Index of song's entry (UINT32_MAX if empty)
+};
+
+struct Entry {
+    int32_t id;
+    int32_t albumID;
+    uint32_t strings[5];        // Offsets into the string pool of the path, title, artist, album and image path
+    uint32_t duration;
+    float loudness;             // NaN if not analysed
+    float peak;
+    float albumLoudness;        // NaN if none of the album's songs are analysed
+    float albumPeak;
+};
+
+// Strings in the pool are a 2 byte length followed by the characters (without a terminator)
+constexpr size_t maxStringLength = UINT16_MAX;
+
+// Returns the first slot to check for an ID (spreads consecutive IDs across the table)
+static uint32_t slotForID(const int id, const uint32_t slots) {
+    uint32_t x = static_cast<uint32_t>(id);
+    x ^= x >> 16;
+    x *= 0x45D9F3B;
+    x ^= x >> 16;
+    return x & (slots - 1);
+}
+
+// Read the given number of bytes at an offset, returning false if they couldn't be
+static bool readAt(std::FILE * fp, const size_t offset, void * buf, const size_t size) {
+    if (std::fseek(fp, offset, SEEK_SET) != 0) {
+        return false;
+    }
+    return (std::fread(buf, 1, size, fp) == size);
+}
+
+// Opens the snapshot and reads (and checks) the header, returning nullptr on an error
+static std::FILE * openSnapshot(const std::string & path, Header & header) {
+    std::FILE * fp = std::fopen(path.c_str(), "rb");
+    if (fp == nullptr) {
+        return nullptr;
+    }
+
+    // Only small reads at scattered offsets are made, so buffering wastes time and memory
+    std::setvbuf(fp, nullptr, _IONBF, 0);
+    if (!readAt(fp, 0, &header, sizeof(Header)) || header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION) {
+        std::fclose(fp);
+        return nullptr;
+    }
+    return fp;
+}
+
+// Append a value's bytes to the buffer
+template <typename T>
+static void append(std::vector<unsigned char> & buf, const T & val) {
+    const unsigned char * ptr = reinterpret_cast<const unsigned char *>(&val);
+    buf.insert(buf.end(), ptr, ptr + sizeof(T));
+}
+
+LibrarySnapshot::LibrarySnapshot(const std::string & path) {
+    this->path = path;
+}
+
+bool LibrarySnapshot::getSong(const int id, Song & song, const uint32_t fields) {
+    Header header;
+    std::FILE * fp = openSnapshot(this->path, header);
+    if (fp == nullptr) {
+        return false;
+    }
+
+    // Search the hash table for the ID, reading a few slots at a time
+    const size_t slotsOffset = sizeof(Header);
+    const size_t entriesOffset = slotsOffset + header.slots * sizeof(Slot);
+    bool found = false;
+    bool ok = (header.songs > 0 && header.slots > 0 && (header.slots & (header.slots - 1)) == 0);
+    uint32_t entryIdx = 0;
+    uint32_t next = (ok ? slotForID(id, header.slots) : 0);
+    for (uint32_t checked = 0; ok && !found && checked < header.slots;) {
+        Slot slots[SLOTS_PER_READ];
+        uint32_t count = std::min<uint32_t>(SLOTS_PER_READ, header.slots - next);
+        ok = readAt(fp, slotsOffset + next * sizeof(Slot), slots, count * sizeof(Slot));
+        for (uint32_t i = 0; ok && i < count; i++, checked++) {
+            if (slots[i].entry == UINT32_MAX) {
+                ok = false;
+            } else if (slots[i].id == id) {
+                entryIdx = slots[i].entry;
+                found = true;
+                break;
+            }
+        }
+        next = (next + count) & (header.slots - 1);
+    }
+
+    // Read the entry and requested strings
+    Entry entry;
+    ok = (found && entryIdx < header.songs && readAt(fp, entriesOffset + entryIdx * sizeof(Entry), &entry, sizeof(Entry)) && entry.id == id);
+    std::string * strings[5] = {&song.path, &song.title, &song.artist, &song.album, &song.imagePath};
+    for (size_t i = 0; ok && i < 5; i++) {
+        strings[i]->clear();
+        if (!(fields & (1 << i))) {
+            continue;
+        }
+
+        uint16_t length;
+        ok = (entry.strings[i] + sizeof(length) <= header.stringsSize && readAt(fp, header.stringsOffset + entry.strings[i], &length, sizeof(length)));
+        ok = ok && (entry.strings[i] + sizeof(length) + length <= header.stringsSize);
+        if (ok && length > 0) {
+            strings[i]->resize(length);
+            ok = readAt(fp, header.stringsOffset + entry.strings[i] + sizeof(length), &(*strings[i])[0], length);
+        }
+    }
+    std::fclose(fp);
+    if (!ok) {
+        return false;
+    }
+
+    song.id = entry.id;
+    song.albumID = entry.albumID;
+    song.duration = entry.duration;
+    song.analysed = !std::isnan(entry.loudness);
+    song.loudness = entry.loudness;
+    song.peak = entry.peak;
+    song.albumAnalysed = !std::isnan(entry.albumLoudness);
+    song.albumLoudness = entry.albumLoudness;
+    song.albumPeak = entry.albumPeak;
+    return true;
+}
+
+uint64_t LibrarySnapshot::generation() {
+    Header header;
+    std::FILE * fp = openSnapshot(this->path, header);
+    if (fp == nullptr) {
+        return 0;
+    }
+    std::fclose(fp);
+    return header.generation;
+}
+
+bool LibrarySnapshot::write(const std::vector<Song> & songs) {
+    // An album's loudness is the average power of it's analysed songs (weighted by their duration), and it's peak is the largest
+    struct AlbumLoudness {
+        double power;
+        double duration;
+        float peak;
+    };
+    std::unordered_map<int, AlbumLoudness> albums;
+    for (const Song & song : songs) {
+        if (song.analysed) {
+            double weight = std::max(song.duration, 1u);
+            AlbumLoudness & album = albums.emplace(song.albumID, AlbumLoudness{0.0, 0.0, -100.0f}).first->second;
+            album.power += weight * std::pow(10.0, song.loudness/10.0);
+            album.duration += weight;
+            album.peak = std::max(album.peak, song.peak);
+        }
+    }
+
+    // Size the hash table so it's at most half full
+    uint32_t slots = 1;
+    while (slots < 2 * songs.size()) {
+        slots <<= 1;
+    }
+    std::vector<Slot> table(slots, Slot{0, UINT32_MAX});
+
+    // Create entries, adding each distinct string to the pool once
+    std::vector<Entry> entries;
+    entries.reserve(songs.size());
+    std::vector<unsigned char> pool;
+    std::unordered_map<std::string, uint32_t> offsets;
+    auto addString = [&pool, &offsets](const std::string & str) -> uint32_t {
+        std::unordered_map<std::string, uint32_t>::iterator it = offsets.find(str);
+        if (it != offsets.end()) {
+            return it->second;
+        }
+
+        uint32_t offset = pool.size();
+        uint16_t length = std::min(str.length(), maxStringLength);
+        append(pool, length);
+        pool.insert(pool.end(), str.begin(), str.begin() + length);
+        offsets[str] = offset;
+        return offset;
+    };
+    for (const Song & song : songs) {
+        // Skip duplicate IDs (there shouldn't be any)
+        uint32_t slot = slotForID(song.id, slots);
+        while (table[slot].entry != UINT32_MAX && table[slot].id != song.id) {
+            slot = (slot + 1) & (slots - 1);
+        }
+        if (table[slot].entry != UINT32_MAX) {
+            continue;
+        }
+        table[slot] = Slot{song.id, static_cast<uint32_t>(entries.size())};
+
+        Entry entry;
+        entry.id = song.id;
+        entry.albumID = song.albumID;
+        entry.strings[0] = addString(song.path);
+        entry.strings[1] = addString(song.title);
+        entry.strings[2] = addString(song.artist);
+        entry.strings[3] = addString(song.album);
+        entry.strings[4] = addString(song.imagePath);
+        entry.duration = song.duration;
+        entry.loudness = (song.analysed ? song.loudness : NAN);
+        entry.peak = (song.analysed ? song.peak : NAN);
+        std::unordered_map<int, AlbumLoudness>::iterator album = albums.find(song.albumID);
+        if (album != albums.end()) {
+            entry.albumLoudness = 10.0 * std::log10(album->second.power/album->second.duration);
+            entry.albumPeak = album->second.peak;
+        } else {
+            entry.albumLoudness = NAN;
+            entry.albumPeak = NAN;
+        }
+        entries.push_back(entry);
+    }
+
+    // Put it all together
+    Header header;
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.generation = this->generation() + 1;
+    header.songs = entries.size();
+    header.slots = slots;
+    header.stringsOffset = sizeof(Header) + slots * sizeof(Slot) + entries.size() * sizeof(Entry);
+    header.stringsSize = pool.size();
+
+    std::vector<unsigned char> data;
+    data.reserve(header.stringsOffset + pool.size());
+    append(data, header);
+    data.insert(data.end(), reinterpret_cast<unsigned char *>(table.data()), reinterpret_cast<unsigned char *>(table.data() + table.size()));
+    data.insert(data.end(), reinterpret_cast<unsigned char *>(entries.data()), reinterpret_cast<unsigned char *>(entries.data() + entries.size()));
+    data.insert(data.end(), pool.begin(), pool.end());
+
+    // Write to a temporary file first, so readers only ever see a complete snapshot
+    std::string tmpPath = this->path + ".tmp";
+    if (!Utils::Fs::writeFile(tmpPath, data)) {
+        return false;
+    }
+
+    // Renaming fails if the snapshot exists on the console (and deleting it fails while a reader has it open), so retry briefly
+    for (size_t i = 0; i < REPLACE_ATTEMPTS; i++) {
+        if (std::rename(tmpPath.c_str(), this->path.c_str()) == 0) {
+            return true;
+        }
+        std::remove(this->path.c_str());
+        if (std::rename(tmpPath.c_str(), this->path.c_str()) == 0) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    std::remove(tmpPath.c_str());
+    return false;
+}
\ No newline at end of file
@@ -10,6 +10,7 @@ namespace Path {
 
         const std::string DatabaseFile = Common::SwitchFolder + "data.sqlite3";
         const std::string DatabaseBackupFile = Common::SwitchFolder + "data_old.sqlite3";
+        const std::string LibraryFile = Common::SwitchFolder + "library.bin";
     };
 
     namespace App {
@@ -31,5 +32,8 @@ namespace Path {
     namespace Sys {
         const std::string ConfigFile = Common::ConfigFolder + "sys_config.ini";
         const std::string LogFile = Common::SwitchFolder + "sysmodule.log";
+        const std::string StateFile = Common::ConfigFolder + "sys_state.bin";
+
+        const std::string SeekIndexFolder = Common::SwitchFolder + "seek/";
     };
 };
\ No newline at end of file
@@ -3,11 +3,6 @@
 #include "utils/FS.hpp"
 
 SQLite::SQLite(const std::string & pth) {
-    // Limit overlay and sysmodule memory usage (200KB)
-    #if defined(_SYSMODULE_) || defined(_OVERLAY_)
-        sqlite3_soft_heap_limit64(204800);
-    #endif
-
     this->path = pth;
     this->path.shrink_to_fit();
 
@@ -257,6 +252,23 @@ bool SQLite::bindBool(int col, bool data) {
     return this->bindInt(col, (data == true ? 1 : 0));
 }
 
+bool SQLite::bindDouble(int col, double data) {
+    // Check query status first
+    if (this->queryStatus != SQLite::Query::Ready) {
+        this->setErrorMsg("Unable to bind a double to an unprepared query");
+        return false;
+    }
+
+    // Now bind
+    int result = sqlite3_bind_double(this->query, col+1, data);
+    if (result != SQLITE_OK) {
+        this->setErrorMsg();
+        return false;
+    }
+
+    return true;
+}
+
 bool SQLite::bindInt(int col, int data) {
     // Check query status first
     if (this->queryStatus != SQLite::Query::Ready) {
@@ -327,6 +339,17 @@ bool SQLite::getBool(int col, bool & data) {
     return b;
 }
 
+bool SQLite::getDouble(int col, double & data) {
+    // Check query status first
+    if (this->queryStatus != SQLite::Query::Results) {
+        this->setErrorMsg("Unable to get a double as no more rows are available");
+        return false;
+    }
+
+    data = sqlite3_column_double(this->query, col);
+    return true;
+}
+
 bool SQLite::getInt(int col, int & data) {
     // Check query status first
     if (this->queryStatus != SQLite::Query::Results) {
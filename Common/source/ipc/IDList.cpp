@@ -0,0 +1,105 @@
+#include "ipc/IDList.hpp"
+
+// Append an unsigned varint (7 bits per byte, high bit set on all but the last)
+static void appendVarint(std::vector<uint8_t> & out, uint64_t val) {
+    while (val >= 0x80) {
+        out.push_back(static_cast<uint8_t>(val) | 0x80);
+        val >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(val));
+}
+
+// Read an unsigned varint, returning false if it runs past the end or is too long
+static bool readVarint(const uint8_t * data, const size_t size, size_t & pos, uint64_t & val) {
+    val = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+        if (pos >= size) {
+            return false;
+        }
+
+        uint8_t byte = data[pos++];
+        val |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+namespace Ipc::IDList {
+    size_t encode(const std::vector<int> & IDs, std::vector<uint8_t> & out, const size_t maxBytes) {
+        const size_t start = out.size();
+        int64_t prev = 0;
+        size_t i = 0;
+        while (i < IDs.size()) {
+            // Count the IDs after this one which continue a run
+            size_t run = 0;
+            while (i + run + 1 < IDs.size() && static_cast<int64_t>(IDs[i + run + 1]) == static_cast<int64_t>(IDs[i + run]) + 1) {
+                run++;
+            }
+
+            // Zigzag encode the difference so small negative steps stay small
+            int64_t delta = static_cast<int64_t>(IDs[i]) - prev;
+            uint64_t zz = (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+
+            // Append the token, undoing it and stopping if it doesn't fit
+            const size_t before = out.size();
+            appendVarint(out, (zz << 1) | (run > 0 ? 1 : 0));
+            if (run > 0) {
+                appendVarint(out, run);
+            }
+            if (out.size() - start > maxBytes) {
+                out.resize(before);
+                break;
+            }
+
+            prev = IDs[i + run];
+            i += run + 1;
+        }
+        return i;
+    }
+
+    bool decode(const uint8_t * data, const size_t size, const size_t count, std::vector<int> & out) {
+        return decode(data, size, count, [&out](int id) {
+            out.push_back(id);
+        });
+    }
+
+    bool decode(const uint8_t * data, const size_t size, const size_t count, const std::function<void(int)> & func) {
+        size_t decoded = 0;
+        size_t pos = 0;
+        int64_t prev = 0;
+        while (decoded < count) {
+            uint64_t token;
+            if (!readVarint(data, size, pos, token)) {
+                return false;
+            }
+
+            // Undo the zigzag encoding
+            uint64_t zz = token >> 1;
+            int64_t delta = static_cast<int64_t>(zz >> 1) ^ -static_cast<int64_t>(zz & 1);
+            int64_t id = prev + delta;
+            if (id < INT32_MIN || id > INT32_MAX) {
+                return false;
+            }
+
+            // Read the length of the run if there is one, which can't go past the number expected
+            uint64_t run = 0;
+            if (token & 1) {
+                if (!readVarint(data, size, pos, run)) {
+                    return false;
+                }
+                if (run >= count - decoded || id + static_cast<int64_t>(run) > INT32_MAX) {
+                    return false;
+                }
+            }
+
+            for (uint64_t i = 0; i <= run; i++) {
+                func(static_cast<int>(id + i));
+            }
+            decoded += run + 1;
+            prev = id + run;
+        }
+        return (pos == size);
+    }
+};
\ No newline at end of file
@@ -1,10 +1,16 @@
 #include "ipc/Command.hpp"
+#include "ipc/IDList.hpp"
+#include "ipc/SharedState.hpp"
 #include "ipc/TriPlayer.hpp"
 #include <string.h>
 #include <switch.h>
 
 namespace TriPlayer {
     static Service * service = nullptr;         // Service object used for communication
+    static Service * waitService = nullptr;     // Service object used to wait for changes (so other calls aren't blocked)
+    static SharedMemory stateMemory;            // Memory the sysmodule publishes it's state in
+    static const Ipc::SharedState * sharedState = nullptr;  // Mapped state (nullptr if it couldn't be mapped)
+    static uint32_t features = 0;               // Optional features both us and the sysmodule support
 
     bool initialize() {
         // Return true if already initialized
@@ -26,16 +32,51 @@ namespace TriPlayer {
         if (R_FAILED(rc)) {
             delete service;
             service = nullptr;
+            return false;
+        }
+
+        // Agree on which optional features to use (none if the sysmodule doesn't know the command)
+        uint32_t supported = Ipc::Feature::CompactIDs;
+        rc = serviceDispatchInOut(service, static_cast<uint32_t>(Ipc::Command::Features), supported, features);
+        if (R_FAILED(rc)) {
+            features = 0;
+        }
+
+        // Map the memory the state is published in (getState() falls back to IPC if this fails)
+        Handle handle;
+        rc = serviceDispatch(service, static_cast<uint32_t>(Ipc::Command::GetStateMemory),
+            .out_handle_attrs = {SfOutHandleAttr_HipcCopy},
+            .out_handles = &handle,
+        );
+        if (R_SUCCEEDED(rc)) {
+            shmemLoadRemote(&stateMemory, handle, Ipc::SharedStateSize, Perm_R);
+            if (R_SUCCEEDED(shmemMap(&stateMemory))) {
+                sharedState = static_cast<const Ipc::SharedState *>(shmemGetAddr(&stateMemory));
+            } else {
+                shmemClose(&stateMemory);
+            }
         }
-        return (service != nullptr);
+        return true;
     }
 
     void exit() {
+        if (sharedState != nullptr) {
+            shmemClose(&stateMemory);
+            sharedState = nullptr;
+        }
+
+        if (waitService != nullptr) {
+            serviceClose(waitService);
+            delete waitService;
+            waitService = nullptr;
+        }
+
         if (service != nullptr) {
             serviceClose(service);
             delete service;
             service = nullptr;
         }
+        features = 0;
     }
 
     bool getVersion(std::string & outVersion) {
@@ -138,34 +179,116 @@ namespace TriPlayer {
     }
 
     bool getQueue(std::vector<int> & outIDs) {
-        // Request queue in groups of 100
-        constexpr size_t count = 100;
+        uint64_t version;
+        return getQueue(outIDs, version);
+    }
+
+    bool getQueue(std::vector<int> & outIDs, uint64_t & outVersion) {
+        // Request queue in groups of 100, or as many as fit in 16kB if they can be compacted
+        const bool compact = (features & Ipc::Feature::CompactIDs);
+        const size_t count = (compact ? 4096 : 100);
+        std::vector<uint8_t> buffer(compact ? count * sizeof(int) : 0);
         outIDs.clear();
 
         // Repeatedly request groups until we run out
         size_t offset = 0;
         while (true) {
-            // Prepare to handle received data
-            const struct {
+            struct {
                size_t index;
                size_t count;
-            } in = {offset, count};
-            outIDs.resize(offset + count);
+               Ipc::IDFormat format;
+            } in = {offset, count, (compact ? Ipc::IDFormat::Compact : Ipc::IDFormat::Raw)};
+            if (!compact) {
+                outIDs.resize(offset + count);
+            }
 
             // Request data
-            size_t returned = 0;
-            Result rc = serviceDispatchInOut(service, static_cast<uint32_t>(Ipc::Command::GetQueue), in, returned,
+            struct {
+                size_t returned;
+                uint64_t version;
+                size_t size;
+                size_t bytes;
+            } out = {0, 0, 0, 0};
+            Result rc = serviceDispatchInOut(service, static_cast<uint32_t>(Ipc::Command::GetQueue), in, out,
                 .buffer_attrs = {SfBufferAttr_Out | SfBufferAttr_HipcMapAlias},
-                .buffers = {{&outIDs[offset], count * sizeof(int)}},
+                .buffers = {{(compact ? static_cast<void *>(&buffer[0]) : &outIDs[offset]), count * sizeof(int)}},
             );
-            offset += returned;
             if (R_FAILED(rc)) {
                 return false;
             }
 
-            // Stop if we didn't receive the amount requested (means we've got the entire sub queue)
-            if (returned != count) {
-                outIDs.resize(offset);
+            // Start again if the queue changed between groups, as the ones we have may no longer match
+            if (offset > 0 && out.version != outVersion) {
+                offset = 0;
+                outIDs.clear();
+                continue;
+            }
+            outVersion = out.version;
+
+            // Stop once we've got the entire queue (compact groups vary in length, so check against the size)
+            if (compact) {
+                if (out.bytes > buffer.size() || !Ipc::IDList::decode(&buffer[0], out.bytes, out.returned, outIDs)) {
+                    return false;
+                }
+                offset += out.returned;
+                if (out.returned == 0 || offset >= out.size) {
+                    break;
+                }
+
+            } else {
+                offset += out.returned;
+                if (out.returned != count) {
+                    outIDs.resize(offset);
+                    break;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool getQueueChanges(const uint64_t sinceVersion, std::vector<QueueChange> & outChanges, uint64_t & outVersion, bool & outResync) {
+        // Request changes in groups of 64
+        constexpr size_t count = 64;
+        outChanges.clear();
+        outVersion = sinceVersion;
+        outResync = false;
+
+        // Repeatedly request groups until we've caught up
+        size_t offset = 0;
+        while (true) {
+            struct {
+                uint64_t version;
+                size_t count;
+            } in = {outVersion, count};
+            outChanges.resize(offset + count);
+
+            // Request data
+            struct {
+                uint64_t version;
+                size_t returned;
+                bool resync;
+            } out = {0, 0, false};
+            Result rc = serviceDispatchInOut(service, static_cast<uint32_t>(Ipc::Command::GetQueueChanges), in, out,
+                .buffer_attrs = {SfBufferAttr_Out | SfBufferAttr_HipcMapAlias},
+                .buffers = {{&outChanges[offset], count * sizeof(QueueChange)}},
+            );
+            if (R_FAILED(rc)) {
+                return false;
+            }
+            outVersion = out.version;
+            offset += out.returned;
+
+            // Any changes received are useless if they can't all be applied
+            if (out.resync) {
+                outChanges.clear();
+                outResync = true;
+                break;
+            }
+
+            // Stop if we didn't receive the amount requested (means we've got every change)
+            if (out.returned != count) {
+                outChanges.resize(offset);
                 break;
             }
         }
@@ -178,10 +301,25 @@ namespace TriPlayer {
     }
 
     bool setQueue(const std::vector<int> & IDs) {
+        // Send raw IDs if the sysmodule can't decode compact ones
         size_t count;
-        Result rc = serviceDispatchOut(service, static_cast<uint32_t>(Ipc::Command::SetQueue), count,
+        if (!(features & Ipc::Feature::CompactIDs)) {
+            Result rc = serviceDispatchOut(service, static_cast<uint32_t>(Ipc::Command::SetQueue), count,
+                .buffer_attrs = {SfBufferAttr_In | SfBufferAttr_HipcMapAlias},
+                .buffers = {{&IDs[0], IDs.size() * sizeof(int)}},
+            );
+            return (R_SUCCEEDED(rc));
+        }
+
+        std::vector<uint8_t> data;
+        Ipc::IDList::encode(IDs, data);
+        struct {
+            size_t count;
+            Ipc::IDFormat format;
+        } in = {IDs.size(), Ipc::IDFormat::Compact};
+        Result rc = serviceDispatchInOut(service, static_cast<uint32_t>(Ipc::Command::SetQueue), in, count,
             .buffer_attrs = {SfBufferAttr_In | SfBufferAttr_HipcMapAlias},
-            .buffers = {{&IDs[0], IDs.size() * sizeof(int)}},
+            .buffers = {{data.data(), data.size()}},
         );
         return (R_SUCCEEDED(rc));
     }
@@ -204,6 +342,34 @@ namespace TriPlayer {
         return (R_SUCCEEDED(serviceDispatchIn(service, static_cast<uint32_t>(Ipc::Command::RemoveFromQueue), pos)));
     }
 
+    bool editQueue(const std::vector<QueueEdit> & edits, const std::vector<int> & IDs) {
+        // Pack each edit followed by the IDs it uses into one buffer
+        std::vector<uint8_t> buf;
+        size_t next = 0;
+        for (const QueueEdit & edit : edits) {
+            const uint8_t * ptr = reinterpret_cast<const uint8_t *>(&edit);
+            buf.insert(buf.end(), ptr, ptr + sizeof(QueueEdit));
+
+            if (edit.type == QueueEditType::Insert || edit.type == QueueEditType::AppendSubQueue) {
+                if (next + edit.count > IDs.size()) {
+                    return false;
+                }
+                ptr = reinterpret_cast<const uint8_t *>(&IDs[next]);
+                buf.insert(buf.end(), ptr, ptr + edit.count * sizeof(int));
+                next += edit.count;
+            }
+        }
+
+        if (buf.empty()) {
+            return true;
+        }
+        Result rc = serviceDispatch(service, static_cast<uint32_t>(Ipc::Command::EditQueue),
+            .buffer_attrs = {SfBufferAttr_In | SfBufferAttr_HipcMapAlias},
+            .buffers = {{&buf[0], buf.size()}},
+        );
+        return (R_SUCCEEDED(rc));
+    }
+
     bool getRepeatMode(Repeat & outMode) {
         return (R_SUCCEEDED(serviceDispatchOut(service, static_cast<uint32_t>(Ipc::Command::GetRepeat), outMode)));
     }
@@ -220,6 +386,14 @@ namespace TriPlayer {
         return (R_SUCCEEDED(serviceDispatchIn(service, static_cast<uint32_t>(Ipc::Command::SetShuffle), mode)));
     }
 
+    bool getShuffleSeed(uint64_t & outSeed) {
+        return (R_SUCCEEDED(serviceDispatchOut(service, static_cast<uint32_t>(Ipc::Command::GetShuffleSeed), outSeed)));
+    }
+
+    bool setShuffleSeed(const uint64_t seed) {
+        return (R_SUCCEEDED(serviceDispatchIn(service, static_cast<uint32_t>(Ipc::Command::SetShuffleSeed), seed)));
+    }
+
     bool getSongID(int & outID) {
         return (R_SUCCEEDED(serviceDispatchOut(service, static_cast<uint32_t>(Ipc::Command::GetSong), outID)));
     }
@@ -288,4 +462,65 @@ namespace TriPlayer {
     bool stopSysmodule() {
         return (R_SUCCEEDED(serviceDispatch(service, static_cast<uint32_t>(Ipc::Command::Quit))));
     }
+
+    bool getStats(Stats & outStats) {
+        return (R_SUCCEEDED(serviceDispatchOut(service, static_cast<uint32_t>(Ipc::Command::GetStats), outStats)));
+    }
+
+    bool getLockStats(std::vector<LockStats> & outStats, const bool reset) {
+        outStats.resize(static_cast<size_t>(Lock::Count));
+        uint8_t in = (reset ? 1 : 0);
+        Result rc = serviceDispatchIn(service, static_cast<uint32_t>(Ipc::Command::GetLockStats), in,
+            .buffer_attrs = {SfBufferAttr_Out | SfBufferAttr_HipcMapAlias},
+            .buffers = {{&outStats[0], outStats.size() * sizeof(LockStats)}},
+        );
+        return (R_SUCCEEDED(rc));
+    }
+
+    bool getState(State & outState) {
+        // The state is only written for a moment, so only fall back to IPC if it's (somehow) being written throughout
+        if (sharedState != nullptr && Ipc::readSharedState(sharedState, outState, 100)) {
+            return true;
+        }
+        return (R_SUCCEEDED(serviceDispatchOut(service, static_cast<uint32_t>(Ipc::Command::GetState), outState)));
+    }
+
+    bool stateShared() {
+        return (sharedState != nullptr);
+    }
+
+    bool waitForChange(const uint32_t mask, const uint64_t sinceSequence, const uint64_t timeout, uint32_t & outChanged, uint64_t & outSequence) {
+        // Checking without waiting can share the main connection
+        Service * srv = service;
+        if (timeout > 0) {
+            if (waitService == nullptr) {
+                waitService = new Service;
+                Result rc = smGetServiceWrapper(waitService, smEncodeName("tri"));
+                if (R_FAILED(rc)) {
+                    delete waitService;
+                    waitService = nullptr;
+                    return false;
+                }
+            }
+            srv = waitService;
+        }
+
+        struct {
+            uint64_t sequence;
+            uint64_t timeout;
+            uint32_t mask;
+        } in = {sinceSequence, timeout, mask};
+        struct {
+            uint64_t sequence;
+            uint32_t changed;
+        } out = {sinceSequence, 0};
+        Result rc = serviceDispatchInOut(srv, static_cast<uint32_t>(Ipc::Command::WaitForChange), in, out);
+        if (R_FAILED(rc)) {
+            return false;
+        }
+
+        outChanged = out.changed;
+        outSequence = out.sequence;
+        return true;
+    }
 };
\ No newline at end of file
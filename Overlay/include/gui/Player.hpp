@@ -4,7 +4,7 @@
 #include "tesla.hpp"
 
 // Forward declarations
-class Database;
+class LibrarySnapshot;
 namespace Element {
     class Player;
 };
@@ -15,7 +15,7 @@ namespace Element {
 namespace Gui {
     class Player : public tsl::Gui {
         private:
-            Database * database;        // Database used to read metadata from
+            LibrarySnapshot * library;  // Library snapshot used to read metadata from
             Element::Player * player;   // Main element
             unsigned char ticks;        // Number of ticks in update() since last check
 
@@ -23,9 +23,9 @@ namespace Gui {
 
         public:
             // Initialize objects
-            Player(Database *);
+            Player(LibrarySnapshot *);
 
-            // Accepts database object to read metadata from
+            // Accepts library snapshot to read metadata from
             tsl::elm::Element * createUI();
 
             // Periodically check if we need to update the element
@@ -1,10 +1,12 @@
-#include "Database.hpp"
 #include "ipc/TriPlayer.hpp"
 #include "gui/Error.hpp"
 #include "gui/Player.hpp"
+#include "LibrarySnapshot.hpp"
+#include "Paths.hpp"
 #include "TriOverlay.hpp"
 
 TriOverlay::TriOverlay() : tsl::Overlay() {
+    this->library = nullptr;
     this->triInitialized = false;
 }
 
@@ -15,13 +17,12 @@ void TriOverlay::initServices() {
     // Attempt to connect to TriPlayer
     this->triInitialized = TriPlayer::initialize();
 
-    // Attempt to open connection to database
-    this->database = new Database();
-    this->dbInitialized = this->database->openReadOnly();
+    // Songs are looked up in the library snapshot as they're played (which doesn't need opening)
+    this->library = new LibrarySnapshot(Path::Common::LibraryFile);
 }
 
 void TriOverlay::exitServices() {
-    delete this->database;
+    delete this->library;
 
     if (this->triInitialized) {
         TriPlayer::exit();
@@ -33,10 +34,10 @@ void TriOverlay::exitServices() {
 
 std::unique_ptr<tsl::Gui> TriOverlay::loadInitialGui() {
     // Show error frame if service failed to initialize
-    if (!this->dbInitialized || !this->triInitialized) {
+    if (!this->triInitialized) {
         return std::make_unique<Gui::Error>();
     }
 
     // Otherwise proceed to normal (player) frame
-    return std::make_unique<Gui::Player>(this->database);
+    return std::make_unique<Gui::Player>(this->library);
 }
\ No newline at end of file
@@ -1,12 +1,12 @@
-#include "Database.hpp"
 #include "element/Player.hpp"
 #include "gui/Player.hpp"
 #include "ipc/TriPlayer.hpp"
+#include "LibrarySnapshot.hpp"
 #include "utils/FS.hpp"
 
 namespace Gui {
-    Player::Player(Database * db) {
-        this->database = db;
+    Player::Player(LibrarySnapshot * library) {
+        this->library = library;
         this->player = nullptr;
         this->currentSongID = -100;
         this->ticks = 0;
@@ -28,73 +28,53 @@ namespace Gui {
     }
 
     void Player::update() {
-        // Only update 10 times per second
-        if (this->ticks < 6) {
-            this->ticks++;
-            return;
+        // The state is read from shared memory every frame, but if it has to be requested only do so 10 times per second
+        if (!TriPlayer::stateShared()) {
+            if (this->ticks < 6) {
+                this->ticks++;
+                return;
+            }
+            this->ticks = 0;
         }
-        this->ticks = 0;
 
-        // Get currently playing song, and if changed update metadata
-        int songID;
-        if (!TriPlayer::getSongID(songID)) {
+        // Get a snapshot of the state
+        TriPlayer::State state;
+        if (!TriPlayer::getState(state)) {
             return;
         }
+
+        // If the song changed update metadata
+        int songID = state.songID;
         if (songID != this->currentSongID) {
-            // Get metadata from database
-            Metadata meta;
-            meta.id = -3;
-            if (songID >= 0) {
-                meta = this->database->getMetadataForID(songID);
-            }
+            // Get metadata from the library snapshot
+            LibrarySnapshot::Song song;
+            bool found = (songID >= 0 && this->library->getSong(songID, song, LibrarySnapshot::Fields::Title | LibrarySnapshot::Fields::Artist | LibrarySnapshot::Fields::ImagePath));
             this->currentSongID = songID;
 
             // Update values
-            if (meta.id < 0) {
-                this->player->setTitle((meta.id == -2 ? "An error occurred" : "Nothing playing!"));
-                this->player->setArtist((meta.id == -2 ? "Please restart the overlay" : "Play a song"));
+            if (!found) {
+                this->player->setTitle((songID >= 0 ? "Unknown song" : "Nothing playing!"));
+                this->player->setArtist((songID >= 0 ? "Open TriPlayer to update the library" : "Play a song"));
                 this->player->setDuration(0);
 
             } else {
-                this->player->setTitle(meta.title);
-                this->player->setArtist(meta.artist);
-                this->player->setDuration(meta.duration);
+                this->player->setTitle(song.title);
+                this->player->setArtist(song.artist);
+                this->player->setDuration(song.duration);
             }
 
             // Set new album art (an empty vector will cause default art to be shown)
             std::vector<uint8_t> buffer;
-            if (!meta.imagePath.empty() && !Utils::Fs::readFile(meta.imagePath, buffer)) {
+            if (found && !song.imagePath.empty() && !Utils::Fs::readFile(song.imagePath, buffer)) {
                 buffer.clear();
             }
             this->player->setAlbumArt(buffer);
         }
 
-        // Check playback status
-        TriPlayer::Status status;
-        if (!TriPlayer::getStatus(status)) {
-            return;
-        }
-        this->player->setPlaying(status == TriPlayer::Status::Playing);
-
-        // Check song position
-        double pos;
-        if (!TriPlayer::getPosition(pos)) {
-            return;
-        }
-        this->player->setPosition(pos);
-
-        // Check repeat
-        TriPlayer::Repeat repeat;
-        if (!TriPlayer::getRepeatMode(repeat)) {
-            return;
-        }
-        this->player->setRepeat(repeat != TriPlayer::Repeat::Off, repeat == TriPlayer::Repeat::One);
-
-        // Check shuffle
-        TriPlayer::Shuffle shuffle;
-        if (!TriPlayer::getShuffleMode(shuffle)) {
-            return;
-        }
-        this->player->setShuffle(shuffle == TriPlayer::Shuffle::On);
+        // Update playback status, position, repeat and shuffle
+        this->player->setPlaying(state.status == TriPlayer::Status::Playing);
+        this->player->setPosition(state.position);
+        this->player->setRepeat(state.repeat != TriPlayer::Repeat::Off, state.repeat == TriPlayer::Repeat::One);
+        this->player->setShuffle(state.shuffle == TriPlayer::Shuffle::On);
     }
 };
\ No newline at end of file
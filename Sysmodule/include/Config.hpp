@@ -2,8 +2,11 @@
 #define CONFIG_HPP
 
 #include <array>
+#include "dsp/Chain.hpp"
+#include "dsp/Resampler.hpp"
 #include "Log.hpp"
 #include <string>
+#include "Types.hpp"
 
 // Forward declaration as we only need the pointer here
 class minIni;
@@ -33,6 +36,21 @@ class Config {
         std::string keyComboPlay();
         std::string keyComboPrev();
 
+        // Number of output buffers (2 - 16, defaults to 6)
+        int bufferCount();
+        // Size of each output buffer in kB (4 - 256, defaults to 50)
+        int bufferSize();
+
+        // Seconds of audio to keep from the start of a song for replaying (0 - 5, defaults to 1)
+        int rewindStart();
+        // Seconds of recently decoded audio to keep for seeking back (0 - 5, defaults to 4)
+        int rewindRecent();
+
+        // Length of crossfade between songs in seconds (0 - 12, defaults to 0)
+        int crossfade();
+        // Seconds before the end of a song to open the next one (0 - 30, defaults to 5)
+        int preload();
+
         // Logging level (defaults to Warning)
         Log::Level logLevel();
 
@@ -42,12 +60,27 @@ class Config {
         // Pause when headset unplugged
         bool pauseOnUnplug();
 
+        // Maximum number of mpg123 handles that can be open at once (defaults to 2)
+        int MP3Decoders();
         // Seek method for mpg123 (defaults to false)
         bool MP3AccurateSeek();
         // Equalizer values for mpg123 (all 1.0 by default)
         // Returns all bands in order
         std::array<float, 32> MP3Equalizer();
 
+        // Filters applied to all audio (up to 8, none by default)
+        std::vector<Dsp::Filter> DSPFilters();
+        // Whether to limit peaks instead of clipping (defaults to false)
+        bool DSPLimiter();
+        // Gain applied before the filters in dB (-24 - 24, defaults to 0)
+        float DSPPreamp();
+        // How songs are normalized to the same loudness (defaults to Off)
+        NormalizeMode DSPNormalize();
+        // Loudness songs are normalized to in LUFS (-30 - -5, defaults to -18)
+        float DSPNormalizeTarget();
+        // Quality of the resampler used for songs not at the output rate (defaults to Medium)
+        Dsp::Resampler::Quality DSPResampleQuality();
+
         // Deletes minIni object
         ~Config();
 };
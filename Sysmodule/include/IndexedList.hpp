@@ -0,0 +1,94 @@
+#ifndef INDEXEDLIST_HPP
+#define INDEXEDLIST_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "Types.hpp"
+#include <vector>
+
+// Number of IDs stored in each node
+#define INDEXEDLIST_BLOCK_SIZE 64   // 272 bytes per node (~4.25 bytes per ID when full)
+
+// An indexed list stores a sequence of song IDs in an implicit treap (a randomly balanced
+// binary tree ordered by position) of small blocks, so IDs can be looked up, inserted, removed
+// and moved at any position in O(log n). Keeping many IDs in each node means the tree only
+// adds a few bytes to each ID. Nodes are allocated in chunks as the list grows (up to the
+// maximum given at creation) without throwing, so running out of memory can be reported
+// instead of aborting: reserve() should be called before adding IDs to make sure they fit.
+class IndexedList {
+    private:
+        // A node in the tree holding a block of consecutive IDs (index 0 is used as the null node)
+        struct Node {
+            uint32_t left;          // Subtree of earlier blocks
+            uint32_t right;         // Subtree of later blocks
+            uint32_t count;         // Number of IDs in this subtree (including this block's)
+            uint32_t used;          // Number of IDs in this block (or the next free node once freed)
+            SongID ids[INDEXEDLIST_BLOCK_SIZE]; // IDs in this block
+        };
+
+        std::vector<Node *> chunks; // All nodes (including free ones), in chunks which are never moved
+        uint32_t nextNode;          // Index of the first node which has never been used
+        uint32_t freeNode;          // Index of the first freed node (0 if there are none)
+        size_t freeCount;           // Number of freed nodes
+        uint32_t root;              // Index of the root node
+        size_t max;                 // Maximum number of IDs
+        uint64_t changes;           // Number of changes made
+
+        // Returns the node at the given index
+        Node & node(uint32_t);
+        // Returns an unused node, or 0 if there's no memory for one
+        uint32_t newNode();
+        // Marks a node as unused
+        void deleteNode(uint32_t);
+        // Updates a node's count after it's children or block have changed
+        void update(uint32_t);
+        // Splits a tree into the first given number of IDs and the rest (which must split between blocks)
+        void split(uint32_t, size_t, uint32_t &, uint32_t &);
+        // Joins two trees, with all of the first's IDs before the second's
+        uint32_t merge(uint32_t, uint32_t);
+        // Returns the block holding the given position, replacing the position with the offset into it.
+        // If the bool is true, a position just after a block can be in it (for inserting). The int is
+        // added to the count of each node passed on the way, so only pass non-zero if the change will be made.
+        uint32_t find(size_t &, bool, int);
+        // Moves a full block's IDs from the given offset to the next (or a new) block and inserts the ID at the offset
+        // (the first size_t is where the block starts, returns false if out of memory)
+        bool splitBlock(uint32_t, size_t, size_t, SongID);
+        // Joins a block with the following one if they fit in one block (the size_t is where the block starts)
+        void joinNext(uint32_t, size_t);
+
+    public:
+        // Constructor takes the maximum number of IDs to store
+        IndexedList(size_t);
+
+        // Make sure there's memory to insert the given number of IDs, split into the given
+        // number of runs of consecutive positions (returns false if there isn't)
+        bool reserve(size_t, size_t = 1);
+
+        // Insert an ID at the given position, shifting the following IDs down (returns false if full or out of memory)
+        // Positions past the end add to the end
+        bool insert(size_t, SongID);
+        // Remove the ID at the given position (returns false if out of bounds)
+        bool erase(size_t);
+        // Move the ID at the first position so it ends up at the second (returns false if either
+        // is out of bounds, or if out of memory, in which case nothing is moved)
+        bool move(size_t, size_t);
+
+        // Returns the ID at the given position (-1 if out of bounds)
+        SongID at(size_t);
+
+        // Remove all IDs (and free their memory)
+        void clear();
+        // Returns true if empty
+        bool empty();
+        // Returns the number of IDs stored
+        size_t size();
+        // Returns the maximum number of IDs that can be stored
+        size_t maxSize();
+        // Returns the number of changes made (to tell if the IDs have changed)
+        uint64_t changeCount();
+
+        // Frees all memory
+        ~IndexedList();
+};
+
+#endif
\ No newline at end of file
@@ -1,45 +1,67 @@
 #ifndef PLAYQUEUE_HPP
 #define PLAYQUEUE_HPP
 
-#include "Types.hpp"
-#include <vector>
+#include "IndexedList.hpp"
+#include "ipc/TriPlayer.hpp"
+#include "ShuffleOrder.hpp"
 
-// Struct stored in vector
-typedef struct {
-    SongID id;              // 4 bytes (it's an int)
-    unsigned short pos;     // 2 bytes (we don't need more than 65535)
-} PlayQueuePair;
-
-// A play queue stores a list of song IDs and can be shuffled, unshuffled (due to keeping original positions)
-// and have IDs inserted/removed. Even though it uses a vector there is a hard limit to avoid running out of RAM
+// A play queue stores a list of song IDs and can be shuffled, unshuffled and have IDs inserted/removed/moved.
+// IDs are always stored unshuffled in an indexed list, with a shuffle order mapping positions onto them while
+// shuffled, so (un)shuffling is O(1) and everything else is O(log n) regardless of the queue's size.
+// IDs added while shuffled are placed at the end when unshuffled. There is a hard limit to avoid running out of RAM.
+// Every change increases the queue's version, and the most recent changes are kept so a client holding a copy
+// of the queue can be sent just what changed since it's version instead of the whole queue.
 class PlayQueue {
     private:
         // Index of 'current' song
-        unsigned short idx;
-        // Largest pos in queue (used for adding IDs when shuffled)
-        unsigned short maxPos;
-        // Vector containing IDs
-        std::vector<PlayQueuePair> queue;
-        // Are we shuffled?
-        bool shuffled;
+        size_t idx;
+        // IDs in unshuffled order
+        IndexedList queue;
+        // Order of IDs while shuffled (nullptr if not shuffled)
+        ShuffleOrder * order;
+
+        // Version of the queue (increased by every change)
+        uint64_t version_;
+        // Version the queue was last reset at (cleared or (un)shuffled), as changes before it can't be replayed
+        uint64_t resetVersion;
+        // Most recent changes, with the one that made version v stored at index v % size
+        std::vector<TriPlayer::QueueChange> changes;
+
+        // Update the current index after the ID at the first position was moved to the second
+        void moveIdx(size_t, size_t);
+        // Record a change, increasing the version
+        void logChange(TriPlayer::QueueChangeType, SongID, size_t, size_t);
+        // Record that every position may have changed, increasing the version
+        void logReset();
 
     public:
         PlayQueue();
 
         // Add an ID at given position, shifting down (returns false if full)
-        bool addID(SongID, unsigned short);
+        bool addID(SongID, size_t);
         // Remove ID at given position (returns false if out of bounds)
-        bool removeID(unsigned short);
+        bool removeID(size_t);
 
         // Shift ID at position by given spots towards end (will move to end if too far)
-        void moveIDDown(unsigned short, unsigned short);
+        void moveIDDown(size_t, size_t);
         // Shift ID at position by given spots towards start (will move to start if too far)
-        void moveIDUp(unsigned short, unsigned short);
+        void moveIDUp(size_t, size_t);
+
+        // Insert the given number of IDs at the position (keeping the current song current)
+        // Returns false without inserting any if they won't all fit (or there's no memory for them)
+        bool addIDs(const SongID *, size_t, size_t);
+        // Remove the given number of IDs starting at the position (keeping the current song current if it's not removed)
+        // Returns false without removing any if the range is out of bounds
+        bool removeIDs(size_t, size_t);
+        // Move the given number of IDs starting at the first position so the first ends up at the second
+        // (keeping the current song current). Returns false without moving any if either range is out of bounds
+        // (or there's no memory to move them)
+        bool moveIDs(size_t, size_t, size_t);
 
         // Get the current ID (-1 if empty)
         SongID currentID();
         // Returns ID at position (-1 if out of bounds)
-        SongID IDatPosition(unsigned short);
+        SongID IDatPosition(size_t);
 
         // Get the index of the current ID
         size_t currentIdx();
@@ -48,7 +70,7 @@ class PlayQueue {
         // Increase position (does nothing if at the end)
         void incrementIdx();
         // Set position (set to end if larger than size)
-        void setIdx(unsigned short);
+        void setIdx(size_t);
 
         // Clear the queue
         void clear();
@@ -56,13 +78,32 @@ class PlayQueue {
         bool empty();
         // Return number of IDs in queue
         size_t size();
+        // Return maximum number of IDs the queue can hold
+        size_t maxSize();
+        // Make sure there's memory to add the given number of IDs in the given number of runs
+        // of consecutive positions, so adding them can't fail part way (returns false if there isn't)
+        bool reserve(size_t, size_t = 1);
 
         // Returns true if shuffled
         bool isShuffled();
-        // (Re)shuffle the queue (current song will become the first song in queue)
+        // (Re)shuffle the queue with a random seed (current song will become the first song in queue)
+        // An empty queue is left unshuffled, as there's no order to permute
         void shuffle();
+        // (Re)shuffle the queue using the given seed (the same seed, queue and current song give the same order)
+        void shuffle(uint64_t);
+        // Returns the seed of the current shuffle (0 if not shuffled)
+        uint64_t shuffleSeed();
         // Unshuffle the queue (no effect if not shuffled)
         void unshuffle();
+
+        // Returns the current version of the queue
+        uint64_t version();
+        // Append up to the given number of changes made after the given version to the vector (in order)
+        // Returns false if they aren't all known, in which case the whole queue needs to be read again
+        bool changesSince(uint64_t, size_t, std::vector<TriPlayer::QueueChange> &);
+
+        // Frees the shuffle order
+        ~PlayQueue();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef REWINDCACHE_HPP
+#define REWINDCACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// The rewind cache keeps a copy of the start of the current song along with
+// the audio most recently decoded from it. Restarting the song or seeking back
+// a short distance can then be served from memory instead of seeking (or
+// reopening) the source. Only one song is cached at a time, and the position of
+// the cache must be kept in sync with the source it is recording.
+class RewindCache {
+    private:
+        int16_t * start;        // First samples of the song
+        size_t startLength;     // Number of samples the start can hold
+        size_t startFill;       // Number of samples stored in the start
+        int16_t * recent;       // Ring holding the most recently decoded samples
+        size_t recentLength;    // Number of samples the ring can hold
+        size_t recentFill;      // Number of samples stored in the ring
+        size_t recentEnd;       // Index in the ring that the next sample is written to
+
+        int channels;           // Channels in the current song
+        long rate;              // Sample rate of the current song
+        size_t startSecs;       // Requested seconds to keep from the start
+        size_t recentSecs;      // Requested seconds of recent audio to keep
+
+        size_t decodePos;       // Position (in samples) of the next sample decoded by the source
+        size_t readPos;         // Position of the next sample to be played (behind decodePos while serving)
+
+        // Frees memory used for samples
+        void freeMemory();
+
+    public:
+        // Constructor allocates nothing until a song is provided
+        RewindCache();
+
+        // Set the number of seconds to keep from the start of a song and of recently decoded audio
+        // (takes effect from the next song, and is limited to avoid exhausting the heap)
+        void setLength(size_t, size_t);
+        // Prepare for a new song with the given sample rate and channels (discards everything)
+        void reset(long, int);
+
+        // Record decoded audio which follows on from the previous call
+        void record(const uint8_t *, size_t);
+        // Call after the source has been seeked to the given position (discards recent audio)
+        void seeked(size_t);
+
+        // Start serving audio from the given position if it is cached, returning whether it was
+        bool rewind(size_t);
+        // Copy served audio into the given buffer, returning the number of bytes written
+        // (zero once caught up to the source or the rest isn't cached)
+        size_t read(uint8_t *, size_t);
+        // Returns the position (in samples) of the next sample to be played
+        size_t position();
+        // Returns whether the source is positioned where playback is up to, and so can be decoded from
+        // (if not, the source must be seeked to position() and seeked() called)
+        bool synced();
+
+        // Frees memory
+        ~RewindCache();
+};
+
+#endif
\ No newline at end of file
@@ -1,26 +1,42 @@
 #ifndef MAINSERVICE_HPP
 #define MAINSERVICE_HPP
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <ctime>
-#include <deque>
+#include <mutex>
 #include <shared_mutex>
 #include "ipc/Command.hpp"
 #include "ipc/Result.hpp"
 #include "ipc/Server.hpp"
+#include "ipc/SharedState.hpp"
+#include "dsp/Resampler.hpp"
+#include "ipc/TriPlayer.hpp"
+#include "LibrarySnapshot.hpp"
 #include "Types.hpp"
+#include "utils/ProfiledMutex.hpp"
 
 // Forward declare pointers
 class Audio;
 class Config;
-class Database;
+namespace Dsp {
+    class Chain;
+};
+class IndexedList;
 class PlayQueue;
+class RewindCache;
 class Source;
 
 // Class which manages all actions taken when receiving a command
 // Essentially encapsulates everything
 class MainService {
     private:
+        // Locks which record how often they're waited on (see TriPlayer::getLockStats())
+        typedef Utils::ProfiledMutex<std::mutex> Mutex;
+        typedef Utils::ProfiledMutex<std::shared_mutex> SharedMutex;
+
         // Enum specifying what action to take when changing a song (i.e. getting a new source)
         enum class SongAction {
             Previous,   // Go to the last song in the queue (if there is one)
@@ -29,18 +45,55 @@ class MainService {
             Nothing     // Do nothing
         };
 
+        // Snapshot of the state clients can wait on, compared to find what has changed
+        struct State {
+            SongID song;
+            TriPlayer::Status status;
+            double position;
+            double volume;
+            RepeatMode repeat;
+            bool shuffled;
+            uint64_t queueVersion;
+            size_t queueIdx;
+            size_t queueSize;
+            uint64_t subQueueChanges;
+            size_t subQueueSize;
+            std::string playingFrom;
+        };
+
+        // An action waiting to be handled along with how many times to perform it
+        // (repeated presses of Next/Previous are merged into one entry)
+        struct QueuedAction {
+            SongAction action;
+            size_t count;
+        };
+
         // Audio instance
         Audio * audio;
         // Config object
         Config * cfg;
-        // Database object
-        Database * db;
+        // Snapshot of the library written by the app (used instead of the database)
+        LibrarySnapshot * library;
         // IPC Server which clients interact with
         Ipc::Server * ipcServer;
+        // Ring buffer of requests for commands which may block, handled (in order) by the IPC worker thread so the
+        // IPC thread can keep answering other clients
+        std::array<Ipc::Request *, 16> deferred;
+        size_t deferredHead;
+        size_t deferredCount;
+        // Whether the worker thread is handling a deferred request (the server owns it, so it can't be deleted until this is false)
+        bool deferredBusy;
+        // Mutex for accessing deferred requests, and condition used to wake the worker thread (or anyone waiting for it to finish)
+        std::mutex deferredMutex;
+        std::condition_variable deferredCond;
         // Main queue of songs
         PlayQueue * queue;
         // Queue of 'queued' songs
-        std::deque<SongID> subQueue;
+        IndexedList * subQueue;
+        // Shuffle waiting for songs to shuffle (restored from the state file, or requested while the queue was empty)
+        // It's reported while the queue is empty, and the seed is used by the next request to shuffle
+        bool pendingShuffle;
+        uint64_t pendingSeed;
 
         // Whether to stop loop and exit
         std::atomic<bool> exit_;
@@ -53,39 +106,140 @@ class MainService {
         // Repeat mode
         std::atomic<RepeatMode> repeatMode;
         // Status vars for comm. between threads
-        std::atomic<SongAction> songAction; // (should this be a queue?)
         std::atomic<double> seekTo;
+
+        // Ring buffer of actions to be handled (in order) by the playback thread
+        std::array<QueuedAction, 32> actions;
+        size_t actionHead;
+        std::atomic<size_t> actionCount;
+        // Mutex for accessing actions, and condition used to wake the playback thread
+        std::mutex actionMutex;
+        std::condition_variable actionCond;
+        bool woken;
         // Whether to listen for events
         std::atomic<bool> watchGpio;
         std::atomic<bool> watchHid;
         std::atomic<bool> watchSleep;
 
         // Mutex for accessing queue
-        std::shared_mutex qMutex;
+        SharedMutex qMutex;
         // Mutex for accessing source
-        std::shared_mutex sMutex;
+        SharedMutex sMutex;
         // Mutex for accessing sub-queue
-        std::shared_mutex sqMutex;
-        // Source currently playing
+        SharedMutex sqMutex;
+        // Source currently playing, the ID it was opened for and a cache of it's recently decoded audio
         Source * source;
+        SongID sourceID;
+        RewindCache * rewind;
+        // Source being faded out (only set while crossfading)
+        Source * fadeSource;
+        // Source opened ahead of time for the next song, and the ID it was opened for
+        Source * nextSource;
+        SongID nextSourceID;
+        // Length of crossfade between songs in seconds (zero if disabled)
+        std::atomic<int> crossfade;
+        // Seconds before the end of a song to open the next one (zero if disabled)
+        std::atomic<int> preload;
+        // Filters applied to decoded audio before it's queued
+        Dsp::Chain * dsp;
+        // How songs are normalized and the loudness (in LUFS) they're normalized to
+        NormalizeMode normalize;
+        float normalizeTarget;
+        // Quality used when resampling songs to the output rate
+        Dsp::Resampler::Quality resampleQuality;
+
+        // Last seen state, when the position was last marked as changed, the sequence number of the most recent
+        // change and the sequence number each piece of state (bit of TriPlayer::Change) last changed at
+        State state;
+        std::chrono::steady_clock::time_point positionTime;
+        uint64_t changeSequence;
+        std::array<uint64_t, 10> changedAt;
+        // Mutex for accessing the above
+        Mutex changeMutex;
+        // Memory the state is published in for clients to read without IPC (nullptr if it couldn't be created)
+        // and the handle to it which is copied to clients. It's written while changeMutex is locked.
+        Ipc::SharedState * sharedState;
+        uint32_t sharedStateHandle;
+
+        // Ring buffer of the most recent times taken to decode a buffer (in microseconds)
+        std::array<uint32_t, 512> decodeTimes;
+        size_t decodeTimesCount;
+        size_t decodeTimesNext;
+        // Mutex for accessing decode times
+        Mutex statsMutex;
 
         // Mutex for access combo strings
-        std::shared_mutex cMutex;
+        SharedMutex cMutex;
         // Variables for reacting to press combinations
         std::atomic<bool> combosUpdated;
         std::string comboNextString;
         std::string comboPlayString;
         std::string comboPrevString;
 
-        // Variables used for 'locking' DB access
-        std::mutex dbMutex;
-        std::atomic<bool> dbLocked;
 
         // Reads config from disk and sets up relevant objects
         void updateConfig();
 
+        // Queues an action for the playback thread and wakes it (dropped if the queue is full)
+        void queueAction(const SongAction);
+        // Removes the oldest queued action, returning false if there isn't one
+        bool takeAction(SongAction &, size_t &);
+        // Drops every queued action (the queue mutex must be locked so the playback thread isn't applying them)
+        void clearActions();
+        // Returns whether an action is waiting to be handled
+        bool hasAction();
+        // Wakes the playback thread without queueing an action (i.e. for a seek)
+        void wakePlayback();
+        // Blocks the playback thread for the given number of ms or until woken
+        void waitForAction(const size_t);
+        // Moves the queue's position for the given action. Both queue mutexes must be locked before calling!
+        void applyAction(const SongAction);
+
+        // Looks up the given song in the library snapshot, reading the requested strings (see LibrarySnapshot::Fields)
+        // Retries briefly if the snapshot is being replaced, returning false if it still can't be read or the song isn't in it
+        // This reads the SD card (and may sleep), so the queue mutexes shouldn't be locked when calling!
+        bool getSong(SongID, LibrarySnapshot::Song &, const uint32_t);
+        // Returns the path for the given ID (blank on error)
+        std::string getPathForID(SongID);
+        // Returns the gain (in dB) which normalizes the given song's loudness (zero if disabled or not analysed)
+        float normalizeGain(SongID);
+        // Sets the pending shuffle if the queue was shuffled when the service last ran, so shuffling the next
+        // queue uses the same seed
+        void loadShuffle();
+        // Returns whether the queue is (or will be) shuffled and it's seed, as reported to clients and stored
+        // (the queue mutex must be locked before calling!)
+        void getShuffle(bool &, uint64_t &);
+        // Stores whether the queue is shuffled and it's seed, so they can be restored next time (no mutexes should be locked!)
+        void saveShuffle(const bool, const uint64_t);
+        // Returns a new Source for the given file, chosen based on it's extension (and resampled to the output rate)
+        Source * openSource(const std::string &);
+        // Returns the ID of the song that follows the current one, setting the action which moves to it
+        // (SongAction::Nothing if there isn't one). Both queue mutexes must be locked before calling!
+        SongID nextSongID(SongAction &);
+
+        // Returns the current playback status
+        TriPlayer::Status status();
+        // Returns the position in the current song (0.0 to 100.0)
+        double position();
+        // Compares the state to the last seen state, waking the IPC server if any changed, and publishes it (no mutexes can be locked!)
+        void checkForChanges();
+        // Fills the given struct with the current state (changeMutex must be locked before calling!)
+        void getState(TriPlayer::State &);
+        // Returns the bits of the mask which changed after the given sequence number, setting the latest sequence number
+        uint32_t changesSince(const uint32_t, const uint64_t, uint64_t &);
+
+        // Records the time taken to decode a single buffer
+        void recordDecodeTime(const std::chrono::steady_clock::duration);
+        // Fills the given struct with current audio and decoding statistics
+        void getStats(TriPlayer::Stats &);
+        // Appends the stats of each lock (in the order of TriPlayer::Lock) to the request's reply, optionally resetting them
+        void getLockStats(Ipc::Request *, const bool);
+
         // Function run to handle an IPC Request
         Ipc::Result commandThread(Ipc::Request *);
+        // Passes a request to the IPC worker thread, returning false if it must be handled now (i.e. the command
+        // can't block or too many are waiting)
+        bool deferRequest(Ipc::Request *);
 
     public:
         // Constructor initializes everything
@@ -100,6 +254,8 @@ class MainService {
         void hidEventThread();
         // Handles interactions from client(s)
         void ipcThread();
+        // Handles requests for commands which may block (see deferRequest())
+        void ipcWorkerThread();
         // Handles decoding and shifting between songs due to commands
         void playbackThread();
         // Listens for 'sleep' event and pauses playback
@@ -0,0 +1,76 @@
+#ifndef SHUFFLEORDER_HPP
+#define SHUFFLEORDER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A shuffle order maps positions in a shuffled queue to indexes in the unshuffled queue without
+// storing the order itself. The queue's size when shuffled is fixed and the chosen song is placed
+// first, with every other index being the output of a seeded Feistel network (a bijection, so each
+// song appears exactly once). Creating an order is O(1) and the same seed always gives the same order.
+//
+// Edits made while shuffled are recorded in a small treap of 'runs', each being either a range of
+// consecutive shuffled positions or a single index. Songs added while shuffled are expected to be
+// appended to the unshuffled queue (so they're placed at the end when unshuffling), and songs removed
+// must also be removed from the unshuffled queue, which is then always up to date.
+class ShuffleOrder {
+    private:
+        // A run of positions in the order (index 0 is used as the null node)
+        struct Run {
+            uint32_t value;         // First position in the permutation, or the index if direct
+            uint32_t length;        // Number of positions in the run (always 1 if direct)
+            uint32_t left;          // Subtree of earlier runs
+            uint32_t right;         // Subtree of later runs
+            uint32_t total;         // Number of positions in this subtree (including itself)
+            bool direct;            // Whether value is an index instead of a position in the permutation
+        };
+
+        uint64_t seed_;             // Seed the order was created with
+        uint32_t keys[8];           // Key for each round of the network (the small block sizes need more than four to mix well)
+        uint32_t domain;            // Number of indexes which are permuted (all but the first)
+        uint32_t halfBits;          // Bits in each half of the network's block
+        uint32_t first;             // Index placed first in the order
+
+        std::vector<Run> runs;      // All runs (including freed ones)
+        std::vector<uint32_t> freed;        // Indexes of freed runs which can be reused
+        uint32_t root;              // Index of the root run
+        std::vector<uint32_t> removed;      // Sorted indexes (as they were before any removals) which have been removed
+        uint32_t nextIndex;         // Index (ignoring removals) that the next added song is appended at
+
+        // Returns the permuted value for a position in [0, domain)
+        uint32_t permute(uint32_t);
+        // Returns the index (ignoring removals) at the given position (which must be valid)
+        uint32_t virtualAt(size_t);
+        // Returns the current index of an index that ignores removals
+        size_t actualIndex(uint32_t);
+
+        // Returns a new run with the given value and length
+        uint32_t newRun(uint32_t, uint32_t, bool);
+        // Updates a run's total after it's children have changed
+        void update(uint32_t);
+        // Splits a tree into the first given number of positions and the rest (cutting a run if needed)
+        void split(uint32_t, size_t, uint32_t &, uint32_t &);
+        // Joins two trees, with all of the first's positions before the second's
+        uint32_t merge(uint32_t, uint32_t);
+
+    public:
+        // Constructor takes the size of the queue, the index to place first and the seed
+        ShuffleOrder(size_t, size_t, uint64_t);
+
+        // Returns the seed the order was created with
+        uint64_t seed();
+        // Returns the number of positions in the order
+        size_t size();
+        // Returns the unshuffled index at the given position (which must be valid)
+        size_t index(size_t);
+
+        // Insert a song at the given position, which must have been appended to the unshuffled queue
+        void insert(size_t);
+        // Remove the song at the given position, returning the unshuffled index that must be removed
+        size_t erase(size_t);
+        // Move the song at the first position so it ends up at the second (both must be in bounds)
+        void move(size_t, size_t);
+};
+
+#endif
\ No newline at end of file
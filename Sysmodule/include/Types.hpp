@@ -7,6 +7,12 @@ enum class RepeatMode {
     All         // Repeat the queue
 };
 
+enum class NormalizeMode {
+    Off,        // Play songs as they are
+    Track,      // Adjust each song by it's own loudness
+    Album       // Adjust each song by it's album's loudness
+};
+
 typedef int SongID;
 
 #endif
\ No newline at end of file
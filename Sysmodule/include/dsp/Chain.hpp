@@ -0,0 +1,73 @@
+#ifndef DSP_CHAIN_HPP
+#define DSP_CHAIN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Dsp {
+    // Parameters describing a single filter
+    struct Filter {
+        // Shape of the filter
+        enum class Type {
+            Peak,           // Boost/cut around the frequency
+            LowShelf,       // Boost/cut below the frequency
+            HighShelf,      // Boost/cut above the frequency
+            LowPass,        // Remove above the frequency (gain is ignored)
+            HighPass        // Remove below the frequency (gain is ignored)
+        };
+
+        Type type;
+        float freq;         // Centre/corner frequency (in Hz)
+        float gain;         // Amount to boost/cut (in dB)
+        float q;            // Quality factor (higher is narrower)
+    };
+
+    // A chain of biquad filters followed by an optional limiter, applied to decoded
+    // interleaved 16-bit PCM before it is queued for output. It doesn't depend on
+    // the codec, and can be reconfigured between buffers without resetting the state
+    // of filters which are only adjusted (so there's no click when changing settings).
+    class Chain {
+        private:
+            // Coefficients (normalized by a0) and state of a single biquad for up to two channels
+            struct Biquad {
+                float b0, b1, b2, a1, a2;
+                float z1[2];
+                float z2[2];
+            };
+
+            std::vector<Filter> filters;    // Parameters of each filter
+            std::vector<Biquad> biquads;    // Filters applied in order
+            float preamp;                   // Linear gain applied before filtering
+            float gain;                     // Linear gain for the current song (i.e. to normalize it's loudness)
+            bool limiter;                   // Whether peaks are limited (otherwise they're clipped)
+            float limitGain;                // Current gain applied by the limiter
+            float limitRelease;             // Amount the limiter's gain recovers per frame
+
+            int channels;                   // Channels in the audio being processed
+            long rate;                      // Sample rate of the audio being processed
+
+            // Recalculates all coefficients for the current sample rate (state is kept)
+            void updateCoefficients();
+            // Runs the chain over a block of interleaved float samples
+            void processBlock(float *, size_t);
+
+        public:
+            // Constructor creates an empty chain (which passes audio through untouched)
+            Chain();
+
+            // Set the filters, preamp (in dB) and whether to limit peaks
+            void setFilters(const std::vector<Filter> &, float, bool);
+            // Set the format of audio being processed (resets state if it changes)
+            void setFormat(long, int);
+            // Set the gain (in dB) for the current song, applied along with the preamp
+            void setGain(float);
+
+            // Returns whether the chain alters audio at all
+            bool active();
+            // Processes the given number of samples in place
+            void process(int16_t *, size_t);
+    };
+};
+
+#endif
\ No newline at end of file
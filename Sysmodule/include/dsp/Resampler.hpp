@@ -0,0 +1,53 @@
+#ifndef DSP_RESAMPLER_HPP
+#define DSP_RESAMPLER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Dsp {
+    // A polyphase windowed-sinc resampler converting interleaved 16-bit PCM between two
+    // fixed rates. Input is pushed in whatever amounts are available, and output is pulled
+    // as it's needed. Rates are converted exactly if the ratio between them is simple enough
+    // (e.g. 44.1kHz to 48kHz uses 160 phases), otherwise the ratio is approximated very closely.
+    class Resampler {
+        public:
+            // Tradeoff between quality and CPU usage
+            enum class Quality {
+                Low,            // 8 taps (cheapest, rolls off noticeably below Nyquist)
+                Medium,         // 16 taps
+                High            // 32 taps (flattest passband and best stopband)
+            };
+
+        private:
+            int channels;                   // Channels in the audio
+            size_t taps;                    // Taps in the filter for each phase
+            size_t half;                    // Half the number of taps (samples needed either side of a position)
+            size_t phases;                  // Number of phases (L in L/M)
+            size_t step;                    // Phases moved per output frame (M in L/M)
+            std::vector<float> coeffs;      // Filter for each phase, one after another
+
+            std::vector< std::vector<float> > input;    // Pushed samples for each channel (along with history)
+            size_t fill;                    // Number of samples held in each channel's buffer
+            size_t pos;                     // Index of the input sample the next output frame follows
+            size_t phase;                   // Phase of the next output frame between pos and pos + 1
+
+        public:
+            // Constructor prepares the filter for the given input rate, output rate, channels and quality
+            Resampler(long, long, int, Quality);
+
+            // Discards all audio (i.e. after seeking)
+            void reset();
+            // Returns the maximum number of frames that can be pushed at once
+            size_t capacity();
+            // Push the given number of frames of input (must not exceed capacity())
+            void push(const int16_t *, size_t);
+            // Pushes silence so the last frames pushed can be pulled (i.e. at the end of a song)
+            void flush();
+            // Resample as much pushed audio as possible into the given buffer, up to the given number
+            // of frames, returning the number written (zero means more input is needed)
+            size_t pull(int16_t *, size_t);
+    };
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef IPC_HIPCSERVER_HPP
+#define IPC_HIPCSERVER_HPP
+
+#include "ipc/Server.hpp"
+#include <switch.h>
+
+// This was heavily inspired by sys-clk's ipc server, a big thanks to those
+// who wrote the original C version:
+// --------------------------------------------------------------------------
+// "THE BEER-WARE LICENSE" (Revision 42):
+// <p-sam@d3vs.net>, <natinusala@gmail.com>, <m4x@m4xw.net>
+// wrote this file. As long as you retain this notice you can do whatever you
+// want with this stuff. If you meet any of us some day, and you think this
+// stuff is worth it, you can buy us a beer in return.  - The sys-clk authors
+// --------------------------------------------------------------------------
+namespace Ipc {
+    // Extends Server to receive requests from other processes on the console,
+    // as a service registered with sm and using CMIF messages on the TLS
+    class HipcServer : public Server {
+        private:
+            SmServiceName serverName;       // Name of IPC server
+
+            std::vector<Handle> handles;    // Server (index 0), wake event (index 1) and client's handles
+            size_t maxHandles;              // Maximum number of clients (plus the server and wake event)
+            Event wakeEvent;                // Signalled to pass held requests to the handler again
+
+            // Send the reply to a request (which must be written to the TLS first)
+            ::Result reply(Handle);
+            // Process a session
+            bool processSession(const int32_t);
+            bool processNewSession();
+
+        protected:
+            bool sendReply(const uint32_t, Request *);
+            void resumeClient(const uint32_t);
+            void closeClient(const uint32_t);
+
+        public:
+            // Constructor inits server (accepts name and max connection count)
+            HipcServer(const std::string &, const size_t);
+
+            bool process();
+            void wake();
+
+            // Clean up and stop the server
+            ~HipcServer();
+    };
+};
+
+#endif
\ No newline at end of file
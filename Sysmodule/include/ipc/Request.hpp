@@ -1,16 +1,17 @@
 #ifndef IPC_REQUEST_HPP
 #define IPC_REQUEST_HPP
 
-#include <cstring>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include "ipc/Result.hpp"
 #include <string>
-#include <switch.h>
-#include <vector>
 #include "utils/Buffer.hpp"
 
 // The Request class encapsulates all data/functionality related to an IPC request.
-// All data is copied from the thread-local storage which should allow other IPC calls
-// to be made in between operations on instances of this class.
+// Requests are created ahead of time and reused (see Server), so handling one never allocates.
+// The 'arguments' are copied in as the transport may reuse their memory (i.e. the TLS), while
+// the data is read from and the reply data written to the client's buffers directly.
 namespace Ipc {
     class Request {
         public:
@@ -21,92 +22,157 @@ namespace Ipc {
                 Other           // Other, unhandled type
             };
 
+            static constexpr size_t maxArgsSize = 0x100;   // Largest 'arguments'/'value' (the size of the TLS)
+            static constexpr size_t maxHandles = 8;        // Most handles a reply can copy to the client
+
         private:
             uint64_t cmd_;                              // IPC command id
-            uint32_t result;                            // IPC result code
+            uint32_t result_;                           // IPC result code
             Type type_;                                 // Request type (see enum)
 
-            std::vector<uint8_t> inArgs;                // Received 'arguments'
+            std::array<uint8_t, maxArgsSize> inArgs;    // Received 'arguments'
+            size_t inArgsSize;                          // Number of bytes of 'arguments'
             size_t inArgsPos;                           // Position to read from next
-            std::vector<uint8_t> inData;                // Received data
+            const uint8_t * inData;                     // Received data (client's buffer)
+            size_t inDataSize;                          // Size of received data
             size_t inDataPos;                           // Position to read from next
 
-            std::vector<uint8_t> outArgs;               // Reply value(s)
-            std::vector<uint8_t> outData;               // Reply data
-            std::vector<HipcBufferDescriptor> outMeta;  // Copy of hipc metadata
+            std::array<uint8_t, maxArgsSize> outArgs;   // Reply value(s)
+            size_t outArgsSize;                         // Number of bytes of reply value(s)
+            uint8_t * outData;                          // Reply data (client's buffer, or one the transport sends)
+            size_t outDataCapacity;                     // Size of the reply data buffer
+            size_t outDataSize;                         // Number of bytes of reply data written
+            std::array<uint32_t, maxHandles> outHandles;    // Handles to copy to the client
+            size_t outHandlesCount;                     // Number of handles to copy
 
-            // Private constructor as we can instantiate a request using different data
-            Request();
+            bool held_;                                 // Whether the reply is being held
+            bool hasDeadline;                           // Whether the deadline has been set
+            std::chrono::steady_clock::time_point deadline_;    // Time the held reply must be sent by
+            bool deferred_;                             // Whether the request is being handled on another thread
+            std::atomic<bool> completed_;               // Set by the other thread once the deferred request is handled
 
         public:
-            // Create a request from the thread-local storage
-            // Returns nullptr on a fatal error
-            static Request * fromTLS();
+            // Create an empty request, which is filled by reset()
+            Request();
 
-            // Use class members to construct a response on thread-local storage
-            void toResponseTLS();
+            // Prepare to handle a newly received request of the given type and command id. Accepts the 'arguments' (copied),
+            // the received data and the buffer to write reply data to (with their sizes). The buffers aren't copied, so they
+            // must stay valid until the request is replied to. Returns false if the 'arguments' are too large.
+            bool reset(const Type, const uint64_t, const uint8_t *, const size_t, const uint8_t *, const size_t, uint8_t *, const size_t);
 
             // Return command id
             uint64_t cmd();
 
             // Set result code to return to caller
             void setResult(const uint32_t);
+            // Return result code to return to caller
+            uint32_t result();
 
             // Return type of request
             Type type();
 
-            // Return a reference to the received data buffer (as a vector)
-            const std::vector<uint8_t> & getRequestBuffer();
-
-            // Return a reference to the reply data buffer (as a vector)
-            const std::vector<uint8_t> & getReplyBuffer();
+            // Hold the reply for up to the given number of ms (measured from the first call). A held request
+            // is passed to the handler again each time the server is woken or the time passes, until it's not held.
+            // Returns false (and doesn't hold) once the time has passed.
+            bool hold(const uint64_t);
+            // Returns whether the reply is being held
+            bool held();
+            // Returns the time the held reply must be sent by
+            std::chrono::steady_clock::time_point deadline();
+            // Reset reading and the reply so the request can be handled again
+            void restart();
+
+            // Defer the reply so the request can be handled on another thread (i.e. one which may block), which must call
+            // complete() once done. The server holds it without passing it to the handler again until then.
+            void defer();
+            // Returns whether the reply is deferred
+            bool deferred();
+            // Set the result of a deferred request, marking it ready to be replied to (called by the other thread)
+            void complete(const uint32_t);
+            // Returns whether a deferred request has been completed
+            bool completed();
+
+            // Return the received data and it's size
+            const uint8_t * requestData();
+            size_t requestDataSize();
+
+            // Return the size of the buffer reply data is written to (0 if there isn't one), and how much has been written
+            size_t replyBufferSize();
+            size_t replyDataSize();
+
+            // Return the reply 'value' and it's size
+            const uint8_t * replyValue();
+            size_t replyValueSize();
+
+            // Return the handles to copy to the client and how many there are
+            const uint32_t * replyHandles();
+            size_t replyHandleCount();
 
             // Append a value to reply buffer
             template <typename T>
             Result appendReplyData(const T value) {
-                return (Utils::Buffer::appendValue(this->outData, value) ? Result::Ok : Result::BadInput);
+                return (Utils::Buffer::writeValue(this->outData, this->outDataCapacity, this->outDataSize, value) ? Result::Ok : Result::BadInput);
             }
 
             // Append a string to reply buffer
             Result appendReplyData(const std::string & str) {
-                return (Utils::Buffer::appendString(this->outData, str) ? Result::Ok : Result::BadInput);
+                return (Utils::Buffer::writeString(this->outData, this->outDataCapacity, this->outDataSize, str) ? Result::Ok : Result::BadInput);
+            }
+
+            // Append raw bytes to reply buffer
+            Result appendReplyBytes(const uint8_t * bytes, const size_t size) {
+                if (this->outDataSize + size > this->outDataCapacity) {
+                    return Result::BadInput;
+                }
+                if (size == 0) {
+                    return Result::Ok;
+                }
+                std::memcpy(this->outData + this->outDataSize, bytes, size);
+                this->outDataSize += size;
+                return Result::Ok;
             }
 
             // Append value to reply 'value'
             template <typename T>
             Result appendReplyValue(const T value) {
-                return (Utils::Buffer::appendValue(this->outArgs, value) ? Result::Ok : Result::BadInput);
+                return (Utils::Buffer::writeValue(this->outArgs.data(), this->outArgs.size(), this->outArgsSize, value) ? Result::Ok : Result::BadInput);
             }
 
             // Append a string to reply 'value'
             Result appendReplyValue(const std::string & str) {
-                return (Utils::Buffer::appendString(this->outArgs, str) ? Result::Ok : Result::BadInput);
+                return (Utils::Buffer::writeString(this->outArgs.data(), this->outArgs.size(), this->outArgsSize, str) ? Result::Ok : Result::BadInput);
+            }
+
+            // Append a handle to copy to the client
+            Result appendReplyHandle(const uint32_t handle) {
+                if (this->outHandlesCount >= this->outHandles.size()) {
+                    return Result::BadInput;
+                }
+                this->outHandles[this->outHandlesCount++] = handle;
+                return Result::Ok;
             }
 
             // Sequentially read from received data
             template <typename T>
             Result readRequestData(T & out) {
-                return (Utils::Buffer::readValue(this->inData, this->inDataPos, out) ? Result::Ok : Result::BadInput);
+                return (Utils::Buffer::readValue(this->inData, this->inDataSize, this->inDataPos, out) ? Result::Ok : Result::BadInput);
             }
 
             // Sequentially read a string from received data
             Result readRequestData(std::string & out) {
-                return (Utils::Buffer::readString(this->inData, this->inDataPos, out) ? Result::Ok : Result::BadInput);
+                return (Utils::Buffer::readString(this->inData, this->inDataSize, this->inDataPos, out) ? Result::Ok : Result::BadInput);
             }
 
             // Sequentially read from received 'arguments'
             template <typename T>
             Result readRequestValue(T & out) {
-                return (Utils::Buffer::readValue(this->inArgs, this->inArgsPos, out) ? Result::Ok : Result::BadInput);
+                return (Utils::Buffer::readValue(this->inArgs.data(), this->inArgsSize, this->inArgsPos, out) ? Result::Ok : Result::BadInput);
             }
 
             // Sequentially read a string from received 'arguments'
             Result readRequestValue(std::string & out) {
-                return (Utils::Buffer::readString(this->inArgs, this->inArgsPos, out) ? Result::Ok : Result::BadInput);
+                return (Utils::Buffer::readString(this->inArgs.data(), this->inArgsSize, this->inArgsPos, out) ? Result::Ok : Result::BadInput);
             }
-
-            // Destructor frees allocated memory
-            ~Request();
     };
 };
 
@@ -4,44 +4,73 @@
 #include <functional>
 #include "ipc/Request.hpp"
 
-// This was heavily inspired by sys-clk's ipc server, a big thanks to those
-// who wrote the original C version:
-// --------------------------------------------------------------------------
-// "THE BEER-WARE LICENSE" (Revision 42):
-// <p-sam@d3vs.net>, <natinusala@gmail.com>, <m4x@m4xw.net>
-// wrote this file. As long as you retain this notice you can do whatever you
-// want with this stuff. If you meet any of us some day, and you think this
-// stuff is worth it, you can buy us a beer in return.  - The sys-clk authors
-// --------------------------------------------------------------------------
+// A Server is an abstract class representing the transport requests are received over.
+// It accepts clients, turns what they send into Requests for the handler and sends back
+// the reply, while children handle the transport specific framing. Replies can be held
+// (see Request::hold()) or deferred to another thread (see Request::defer()), which the
+// base class tracks so every transport behaves the same and other clients aren't stalled.
+// A Request is created for each client up front and reused, so none are allocated per message.
 namespace Ipc {
     // Typedef this long line cause it's messy
     typedef std::function<uint32_t(Request *)> Handler;
 
     class Server {
         private:
-            SmServiceName serverName;       // Name of IPC server
+            // A request whose reply is being held, along with the client it came from
+            struct HeldRequest {
+                uint32_t client;
+                Request * request;
+            };
+
+            std::vector<HeldRequest> held;  // Requests being held (their clients aren't waited on until replied to)
+            std::vector<Request> requests;  // Request for each client
+            std::vector<Request *> unused;  // Requests not currently being handled/held
+
+        protected:
             bool error_;                    // Set true when a fatal error occurs
             Handler handler;                // Function to handle request
 
-            std::vector<Handle> handles;    // Server (index 0) and client's handles
-            size_t maxHandles;              // Maximum number of clients
+            // Take an unused request to fill with a received message (nullptr if every client has one)
+            Request * takeRequest();
+            // Return a request which has been replied to
+            void returnRequest(Request *);
 
-            // Process a session
-            bool processSession(const int32_t);
-            bool processNewSession();
+            // Pass a request from the given client to the handler. Returns true if the reply is being held or deferred, in
+            // which case the request is kept and the client shouldn't be waited on until it's replied to.
+            bool handleRequest(const uint32_t, Request *);
+            // Returns the number of requests being held
+            size_t heldCount();
+            // Returns the number of nanoseconds until the first held reply is due (UINT64_MAX if none are held)
+            uint64_t heldTimeout();
+            // Pass each held request to the handler again, replying to those no longer held (and to completed deferred requests)
+            void processHeld();
+            // Drop held requests, passing each client to closeClient() (must be called by children's destructors,
+            // once nothing is still handling a deferred request)
+            void closeHeld();
+
+            // Send the reply to a request to the given client, returning false if the client has gone
+            virtual bool sendReply(const uint32_t, Request *) = 0;
+            // Start waiting on a client again after it's held reply was sent
+            virtual void resumeClient(const uint32_t) = 0;
+            // Close the connection to a client
+            virtual void closeClient(const uint32_t) = 0;
 
         public:
-            // Constructor inits server (accepts name and max connection count)
-            Server(const std::string &, const size_t);
+            // Constructor inits shared variables (accepts max connection count)
+            Server(const size_t);
 
             // Set the request handler function
             void setRequestHandler(Handler);
 
             // Process any received requests (returns false once a fatal error occurs)
-            bool process();
+            virtual bool process() = 0;
+
+            // Wake the server so held requests are handled again (can be called from any thread, and must be once a
+            // deferred request is completed)
+            virtual void wake() = 0;
 
-            // Clean up and stop the server
-            ~Server();
+            // Children clean up and stop the server
+            virtual ~Server();
     };
 };
 
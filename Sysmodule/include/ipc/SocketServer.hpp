@@ -0,0 +1,78 @@
+#ifndef IPC_SOCKETSERVER_HPP
+#define IPC_SOCKETSERVER_HPP
+
+#include "ipc/Server.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+// Sent before each request/reply over a socket, followed by the 'arguments'/'value' and then the data
+namespace Ipc {
+    constexpr uint32_t SocketRequestMagic = 0x51495254;     // 'TRIQ'
+    constexpr uint32_t SocketReplyMagic = 0x52495254;       // 'TRIR'
+    constexpr uint32_t SocketMaxArgsSize = 0x100;           // Largest 'arguments'/'value' accepted
+    constexpr uint32_t SocketMaxDataSize = 0x1000000;       // Largest data accepted (16MB)
+
+    struct SocketRequestHeader {
+        uint32_t magic;             // Must be SocketRequestMagic
+        uint32_t close;             // Non-zero if the client is closing the connection (nothing else is read)
+        uint64_t cmd;               // Command id
+        uint32_t argsSize;          // Number of bytes of 'arguments'
+        uint32_t dataSize;          // Number of bytes of data
+        uint32_t replySize;         // Largest amount of reply data the client accepts
+        uint32_t padding;
+    };
+
+    struct SocketReplyHeader {
+        uint32_t magic;             // Always SocketReplyMagic
+        uint32_t result;            // Result of the request
+        uint32_t valueSize;         // Number of bytes of 'value'
+        uint32_t dataSize;          // Number of bytes of data
+    };
+
+    // Extends Server to receive requests over a Unix domain socket, allowing the sysmodule
+    // to be driven by programs (i.e. a load generator) when running on a regular computer.
+    // Handles can't be sent over the socket, so requests replying with one fail.
+    class SocketServer : public Server {
+        private:
+            std::string path;               // Path of the socket
+            int listenFd;                   // Socket accepting new clients
+            int wakeFds[2];                 // Pipe written to to wake the server (read end, write end)
+            std::vector<int> clients;       // Sockets of clients waiting to be read from
+            size_t maxClients;              // Maximum number of clients (including those with a held reply)
+
+            // Memory a client's messages are read into and replies written to (reused for each message, and kept
+            // while the reply is held as the request points at it)
+            struct Buffers {
+                std::vector<uint8_t> args;
+                std::vector<uint8_t> data;
+                std::vector<uint8_t> reply;
+            };
+            std::map<int, Buffers> buffers;
+
+            // Read/write exactly the given number of bytes, returning false if the client has gone
+            bool readAll(const int, void *, const size_t);
+            bool writeAll(const int, const void *, const size_t);
+            // Read and handle a request from the client at the given index
+            bool processClient(const size_t);
+            // Accept a new client
+            void processNewClient();
+
+        protected:
+            bool sendReply(const uint32_t, Request *);
+            void resumeClient(const uint32_t);
+            void closeClient(const uint32_t);
+
+        public:
+            // Constructor creates the socket at the given path (accepts max connection count)
+            SocketServer(const std::string &, const size_t);
+
+            bool process();
+            void wake();
+
+            // Close all connections and remove the socket
+            ~SocketServer();
+    };
+};
+
+#endif
\ No newline at end of file
@@ -2,12 +2,13 @@
 #define NX_AUDIO_HPP
 
 #include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <mutex>
 #include "Types.hpp"
 
 // Forward declare types
-struct AudioDriverWaveBuf;
+class AudioSink;
 
 // The Audio class handles audio output, but not decoding.
 // It is provided with decoded audio through public methods
@@ -15,7 +16,9 @@ struct AudioDriverWaveBuf;
 // of the output stream.
 //
 // It is a singleton class as we only ever want one instance
-// shared across the entire service.
+// shared across the entire service. Output is handled by an
+// AudioSink, which is the console's audio renderer unless
+// another one is provided with setSink().
 class Audio {
     public:
         // Status of audio playback
@@ -32,19 +35,34 @@ class Audio {
         std::atomic<Status> action;     // Action to take on next loop iteration
         std::atomic<bool> exit_;        // Set true to stop looping
         static Audio * instance;        // Single instance of class
+        static AudioSink * nextSink;    // Sink to use when the instance is created
+        static size_t nextBufferCount;  // Number of buffers to create with the instance
+        static size_t nextBufferSize;   // Size of each buffer to create with the instance
         std::mutex mutex;               // Mutex protecting all public methods
         std::atomic<bool> success;      // Indicates whether created successfullY
 
         int channels;                   // Channels in current song
-        std::atomic<int> sampleOffset;  // Offset of voice's played sample count
+        long rate;                      // Sample rate of current song
+        std::atomic<int> sampleOffset;  // Position of the song when songStart was played
+        uint32_t songStart;             // Voice's played sample count when the song started (counts wrap, so only differences are used)
+        uint32_t queuedSamples;         // Number of samples queued on the voice since it was started (wraps with the played count)
         std::atomic<Status> status_;    // Current status of playback (see above enum)
-        int voice;                      // ID of audio 'voice' (-1 if not set)
+        std::atomic<bool> voice;        // Whether the sink has a voice for the current song
         std::atomic<double> vol;        // Current volume level (0.0 - 100.0)
 
-        uint8_t ** memPool;             // Array of pointers to buffers containing decoded audio
-        int nextBuf;                    // Index in waveBuf array of next buffer to fill
-        int sink;                       // ID of audio 'sink'
-        AudioDriverWaveBuf * waveBuf;   // Array of buffers
+        AudioSink * sink;               // Output that buffers are played through
+        size_t bufferCount_;            // Number of buffer slots
+        int claimedBuf;                 // Index of buffer handed out by claimBuffer() (-1 if none)
+        int nextBuf;                    // Index of next buffer to fill
+
+        std::atomic<int> minQueued;     // Fewest samples left to play when a buffer was queued (-1 if not measured)
+        std::atomic<bool> starved;      // Set true when the voice stopped because it ran out of buffers
+        std::atomic<size_t> underruns_; // Number of times the voice ran out of buffers part way through a song
+
+        // Time when the voice last ran out of buffers
+        std::chrono::steady_clock::time_point drainTime;
+        std::atomic<int> gap;           // Number of samples of silence in the last song transition
+        std::atomic<bool> transition;   // Set true when waiting for the first buffer of a new song
 
     public:
         // Delete copy constructors as this is a singleton
@@ -53,23 +71,39 @@ class Audio {
 
         // Create or return instance
         static Audio * getInstance();
+        // Set the sink to output to, which must be called before the instance is created
+        // (takes ownership of the sink, defaults to the audio renderer)
+        static void setSink(AudioSink *);
+        // Set the number and size (in bytes) of buffers, which must be called before the instance is created
+        // (defaults to 6 x 50kB, and the total is limited to avoid exhausting the heap)
+        static void setBuffers(size_t, size_t);
 
         // Returns true if the output device was initialized successfully
         bool initialized();
         // Call to indicate the main loop (process()) should stop and return
         void exit();
 
-        // Append a buffer of audio data to play (does nothing if there is no free slot)
-        // Takes pointer to buffer and it's size (does not free afterwards!)
-        void addBuffer(uint8_t *, size_t);
+        // Returns a pointer to the next free buffer slot (nullptr if none are free)
+        // Audio should be decoded directly into it and then passed to queueBuffer()
+        uint8_t * claimBuffer();
+        // Queue the previously claimed buffer for playback
+        // Takes the number of bytes written into the buffer
+        void queueBuffer(size_t);
         // Returns whether a buffer slot is available
         bool bufferAvailable();
         // Returns the maximum size of a single buffer
         size_t bufferSize();
+        // Returns the number of buffer slots
+        size_t bufferCount();
 
         // Call to prepare the output device for a new song with the given info
-        // Takes sample rate and number of channels
-        void newSong(long, int);
+        // Takes sample rate, number of channels and whether to let queued buffers finish playing
+        // (the voice is only kept if the format matches, otherwise it must have stopped first)
+        void newSong(long, int, bool = false);
+        // Returns true if a new song with the given sample rate and channels can reuse the current voice
+        bool sameFormat(long, int);
+        // Returns the number of samples of silence between the last two songs
+        int transitionGap();
 
         // Resume playback if paused
         void resume();
@@ -85,6 +119,11 @@ class Audio {
         // Set the number of samples played so far (used when seeking)
         void setSamplesPlayed(int);
 
+        // Returns the number of times the voice ran out of buffers before the song was finished
+        size_t underruns();
+        // Returns the fewest samples that were left to play when a buffer was queued (-1 if not measured yet)
+        int minQueuedSamples();
+
         // Return the current volume level (0.0 - 100.0)
         double volume();
         // Set the volume level (0.0 - 100.0)
@@ -63,6 +63,11 @@ namespace NX {
             // Returns -1 on an error
             off_t seek(const off_t, const Position);
 
+            // Returns the current position in the file (-1 on an error)
+            off_t tell();
+            // Returns the size of the file in bytes (-1 on an error)
+            int64_t length();
+
             // Destructor closes file handle
             ~File();
 
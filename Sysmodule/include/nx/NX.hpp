@@ -1,6 +1,7 @@
 #ifndef NX_NX_HPP
 #define NX_NX_HPP
 
+#include <cstdint>
 #include <functional>
 #include "utils/nx/Button.hpp"
 
@@ -47,6 +48,14 @@ namespace NX {
         void monitor(const size_t);
     };
 
+    namespace Shmem {
+        // Create and map memory of the given size which other processes can map read-only
+        // Returns it's address (nullptr on an error) and sets the handle to send to them
+        void * create(const size_t, uint32_t &);
+        // Unmap and close the memory created above
+        void destroy();
+    };
+
     namespace Thread {
         // Start a new thread with the given function and argument
         // Uses given id to identify a thread
@@ -0,0 +1,59 @@
+#ifndef SINKS_AUDIOSINK_HPP
+#define SINKS_AUDIOSINK_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// An AudioSink is an abstract class representing an audio output.
+// Audio owns a sink and uses it to play the buffers it has been given,
+// while the sink handles the device (or file) specific details.
+//
+// Buffers are referred to by index and are owned by the sink, as some
+// outputs have requirements on where the memory is located. Audio locks
+// it's own mutex before calling any method, so sinks don't need to.
+class AudioSink {
+    protected:
+        // Must be set by children
+        bool valid_;
+
+    public:
+        AudioSink();
+
+        // Returns true if the output was prepared without errors
+        bool valid();
+
+        // Allocate the given number of buffers, each able to hold at least the given number of bytes
+        virtual bool createBuffers(size_t, size_t) = 0;
+        // Returns a pointer to the memory of the buffer at the given index
+        virtual uint8_t * buffer(size_t) = 0;
+        // Returns the usable size of a single buffer
+        virtual size_t bufferSize() = 0;
+
+        // Prepare to play audio with the given sample rate and number of channels
+        virtual bool openVoice(long, int) = 0;
+        // Release the current voice (if there is one)
+        virtual void closeVoice() = 0;
+
+        // Queue the buffer at the given index containing the given number of bytes
+        virtual void queueBuffer(size_t, size_t) = 0;
+        // Returns true if the buffer at the given index is not queued/playing
+        virtual bool bufferDone(size_t) = 0;
+
+        // Start playing queued buffers
+        virtual void start() = 0;
+        // Stop playback and mark all buffers as done
+        virtual void stop() = 0;
+        // Pause/resume playback
+        virtual void setPaused(bool) = 0;
+        // Returns the number of samples played since the voice was started (wraps around, like the console's counter)
+        virtual uint32_t playedSamples() = 0;
+        // Set the output volume (0.0 - 1.0)
+        virtual void setVolume(double) = 0;
+
+        // Process queued buffers, blocking until the next audio frame
+        virtual void update() = 0;
+
+        virtual ~AudioSink();
+};
+
+#endif
\ No newline at end of file
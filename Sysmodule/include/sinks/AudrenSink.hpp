@@ -0,0 +1,51 @@
+#ifndef SINKS_AUDRENSINK_HPP
+#define SINKS_AUDRENSINK_HPP
+
+#include "sinks/AudioSink.hpp"
+
+// Forward declare types
+struct AudioDriverWaveBuf;
+
+// Extends AudioSink to output through the console's audio renderer
+// using libnx's audrv. audren must be initialized before creating one,
+// and as the driver is shared only one object should exist at a time.
+class AudrenSink : public AudioSink {
+    private:
+        int channels;                   // Channels of current voice
+        uint8_t ** memPool;             // Array of pointers to buffers containing decoded audio
+        size_t numBuffers;              // Number of buffers in memPool
+        size_t realSize;                // Size of each buffer (after alignment)
+        int sink;                       // ID of audio 'sink'
+        int voice;                      // ID of audio 'voice' (-1 if not set)
+        AudioDriverWaveBuf * waveBuf;   // Array of buffers
+
+        // Free all buffers
+        void freeBuffers();
+
+    public:
+        // Creates the audio driver
+        AudrenSink();
+
+        bool createBuffers(size_t, size_t);
+        uint8_t * buffer(size_t);
+        size_t bufferSize();
+
+        bool openVoice(long, int);
+        void closeVoice();
+
+        void queueBuffer(size_t, size_t);
+        bool bufferDone(size_t);
+
+        void start();
+        void stop();
+        void setPaused(bool);
+        uint32_t playedSamples();
+        void setVolume(double);
+
+        void update();
+
+        // Drops the voice and closes the driver
+        ~AudrenSink();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef SINKS_NULLSINK_HPP
+#define SINKS_NULLSINK_HPP
+
+#include <chrono>
+#include <deque>
+#include <vector>
+#include "sinks/AudioSink.hpp"
+
+// Extends AudioSink to discard audio without any hardware, allowing
+// playback to run on a regular computer. Buffers are 'played' at the
+// rate of the current voice, so timing matches a real device.
+class NullSink : public AudioSink {
+    private:
+        std::vector<uint8_t *> buffers;                     // Memory for each buffer
+        std::vector<bool> queued;                           // Whether each buffer is queued
+        std::deque<std::pair<size_t, size_t> > order;       // Index and size (in bytes) of queued buffers, oldest first
+        size_t size;                                        // Size of each buffer
+
+        int channels;                                       // Channels of current voice
+        long rate;                                          // Sample rate of current voice
+        bool paused;                                        // Whether playback is paused
+        bool playing;                                       // Whether the voice has been started
+        uint32_t played;                                    // Number of samples played since starting
+        int playedFront;                                    // Number of samples played from the oldest buffer
+        double carry;                                       // Fraction of a sample carried between updates
+        std::chrono::steady_clock::time_point last;         // Time of the last update
+
+        // Play up to the given number of samples from the queued buffers
+        void advance(size_t);
+
+    protected:
+        // Whether buffers play in real time (otherwise they are finished on the next update)
+        bool paced;
+
+        // Called with the contents of each buffer once it has been played
+        virtual void consume(const uint8_t *, size_t);
+
+    public:
+        NullSink();
+
+        bool createBuffers(size_t, size_t);
+        uint8_t * buffer(size_t);
+        size_t bufferSize();
+
+        bool openVoice(long, int);
+        void closeVoice();
+
+        void queueBuffer(size_t, size_t);
+        bool bufferDone(size_t);
+
+        void start();
+        void stop();
+        void setPaused(bool);
+        uint32_t playedSamples();
+        void setVolume(double);
+
+        void update();
+
+        // Frees buffers
+        virtual ~NullSink();
+};
+
+#endif
\ No newline at end of file
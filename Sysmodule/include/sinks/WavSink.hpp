@@ -0,0 +1,35 @@
+#ifndef SINKS_WAVSINK_HPP
+#define SINKS_WAVSINK_HPP
+
+#include <cstdio>
+#include <string>
+#include "sinks/NullSink.hpp"
+
+// Extends NullSink to write everything that is played to a .wav file
+// (16 bit PCM). Buffers are not paced, so songs are written as fast as
+// they can be decoded. A file can only hold one format, so a voice with
+// a different rate/channels to the first one can't be opened.
+class WavSink : public NullSink {
+    private:
+        FILE * file;            // File being written to
+        int fileChannels;       // Channels in file (0 if not yet known)
+        long fileRate;          // Sample rate of file (0 if not yet known)
+        size_t written;         // Number of bytes of audio written
+
+        // Write the header with the current format and size
+        void writeHeader();
+
+    protected:
+        void consume(const uint8_t *, size_t);
+
+    public:
+        // Takes path to the .wav file to create
+        WavSink(const std::string &);
+
+        bool openVoice(long, int);
+
+        // Finalizes and closes the file
+        ~WavSink();
+};
+
+#endif
\ No newline at end of file
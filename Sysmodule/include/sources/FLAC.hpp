@@ -0,0 +1,48 @@
+#ifndef SOURCES_FLAC_HPP
+#define SOURCES_FLAC_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "sources/Source.hpp"
+
+// Forward declaration as we only need the pointers here
+struct FLAC__StreamDecoder;
+namespace NX {
+    class File;
+};
+
+// Extends Source to support FLAC files using libFLAC
+// Samples are converted to 16 bit as they are decoded, and only the
+// most recently decoded frame is held in memory. Mono and stereo files
+// are supported.
+class FLAC : public Source {
+    private:
+        // libFLAC decoder used by this object
+        FLAC__StreamDecoder * decoder;
+
+        // Object associated with file
+        NX::File * file;
+
+        // Samples from the last decoded frame that haven't been returned yet
+        std::vector<int16_t> pending;
+        size_t pendingPos;
+        // Position in song (in samples)
+        size_t position;
+
+        // Callbacks used by libFLAC (defined with libFLAC's types)
+        struct Callbacks;
+
+    public:
+        // Takes path to a .flac file
+        FLAC(const std::string &);
+
+        size_t decode(unsigned char *, size_t);
+        void seek(size_t);
+        size_t tell();
+
+        // Closes associated file
+        ~FLAC();
+};
+
+#endif
\ No newline at end of file
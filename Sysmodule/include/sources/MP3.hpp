@@ -2,7 +2,9 @@
 #define SOURCES_MP3_HPP
 
 #include <array>
+#include <mutex>
 #include <string>
+#include <vector>
 #include "sources/Source.hpp"
 
 // Forward declaration as we only need the pointers here
@@ -12,17 +14,61 @@ namespace NX {
 };
 
 // Extends Source to support MP3 files
-// This class is not thread-safe!
+// Each object decodes using it's own mpg123 handle, which is taken from
+// a shared pool limited in size in order to keep heap usage bounded.
+// The frame index built while decoding a file is stored on the SD card,
+// and is loaded the next time the file is played to allow accurate
+// seeking without scanning the file from the start.
+// Separate objects can be used on separate threads, however a single
+// object is not thread-safe!
 class MP3 : public Source {
     private:
-        // mpg123 instance
-        static mpg123_handle * mpg;
+        // mpg123 instance used by this object
+        mpg123_handle * mpg;
 
         // Object associated with file
         NX::File * file;
 
+        // Path and size of file (used to identify it's seek index)
+        std::string path;
+        size_t fileSize;
+        // Set true if a stored seek index was loaded
+        bool indexed;
+        // Set true once seeked (the index won't cover the whole file)
+        bool seeked;
+
         // Logs most recent error
-        static void logErrorMsg();
+        void logErrorMsg();
+
+        // Returns the path to this file's seek index
+        std::string indexPath();
+        // Load a previously stored seek index into the handle, returning true if successful
+        bool loadIndex();
+        // Store the handle's seek index for next time (should only be called after decoding the whole file)
+        void saveIndex();
+
+        // Handles not currently used by an object
+        static std::vector<mpg123_handle *> freeHandles;
+        // Every handle that has been created
+        static std::vector<mpg123_handle *> handles;
+        // Handles in use which have loaded a seek index
+        static std::vector<mpg123_handle *> indexedHandles;
+        // Maximum number of handles that can exist at once
+        static size_t maxHandles;
+        // Mutex protecting the pool and settings
+        static std::mutex poolMutex;
+
+        // Settings applied to every handle
+        static bool accurateSeek;
+        static std::array<float, 32> equalizer;
+
+        // Take a handle from the pool, creating one if there is room (nullptr if none available)
+        static mpg123_handle * acquireHandle();
+        // Return a handle to the pool
+        static void releaseHandle(mpg123_handle *);
+        // Apply the current settings to the given handle
+        static bool applyAccurateSeek(mpg123_handle *);
+        static bool applyEqualizer(mpg123_handle *);
 
     public:
         // Takes path to a .mp3 file
@@ -32,17 +78,24 @@ class MP3 : public Source {
         void seek(size_t);
         size_t tell();
 
-        // Closes associated file
+        // Closes associated file and returns handle to the pool
         ~MP3();
 
         // Initialize mpg123
         static bool initLib();
-        // Cleanup mpg123
+        // Cleanup mpg123 (all objects must be deleted first)
         static void freeLib();
 
-        // Set seek method
+        // Set the maximum number of handles (and thus objects) that can exist at once (at least two, so the
+        // next song can be opened while the current one plays)
+        // Existing handles are not deleted if lowered, but are freed as they are released
+        static void setHandleLimit(const size_t);
+
+        // Set seek method for all objects
+        // Objects must not be decoding on another thread when called
         static bool setAccurateSeek(const bool);
-        // Set the equalizer for decoding
+        // Set the equalizer for decoding for all objects
+        // Objects must not be decoding on another thread when called
         static bool setEqualizer(const std::array<float, 32> &);
 };
 
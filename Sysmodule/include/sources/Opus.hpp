@@ -0,0 +1,38 @@
+#ifndef SOURCES_OPUS_HPP
+#define SOURCES_OPUS_HPP
+
+#include <string>
+#include "sources/Source.hpp"
+
+// Forward declaration as we only need the pointers here
+typedef struct OggOpusFile OggOpusFile;
+namespace NX {
+    class File;
+};
+
+// Extends Source to support Ogg Opus files using opusfile
+// Opus always decodes at 48kHz, and is downmixed to stereo by opusfile.
+class Opus : public Source {
+    private:
+        // opusfile object used to decode the file
+        OggOpusFile * of;
+
+        // Object associated with file
+        NX::File * file;
+
+        // Callbacks used by opusfile (defined with opusfile's types)
+        struct Callbacks;
+
+    public:
+        // Takes path to a .opus file
+        Opus(const std::string &);
+
+        size_t decode(unsigned char *, size_t);
+        void seek(size_t);
+        size_t tell();
+
+        // Closes associated file
+        ~Opus();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef SOURCES_RESAMPLED_HPP
+#define SOURCES_RESAMPLED_HPP
+
+#include <chrono>
+#include "dsp/Resampler.hpp"
+#include "sources/Source.hpp"
+
+// Extends Source to play another source at a different sample rate. It takes ownership
+// of the source and passes its audio through a resampler, so everything after it
+// (the rewind cache, crossfading and the output voice) only sees the new rate.
+class Resampled : public Source {
+    private:
+        Source * source;                // Source being resampled
+        Dsp::Resampler * resampler;     // Converts between the two rates
+        int16_t * staging;              // Audio decoded from the source before it's pushed
+        bool flushed;                   // Set true once the end of the source has been pushed
+        size_t position;                // Number of frames output since the start of the song
+
+        // Time spent resampling and the number of frames produced (logged when deleted)
+        std::chrono::steady_clock::duration time;
+        size_t produced;
+
+    public:
+        // Takes the source to resample, the rate to output at and the quality to use
+        Resampled(Source *, long, Dsp::Resampler::Quality);
+
+        size_t decode(unsigned char *, size_t);
+        void seek(size_t);
+        size_t tell();
+
+        // Deletes the source
+        ~Resampled();
+};
+
+#endif
\ No newline at end of file
@@ -26,7 +26,7 @@ class Source {
         // Returns true if file was opened without errors
         bool valid();
 
-        // Seek to sample in song
+        // Seek to sample in song (allows decoding again if done)
         virtual void seek(size_t) = 0;
         // Return position in song (in samples)
         virtual size_t tell() = 0;
@@ -0,0 +1,39 @@
+#ifndef SOURCES_VORBIS_HPP
+#define SOURCES_VORBIS_HPP
+
+#include <string>
+#include "sources/Source.hpp"
+
+// Forward declaration as we only need the pointers here
+struct OggVorbis_File;
+namespace NX {
+    class File;
+};
+
+// Extends Source to support Ogg Vorbis files using libvorbisfile
+// Mono and stereo files are supported (and chained files must keep the
+// same format throughout).
+class Vorbis : public Source {
+    private:
+        // libvorbisfile object used to decode the file
+        OggVorbis_File * vf;
+
+        // Object associated with file
+        NX::File * file;
+
+        // Callbacks used by libvorbisfile (defined with libvorbisfile's types)
+        struct Callbacks;
+
+    public:
+        // Takes path to a .ogg file
+        Vorbis(const std::string &);
+
+        size_t decode(unsigned char *, size_t);
+        void seek(size_t);
+        size_t tell();
+
+        // Closes associated file
+        ~Vorbis();
+};
+
+#endif
\ No newline at end of file
@@ -1,38 +1,43 @@
 #ifndef UTILS_BUFFER_HPP
 #define UTILS_BUFFER_HPP
 
+#include <cstdint>
+#include <cstring>
 #include <string>
-#include <vector>
 
-// Helpers to read/write values to a buffer (vector)
+// Helpers to read/write values to a fixed size buffer, which never allocate
 namespace Utils::Buffer {
-    // Append a string to a biffer
-    bool appendString(std::vector<uint8_t> &, const std::string &);
+    // Write a string (including it's terminator) at the position and increment it (returns false if it doesn't fit)
+    bool writeString(uint8_t *, const size_t, size_t &, const std::string &);
 
-    // Append value onto a buffer
+    // Write value at the position and increment it (returns false if it doesn't fit)
     template <typename T>
-    bool appendValue(std::vector<uint8_t> & buf, const T val) {
-        const uint8_t * ptr = reinterpret_cast<const uint8_t *>(&val);
-        for (size_t i = 0; i < sizeof(val); i++) {
-            buf.push_back(ptr[i]);
+    bool writeValue(uint8_t * buf, const size_t size, size_t & pos, const T val) {
+        // Check we have room for the value
+        size_t bytes = sizeof(val);
+        if (pos + bytes > size) {
+            return false;
         }
+
+        std::memcpy(buf + pos, &val, bytes);
+        pos += bytes;
         return true;
     }
 
     // Retrieve a string from buffer and increment position (returns false if outside of buffer)
-    bool readString(const std::vector<uint8_t> &, size_t &, std::string &);
+    bool readString(const uint8_t *, const size_t, size_t &, std::string &);
 
     // Retrieve value from buffer and increment position (returns false if outside of buffer)
     template <typename T>
-    bool readValue(const std::vector<uint8_t> & buf, size_t & pos, T & val) {
+    bool readValue(const uint8_t * buf, const size_t size, size_t & pos, T & val) {
         // Check we have enough bytes to read
         size_t bytes = sizeof(val);
-        if (pos + bytes > buf.size()) {
+        if (pos + bytes > size) {
             return false;
         }
 
         // Read required number of bytes and move position
-        std::memcpy(&val, &buf[pos], bytes);
+        std::memcpy(&val, buf + pos, bytes);
         pos += bytes;
         return true;
     }
@@ -0,0 +1,18 @@
+#ifndef UTILS_MIX_HPP
+#define UTILS_MIX_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Helpers to mix buffers of interleaved 16-bit PCM
+namespace Utils::Mix {
+    // Crossfade two buffers into the first, saturating on overflow
+    // Params: incoming audio (overwritten with the result), outgoing audio, number of samples,
+    //         number of channels (1 or 2), incoming gain for the first frame, gain increase per frame
+    // The outgoing audio is weighted by (1 - incoming gain); gains are clamped to 0.0 - 1.0
+    void crossfade(int16_t *, const int16_t *, const size_t, const int, const float, const float);
+    // As above, but without using vector instructions (used for any leftover samples, and to compare against)
+    void crossfadeScalar(int16_t *, const int16_t *, const size_t, const int, const float, const float);
+};
+
+#endif
\ No newline at end of file
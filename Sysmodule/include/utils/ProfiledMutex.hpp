@@ -0,0 +1,95 @@
+#ifndef UTILS_PROFILEDMUTEX_HPP
+#define UTILS_PROFILEDMUTEX_HPP
+
+#include <atomic>
+#include <chrono>
+#include "ipc/TriPlayer.hpp"
+
+// Wraps a mutex (std::mutex or std::shared_mutex) to record how often it's taken and how long
+// threads wait for it. Each lock first tries to take the mutex without blocking, so the clock is
+// only read when it has to wait. Can be used with std::scoped_lock, std::shared_lock, etc.
+namespace Utils {
+    template <typename Mutex>
+    class ProfiledMutex {
+        private:
+            Mutex mutex;                            // Wrapped mutex
+            std::atomic<uint32_t> acquired;         // Number of times it's been locked
+            std::atomic<uint32_t> contended;        // Number of those which had to wait
+            std::atomic<uint64_t> waitTotal;        // Total time waited (in microseconds)
+            std::atomic<uint32_t> waitMax;          // Longest wait (in microseconds)
+
+            // Record a wait which started at the given time
+            void recordWait(const std::chrono::steady_clock::time_point start) {
+                uint32_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+                this->contended.fetch_add(1, std::memory_order_relaxed);
+                this->waitTotal.fetch_add(us, std::memory_order_relaxed);
+                uint32_t max = this->waitMax.load(std::memory_order_relaxed);
+                while (us > max && !this->waitMax.compare_exchange_weak(max, us, std::memory_order_relaxed));
+            }
+
+        public:
+            ProfiledMutex() {
+                this->reset();
+            }
+
+            void lock() {
+                this->acquired.fetch_add(1, std::memory_order_relaxed);
+                if (!this->mutex.try_lock()) {
+                    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                    this->mutex.lock();
+                    this->recordWait(start);
+                }
+            }
+
+            bool try_lock() {
+                bool ok = this->mutex.try_lock();
+                if (ok) {
+                    this->acquired.fetch_add(1, std::memory_order_relaxed);
+                }
+                return ok;
+            }
+
+            void unlock() {
+                this->mutex.unlock();
+            }
+
+            void lock_shared() {
+                this->acquired.fetch_add(1, std::memory_order_relaxed);
+                if (!this->mutex.try_lock_shared()) {
+                    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                    this->mutex.lock_shared();
+                    this->recordWait(start);
+                }
+            }
+
+            bool try_lock_shared() {
+                bool ok = this->mutex.try_lock_shared();
+                if (ok) {
+                    this->acquired.fetch_add(1, std::memory_order_relaxed);
+                }
+                return ok;
+            }
+
+            void unlock_shared() {
+                this->mutex.unlock_shared();
+            }
+
+            // Copy the recorded statistics
+            void stats(TriPlayer::LockStats & out) {
+                out.acquired = this->acquired.load(std::memory_order_relaxed);
+                out.contended = this->contended.load(std::memory_order_relaxed);
+                out.waitTotal = this->waitTotal.load(std::memory_order_relaxed);
+                out.waitMax = this->waitMax.load(std::memory_order_relaxed);
+            }
+
+            // Reset the recorded statistics to zero
+            void reset() {
+                this->acquired = 0;
+                this->contended = 0;
+                this->waitTotal = 0;
+                this->waitMax = 0;
+            }
+    };
+};
+
+#endif
\ No newline at end of file
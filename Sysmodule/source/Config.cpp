@@ -1,5 +1,6 @@
 #include "Config.hpp"
 #include <cstring>
+#include <strings.h>
 #include "minIni.h"
 #include "utils/FS.hpp"
 
@@ -65,6 +66,60 @@ std::string Config::keyComboPrev() {
     return combo;
 }
 
+int Config::bufferCount() {
+    int count = this->ini->geti("General", "buffer_count", 6);
+    if (count < 2 || count > 16) {
+        Log::writeError("[CONFIG] Invalid number of buffers (must be 2 - 16): " + std::to_string(count));
+        count = 6;
+    }
+    return count;
+}
+
+int Config::bufferSize() {
+    int size = this->ini->geti("General", "buffer_size", 50);
+    if (size < 4 || size > 256) {
+        Log::writeError("[CONFIG] Invalid buffer size (must be 4 - 256): " + std::to_string(size));
+        size = 50;
+    }
+    return size;
+}
+
+int Config::crossfade() {
+    int secs = this->ini->geti("General", "crossfade", 0);
+    if (secs < 0 || secs > 12) {
+        Log::writeError("[CONFIG] Invalid crossfade length (must be 0 - 12): " + std::to_string(secs));
+        secs = 0;
+    }
+    return secs;
+}
+
+int Config::preload() {
+    int secs = this->ini->geti("General", "preload", 5);
+    if (secs < 0 || secs > 30) {
+        Log::writeError("[CONFIG] Invalid preload length (must be 0 - 30): " + std::to_string(secs));
+        secs = 5;
+    }
+    return secs;
+}
+
+int Config::rewindStart() {
+    int secs = this->ini->geti("General", "rewind_start", 1);
+    if (secs < 0 || secs > 5) {
+        Log::writeError("[CONFIG] Invalid length of song start to keep (must be 0 - 5): " + std::to_string(secs));
+        secs = 1;
+    }
+    return secs;
+}
+
+int Config::rewindRecent() {
+    int secs = this->ini->geti("General", "rewind_recent", 4);
+    if (secs < 0 || secs > 5) {
+        Log::writeError("[CONFIG] Invalid length of recent audio to keep (must be 0 - 5): " + std::to_string(secs));
+        secs = 4;
+    }
+    return secs;
+}
+
 Log::Level Config::logLevel() {
     const std::string level = this->ini->gets("General", "log_level", "");
     if (level.empty()) {
@@ -95,6 +150,16 @@ bool Config::pauseOnUnplug() {
     return this->ini->getbool("General", "pause_on_unplug", true);
 }
 
+int Config::MP3Decoders() {
+    int decoders = this->ini->geti("MP3", "decoders", 2);
+    // Two are needed to open the next song while the current one finishes (or fades out)
+    if (decoders < 2 || decoders > 4) {
+        Log::writeError("[CONFIG] Invalid number of decoders (must be 2 - 4): " + std::to_string(decoders));
+        decoders = 2;
+    }
+    return decoders;
+}
+
 bool Config::MP3AccurateSeek() {
     return this->ini->getbool("MP3", "accurate_seek", false);
 }
@@ -126,6 +191,114 @@ std::array<float, 32> Config::MP3Equalizer() {
     return eq;
 }
 
+std::vector<Dsp::Filter> Config::DSPFilters() {
+    std::vector<Dsp::Filter> filters;
+
+    // Each filter is stored as: type, frequency, gain, q
+    for (size_t i = 1; i <= 8; i++) {
+        const std::string key = "filter_" + std::to_string(i);
+        const std::string str = this->ini->gets("DSP", key, "");
+        if (str.empty()) {
+            continue;
+        }
+
+        // Split on comma/space
+        std::vector<std::string> toks;
+        char * cstr = strdup(str.c_str());
+        char * tok = strtok(cstr, ", ");
+        while (tok != nullptr) {
+            toks.push_back(tok);
+            tok = strtok(nullptr, ", ");
+        }
+        free(cstr);
+        if (toks.size() != 4) {
+            Log::writeError("[CONFIG] Invalid filter (must be type, frequency, gain, q): " + key);
+            continue;
+        }
+
+        Dsp::Filter f;
+        if (strcasecmp(toks[0].c_str(), "peak") == 0) {
+            f.type = Dsp::Filter::Type::Peak;
+        } else if (strcasecmp(toks[0].c_str(), "lowshelf") == 0) {
+            f.type = Dsp::Filter::Type::LowShelf;
+        } else if (strcasecmp(toks[0].c_str(), "highshelf") == 0) {
+            f.type = Dsp::Filter::Type::HighShelf;
+        } else if (strcasecmp(toks[0].c_str(), "lowpass") == 0) {
+            f.type = Dsp::Filter::Type::LowPass;
+        } else if (strcasecmp(toks[0].c_str(), "highpass") == 0) {
+            f.type = Dsp::Filter::Type::HighPass;
+        } else {
+            Log::writeError("[CONFIG] Invalid filter type: " + toks[0]);
+            continue;
+        }
+
+        f.freq = strtof(toks[1].c_str(), nullptr);
+        f.gain = strtof(toks[2].c_str(), nullptr);
+        f.q = strtof(toks[3].c_str(), nullptr);
+        if (f.freq < 20.0f || f.freq > 20000.0f || f.gain < -24.0f || f.gain > 24.0f || f.q < 0.1f || f.q > 10.0f) {
+            Log::writeError("[CONFIG] Filter out of range (frequency 20 - 20000, gain -24 - 24, q 0.1 - 10): " + key);
+            continue;
+        }
+        filters.push_back(f);
+    }
+
+    return filters;
+}
+
+bool Config::DSPLimiter() {
+    return this->ini->getbool("DSP", "limiter", false);
+}
+
+float Config::DSPPreamp() {
+    const std::string str = this->ini->gets("DSP", "preamp", "0.0");
+    float gain = strtof(str.c_str(), nullptr);
+    if (gain < -24.0f || gain > 24.0f) {
+        Log::writeError("[CONFIG] Invalid preamp (must be -24 - 24): " + std::to_string(gain));
+        gain = 0.0f;
+    }
+    return gain;
+}
+
+NormalizeMode Config::DSPNormalize() {
+    const std::string mode = this->ini->gets("DSP", "normalize", "Off");
+    if (mode == "Track") {
+        return NormalizeMode::Track;
+
+    } else if (mode == "Album") {
+        return NormalizeMode::Album;
+
+    } else if (mode != "Off") {
+        Log::writeError("[CONFIG] Invalid normalize mode (must be Off, Track or Album): " + mode);
+    }
+
+    return NormalizeMode::Off;
+}
+
+float Config::DSPNormalizeTarget() {
+    const std::string str = this->ini->gets("DSP", "normalize_target", "-18.0");
+    float target = strtof(str.c_str(), nullptr);
+    if (target < -30.0f || target > -5.0f) {
+        Log::writeError("[CONFIG] Invalid normalize target (must be -30 - -5): " + std::to_string(target));
+        target = -18.0f;
+    }
+    return target;
+}
+
+Dsp::Resampler::Quality Config::DSPResampleQuality() {
+    const std::string quality = this->ini->gets("DSP", "resample_quality", "Medium");
+    if (quality == "Low") {
+        return Dsp::Resampler::Quality::Low;
+
+    } else if (quality == "High") {
+        return Dsp::Resampler::Quality::High;
+
+    } else if (quality != "Medium") {
+        Log::writeError("[CONFIG] Invalid resample quality (must be Low, Medium or High): " + quality);
+    }
+
+    return Dsp::Resampler::Quality::Medium;
+}
+
 Config::~Config() {
     delete this->ini;
 }
\ No newline at end of file
@@ -0,0 +1,360 @@
+#include <cstring>
+#include "IndexedList.hpp"
+#include <new>
+
+// Number of nodes in each chunk (as a power of two, so an index can be split with shifts)
+#define CHUNK_BITS 4    // ~4.3kB per chunk (enough for 1024 IDs)
+#define CHUNK_SIZE (1 << CHUNK_BITS)
+// Number of IDs in each block
+#define BLOCK_SIZE INDEXEDLIST_BLOCK_SIZE
+
+// Returns the priority of the node at the given index. Hashing the index gives each node an effectively
+// random priority which doesn't need to be stored, keeping the tree balanced with high probability.
+static uint32_t priority(uint32_t i) {
+    i ^= i >> 16;
+    i *= 0x7FEB352D;
+    i ^= i >> 15;
+    i *= 0x846CA68B;
+    i ^= i >> 16;
+    return i;
+}
+
+IndexedList::IndexedList(size_t max) {
+    this->max = max;
+    this->changes = 0;
+    this->clear();
+}
+
+IndexedList::Node & IndexedList::node(uint32_t i) {
+    return this->chunks[i >> CHUNK_BITS][i & (CHUNK_SIZE - 1)];
+}
+
+uint32_t IndexedList::newNode() {
+    uint32_t i;
+    if (this->freeNode != 0) {
+        i = this->freeNode;
+        this->freeNode = this->node(i).used;
+        this->freeCount--;
+
+    } else {
+        // Allocate another chunk once every node has been used
+        if (this->nextNode == (this->chunks.size() << CHUNK_BITS)) {
+            Node * chunk = new (std::nothrow) Node[CHUNK_SIZE];
+            if (chunk == nullptr) {
+                return 0;
+            }
+            this->chunks.push_back(chunk);
+        }
+        i = this->nextNode++;
+    }
+
+    Node & n = this->node(i);
+    n.left = 0;
+    n.right = 0;
+    n.count = 0;
+    n.used = 0;
+    return i;
+}
+
+void IndexedList::deleteNode(uint32_t i) {
+    this->node(i).used = this->freeNode;
+    this->freeNode = i;
+    this->freeCount++;
+}
+
+void IndexedList::update(uint32_t i) {
+    Node & n = this->node(i);
+    n.count = n.used + this->node(n.left).count + this->node(n.right).count;
+}
+
+void IndexedList::split(uint32_t t, size_t pos, uint32_t & l, uint32_t & r) {
+    if (t == 0) {
+        l = 0;
+        r = 0;
+        return;
+    }
+
+    // Descend into whichever side the split point is in
+    Node & n = this->node(t);
+    size_t leftCount = this->node(n.left).count;
+    if (pos <= leftCount) {
+        this->split(n.left, pos, l, n.left);
+        r = t;
+    } else {
+        this->split(n.right, pos - leftCount - n.used, n.right, r);
+        l = t;
+    }
+    this->update(t);
+}
+
+uint32_t IndexedList::merge(uint32_t l, uint32_t r) {
+    if (l == 0 || r == 0) {
+        return (l == 0 ? r : l);
+    }
+
+    // The node with the higher priority becomes the root
+    if (priority(l) > priority(r)) {
+        this->node(l).right = this->merge(this->node(l).right, r);
+        this->update(l);
+        return l;
+    }
+    this->node(r).left = this->merge(l, this->node(r).left);
+    this->update(r);
+    return r;
+}
+
+uint32_t IndexedList::find(size_t & pos, bool end, int change) {
+    uint32_t t = this->root;
+    while (true) {
+        Node & n = this->node(t);
+        n.count += change;
+        size_t leftCount = this->node(n.left).count;
+        if (pos < leftCount) {
+            t = n.left;
+        } else if (pos < leftCount + n.used || (end && pos == leftCount + n.used)) {
+            pos -= leftCount;
+            return t;
+        } else {
+            pos -= leftCount + n.used;
+            t = n.right;
+        }
+    }
+}
+
+bool IndexedList::splitBlock(uint32_t t, size_t start, size_t off, SongID id) {
+    // Everything from the offset moves to the next block if it fits, otherwise to a new block. Either way
+    // the ID (and any inserted after it) are added to the end of the first, filling it before another is needed
+    uint32_t i = 0;
+    bool spare = false;
+    size_t next = start + BLOCK_SIZE;
+    if (off < BLOCK_SIZE && next < this->size()) {
+        i = this->find(next, false, 0);
+        spare = (this->node(i).used + BLOCK_SIZE - off <= BLOCK_SIZE);
+    }
+    if (!spare) {
+        i = this->newNode();
+        if (i == 0) {
+            return false;
+        }
+    }
+
+    // Take the block(s) out of the tree while they're changed
+    Node & a = this->node(t);
+    Node & b = this->node(i);
+    uint32_t l, mid, r;
+    this->split(this->root, start, l, r);
+    this->split(r, BLOCK_SIZE + b.used, mid, r);
+    a.left = 0;
+    a.right = 0;
+    b.left = 0;
+    b.right = 0;
+    std::memmove(&b.ids[BLOCK_SIZE - off], b.ids, b.used * sizeof(SongID));
+    b.used += BLOCK_SIZE - off;
+    std::memcpy(b.ids, &a.ids[off], (BLOCK_SIZE - off) * sizeof(SongID));
+    a.used = off;
+    if (off < BLOCK_SIZE) {
+        a.ids[a.used++] = id;
+    } else {
+        b.ids[b.used++] = id;
+    }
+    this->update(t);
+    this->update(i);
+
+    this->root = this->merge(this->merge(l, this->merge(t, i)), r);
+    return true;
+}
+
+void IndexedList::joinNext(uint32_t t, size_t start) {
+    Node & a = this->node(t);
+    size_t next = start + a.used;
+    if (next >= this->size()) {
+        return;
+    }
+    uint32_t i = this->find(next, false, 0);
+    Node & b = this->node(i);
+    if (a.used + b.used > BLOCK_SIZE) {
+        return;
+    }
+
+    // Take both blocks out of the tree and put back the first holding both's IDs
+    uint32_t l, mid, r;
+    this->split(this->root, start, l, r);
+    this->split(r, a.used + b.used, mid, r);
+    std::memcpy(&a.ids[a.used], b.ids, b.used * sizeof(SongID));
+    a.used += b.used;
+    a.left = 0;
+    a.right = 0;
+    this->update(t);
+    this->deleteNode(i);
+
+    this->root = this->merge(this->merge(l, t), r);
+}
+
+bool IndexedList::reserve(size_t ids, size_t runs) {
+    // Inserting a run of IDs splits at most one block, and otherwise only starts a new block once the last is full
+    if (ids > this->max - this->size()) {
+        ids = this->max - this->size();
+    }
+    size_t needed = 2 * runs + ids/BLOCK_SIZE;
+    size_t spare = this->freeCount + (this->chunks.size() << CHUNK_BITS) - this->nextNode;
+    while (spare < needed) {
+        Node * chunk = new (std::nothrow) Node[CHUNK_SIZE];
+        if (chunk == nullptr) {
+            return false;
+        }
+        this->chunks.push_back(chunk);
+        spare += CHUNK_SIZE;
+    }
+    return true;
+}
+
+bool IndexedList::insert(size_t pos, SongID id) {
+    // Sanity check
+    if (this->size() >= this->max) {
+        return false;
+    }
+
+    // If past the end add at end
+    if (pos > this->size()) {
+        pos = this->size();
+    }
+
+    // The first ID needs a block to go in
+    if (this->root == 0) {
+        uint32_t t = this->newNode();
+        if (t == 0) {
+            return false;
+        }
+        this->node(t).ids[0] = id;
+        this->node(t).used = 1;
+        this->update(t);
+        this->root = t;
+        this->changes++;
+        return true;
+    }
+
+    // Split the block if it's full, otherwise add to it (counting the ID on the way down the second time)
+    size_t off = pos;
+    uint32_t t = this->find(off, true, 0);
+    if (this->node(t).used == BLOCK_SIZE) {
+        if (!this->splitBlock(t, pos - off, off, id)) {
+            return false;
+        }
+
+    } else {
+        off = pos;
+        this->find(off, true, 1);
+        Node & n = this->node(t);
+        std::memmove(&n.ids[off + 1], &n.ids[off], (n.used - off) * sizeof(SongID));
+        n.ids[off] = id;
+        n.used++;
+    }
+
+    this->changes++;
+    return true;
+}
+
+bool IndexedList::erase(size_t pos) {
+    // Sanity check
+    if (pos >= this->size()) {
+        return false;
+    }
+
+    size_t off = pos;
+    uint32_t t = this->find(off, false, 0);
+    size_t start = pos - off;
+
+    // Cut out the block if it would be empty
+    if (this->node(t).used == 1) {
+        uint32_t l, mid, r;
+        this->split(this->root, start, l, r);
+        this->split(r, 1, mid, r);
+        this->deleteNode(mid);
+        this->root = this->merge(l, r);
+
+    // Otherwise remove from it, joining it with the next if it's mostly empty
+    } else {
+        off = pos;
+        this->find(off, false, -1);
+        Node & n = this->node(t);
+        std::memmove(&n.ids[off], &n.ids[off + 1], (n.used - off - 1) * sizeof(SongID));
+        n.used--;
+        if (n.used < BLOCK_SIZE/4) {
+            this->joinNext(t, start);
+        }
+    }
+
+    this->changes++;
+    return true;
+}
+
+bool IndexedList::move(size_t from, size_t to) {
+    if (from >= this->size() || to >= this->size()) {
+        return false;
+    }
+    if (from == to) {
+        return true;
+    }
+
+    // Reserving first means the insert can't fail once the ID is removed
+    if (!this->reserve(1)) {
+        return false;
+    }
+    SongID id = this->at(from);
+    this->erase(from);
+    this->insert(to, id);
+    return true;
+}
+
+SongID IndexedList::at(size_t pos) {
+    if (pos >= this->size()) {
+        return -1;
+    }
+
+    uint32_t t = this->find(pos, false, 0);
+    return this->node(t).ids[pos];
+}
+
+void IndexedList::clear() {
+    // Keep only the first chunk, with node zero as the null node (no IDs, children or count)
+    for (size_t i = 1; i < this->chunks.size(); i++) {
+        delete[] this->chunks[i];
+    }
+    if (this->chunks.empty()) {
+        this->chunks.push_back(new Node[CHUNK_SIZE]);
+    }
+    this->chunks.resize(1);
+    Node & n = this->node(0);
+    n.left = 0;
+    n.right = 0;
+    n.count = 0;
+    n.used = 0;
+
+    this->nextNode = 1;
+    this->freeNode = 0;
+    this->freeCount = 0;
+    this->root = 0;
+    this->changes++;
+}
+
+bool IndexedList::empty() {
+    return (this->root == 0);
+}
+
+size_t IndexedList::size() {
+    return this->node(this->root).count;
+}
+
+size_t IndexedList::maxSize() {
+    return this->max;
+}
+
+uint64_t IndexedList::changeCount() {
+    return this->changes;
+}
+
+IndexedList::~IndexedList() {
+    for (Node * chunk : this->chunks) {
+        delete[] chunk;
+    }
+}
\ No newline at end of file
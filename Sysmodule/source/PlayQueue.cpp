@@ -1,92 +1,90 @@
-#include <algorithm>
 #include "PlayQueue.hpp"
 #include "utils/Random.hpp"
 
-// Maximum number of IDs (reserved at creation)
-#define MAX_SIZE 25000  // Requires 150kB (100kB for IDs, 50kB for position)
+// Maximum number of IDs (memory is only allocated as they're added)
+#define MAX_SIZE 200000 // Requires ~0.85MB when added in order, up to ~1.4MB when inserted randomly (see IndexedList)
+// Number of recent changes remembered
+#define LOG_SIZE 512    // Requires 12kB (24 bytes per change)
 
-PlayQueue::PlayQueue() {
+PlayQueue::PlayQueue() : queue(MAX_SIZE) {
     this->idx = 0;
-    this->queue.reserve(MAX_SIZE);
-    this->shuffled = false;
+    this->order = nullptr;
+    this->version_ = 0;
+    this->resetVersion = 0;
+    this->changes.resize(LOG_SIZE);
 }
 
-bool PlayQueue::addID(SongID id, unsigned short pos) {
-    // Sanity check
-    if (this->queue.size() == MAX_SIZE) {
-        return false;
-    }
+void PlayQueue::logChange(TriPlayer::QueueChangeType type, SongID id, size_t pos, size_t to) {
+    this->version_++;
+    this->changes[this->version_ % LOG_SIZE] = TriPlayer::QueueChange{type, id, pos, to};
+}
+
+void PlayQueue::logReset() {
+    this->version_++;
+    this->resetVersion = this->version_;
+}
 
+bool PlayQueue::addID(SongID id, size_t pos) {
     // If past the end add at end
     if (pos > this->queue.size()) {
         pos = this->queue.size();
     }
 
-    PlayQueuePair p;
-    p.id = id;
-    p.pos = (this->shuffled ? this->maxPos + 1 : pos);
-    this->queue.insert(this->queue.begin() + pos, p);
+    if (this->order == nullptr) {
+        if (!this->queue.insert(pos, id)) {
+            return false;
+        }
 
-    if (!this->shuffled) {
-        // If it's not shuffled we update following pairs
-        for (size_t i = pos + 1; i < this->queue.size(); i++) {
-            this->queue[i].pos++;
+    // Append to the unshuffled queue so it's placed after all others when unshuffling
+    } else {
+        if (!this->queue.insert(this->queue.size(), id)) {
+            return false;
         }
+        this->order->insert(pos);
     }
-    this->maxPos++;
 
+    this->logChange(TriPlayer::QueueChangeType::Insert, id, pos, 0);
     return true;
 }
 
-bool PlayQueue::removeID(unsigned short pos) {
+bool PlayQueue::removeID(size_t pos) {
     // Sanity check
-    if (this->queue.size() == MAX_SIZE || pos >= this->queue.size()) {
+    if (pos >= this->queue.size()) {
         return false;
     }
 
-    this->queue.erase(this->queue.begin() + pos);
-    if (!this->shuffled) {
-        // If it's not shuffled we update following pairs
-        for (size_t i = pos + 1; i < this->queue.size(); i++) {
-            this->queue[i].pos--;
-        }
-        this->maxPos--;
+    if (this->order == nullptr) {
+        this->queue.erase(pos);
+    } else {
+        this->queue.erase(this->order->erase(pos));
     }
 
+    this->logChange(TriPlayer::QueueChangeType::Remove, -1, pos, 0);
     return true;
 }
 
-void PlayQueue::moveIDDown(unsigned short pos, unsigned short amt) {
+void PlayQueue::moveIDDown(size_t pos, size_t amt) {
     // Sanity check
     if (pos >= this->queue.size() || amt == 0) {
         return;
     }
 
     // If too large move to the end
-    if ((pos + amt) > this->queue.size()) {
-        amt = (this->queue.size() - pos);
-    }
-
-    // Move (need to update positions if not shuffled)
-    if (!this->shuffled) {
-        for (size_t i = pos + 1; i < pos + amt; i++) {
-            PlayQueuePair tmp = this->queue[i-1];
-            this->queue[i-1] = this->queue[i];
-            this->queue[i] = tmp;
-            this->queue[i-1].pos--;
-            this->queue[i].pos++;
-        }
+    if (amt > this->queue.size() - 1 - pos) {
+        amt = this->queue.size() - 1 - pos;
+    }
 
-    } else {
-        for (size_t i = pos + 1; i < pos + amt; i++) {
-            PlayQueuePair tmp = this->queue[i-1];
-            this->queue[i-1] = this->queue[i];
-            this->queue[i] = tmp;
+    if (this->order == nullptr) {
+        if (!this->queue.move(pos, pos + amt)) {
+            return;
         }
+    } else {
+        this->order->move(pos, pos + amt);
     }
+    this->logChange(TriPlayer::QueueChangeType::Move, -1, pos, pos + amt);
 }
 
-void PlayQueue::moveIDUp(unsigned short pos, unsigned short amt) {
+void PlayQueue::moveIDUp(size_t pos, size_t amt) {
     // Sanity check
     if (pos == 0 || pos >= this->queue.size() || amt == 0) {
         return;
@@ -97,40 +95,109 @@ void PlayQueue::moveIDUp(unsigned short pos, unsigned short amt) {
         amt = pos;
     }
 
-    // Move (need to update positions if not shuffled)
-    unsigned short mv = pos - amt;
-    if (!this->shuffled) {
-        for (size_t i = pos - 1; i >= mv && i <= MAX_SIZE; i--) {
-            PlayQueuePair tmp = this->queue[i+1];
-            this->queue[i+1] = this->queue[i];
-            this->queue[i] = tmp;
-            this->queue[i+1].pos++;
-            this->queue[i].pos--;
+    if (this->order == nullptr) {
+        if (!this->queue.move(pos, pos - amt)) {
+            return;
         }
-
     } else {
-        for (size_t i = pos - 1; i >= mv && i <= MAX_SIZE; i--) {
-            PlayQueuePair tmp = this->queue[i+1];
-            this->queue[i+1] = this->queue[i];
-            this->queue[i] = tmp;
-        }
+        this->order->move(pos, pos - amt);
     }
+    this->logChange(TriPlayer::QueueChangeType::Move, -1, pos, pos - amt);
 }
 
-SongID PlayQueue::currentID() {
-    if (this->queue.size() == 0) {
-        return -1;
+void PlayQueue::moveIdx(size_t from, size_t to) {
+    if (this->idx == from) {
+        this->idx = to;
+    } else if (from < this->idx && this->idx <= to) {
+        this->idx--;
+    } else if (to <= this->idx && this->idx < from) {
+        this->idx++;
+    }
+}
+
+bool PlayQueue::addIDs(const SongID * ids, size_t count, size_t pos) {
+    // Sanity check (making sure there's memory for them all first)
+    if (count > this->maxSize() - this->size() || !this->queue.reserve(count)) {
+        return false;
+    }
+
+    // If past the end add at end
+    if (pos > this->size()) {
+        pos = this->size();
     }
 
-    return this->queue[this->idx].id;
+    // Songs inserted before the current one push it down
+    if (!this->empty() && pos <= this->idx) {
+        this->idx += count;
+    }
+    for (size_t i = 0; i < count; i++) {
+        this->addID(ids[i], pos + i);
+    }
+
+    return true;
 }
 
-SongID PlayQueue::IDatPosition(unsigned short pos) {
-    if (this->queue.size() == 0 || pos >= this->queue.size()) {
+bool PlayQueue::removeIDs(size_t pos, size_t count) {
+    // Sanity check
+    if (pos > this->size() || count > this->size() - pos) {
+        return false;
+    }
+
+    // Remove from the end of the range so nothing in it moves
+    for (size_t i = count; i > 0; i--) {
+        this->removeID(pos + i - 1);
+    }
+
+    // Move the current index back if songs before it were removed, or to the song after the range if it was removed
+    if (this->idx >= pos + count) {
+        this->idx -= count;
+    } else if (this->idx >= pos) {
+        this->setIdx(pos);
+    }
+
+    return true;
+}
+
+bool PlayQueue::moveIDs(size_t pos, size_t count, size_t to) {
+    // Sanity check
+    if (pos > this->size() || count > this->size() - pos || to > this->size() - count) {
+        return false;
+    }
+
+    // The moved IDs are inserted as one run, so they can't run out of memory part way through
+    if (this->order == nullptr && !this->queue.reserve(count)) {
+        return false;
+    }
+
+    // Move one at a time, either taking the first of the range to the end of where it will be,
+    // or the next of the range to the position it will be at
+    for (size_t i = 0; i < count; i++) {
+        size_t from = (to > pos ? pos : pos + i);
+        size_t dest = (to > pos ? to + count - 1 : to + i);
+        if (this->order == nullptr) {
+            this->queue.move(from, dest);
+        } else {
+            this->order->move(from, dest);
+        }
+        this->moveIdx(from, dest);
+        if (from != dest) {
+            this->logChange(TriPlayer::QueueChangeType::Move, -1, from, dest);
+        }
+    }
+
+    return true;
+}
+
+SongID PlayQueue::currentID() {
+    return this->IDatPosition(this->idx);
+}
+
+SongID PlayQueue::IDatPosition(size_t pos) {
+    if (pos >= this->queue.size()) {
         return -1;
     }
 
-    return this->queue[pos].id;
+    return this->queue.at(this->order == nullptr ? pos : this->order->index(pos));
 }
 
 size_t PlayQueue::currentIdx() {
@@ -153,7 +220,7 @@ void PlayQueue::incrementIdx() {
     this->idx++;
 }
 
-void PlayQueue::setIdx(unsigned short i) {
+void PlayQueue::setIdx(size_t i) {
     if (i >= this->queue.size() && this->queue.size() > 0) {
         this->idx = this->queue.size() - 1;
     } else {
@@ -163,66 +230,88 @@ void PlayQueue::setIdx(unsigned short i) {
 
 void PlayQueue::clear() {
     this->idx = 0;
-    this->queue.erase(this->queue.begin(), this->queue.end());
-    this->shuffled = false;
+    this->queue.clear();
+    delete this->order;
+    this->order = nullptr;
+    this->logReset();
 }
 
 bool PlayQueue::empty() {
-    return (this->queue.size() == 0);
+    return this->queue.empty();
 }
 
 size_t PlayQueue::size() {
     return this->queue.size();
 }
 
+size_t PlayQueue::maxSize() {
+    return this->queue.maxSize();
+}
+
+bool PlayQueue::reserve(size_t count, size_t runs) {
+    return this->queue.reserve(count, runs);
+}
+
 bool PlayQueue::isShuffled() {
-    return this->shuffled;
+    return (this->order != nullptr);
 }
 
 void PlayQueue::shuffle() {
-    this->shuffled = true;
+    this->shuffle(Utils::Random::getSizeT(0, UINT64_MAX));
+}
 
-    if (this->queue.size() == 0) {
+void PlayQueue::shuffle(uint64_t seed) {
+    if (this->queue.empty()) {
         return;
     }
 
-    // Set current song as first
-    PlayQueuePair tmp = this->queue[this->idx];
-    this->queue[this->idx] = this->queue[0];
-    this->queue[0] = tmp;
+    // Set current song as first (clamping the index, as removals can leave it past the end)
+    size_t first = (this->idx < this->queue.size() ? this->idx : this->queue.size() - 1);
+    if (this->order != nullptr) {
+        first = this->order->index(first);
+    }
     this->setIdx(0);
 
-    // Uses the Yates-Fisher algorithm
-    for (size_t i = this->queue.size() - 1; i > 1; i--) {
-        size_t r = Utils::Random::getSizeT(1, i);
-        tmp = this->queue[i];
-        this->queue[i] = this->queue[r];
-        this->queue[r] = tmp;
-    }
+    // The order is generated as it's needed
+    delete this->order;
+    this->order = new ShuffleOrder(this->queue.size(), first, seed);
+    this->logReset();
+}
+
+uint64_t PlayQueue::shuffleSeed() {
+    return (this->order == nullptr ? 0 : this->order->seed());
 }
 
 void PlayQueue::unshuffle() {
-    if (!this->shuffled) {
+    if (this->order == nullptr) {
         return;
     }
 
-    // Get pos of current song
-    unsigned short songPos = this->queue[this->currentIdx()].pos;
+    // Keep the same song as current song
+    if (this->idx < this->queue.size()) {
+        this->idx = this->order->index(this->idx);
+    }
+    delete this->order;
+    this->order = nullptr;
+    this->logReset();
+}
 
-    // Sort by pos value
-    std::sort(this->queue.begin(), this->queue.end(), [](const PlayQueuePair & lhs, const PlayQueuePair & rhs) {
-        return lhs.pos < rhs.pos;
-    });
+uint64_t PlayQueue::version() {
+    return this->version_;
+}
 
-    // Update pos values
-    for (size_t i = 0; i < this->queue.size(); i++) {
-        // Set same song as current song
-        if (this->queue[i].pos == songPos) {
-            this->setIdx(i);
-        }
-        this->queue[i].pos = i;
+bool PlayQueue::changesSince(uint64_t since, size_t max, std::vector<TriPlayer::QueueChange> & out) {
+    // Changes are only known from the last reset, and only the most recent are kept
+    if (since > this->version_ || since < this->resetVersion || this->version_ - since > LOG_SIZE) {
+        return false;
     }
-    this->maxPos = this->queue.size();
 
-    this->shuffled = false;
+    for (uint64_t v = since + 1; v <= this->version_ && max > 0; v++, max--) {
+        out.push_back(this->changes[v % LOG_SIZE]);
+    }
+    return true;
+}
+
+PlayQueue::~PlayQueue() {
+    delete this->order;
 }
\ No newline at end of file
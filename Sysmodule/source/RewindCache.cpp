@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cstring>
+#include "Log.hpp"
+#include <new>
+#include "RewindCache.hpp"
+
+// Maximum memory used for samples (1MB, which is about 5 seconds of 48kHz stereo)
+#define MAX_MEMORY (size_t)(1024 * 1024)
+
+RewindCache::RewindCache() {
+    this->start = nullptr;
+    this->startLength = 0;
+    this->recent = nullptr;
+    this->recentLength = 0;
+    this->channels = 0;
+    this->rate = 0;
+    this->startSecs = 0;
+    this->recentSecs = 0;
+    this->reset(0, 0);
+}
+
+void RewindCache::freeMemory() {
+    delete[] this->start;
+    delete[] this->recent;
+    this->start = nullptr;
+    this->recent = nullptr;
+    this->startLength = 0;
+    this->recentLength = 0;
+}
+
+void RewindCache::setLength(size_t startSecs, size_t recentSecs) {
+    this->startSecs = startSecs;
+    this->recentSecs = recentSecs;
+}
+
+void RewindCache::reset(long rate, int channels) {
+    this->startFill = 0;
+    this->recentFill = 0;
+    this->recentEnd = 0;
+    this->decodePos = 0;
+    this->readPos = 0;
+
+    // Work out how much is needed, shrinking the recent audio first if it won't fit
+    size_t startLength = 0;
+    size_t recentLength = 0;
+    if (rate > 0 && channels > 0) {
+        size_t maxSamples = MAX_MEMORY/(channels * sizeof(int16_t));
+        startLength = std::min(this->startSecs * rate, maxSamples);
+        recentLength = std::min(this->recentSecs * rate, maxSamples - startLength);
+    }
+
+    // Only reallocate if the size has changed
+    bool same = (channels == this->channels && startLength == this->startLength && recentLength == this->recentLength);
+    this->channels = channels;
+    this->rate = rate;
+    if (same) {
+        return;
+    }
+    this->freeMemory();
+    if (startLength + recentLength == 0) {
+        return;
+    }
+
+    this->start = (startLength > 0 ? new (std::nothrow) int16_t[startLength * channels] : nullptr);
+    this->recent = (recentLength > 0 ? new (std::nothrow) int16_t[recentLength * channels] : nullptr);
+    if ((startLength > 0 && this->start == nullptr) || (recentLength > 0 && this->recent == nullptr)) {
+        this->freeMemory();
+        Log::writeWarning("[REWIND] Unable to allocate memory, disabling cache");
+        return;
+    }
+    this->startLength = startLength;
+    this->recentLength = recentLength;
+    Log::writeInfo("[REWIND] Caching " + std::to_string(startLength) + " start samples and " + std::to_string(recentLength) + " recent samples");
+}
+
+void RewindCache::record(const uint8_t * buf, size_t bytes) {
+    if (this->channels == 0) {
+        return;
+    }
+
+    const int16_t * in = reinterpret_cast<const int16_t *>(buf);
+    size_t count = bytes/(this->channels * sizeof(int16_t));
+
+    // Extend the start if this carries on from it
+    if (this->decodePos == this->startFill && this->startFill < this->startLength) {
+        size_t num = std::min(count, this->startLength - this->startFill);
+        std::memcpy(this->start + this->startFill * this->channels, in, num * this->channels * sizeof(int16_t));
+        this->startFill += num;
+    }
+
+    // Copy into the ring, wrapping around as needed (only the newest samples are kept)
+    if (this->recentLength > 0) {
+        size_t skip = (count > this->recentLength ? count - this->recentLength : 0);
+        size_t copied = skip;
+        while (copied < count) {
+            size_t num = std::min(count - copied, this->recentLength - this->recentEnd);
+            std::memcpy(this->recent + this->recentEnd * this->channels, in + copied * this->channels, num * this->channels * sizeof(int16_t));
+            this->recentEnd = (this->recentEnd + num) % this->recentLength;
+            copied += num;
+        }
+        this->recentFill = std::min(this->recentFill + count, this->recentLength);
+    }
+
+    this->decodePos += count;
+    this->readPos = this->decodePos;
+}
+
+void RewindCache::seeked(size_t pos) {
+    this->decodePos = pos;
+    this->readPos = pos;
+    this->recentFill = 0;
+    this->recentEnd = 0;
+}
+
+bool RewindCache::rewind(size_t pos) {
+    // Moving to where the source is up to doesn't need anything cached
+    bool cached = (pos == this->decodePos);
+    if (pos < this->startFill) {
+        cached = true;
+    } else if (pos < this->decodePos && pos >= this->decodePos - this->recentFill) {
+        cached = true;
+    }
+
+    if (cached) {
+        this->readPos = pos;
+        Log::writeInfo("[REWIND] Serving from sample " + std::to_string(pos));
+    }
+    return cached;
+}
+
+size_t RewindCache::read(uint8_t * buf, size_t bytes) {
+    if (this->channels == 0) {
+        return 0;
+    }
+
+    int16_t * out = reinterpret_cast<int16_t *>(buf);
+    size_t count = bytes/(this->channels * sizeof(int16_t));
+    size_t copied = 0;
+    while (copied < count && this->readPos < this->decodePos) {
+        // Prefer the start as it won't wrap
+        const int16_t * src;
+        size_t num;
+        if (this->readPos < this->startFill) {
+            src = this->start + this->readPos * this->channels;
+            num = std::min(count - copied, this->startFill - this->readPos);
+
+        // Otherwise find where the position is in the ring
+        } else if (this->readPos >= this->decodePos - this->recentFill) {
+            size_t behind = this->decodePos - this->readPos;
+            size_t idx = (this->recentEnd + this->recentLength - behind) % this->recentLength;
+            src = this->recent + idx * this->channels;
+            num = std::min(count - copied, std::min(behind, this->recentLength - idx));
+
+        // The rest isn't cached, so the source needs to seek
+        } else {
+            break;
+        }
+
+        std::memcpy(out + copied * this->channels, src, num * this->channels * sizeof(int16_t));
+        copied += num;
+        this->readPos += num;
+    }
+
+    return copied * this->channels * sizeof(int16_t);
+}
+
+size_t RewindCache::position() {
+    return this->readPos;
+}
+
+bool RewindCache::synced() {
+    return (this->readPos == this->decodePos);
+}
+
+RewindCache::~RewindCache() {
+    this->freeMemory();
+}
\ No newline at end of file
@@ -1,51 +1,128 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include "Config.hpp"
-#include "Database.hpp"
+#include "dsp/Chain.hpp"
+#include "IndexedList.hpp"
+#include "ipc/IDList.hpp"
+#ifdef __SWITCH__
+#include "ipc/HipcServer.hpp"
+#else
+#include "ipc/SocketServer.hpp"
+#endif
 #include "ipc/TriPlayer.hpp"
 #include "nx/Audio.hpp"
 #include "nx/NX.hpp"
 #include "Paths.hpp"
 #include "PlayQueue.hpp"
+#include "RewindCache.hpp"
 #include "Service.hpp"
+#include "sources/FLAC.hpp"
 #include "sources/MP3.hpp"
+#include "sources/Opus.hpp"
+#include "sources/Resampled.hpp"
+#include "sources/Vorbis.hpp"
 #include "utils/FS.hpp"
-
-// Interval (in seconds) to test if DB file is accessible
-#define DB_TEST_INTERVAL 2
+#include "utils/Mix.hpp"
+#include "utils/Random.hpp"
+
+// Sample rate that all audio is output at (the console's native rate)
+#define OUTPUT_RATE 48000
+// Number of times to try reading the library snapshot, and the milliseconds between each (it can't be read while being replaced)
+#define LIBRARY_ATTEMPTS 5
+#define LIBRARY_RETRY_INTERVAL 20
 // Number of milliseconds between polling system state
 #define POLL_INTERVAL 10
 // Number of seconds to wait before previous becomes (back to start)
 #define PREV_WAIT 2
-// Max size of sub-queue (requires 20kB)
+// Max size of sub-queue (requires 100kB)
 #define SUBQUEUE_MAX_SIZE 5000
+// Minimum number of milliseconds between reporting changes in position
+#define POSITION_INTERVAL 100
+// Longest time (in milliseconds) a client can wait for a change
+#define WAIT_MAX 60000
+// Path of the socket clients connect to when not running on a console, and how many can connect (i.e. from a load generator)
+#define SOCKET_PATH "/tmp/triplayer.sock"
+#define SOCKET_CLIENTS 16
+
+// Identifies the file storing the shuffle state (and it's version)
+constexpr uint32_t stateMagic = 0x31535054;     // "TPS1"
+
+// Contents of the file storing the shuffle state
+struct ShuffleState {
+    uint32_t magic;         // Always stateMagic
+    uint32_t shuffled;      // Non-zero if the queue was shuffled
+    uint64_t seed;          // Seed of the shuffle
+};
 
 MainService::MainService() {
     this->audio = Audio::getInstance();
     this->combosUpdated = false;
-    this->dbLocked = false;
+    this->crossfade = 0;
+    this->decodeTimesCount = 0;
+    this->decodeTimesNext = 0;
+    this->dsp = new Dsp::Chain();
+    this->normalize = NormalizeMode::Off;
+    this->normalizeTarget = -18.0f;
+    this->preload = 0;
+    this->resampleQuality = Dsp::Resampler::Quality::Medium;
     this->muteLevel = 0.0;
     this->pressTime = std::time(nullptr);
     this->queue = new PlayQueue();
     this->repeatMode = RepeatMode::Off;
+    this->rewind = new RewindCache();
     this->seekTo = -1;
+    this->fadeSource = nullptr;
+    this->nextSource = nullptr;
+    this->nextSourceID = -1;
     this->source = nullptr;
-    this->songAction = SongAction::Nothing;
+    this->sourceID = -1;
+    this->subQueue = new IndexedList(SUBQUEUE_MAX_SIZE);
+    this->pendingShuffle = false;
+    this->pendingSeed = 0;
+    this->actionCount = 0;
+    this->actionHead = 0;
+    this->woken = false;
+    this->changeSequence = 1;
+    this->changedAt.fill(0);
+    this->positionTime = std::chrono::steady_clock::now();
+    this->state = State{-1, TriPlayer::Status::Stopped, 0.0, 0.0, RepeatMode::Off, false, 0, 0, 0, 0, 0, ""};
+
+    // Create memory to publish the state in
+    this->sharedState = static_cast<Ipc::SharedState *>(NX::Shmem::create(Ipc::SharedStateSize, this->sharedStateHandle));
+    if (this->sharedState == nullptr) {
+        Log::writeWarning("[SERVICE] Couldn't create shared memory, clients will have to request the state");
+    }
 
     // Read and set config
     this->cfg = new Config(Path::Sys::ConfigFile);
     this->updateConfig();
-
-    // Create ipc server
-    this->ipcServer = new Ipc::Server("tri", 3);
+    this->loadShuffle();
+
+    // Create ipc server (each client may use a second session to wait for changes)
+#ifdef __SWITCH__
+    this->ipcServer = new Ipc::HipcServer("tri", 4);
+#else
+    this->ipcServer = new Ipc::SocketServer(SOCKET_PATH, SOCKET_CLIENTS);
+#endif
+    this->deferredHead = 0;
+    this->deferredCount = 0;
+    this->deferredBusy = false;
     this->ipcServer->setRequestHandler([this](Ipc::Request * r) -> uint32_t {
-        return static_cast<uint32_t>(this->commandThread(r));
+        if (this->deferRequest(r)) {
+            return static_cast<uint32_t>(Ipc::Result::Ok);
+        }
+
+        uint32_t rc = static_cast<uint32_t>(this->commandThread(r));
+        this->checkForChanges();
+        return rc;
     });
 
-    // Create database
-    if (!this->exit_) {
-        this->db = new Database();
-    } else {
-        this->db = nullptr;
-    }
+    // Create object to read the library from
+    this->library = new LibrarySnapshot(Path::Common::LibraryFile);
+
+    // Publish the initial state
+    this->checkForChanges();
 }
 
 void MainService::updateConfig() {
@@ -53,18 +130,220 @@ void MainService::updateConfig() {
     this->watchGpio = this->cfg->pauseOnUnplug();
     this->watchHid = this->cfg->keyComboEnabled();
     this->watchSleep = this->cfg->pauseOnSleep();
+    this->crossfade = this->cfg->crossfade();
+    this->preload = this->cfg->preload();
 
-    std::scoped_lock<std::shared_mutex> cMtx(this->cMutex);
+    std::scoped_lock<SharedMutex> cMtx(this->cMutex);
     this->comboNextString = this->cfg->keyComboNext();
     this->comboPlayString = this->cfg->keyComboPlay();
     this->comboPrevString = this->cfg->keyComboPrev();
     this->combosUpdated = true;
 
-    std::scoped_lock<std::shared_mutex> sMtx(this->sMutex);
+    std::scoped_lock<SharedMutex> sMtx(this->sMutex);
+    this->rewind->setLength(this->cfg->rewindStart(), this->cfg->rewindRecent());
+    this->dsp->setFilters(this->cfg->DSPFilters(), this->cfg->DSPPreamp(), this->cfg->DSPLimiter());
+    this->normalize = this->cfg->DSPNormalize();
+    this->normalizeTarget = this->cfg->DSPNormalizeTarget();
+    this->resampleQuality = this->cfg->DSPResampleQuality();
+    MP3::setHandleLimit(this->cfg->MP3Decoders());
     MP3::setAccurateSeek(this->cfg->MP3AccurateSeek());
     MP3::setEqualizer(this->cfg->MP3Equalizer());
 }
 
+void MainService::recordDecodeTime(const std::chrono::steady_clock::duration time) {
+    std::scoped_lock<Mutex> mtx(this->statsMutex);
+    this->decodeTimes[this->decodeTimesNext] = std::chrono::duration_cast<std::chrono::microseconds>(time).count();
+    this->decodeTimesNext = (this->decodeTimesNext + 1) % this->decodeTimes.size();
+    if (this->decodeTimesCount < this->decodeTimes.size()) {
+        this->decodeTimesCount++;
+    }
+}
+
+TriPlayer::Status MainService::status() {
+    // Say that we're playing if the song is currently seeking
+    if (this->seekTo >= 0) {
+        return TriPlayer::Status::Playing;
+    }
+
+    switch (this->audio->status()) {
+        case Audio::Status::Playing:
+            return TriPlayer::Status::Playing;
+
+        case Audio::Status::Paused:
+            return TriPlayer::Status::Paused;
+
+        case Audio::Status::Stopped:
+            return TriPlayer::Status::Stopped;
+    }
+    return TriPlayer::Status::Error;
+}
+
+double MainService::position() {
+    // Check position if not seeking
+    double pos = 100.0 * this->seekTo;
+    if (pos < 0) {
+        std::shared_lock<SharedMutex> mtx(this->sMutex);
+        if (this->source == nullptr) {
+            pos = 0;
+        } else {
+            pos = 100 * (this->audio->samplesPlayed()/(double)this->source->totalSamples());
+        }
+    }
+    return pos;
+}
+
+void MainService::checkForChanges() {
+    std::scoped_lock<Mutex> mtx(this->changeMutex);
+    uint32_t changed = 0;
+
+    // Compare everything in the snapshot
+    State now = this->state;
+    now.status = this->status();
+    now.volume = this->audio->volume();
+    now.repeat = this->repeatMode;
+    {
+        std::shared_lock<SharedMutex> sqMtx(this->sqMutex);
+        std::shared_lock<SharedMutex> qMtx(this->qMutex);
+        now.song = this->queue->currentID();
+        uint64_t seed;
+        this->getShuffle(now.shuffled, seed);
+        now.queueVersion = this->queue->version();
+        now.queueIdx = this->queue->currentIdx();
+        now.subQueueChanges = this->subQueue->changeCount();
+        now.queueSize = this->queue->size();
+        now.subQueueSize = this->subQueue->size();
+        if (this->playingFrom != this->state.playingFrom) {
+            now.playingFrom = this->playingFrom;
+            changed |= TriPlayer::Change::PlayingFrom;
+        }
+    }
+    changed |= (now.song != this->state.song ? TriPlayer::Change::Song : 0);
+    changed |= (now.status != this->state.status ? TriPlayer::Change::Status : 0);
+    changed |= (now.volume != this->state.volume ? TriPlayer::Change::Volume : 0);
+    changed |= (now.repeat != this->state.repeat ? TriPlayer::Change::Repeat : 0);
+    changed |= (now.shuffled != this->state.shuffled ? TriPlayer::Change::Shuffle : 0);
+    changed |= (now.queueVersion != this->state.queueVersion || now.queueSize != this->state.queueSize ? TriPlayer::Change::Queue : 0);
+    changed |= (now.queueIdx != this->state.queueIdx ? TriPlayer::Change::QueueIdx : 0);
+    changed |= (now.subQueueChanges != this->state.subQueueChanges || now.subQueueSize != this->state.subQueueSize ? TriPlayer::Change::SubQueue : 0);
+
+    // The position changes constantly while playing, so it's only marked as changed every so often
+    // (it stays different from the snapshot in between, so the latest position is always reported eventually)
+    double pos = this->position();
+    std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+    if (pos != this->state.position && time - this->positionTime >= std::chrono::milliseconds(POSITION_INTERVAL)) {
+        now.position = pos;
+        this->positionTime = time;
+        changed |= TriPlayer::Change::Position;
+    }
+
+    // Record the sequence number each piece changed at and wake the server so any waiting clients are replied to
+    if (changed != 0) {
+        this->changeSequence++;
+        for (size_t i = 0; i < this->changedAt.size(); i++) {
+            if (changed & (1 << i)) {
+                this->changedAt[i] = this->changeSequence;
+            }
+        }
+        this->state = now;
+        this->ipcServer->wake();
+    }
+
+    // Publish the state every time so the position is always current
+    if (this->sharedState != nullptr) {
+        TriPlayer::State s;
+        this->getState(s);
+        s.position = pos;
+        Ipc::writeSharedState(this->sharedState, s);
+    }
+}
+
+void MainService::getState(TriPlayer::State & s) {
+    s.songID = this->state.song;
+    s.status = this->state.status;
+    s.position = this->state.position;
+    s.volume = this->state.volume;
+    s.repeat = TriPlayer::Repeat::Off;
+    switch (this->state.repeat) {
+        case RepeatMode::Off:
+            s.repeat = TriPlayer::Repeat::Off;
+            break;
+
+        case RepeatMode::One:
+            s.repeat = TriPlayer::Repeat::One;
+            break;
+
+        case RepeatMode::All:
+            s.repeat = TriPlayer::Repeat::All;
+            break;
+    }
+    s.shuffle = (this->state.shuffled ? TriPlayer::Shuffle::On : TriPlayer::Shuffle::Off);
+    s.queueSize = this->state.queueSize;
+    s.queueIdx = this->state.queueIdx;
+    s.subQueueSize = this->state.subQueueSize;
+    s.queueVersion = this->state.queueVersion;
+    s.changeSequence = this->changeSequence;
+}
+
+uint32_t MainService::changesSince(const uint32_t mask, const uint64_t since, uint64_t & sequence) {
+    std::scoped_lock<Mutex> mtx(this->changeMutex);
+    uint32_t changed = 0;
+    for (size_t i = 0; i < this->changedAt.size(); i++) {
+        if ((mask & (1 << i)) && this->changedAt[i] > since) {
+            changed |= (1 << i);
+        }
+    }
+    sequence = this->changeSequence;
+    return changed;
+}
+
+void MainService::getStats(TriPlayer::Stats & stats) {
+    stats.bufferCount = this->audio->bufferCount();
+    stats.bufferSize = this->audio->bufferSize();
+    stats.underruns = this->audio->underruns();
+    stats.minQueuedSamples = this->audio->minQueuedSamples();
+
+    // Copy the times so they can be sorted without holding the lock
+    std::array<uint32_t, 512> times;
+    size_t count;
+    {
+        std::scoped_lock<Mutex> mtx(this->statsMutex);
+        count = this->decodeTimesCount;
+        std::copy(this->decodeTimes.begin(), this->decodeTimes.begin() + count, times.begin());
+    }
+
+    stats.decodeSamples = count;
+    stats.decodeP50 = 0;
+    stats.decodeP95 = 0;
+    stats.decodeP99 = 0;
+    stats.decodeMax = 0;
+    if (count > 0) {
+        std::sort(times.begin(), times.begin() + count);
+        stats.decodeP50 = times[(count - 1) * 50/100];
+        stats.decodeP95 = times[(count - 1) * 95/100];
+        stats.decodeP99 = times[(count - 1) * 99/100];
+        stats.decodeMax = times[count - 1];
+    }
+}
+
+void MainService::getLockStats(Ipc::Request * request, const bool reset) {
+    auto append = [request, reset](auto & mutex) {
+        TriPlayer::LockStats stats{};
+        mutex.stats(stats);
+        request->appendReplyData(stats);
+        if (reset) {
+            mutex.reset();
+        }
+    };
+
+    append(this->qMutex);
+    append(this->sqMutex);
+    append(this->sMutex);
+    append(this->changeMutex);
+    request->appendReplyData(TriPlayer::LockStats{});     // Database (no longer locked)
+    append(this->cMutex);
+    append(this->statsMutex);
+}
+
 Ipc::Result MainService::commandThread(Ipc::Request * request) {
     switch (static_cast<Ipc::Command>(request->cmd())) {
         case Ipc::Command::Version:
@@ -81,25 +360,25 @@ Ipc::Result MainService::commandThread(Ipc::Request * request) {
             break;
         }
 
-        // Simply set the 'SongAction' to Previous/Replay based on time of last press
+        // Simply queue a 'SongAction' of Previous/Replay based on time of last press
         // The other thread will handle changing songs
         case Ipc::Command::Previous:
             // Change song if within timeframe
             if ((std::time(nullptr) - this->pressTime) < PREV_WAIT) {
-                this->songAction = SongAction::Previous;
+                this->queueAction(SongAction::Previous);
 
             // Otherwise restart the current song
             } else {
-                this->songAction = SongAction::Replay;
+                this->queueAction(SongAction::Replay);
             }
 
             this->pressTime = std::time(nullptr);
             break;
 
-        // Simply set the 'SongAction' to Next
+        // Simply queue a 'SongAction' of Next
         // The other thread will handle changing songs
         case Ipc::Command::Next:
-            this->songAction = SongAction::Next;
+            this->queueAction(SongAction::Next);
             this->pressTime = std::time(nullptr);
             break;
 
@@ -138,8 +417,8 @@ Ipc::Result MainService::commandThread(Ipc::Request * request) {
 
         case Ipc::Command::GetSubQueue: {
             // Return if empty
-            std::unique_lock<std::shared_mutex> mtx(this->sqMutex);
-            if (this->subQueue.empty()) {
+            std::unique_lock<SharedMutex> mtx(this->sqMutex);
+            if (this->subQueue->empty()) {
                 size_t zero = 0;
                 request->appendReplyValue(zero);
                 break;
@@ -166,9 +445,9 @@ Ipc::Result MainService::commandThread(Ipc::Request * request) {
             }
 
             // Iterate over sub queue and append each ID
-            size_t max = (count > this->subQueue.size()-index ? this->subQueue.size()-index : count);
+            size_t max = (count > this->subQueue->size()-index ? this->subQueue->size()-index : count);
             for (size_t i = 0; i < max; i++) {
-                request->appendReplyData(this->subQueue[index + i]);
+                request->appendReplyData(this->subQueue->at(index + i));
             }
             request->appendReplyValue(max);
             break;
@@ -182,21 +461,23 @@ Ipc::Result MainService::commandThread(Ipc::Request * request) {
                 return rc;
             }
 
-            // Pop songs from queue and skip
+            // Pop songs from queue and skip, dropping any actions still waiting so they can't be applied after this
+            // (both queues are locked so the playback thread isn't part way through them)
             size_t skipped = 0;
-            std::unique_lock<std::shared_mutex> mtx(this->sqMutex);
-            while (skipped < count && !this->subQueue.empty()) {
-                this->subQueue.pop_front();
+            std::scoped_lock<SharedMutex, SharedMutex> mtx(this->sqMutex, this->qMutex);
+            this->clearActions();
+            while (skipped < count && !this->subQueue->empty()) {
+                this->subQueue->erase(0);
                 skipped++;
             }
-            this->songAction = SongAction::Next;
+            this->queueAction(SongAction::Next);
             request->appendReplyValue(skipped);
             break;
         }
 
         case Ipc::Command::SubQueueSize: {
-            std::shared_lock<std::shared_mutex> mtx(this->sqMutex);
-            request->appendReplyValue(this->subQueue.size());
+            std::shared_lock<SharedMutex> mtx(this->sqMutex);
+            request->appendReplyValue(this->subQueue->size());
             break;
         }
 
@@ -209,18 +490,17 @@ Ipc::Result MainService::commandThread(Ipc::Request * request) {
             }
 
             // Lock and update queue
-            std::unique_lock<std::shared_mutex> mtx(this->sqMutex);
-            if (this->subQueue.size() < SUBQUEUE_MAX_SIZE) {
-                this->subQueue.push_back(id);
+            std::unique_lock<SharedMutex> mtx(this->sqMutex);
+            if (this->subQueue->insert(this->subQueue->size(), id)) {
                 mtx.unlock();
 
                 // Start playing if there is nothing playing
-                std::shared_lock<std::shared_mutex> qMtx(this->qMutex);
+                std::shared_lock<SharedMutex> qMtx(this->qMutex);
                 if (this->queue->currentID() == -1) {
-                    this->songAction = SongAction::Next;
+                    this->queueAction(SongAction::Next);
                 }
 
-            // Return error code if subqueue full
+            // Return error code if subqueue full (or there's no memory for the song)
             } else {
                 return Ipc::Result::SubQueueFull;
             }
@@ -236,14 +516,14 @@ Ipc::Result MainService::commandThread(Ipc::Request * request) {
             }
 
             // Erase element
-            std::unique_lock<std::shared_mutex> mtx(this->sqMutex);
-            index = (index >= this->subQueue.size() ? this->subQueue.size()-1 : index);
-            this->subQueue.erase(this->subQueue.begin() + index);
+            std::unique_lock<SharedMutex> mtx(this->sqMutex);
+            index = (index >= this->subQueue->size() ? this->subQueue->size()-1 : index);
+            this->subQueue->erase(index);
             break;
         }
 
         case Ipc::Command::QueueIdx: {
-            std::shared_lock<std::shared_mutex> mtx(this->qMutex);
+            std::shared_lock<SharedMutex> mtx(this->qMutex);
             request->appendReplyValue(this->queue->currentIdx());
             break;
         }
@@ -256,16 +536,19 @@ Ipc::Result MainService::commandThread(Ipc::Request * request) {
                 return rc;
             }
 
-            // Jump to and return current index
-            std::unique_lock<std::shared_mutex> mtx(this->qMutex);
+            // Jump to and return current index, dropping any actions still waiting as the jump replaces them
+            // (the change is made here rather than queued, as clients expect the index to have changed by the
+            // time they send their next command, i.e. SetShuffle making it the first shuffled song)
+            std::unique_lock<SharedMutex> mtx(this->qMutex);
+            this->clearActions();
             this->queue->setIdx(pos);
-            this->songAction = SongAction::Replay;
+            this->queueAction(SongAction::Replay);
             request->appendReplyValue(this->queue->currentIdx());
             break;
         }
 
         case Ipc::Command::QueueSize: {
-            std::shared_lock<std::shared_mutex> mtx(this->qMutex);
+            std::shared_lock<SharedMutex> mtx(this->qMutex);
             request->appendReplyValue(this->queue->size());
             break;
         }
@@ -279,22 +562,154 @@ Ipc::Result MainService::commandThread(Ipc::Request * request) {
             }
 
             // Remove from queue
-            std::unique_lock<std::shared_mutex> mtx(this->qMutex);
+            std::unique_lock<SharedMutex> mtx(this->qMutex);
             if (!this->queue->removeID(pos)) {
                 return Ipc::Result::BadInput;
             }
             break;
         }
 
-        case Ipc::Command::GetQueue: {
-            // Return if empty
-            std::unique_lock<std::shared_mutex> mtx(this->qMutex);
-            if (this->queue->empty()) {
-                size_t zero = 0;
-                request->appendReplyValue(zero);
-                break;
+        case Ipc::Command::EditQueue: {
+            // Read every edit (and the IDs it inserts) before changing anything
+            std::vector<TriPlayer::QueueEdit> edits;
+            std::vector<SongID> ids;
+            TriPlayer::QueueEdit edit;
+            while (request->readRequestData(edit) == Ipc::Result::Ok) {
+                if (edit.type == TriPlayer::QueueEditType::Insert || edit.type == TriPlayer::QueueEditType::AppendSubQueue) {
+                    for (uint32_t i = 0; i < edit.count; i++) {
+                        SongID id;
+                        Ipc::Result rc = request->readRequestData(id);
+                        if (rc != Ipc::Result::Ok) {
+                            return rc;
+                        }
+                        ids.push_back(id);
+                    }
+                }
+                edits.push_back(edit);
+            }
+
+            // Lock both queues so the edits are seen all at once
+            std::unique_lock<SharedMutex> sqMtx(this->sqMutex);
+            std::unique_lock<SharedMutex> qMtx(this->qMutex);
+
+            // Check each edit against the sizes the queues will be when it's applied, so none can fail part way through
+            size_t qSize = this->queue->size();
+            size_t sqSize = this->subQueue->size();
+            size_t qAdded = 0, qRuns = 0;
+            size_t sqAdded = 0, sqRuns = 0;
+            for (const TriPlayer::QueueEdit & e : edits) {
+                switch (e.type) {
+                    case TriPlayer::QueueEditType::Insert:
+                        if (e.count > this->queue->maxSize() - qSize) {
+                            return Ipc::Result::QueueFull;
+                        }
+                        qSize += e.count;
+                        qAdded += e.count;
+                        qRuns++;
+                        break;
+
+                    case TriPlayer::QueueEditType::AppendSubQueue:
+                        if (e.count > SUBQUEUE_MAX_SIZE - sqSize) {
+                            return Ipc::Result::SubQueueFull;
+                        }
+                        sqSize += e.count;
+                        sqAdded += e.count;
+                        sqRuns++;
+                        break;
+
+                    case TriPlayer::QueueEditType::Remove:
+                    case TriPlayer::QueueEditType::RemoveSubQueue: {
+                        size_t & size = (e.type == TriPlayer::QueueEditType::Remove ? qSize : sqSize);
+                        if (e.pos > size || e.count > size - e.pos) {
+                            return Ipc::Result::BadInput;
+                        }
+                        size -= e.count;
+                        break;
+                    }
+
+                    case TriPlayer::QueueEditType::Move:
+                    case TriPlayer::QueueEditType::MoveSubQueue: {
+                        size_t size = (e.type == TriPlayer::QueueEditType::Move ? qSize : sqSize);
+                        if (e.pos > size || e.count > size - e.pos || e.to > size - e.count) {
+                            return Ipc::Result::BadInput;
+                        }
+
+                        // Moved IDs are reinserted, so need memory as well
+                        (e.type == TriPlayer::QueueEditType::Move ? qAdded : sqAdded) += e.count;
+                        (e.type == TriPlayer::QueueEditType::Move ? qRuns : sqRuns)++;
+                        break;
+                    }
+
+                    default:
+                        return Ipc::Result::BadInput;
+                }
             }
 
+            // Also make sure there's memory for everything added, which a full heap could prevent before the maximum size
+            if (!this->queue->reserve(qAdded, qRuns)) {
+                return Ipc::Result::QueueFull;
+            }
+            if (!this->subQueue->reserve(sqAdded, sqRuns)) {
+                return Ipc::Result::SubQueueFull;
+            }
+
+            // Now apply them
+            bool appended = false;
+            const SongID * next = ids.data();
+            for (const TriPlayer::QueueEdit & e : edits) {
+                switch (e.type) {
+                    case TriPlayer::QueueEditType::Insert:
+                        this->queue->addIDs(next, e.count, e.pos);
+                        next += e.count;
+                        break;
+
+                    case TriPlayer::QueueEditType::Remove:
+                        this->queue->removeIDs(e.pos, e.count);
+                        break;
+
+                    case TriPlayer::QueueEditType::Move:
+                        this->queue->moveIDs(e.pos, e.count, e.to);
+                        break;
+
+                    case TriPlayer::QueueEditType::AppendSubQueue:
+                        for (uint32_t i = 0; i < e.count; i++) {
+                            this->subQueue->insert(this->subQueue->size(), *next++);
+                        }
+                        appended = (appended || e.count > 0);
+                        break;
+
+                    case TriPlayer::QueueEditType::RemoveSubQueue:
+                        for (uint32_t i = 0; i < e.count; i++) {
+                            this->subQueue->erase(e.pos);
+                        }
+                        break;
+
+                    case TriPlayer::QueueEditType::MoveSubQueue:
+                        for (uint32_t i = 0; i < e.count; i++) {
+                            if (e.to > e.pos) {
+                                this->subQueue->move(e.pos, e.to + e.count - 1);
+                            } else {
+                                this->subQueue->move(e.pos + i, e.to + i);
+                            }
+                        }
+                        break;
+                }
+            }
+
+            // Apply a pending shuffle once there are songs to shuffle, so it's still reported the same
+            if (this->pendingShuffle && !this->queue->empty()) {
+                this->queue->shuffle(this->pendingSeed);
+                this->pendingShuffle = false;
+            }
+
+            // Start playing if there is nothing playing and songs were added to the sub-queue (as with AddToSubQueue)
+            if (appended && this->queue->currentID() == -1) {
+                this->queueAction(SongAction::Next);
+            }
+            break;
+        }
+
+        case Ipc::Command::GetQueue: {
             // Read first arg (index of first song to get)
             size_t index;
             Ipc::Result rc = request->readRequestValue(index);
@@ -309,43 +724,142 @@ Ipc::Result MainService::commandThread(Ipc::Request * request) {
                 return rc;
             }
 
-            // Return if requesting zero
-            if (count == 0) {
-                request->appendReplyValue(count);
-                break;
+            // Read third arg (format to send IDs in), which older clients don't send
+            Ipc::IDFormat format;
+            if (request->readRequestValue(format) != Ipc::Result::Ok) {
+                format = Ipc::IDFormat::Raw;
             }
 
-            // Iterate over queue and append each ID
-            size_t max = (count > this->queue->size()-index ? this->queue->size()-index : count);
+            // Gather the IDs in the requested range
+            std::unique_lock<SharedMutex> mtx(this->qMutex);
+            size_t size = this->queue->size();
+            size_t max = (index >= size ? 0 : std::min(count, size - index));
+            std::vector<int> ids;
+            ids.reserve(max);
             for (size_t i = 0; i < max; i++) {
-                request->appendReplyData(this->queue->IDatPosition(index + i));
+                ids.push_back(this->queue->IDatPosition(index + i));
+            }
+
+            // Append as many as fit in the client's buffer
+            size_t bytes;
+            if (format == Ipc::IDFormat::Compact) {
+                std::vector<uint8_t> data;
+                max = Ipc::IDList::encode(ids, data, request->replyBufferSize());
+                request->appendReplyBytes(data.data(), data.size());
+                bytes = data.size();
+
+            } else {
+                max = std::min(max, request->replyBufferSize() / sizeof(int));
+                for (size_t i = 0; i < max; i++) {
+                    request->appendReplyData(ids[i]);
+                }
+                bytes = max * sizeof(int);
             }
             request->appendReplyValue(max);
+            request->appendReplyValue(this->queue->version());
+            request->appendReplyValue(size);
+            request->appendReplyValue(bytes);
+            break;
+        }
+
+        case Ipc::Command::GetQueueChanges: {
+            // Read first arg (version to get changes since)
+            uint64_t version;
+            Ipc::Result rc = request->readRequestValue(version);
+            if (rc != Ipc::Result::Ok) {
+                return rc;
+            }
+
+            // Read second arg (maximum number to get)
+            size_t count;
+            rc = request->readRequestValue(count);
+            if (rc != Ipc::Result::Ok) {
+                return rc;
+            }
+
+            // Append each change after the version, or tell the client to fetch the whole queue if they're not known
+            std::shared_lock<SharedMutex> mtx(this->qMutex);
+            std::vector<TriPlayer::QueueChange> changes;
+            bool resync = !this->queue->changesSince(version, count, changes);
+            for (const TriPlayer::QueueChange & change : changes) {
+                request->appendReplyData(change);
+            }
+            request->appendReplyValue(resync ? this->queue->version() : version + changes.size());
+            request->appendReplyValue(changes.size());
+            request->appendReplyValue(resync);
             break;
         }
 
         case Ipc::Command::SetQueue: {
+            // Read args (number of IDs and the format they're in), which are only sent with compact IDs
+            size_t count;
+            Ipc::IDFormat format;
+            if (request->readRequestValue(count) != Ipc::Result::Ok || request->readRequestValue(format) != Ipc::Result::Ok) {
+                format = Ipc::IDFormat::Raw;
+            }
+
+            // Check compact IDs decode before changing anything, so bad input leaves the queue alone
+            // (they're decoded again straight into the queue, rather than needing memory for a copy of them all)
+            if (format == Ipc::IDFormat::Compact) {
+                if (count > this->queue->maxSize()) {
+                    return Ipc::Result::QueueFull;
+                }
+
+                if (!Ipc::IDList::decode(request->requestData(), request->requestDataSize(), count, [](int) { })) {
+                    return Ipc::Result::BadInput;
+                }
+            }
+
             // Clear sub queue
-            std::unique_lock<std::shared_mutex> sqMtx(this->sqMutex);
-            this->subQueue.clear();
+            std::unique_lock<SharedMutex> sqMtx(this->sqMutex);
+            this->subQueue->clear();
             sqMtx.unlock();
 
-            // Clear main queue
-            std::unique_lock<std::shared_mutex> mtx(this->qMutex);
+            // Clear main queue (which drops any shuffle, though a pending one is kept for the next request to shuffle)
+            std::unique_lock<SharedMutex> mtx(this->qMutex);
+            bool wasShuffled;
+            uint64_t oldSeed;
+            this->getShuffle(wasShuffled, oldSeed);
             this->queue->clear();
 
-            // Add each value present in the buffer
-            while (true) {
-                SongID id;
-                Ipc::Result rc = request->readRequestData(id);
-                if (rc != Ipc::Result::Ok) {
-                    break;
+            // Make sure there's memory for every ID first, leaving the queue empty if there isn't (as if there were too many)
+            size_t total = (format == Ipc::IDFormat::Compact ? count : request->requestDataSize()/sizeof(SongID));
+            bool fits = this->queue->reserve(total);
+            if (!fits) {
+                Log::writeError("[SERVICE] Not enough memory to queue " + std::to_string(total) + " songs");
+
+            } else if (format == Ipc::IDFormat::Compact) {
+                Ipc::IDList::decode(request->requestData(), request->requestDataSize(), count, [this](int id) {
+                    this->queue->addID(id, this->queue->size());
+                });
+
+            } else {
+                // Add each value present in the buffer
+                while (true) {
+                    SongID id;
+                    Ipc::Result rc = request->readRequestData(id);
+                    if (rc != Ipc::Result::Ok) {
+                        break;
+                    }
+                    this->queue->addID(id, this->queue->size());
                 }
-                this->queue->addID(id, this->queue->size());
+            }
+
+            // Keep the stored state in line with what clients now see
+            bool shuffled;
+            uint64_t seed;
+            this->getShuffle(shuffled, seed);
+            size_t size = this->queue->size();
+            mtx.unlock();
+            if (shuffled != wasShuffled || seed != oldSeed) {
+                this->saveShuffle(shuffled, seed);
+            }
+            if (!fits) {
+                return Ipc::Result::QueueFull;
             }
 
             // Reply with number of songs inserted
-            request->appendReplyValue(this->queue->size());
+            request->appendReplyValue(size);
             break;
         }
 
@@ -394,8 +908,11 @@ Ipc::Result MainService::commandThread(Ipc::Request * request) {
         }
 
         case Ipc::Command::GetShuffle: {
-            std::shared_lock<std::shared_mutex> mtx(this->qMutex);
-            request->appendReplyValue((this->queue->isShuffled() ? TriPlayer::Shuffle::On : TriPlayer::Shuffle::Off));
+            std::shared_lock<SharedMutex> mtx(this->qMutex);
+            bool shuffled;
+            uint64_t seed;
+            this->getShuffle(shuffled, seed);
+            request->appendReplyValue((shuffled ? TriPlayer::Shuffle::On : TriPlayer::Shuffle::Off));
             break;
         }
 
@@ -407,62 +924,74 @@ Ipc::Result MainService::commandThread(Ipc::Request * request) {
                 return rc;
             }
 
-            // Adjust accordingly
-            std::unique_lock<std::shared_mutex> mtx(this->qMutex);
+            // Adjust accordingly (using the pending seed if there is one, and keeping it pending if there's nothing to shuffle yet)
+            std::unique_lock<SharedMutex> mtx(this->qMutex);
             if (sm == TriPlayer::Shuffle::Off) {
                 this->queue->unshuffle();
+                this->pendingShuffle = false;
+
+            } else if (this->queue->empty()) {
+                this->pendingSeed = (this->pendingShuffle ? this->pendingSeed : Utils::Random::getSizeT(0, UINT64_MAX));
+                this->pendingShuffle = true;
+
             } else {
-                this->queue->shuffle();
+                if (this->pendingShuffle) {
+                    this->queue->shuffle(this->pendingSeed);
+                } else {
+                    this->queue->shuffle();
+                }
+                this->pendingShuffle = false;
             }
+            bool shuffled;
+            uint64_t seed;
+            this->getShuffle(shuffled, seed);
+            mtx.unlock();
+            this->saveShuffle(shuffled, seed);
             break;
         }
 
-        case Ipc::Command::GetSong: {
-            std::shared_lock<std::shared_mutex> mtx(this->qMutex);
-            request->appendReplyValue(this->queue->currentID());
+        case Ipc::Command::GetShuffleSeed: {
+            std::shared_lock<SharedMutex> mtx(this->qMutex);
+            bool shuffled;
+            uint64_t seed;
+            this->getShuffle(shuffled, seed);
+            request->appendReplyValue(seed);
             break;
         }
 
-        case Ipc::Command::GetStatus: {
-            TriPlayer::Status s = TriPlayer::Status::Error;
-
-            // Say that we're playing if the song is currently seeking
-            if (this->seekTo >= 0) {
-                s = TriPlayer::Status::Playing;
-            } else {
-                switch (audio->status()) {
-                    case Audio::Status::Playing:
-                        s = TriPlayer::Status::Playing;
-                        break;
-
-                    case Audio::Status::Paused:
-                        s = TriPlayer::Status::Paused;
-                        break;
-
-                    case Audio::Status::Stopped:
-                        s = TriPlayer::Status::Stopped;
-                        break;
-                }
+        case Ipc::Command::SetShuffleSeed: {
+            // Read seed from args
+            uint64_t seed;
+            Ipc::Result rc = request->readRequestValue(seed);
+            if (rc != Ipc::Result::Ok) {
+                return rc;
             }
-            request->appendReplyValue(s);
+
+            // Shuffle with the seed, which gives the same order as before if the queue and current song match
+            // (it's kept pending if the queue is empty)
+            std::unique_lock<SharedMutex> mtx(this->qMutex);
+            this->pendingShuffle = this->queue->empty();
+            this->pendingSeed = seed;
+            this->queue->shuffle(seed);
+            mtx.unlock();
+            this->saveShuffle(true, seed);
             break;
         }
 
-        case Ipc::Command::GetPosition: {
-            // Check position if not seeking
-            double pos = 100.0 * this->seekTo;
-            if (pos < 0) {
-                std::shared_lock<std::shared_mutex> mtx(this->sMutex);
-                if (this->source == nullptr) {
-                    pos = 0;
-                } else {
-                    pos = 100 * (this->audio->samplesPlayed()/(double)this->source->totalSamples());
-                }
-            }
-            request->appendReplyValue(pos);
+        case Ipc::Command::GetSong: {
+            std::shared_lock<SharedMutex> mtx(this->qMutex);
+            request->appendReplyValue(this->queue->currentID());
             break;
         }
 
+        case Ipc::Command::GetStatus:
+            request->appendReplyValue(this->status());
+            break;
+
+        case Ipc::Command::GetPosition:
+            request->appendReplyValue(this->position());
+            break;
+
         case Ipc::Command::SetPosition: {
             // Read position from args
             double pos;
@@ -474,12 +1003,13 @@ Ipc::Result MainService::commandThread(Ipc::Request * request) {
             // Set seek value and return it
             pos /= 100.0;
             this->seekTo = pos;
+            this->wakePlayback();
             request->appendReplyValue(pos);
             break;
         }
 
         case Ipc::Command::GetPlayingFrom: {
-            std::shared_lock<std::shared_mutex> mtx(this->qMutex);
+            std::shared_lock<SharedMutex> mtx(this->qMutex);
             request->appendReplyData(this->playingFrom);
             break;
         }
@@ -493,23 +1023,14 @@ Ipc::Result MainService::commandThread(Ipc::Request * request) {
             }
 
             // Lock queue to allow updating and return string
-            std::unique_lock<std::shared_mutex> mtx(this->qMutex);
+            std::unique_lock<SharedMutex> mtx(this->qMutex);
             this->playingFrom = str.substr(0, (str.length() > 100) ? 100 : str.length());
             break;
         }
 
-        // Lock the mutex and mark that the database is being used for writing by the app
-        // Once we lock the mutex the decode thread is guaranteed to not be using the DB
-        case Ipc::Command::RequestDBLock: {
-            std::scoped_lock<std::mutex> mtx(this->dbMutex);
-            this->db->close();
-            this->dbLocked = true;
-            break;
-        }
-
-        // Mark the database as unlocked
+        // The database isn't used (the app replaces the library snapshot instead), so there's nothing to lock
+        case Ipc::Command::RequestDBLock:
         case Ipc::Command::ReleaseDBLock:
-            this->dbLocked = false;
             break;
 
         case Ipc::Command::ReloadConfig:
@@ -517,22 +1038,31 @@ Ipc::Result MainService::commandThread(Ipc::Request * request) {
             break;
 
         case Ipc::Command::Reset: {
-            // Need to lock everything!!
-            std::scoped_lock<std::shared_mutex> sMtx(this->sMutex);
-            std::scoped_lock<std::shared_mutex> sqMtx(this->sqMutex);
-            std::scoped_lock<std::shared_mutex> qMtx(this->qMutex);
-            std::scoped_lock<std::mutex> mtx(this->dbMutex);
-
-            // Ensure we're disconnected from the DB
-            this->db->close();
-
-            // Stop playback and empty queues
-            this->audio->stop();
-            this->queue->clear();
-            this->subQueue.clear();
-            delete this->source;
-            this->source = nullptr;
+            bool wasShuffled;
+            {
+                // Need to lock everything!! (together, so the queues aren't held while waiting for the source)
+                std::scoped_lock<SharedMutex, SharedMutex, SharedMutex> mtx(this->sMutex, this->sqMutex, this->qMutex);
+
+                // Stop playback and empty queues (dropping the shuffle too)
+                uint64_t seed;
+                this->getShuffle(wasShuffled, seed);
+                this->audio->stop();
+                this->queue->clear();
+                this->pendingShuffle = false;
+                this->subQueue->clear();
+                delete this->fadeSource;
+                this->fadeSource = nullptr;
+                delete this->nextSource;
+                this->nextSource = nullptr;
+                delete this->source;
+                this->source = nullptr;
+                this->sourceID = -1;
+            }
 
+            // Forget the stored shuffle too, now that nothing is locked
+            if (wasShuffled) {
+                this->saveShuffle(false, 0);
+            }
             request->appendReplyValue(std::string(VER_STRING));
             break;
         }
@@ -540,14 +1070,126 @@ Ipc::Result MainService::commandThread(Ipc::Request * request) {
         case Ipc::Command::Quit:
             this->exit_ = true;
             break;
+
+        case Ipc::Command::GetStats: {
+            TriPlayer::Stats stats;
+            this->getStats(stats);
+            request->appendReplyValue(stats);
+            break;
+        }
+
+        case Ipc::Command::GetState: {
+            // Use the latest position rather than the one last marked as changed
+            TriPlayer::State s;
+            double pos = this->position();
+            std::scoped_lock<Mutex> mtx(this->changeMutex);
+            this->getState(s);
+            s.position = pos;
+            request->appendReplyValue(s);
+            break;
+        }
+
+        case Ipc::Command::GetStateMemory:
+            if (this->sharedState == nullptr) {
+                return Ipc::Result::Unknown;
+            }
+            request->appendReplyHandle(this->sharedStateHandle);
+            break;
+
+        case Ipc::Command::Features: {
+            // Read first arg (features the client supports) and reply with those we also support
+            uint32_t features;
+            Ipc::Result rc = request->readRequestValue(features);
+            if (rc != Ipc::Result::Ok) {
+                return rc;
+            }
+            request->appendReplyValue(features & Ipc::Feature::CompactIDs);
+            break;
+        }
+
+        case Ipc::Command::GetLockStats: {
+            // Read first arg (whether to reset the counts after)
+            bool reset;
+            Ipc::Result rc = request->readRequestValue(reset);
+            if (rc != Ipc::Result::Ok) {
+                return rc;
+            }
+
+            // Append stats for each lock in the same order as TriPlayer::Lock
+            this->getLockStats(request, reset);
+            break;
+        }
+
+        case Ipc::Command::WaitForChange: {
+            // Read first arg (sequence number to wait for changes after)
+            uint64_t since;
+            Ipc::Result rc = request->readRequestValue(since);
+            if (rc != Ipc::Result::Ok) {
+                return rc;
+            }
+
+            // Read second arg (time to wait in ms)
+            uint64_t timeout;
+            rc = request->readRequestValue(timeout);
+            if (rc != Ipc::Result::Ok) {
+                return rc;
+            }
+
+            // Read third arg (mask of state to wait for)
+            uint32_t mask;
+            rc = request->readRequestValue(mask);
+            if (rc != Ipc::Result::Ok) {
+                return rc;
+            }
+
+            // Hold the reply until something in the mask changes or the time passes (the server passes the request
+            // back here whenever it's woken). A sequence of zero is answered straight away so a client can get it's first one.
+            uint64_t sequence;
+            uint32_t changed = this->changesSince(mask, since, sequence);
+            if (since != 0 && changed == 0 && request->hold(std::min<uint64_t>(timeout, WAIT_MAX))) {
+                break;
+            }
+            request->appendReplyValue(sequence);
+            request->appendReplyValue(changed);
+            break;
+        }
     }
 
     // If we make it this far then everything went OK
     return Ipc::Result::Ok;
 }
 
+bool MainService::deferRequest(Ipc::Request * request) {
+    // Only commands which wait on the disk or every lock are deferred
+    switch (static_cast<Ipc::Command>(request->cmd())) {
+        case Ipc::Command::ReloadConfig:
+        case Ipc::Command::Reset:
+            break;
+
+        default:
+            return false;
+    }
+
+    std::scoped_lock<std::mutex> mtx(this->deferredMutex);
+    if (this->deferredCount == this->deferred.size()) {
+        Log::writeWarning("[SERVICE] Too many deferred requests, handling on IPC thread");
+        return false;
+    }
+
+    request->defer();
+    this->deferred[(this->deferredHead + this->deferredCount) % this->deferred.size()] = request;
+    this->deferredCount++;
+    this->deferredCond.notify_one();
+    return true;
+}
+
 void MainService::exit() {
     this->exit_ = true;
+    this->wakePlayback();
+    this->ipcServer->wake();
+
+    std::scoped_lock<std::mutex> mtx(this->deferredMutex);
+    this->deferredCond.notify_all();
 }
 
 void MainService::gpioEventThread() {
@@ -590,7 +1232,7 @@ void MainService::hidEventThread() {
 
         // Re-read combos if needed
         if (this->combosUpdated) {
-            std::scoped_lock<std::shared_mutex> mtx(this->cMutex);
+            std::scoped_lock<SharedMutex> mtx(this->cMutex);
             comboNext = NX::stringToCombo(this->comboNextString);
             if (comboNext.empty()) {
                 Log::writeWarning("[HID] Couldn't parse next combination config, skipping via button press will be unavailable");
@@ -609,7 +1251,7 @@ void MainService::hidEventThread() {
         // Check if each combo pressed
         if (NX::Hid::comboPressed(comboNext)) {
             if (!nextPressed) {
-                this->songAction = SongAction::Next;
+                this->queueAction(SongAction::Next);
                 this->pressTime = std::time(nullptr);
                 nextPressed = true;
             }
@@ -628,9 +1270,9 @@ void MainService::hidEventThread() {
         } else if (NX::Hid::comboPressed(comboPrev)) {
             if (!prevPressed) {
                 if ((std::time(nullptr) - this->pressTime) < PREV_WAIT) {
-                    this->songAction = SongAction::Previous;
+                    this->queueAction(SongAction::Previous);
                 } else {
-                    this->songAction = SongAction::Replay;
+                    this->queueAction(SongAction::Replay);
                 }
                 this->pressTime = std::time(nullptr);
                 prevPressed = true;
@@ -656,161 +1298,651 @@ void MainService::ipcThread() {
     }
 }
 
+void MainService::ipcWorkerThread() {
+    while (!this->exit_) {
+        // Wait for a request, checking periodically as exit_ isn't always set by exit()
+        // (those left when exiting are dropped, as their clients are closed with the server)
+        std::unique_lock<std::mutex> mtx(this->deferredMutex);
+        this->deferredCond.wait_for(mtx, std::chrono::milliseconds(POLL_INTERVAL * 10), [this]() {
+            return (this->deferredCount > 0 || this->exit_);
+        });
+        if (this->exit_ || this->deferredCount == 0) {
+            continue;
+        }
+        Ipc::Request * request = this->deferred[this->deferredHead];
+        this->deferredHead = (this->deferredHead + 1) % this->deferred.size();
+        this->deferredCount--;
+        this->deferredBusy = true;
+        mtx.unlock();
+
+        // Handle it and wake the server to send the reply
+        uint32_t rc = static_cast<uint32_t>(this->commandThread(request));
+        this->checkForChanges();
+        request->complete(rc);
+        this->ipcServer->wake();
+
+        mtx.lock();
+        this->deferredBusy = false;
+        this->deferredCond.notify_all();
+    }
+}
+
+bool MainService::getSong(SongID id, LibrarySnapshot::Song & song, const uint32_t fields) {
+    // The snapshot can't be read for a moment while the app replaces it, so try a few times
+    for (size_t i = 0; i < LIBRARY_ATTEMPTS; i++) {
+        if (this->library->getSong(id, song, fields)) {
+            return true;
+        }
+        NX::Thread::sleepMilli(LIBRARY_RETRY_INTERVAL);
+    }
+
+    Log::writeError("[SERVICE] Couldn't find song with ID " + std::to_string(id) + " in the library snapshot");
+    return false;
+}
+
+std::string MainService::getPathForID(SongID id) {
+    LibrarySnapshot::Song song;
+    if (!this->getSong(id, song, LibrarySnapshot::Fields::Path)) {
+        return "";
+    }
+    return song.path;
+}
+
+float MainService::normalizeGain(SongID id) {
+    if (this->normalize == NormalizeMode::Off) {
+        return 0.0f;
+    }
+
+    // Use the album's loudness/peak if requested
+    LibrarySnapshot::Song song;
+    if (!this->getSong(id, song, 0)) {
+        return 0.0f;
+    }
+    bool album = (this->normalize == NormalizeMode::Album);
+    if (!(album ? song.albumAnalysed : song.analysed)) {
+        return 0.0f;
+    }
+    float loudness = (album ? song.albumLoudness : song.loudness);
+    float peak = (album ? song.albumPeak : song.peak);
+
+    // Don't push the true peak over -1dBTP, and keep silent songs from being boosted massively
+    float gain = std::min(this->normalizeTarget - loudness, -1.0f - peak);
+    gain = std::clamp(gain, -24.0f, 24.0f);
+    Log::writeInfo("[SERVICE] Normalizing song by " + std::to_string(gain) + "dB");
+    return gain;
+}
+
+void MainService::loadShuffle() {
+    std::vector<unsigned char> data;
+    if (!Utils::Fs::readFile(Path::Sys::StateFile, data) || data.size() != sizeof(ShuffleState)) {
+        return;
+    }
+
+    ShuffleState state;
+    std::memcpy(&state, data.data(), sizeof(ShuffleState));
+    if (state.magic != stateMagic) {
+        Log::writeWarning("[SERVICE] Ignoring unknown shuffle state");
+        return;
+    }
+
+    // The queue isn't stored, so the shuffle is applied once there's a queue to shuffle again
+    if (state.shuffled) {
+        std::scoped_lock<SharedMutex> mtx(this->qMutex);
+        this->pendingShuffle = true;
+        this->pendingSeed = state.seed;
+        Log::writeInfo("[SERVICE] Restored shuffle (seed " + std::to_string(state.seed) + ")");
+    }
+}
+
+void MainService::getShuffle(bool & shuffled, uint64_t & seed) {
+    if (this->queue->isShuffled()) {
+        shuffled = true;
+        seed = this->queue->shuffleSeed();
+
+    } else {
+        shuffled = (this->pendingShuffle && this->queue->empty());
+        seed = (shuffled ? this->pendingSeed : 0);
+    }
+}
+
+void MainService::saveShuffle(const bool shuffled, const uint64_t seed) {
+    ShuffleState state = {stateMagic, shuffled, seed};
+    std::vector<unsigned char> data(sizeof(ShuffleState));
+    std::memcpy(data.data(), &state, sizeof(ShuffleState));
+    if (!Utils::Fs::writeFile(Path::Sys::StateFile, data)) {
+        Log::writeWarning("[SERVICE] Couldn't store shuffle state");
+    }
+}
+
+Source * MainService::openSource(const std::string & path) {
+    // Compare extensions ignoring case
+    std::string ext = Utils::Fs::getExtension(path);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) {
+        return std::tolower(c);
+    });
+
+    Source * source;
+    if (ext == ".flac") {
+        source = new FLAC(path);
+    } else if (ext == ".ogg" || ext == ".oga") {
+        source = new Vorbis(path);
+    } else if (ext == ".opus") {
+        source = new Opus(path);
+    } else {
+        source = new MP3(path);
+    }
+
+    // Keep everything at one rate so the voice never needs recreating and any two songs can be crossfaded
+    if (source->valid() && source->sampleRate() > 0 && source->sampleRate() != OUTPUT_RATE) {
+        source = new Resampled(source, OUTPUT_RATE, this->resampleQuality);
+    }
+    return source;
+}
+
+SongID MainService::nextSongID(SongAction & action) {
+    // Replay current song if repeat is set to one
+    if (this->repeatMode == RepeatMode::One) {
+        action = SongAction::Replay;
+        return this->queue->currentID();
+    }
+
+    // Don't go to next song if at the end and repeat is off
+    bool atEnd = (this->queue->currentIdx() + 1 >= this->queue->size());
+    if (atEnd && this->repeatMode == RepeatMode::Off && this->subQueue->empty()) {
+        action = SongAction::Nothing;
+        return -1;
+    }
+
+    // Otherwise it's the next song (matches SongAction::Next in playbackThread())
+    action = SongAction::Next;
+    if (!this->subQueue->empty()) {
+        return this->subQueue->at(0);
+    }
+    return this->queue->IDatPosition(atEnd ? 0 : this->queue->currentIdx() + 1);
+}
+
+void MainService::queueAction(const SongAction action) {
+    std::unique_lock<std::mutex> mtx(this->actionMutex);
+
+    // Merge with the newest action if it's the same, as a repeated Replay does nothing extra
+    // and repeated Next/Previous presses can be applied in one go
+    if (this->actionCount > 0) {
+        QueuedAction & last = this->actions[(this->actionHead + this->actionCount - 1) % this->actions.size()];
+        if (last.action == action) {
+            if (action != SongAction::Replay) {
+                last.count++;
+            }
+            this->woken = true;
+            this->actionCond.notify_one();
+            return;
+        }
+    }
+
+    // Otherwise append if there is room
+    if (this->actionCount >= this->actions.size()) {
+        Log::writeWarning("[SERVICE] Action queue is full, ignoring action");
+        return;
+    }
+    this->actions[(this->actionHead + this->actionCount) % this->actions.size()] = {action, 1};
+    this->actionCount++;
+    this->woken = true;
+    this->actionCond.notify_one();
+}
+
+bool MainService::takeAction(SongAction & action, size_t & count) {
+    std::unique_lock<std::mutex> mtx(this->actionMutex);
+    if (this->actionCount == 0) {
+        return false;
+    }
+
+    action = this->actions[this->actionHead].action;
+    count = this->actions[this->actionHead].count;
+    this->actionHead = (this->actionHead + 1) % this->actions.size();
+    this->actionCount--;
+    return true;
+}
+
+void MainService::clearActions() {
+    std::unique_lock<std::mutex> mtx(this->actionMutex);
+    this->actionHead = 0;
+    this->actionCount = 0;
+}
+
+bool MainService::hasAction() {
+    return (this->actionCount > 0);
+}
+
+void MainService::wakePlayback() {
+    std::unique_lock<std::mutex> mtx(this->actionMutex);
+    this->woken = true;
+    this->actionCond.notify_one();
+}
+
+void MainService::waitForAction(const size_t ms) {
+    std::unique_lock<std::mutex> mtx(this->actionMutex);
+    this->actionCond.wait_for(mtx, std::chrono::milliseconds(ms), [this]() {
+        return (this->woken || this->actionCount > 0 || this->exit_);
+    });
+    this->woken = false;
+}
+
+void MainService::applyAction(const SongAction action) {
+    switch (action) {
+        case SongAction::Previous:
+            // If repeat is on and we're at the start, wrap around
+            if (this->repeatMode != RepeatMode::Off && this->queue->currentIdx() == 0) {
+                this->queue->setIdx(this->queue->size());
+
+            // Go back to last song on queue otherwise (won't do anything if at the start)
+            } else {
+                this->queue->decrementIdx();
+            }
+
+            this->repeatMode = (this->repeatMode != RepeatMode::Off ? RepeatMode::All : RepeatMode::Off);
+            break;
+
+        case SongAction::Next:
+            // If repeat is on and we're at the end, wrap around
+            if (this->repeatMode != RepeatMode::Off && (this->queue->currentIdx() + 1 >= this->queue->size()) && this->subQueue->empty()) {
+                this->queue->setIdx(0);
+
+            // Otherwise advance to next song (check subqueue if there's one there)
+            } else {
+                // Check if we need to pop off of subqueue
+                if (!this->subQueue->empty()) {
+                    this->queue->addID(this->subQueue->at(0), this->queue->currentIdx() + 1);
+                    this->subQueue->erase(0);
+                }
+
+                this->queue->incrementIdx();
+            }
+
+            this->repeatMode = (this->repeatMode != RepeatMode::Off ? RepeatMode::All : RepeatMode::Off);
+            break;
+
+        default:
+            // Do nothing if set to SongAction::Replay (just want to replay current song)
+            break;
+    }
+}
+
 void MainService::playbackThread() {
     // Request a higher priority for FS access
     NX::Fs::setHighPriority(true);
 
+    // Action to take once the current source has been decoded (set by this thread)
+    SongAction nextAction = SongAction::Nothing;
+    // Set true once it's been decided whether to crossfade out of the current source
+    bool fadeChecked = false;
+    // Holds the outgoing source's audio while crossfading
+    uint8_t * fadeBuf = nullptr;
+    // Set true once it's been decided whether to open the next song ahead of time
+    bool preloadChecked = false;
+    // Holds the first audio decoded from the next song when it's opened ahead of time, the number of bytes
+    // decoded for the next song, and the number still to be played from the current song (once it's moved on)
+    uint8_t * primeBuf = nullptr;
+    size_t primedBytes = 0;
+    size_t pendingBytes = 0;
+    // Gain of the incoming source and increase per frame
+    float fadeGain = 0.0f;
+    float fadeStep = 0.0f;
+    // Time spent decoding the current source and how much audio it produced
+    std::chrono::steady_clock::duration decodeTime = std::chrono::steady_clock::duration::zero();
+    size_t decodedBytes = 0;
+    // Time spent filtering audio and how much was filtered
+    std::chrono::steady_clock::duration dspTime = std::chrono::steady_clock::duration::zero();
+    size_t dspBytes = 0;
+
     while (!this->exit_) {
-        std::unique_lock<std::shared_mutex> sMtx(this->sMutex);
-        std::unique_lock<std::shared_mutex> sqMtx(this->sqMutex);
-        std::unique_lock<std::shared_mutex> qMtx(this->qMutex);
+        // Let waiting clients know about anything that changed outside of a request (i.e. songs finishing or button presses)
+        this->checkForChanges();
 
-        // Change source if the current song has been changed
-        if (this->songAction != SongAction::Nothing) {
-            // Only do something if a queue has something in it
-            if (!(this->queue->empty() && this->subQueue.empty())) {
-                switch (this->songAction) {
-                    case SongAction::Previous:
-                        // If repeat is on and we're at the start, wrap around
-                        if (this->repeatMode != RepeatMode::Off && this->queue->currentIdx() == 0) {
-                            this->queue->setIdx(this->queue->size());
-
-                        // Go back to last song on queue otherwise (won't do anything if at the start)
-                        } else {
-                            this->queue->decrementIdx();
-                        }
+        std::unique_lock<SharedMutex> sMtx(this->sMutex);
+        std::unique_lock<SharedMutex> sqMtx(this->sqMutex);
+        std::unique_lock<SharedMutex> qMtx(this->qMutex);
 
-                        this->repeatMode = (this->repeatMode != RepeatMode::Off ? RepeatMode::All : RepeatMode::Off);
-                        break;
+        // Free the crossfade buffer once it's no longer needed
+        if (this->fadeSource == nullptr && fadeBuf != nullptr) {
+            delete[] fadeBuf;
+            fadeBuf = nullptr;
+        }
+        if (primedBytes == 0 && pendingBytes == 0 && primeBuf != nullptr) {
+            delete[] primeBuf;
+            primeBuf = nullptr;
+        }
 
-                    case SongAction::Next:
-                        // If repeat is on and we're at the end, wrap around
-                        if (this->repeatMode != RepeatMode::Off && (this->queue->currentIdx() == this->queue->size() - 1) && this->subQueue.empty()) {
-                            this->queue->setIdx(0);
+        // Actions requested by a client take priority and cut off the current song (all queued actions are
+        // applied in order), otherwise move on to the next song while the current one's buffers play out
+        bool hasQueue = !(this->queue->empty() && this->subQueue->empty());
+        bool changed = false;
+        bool gapless = false;
+        SongAction action;
+        size_t count;
+        while (this->takeAction(action, count)) {
+            // Actions are discarded if there is nothing to play
+            if (hasQueue) {
+                for (size_t i = 0; i < count; i++) {
+                    this->applyAction(action);
+                }
+                changed = true;
+            }
+        }
+        if (!changed && hasQueue && nextAction != SongAction::Nothing) {
+            this->applyAction(nextAction);
+            changed = true;
+            gapless = true;
+        }
+        nextAction = SongAction::Nothing;
 
-                        // Otherwise advance to next song (check subqueue if there's one there)
-                        } else {
-                            // Check if we need to pop off of subqueue
-                            if (!this->subQueue.empty()) {
-                                this->queue->addID(this->subQueue.front(), this->queue->currentIdx() + 1);
-                                this->subQueue.pop_front();
-                            }
+        // Change source if the current song has been changed
+        if (changed) {
+            // Only the ID is needed from the queues, so release them before the library is read
+            SongID id = this->queue->currentID();
+            qMtx.unlock();
+            sqMtx.unlock();
 
-                            this->queue->incrementIdx();
-                        }
+            // Any fade in progress is cut off by the change, so free it's decoder before opening another
+            Source * outgoing = this->source;
+            delete this->fadeSource;
+            this->fadeSource = nullptr;
+            fadeChecked = false;
+            preloadChecked = false;
+            pendingBytes = 0;
+
+            // Use the source opened ahead of time if it's for the right song (unless the current one is being
+            // replayed by request), restart the current one from the cache if it's being replayed, otherwise
+            // prepare a new one
+            if (this->nextSource != nullptr && this->nextSourceID == id && (gapless || id != this->sourceID)) {
+                // Nothing is faded after a manual change, otherwise the old source may be ahead of what's playing
+                // if cached audio was being played
+                if (!gapless) {
+                    delete outgoing;
+                    outgoing = nullptr;
+                } else if (outgoing != nullptr && !this->rewind->synced()) {
+                    outgoing->seek(this->rewind->position());
+                }
+                this->source = this->nextSource;
+                this->rewind->reset(this->source->sampleRate(), this->source->channels());
+                pendingBytes = primedBytes;
 
-                        this->repeatMode = (this->repeatMode != RepeatMode::Off ? RepeatMode::All : RepeatMode::Off);
-                        break;
+            } else if (id == this->sourceID && this->source != nullptr && this->source->valid() && this->rewind->rewind(0)) {
+                delete this->nextSource;
+                outgoing = nullptr;
+                Log::writeInfo("[SERVICE] Replaying from cache");
 
-                    default:
-                        // Do nothing if set to SongAction::Replay (just want to replay current song)
-                        break;
+            } else {
+                // Nothing will be faded after a manual change, so free the old source first too
+                delete this->nextSource;
+                if (!gapless) {
+                    delete outgoing;
+                    outgoing = nullptr;
                 }
-
-                // In order to read the file path we need to:
-                // - Lock the mutex and either:
-                // -> Wait until it is marked as unlocked OR
-                // -> Wait until it's readable (in case application crashes)
-                std::unique_lock<std::mutex> mtx(this->dbMutex);
-                std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
-                while (this->dbLocked) {
-                    NX::Thread::sleepMilli(50);
-                    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
-                    if (std::chrono::duration_cast< std::chrono::duration<double> >(now - last).count() > DB_TEST_INTERVAL) {
-                        if (Utils::Fs::fileAccessible("/switch/TriPlayer/data.sqlite3")) {
-                            this->dbLocked = false;
-                        }
-                        last = now;
-                    }
+                this->source = this->openSource(this->getPathForID(id));
+                this->rewind->reset(this->source->sampleRate(), this->source->channels());
+            }
+            this->nextSource = nullptr;
+            this->sourceID = id;
+            primedBytes = 0;
+            decodeTime = std::chrono::steady_clock::duration::zero();
+            decodedBytes = 0;
+            dspTime = std::chrono::steady_clock::duration::zero();
+            dspBytes = 0;
+
+            // Fade out the old source if it's still being decoded, otherwise delete it
+            if (gapless && outgoing != nullptr && outgoing->valid() && !outgoing->done() && this->source->valid() &&
+                outgoing->sampleRate() == this->source->sampleRate() && outgoing->channels() == this->source->channels())
+            {
+                // Fade over whatever is left of the old source
+                int remaining = outgoing->totalSamples() - static_cast<int>(outgoing->tell());
+                fadeGain = 0.0f;
+                fadeStep = 1.0f/(remaining > 0 ? remaining : 1);
+                if (fadeBuf == nullptr) {
+                    fadeBuf = new uint8_t[this->audio->bufferSize()];
                 }
+                this->fadeSource = outgoing;
+                Log::writeInfo("[SERVICE] Crossfading over " + std::to_string(remaining) + " samples");
 
-                // Now that the database is available actually read from it (note that this read-only connection
-                // is left intact until either RESET or REQUESTDBLOCK is received)
-                if (!this->db->openReadOnly()) {
-                    this->exit_ = true;
-                }
-                std::string path = this->db->getPathForID(this->queue->currentID());
-                mtx.unlock();
+            } else {
+                delete outgoing;
+            }
 
-                // Delete old source and prepare a new one
-                delete this->source;
-                this->source = new MP3(path);
-                this->audio->newSong(this->source->sampleRate(), this->source->channels());
+            // A new voice is needed if the format changed, so let the previous song finish first
+            if (gapless && !this->audio->sameFormat(this->source->sampleRate(), this->source->channels())) {
+                sMtx.unlock();
+                while (this->audio->status() != Audio::Status::Stopped && !this->hasAction() && !this->exit_) {
+                    this->waitForAction(5);
+                }
+                sMtx.lock();
+            }
+            if (this->source != nullptr) {
+                this->dsp->setFormat(this->source->sampleRate(), this->source->channels());
+                this->dsp->setGain(this->normalizeGain(id));
+                this->audio->newSong(this->source->sampleRate(), this->source->channels(), gapless);
             }
-            this->songAction = SongAction::Nothing;
         }
 
         // Don't need queues for a while
-        qMtx.unlock();
-        sqMtx.unlock();
+        if (qMtx.owns_lock()) {
+            qMtx.unlock();
+            sqMtx.unlock();
+        }
 
         bool sleep = true;
         if (this->source != nullptr) {
             sleep = false;
 
-            // Seek to a position if required
+            // Seek to a position if required (abandons any crossfade), using cached audio if possible
             if (this->source->valid() && this->seekTo >= 0) {
+                delete this->fadeSource;
+                this->fadeSource = nullptr;
+                fadeChecked = false;
                 this->audio->stop();
-                this->source->seek(this->seekTo * this->source->totalSamples());
-                this->audio->setSamplesPlayed(this->source->tell());
+                preloadChecked = false;
+                pendingBytes = 0;
+                size_t pos = this->seekTo * this->source->totalSamples();
+                if (!this->rewind->rewind(pos)) {
+                    this->source->seek(pos);
+                    pos = this->source->tell();
+                    this->rewind->seeked(pos);
+                }
+                this->audio->setSamplesPlayed(pos);
                 this->seekTo = -1;
             }
 
-            // If the source is not corrupt and not done decode into an available buffer
-            if (this->source->valid() && !this->source->done()) {
-                uint8_t * buf = new uint8_t[this->audio->bufferSize()];
-                size_t dec = this->source->decode(buf, this->audio->bufferSize());
+            // If the source is not corrupt and not done (or has cached audio to play) decode directly into an available buffer
+            if (this->source->valid() && (!this->source->done() || !this->rewind->synced() || pendingBytes > 0)) {
+                // Open the next song and decode it's first buffer once we're within the preload length of the end, so
+                // moving on doesn't wait for it (replaying uses the cache instead). This is skipped while the start
+                // of the current song is still waiting to be played, as it's in the same buffer.
+                int remaining = this->source->totalSamples() - static_cast<int>(this->rewind->position());
+                if (!preloadChecked && this->fadeSource == nullptr && pendingBytes == 0 && this->preload > 0 && remaining <= this->preload * this->source->sampleRate()) {
+                    preloadChecked = true;
+
+                    sqMtx.lock();
+                    qMtx.lock();
+                    SongAction peekAction;
+                    SongID id = this->nextSongID(peekAction);
+                    qMtx.unlock();
+                    sqMtx.unlock();
+
+                    if (peekAction == SongAction::Next && (this->nextSource == nullptr || this->nextSourceID != id)) {
+                        Source * next = this->openSource(this->getPathForID(id));
+                        if (next->valid()) {
+                            if (primeBuf == nullptr) {
+                                primeBuf = new uint8_t[this->audio->bufferSize()];
+                            }
+                            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                            primedBytes = next->decode(primeBuf, this->audio->bufferSize());
+                            this->recordDecodeTime(std::chrono::steady_clock::now() - start);
+
+                            delete this->nextSource;
+                            this->nextSource = next;
+                            this->nextSourceID = id;
+                            Log::writeInfo("[SERVICE] Preloaded next song with " + std::to_string(remaining) + " samples left");
+
+                        } else {
+                            delete next;
+                        }
+                    }
+                }
+
+                // Start crossfading once we're within the crossfade length of the end (opening the next song now if
+                // it wasn't preloaded)
+                if (!fadeChecked && this->fadeSource == nullptr && this->crossfade > 0 && remaining <= this->crossfade * this->source->sampleRate()) {
+                    fadeChecked = true;
+
+                    sqMtx.lock();
+                    qMtx.lock();
+                    SongAction peekAction;
+                    SongID id = this->nextSongID(peekAction);
+                    qMtx.unlock();
+                    sqMtx.unlock();
+
+                    // Only songs with a matching format can be mixed (otherwise it's kept to move on to at the end)
+                    if (peekAction != SongAction::Nothing) {
+                        if (this->nextSource == nullptr || this->nextSourceID != id) {
+                            delete this->nextSource;
+                            this->nextSource = this->openSource(this->getPathForID(id));
+                            this->nextSourceID = id;
+                            primedBytes = 0;
+                        }
+                        if (this->nextSource->valid() && this->nextSource->sampleRate() == this->source->sampleRate() && this->nextSource->channels() == this->source->channels()) {
+                            nextAction = peekAction;
+                        }
+                    }
+                }
                 sMtx.unlock();
 
-                // Wait until a buffer is available to queue or there is an update
-                while (this->songAction == SongAction::Nothing && this->seekTo < 0 && !this->exit_) {
-                    if (this->audio->bufferAvailable()) {
-                        this->audio->addBuffer(buf, dec);
+                // Wait until a buffer is available to decode into or there is an update
+                uint8_t * buf = nullptr;
+                while (!this->hasAction() && nextAction == SongAction::Nothing && this->seekTo < 0 && !this->exit_) {
+                    buf = this->audio->claimBuffer();
+                    if (buf != nullptr) {
                         break;
-
-                    // Sleep if no buffer is available (duration depends on state)
-                    } else {
-                        NX::Thread::sleepMilli((this->audio->status() == Audio::Status::Paused ? 20 : 5));
                     }
+
+                    // Wait if no buffer is available (duration depends on state, but a command wakes immediately)
+                    this->waitForAction((this->audio->status() == Audio::Status::Paused ? 20 : 5));
                 }
-                delete[] buf;
 
-            // Otherwise if the source is not corrupt and has finished being decoded, wait until the audio device has finished playing it's buffers
-            } else if (this->source->valid() && this->source->done() && this->audio->status() != Audio::Status::Stopped) {
-                sleep = true;
+                // Decode and queue (the source may have been removed while waiting)
+                if (buf != nullptr) {
+                    sMtx.lock();
+                    if (this->source != nullptr) {
+                        // Play cached audio first, moving the source to where it finishes if it isn't already there
+                        size_t dec = this->rewind->read(buf, this->audio->bufferSize());
+                        if (dec == 0 && pendingBytes > 0) {
+                            // Use the audio decoded when the song was opened ahead of time
+                            std::memcpy(buf, primeBuf, pendingBytes);
+                            dec = pendingBytes;
+                            pendingBytes = 0;
+                            decodedBytes += dec;
+                            this->rewind->record(buf, dec);
+
+                        } else if (dec == 0) {
+                            if (!this->rewind->synced()) {
+                                this->source->seek(this->rewind->position());
+                                this->rewind->seeked(this->source->tell());
+                            }
+
+                            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                            dec = this->source->decode(buf, this->audio->bufferSize());
+                            std::chrono::steady_clock::duration taken = std::chrono::steady_clock::now() - start;
+                            this->recordDecodeTime(taken);
+                            decodeTime += taken;
+                            decodedBytes += dec;
+                            this->rewind->record(buf, dec);
+                        }
+
+                        // Mix in the end of the previous song if crossfading
+                        if (this->fadeSource != nullptr) {
+                            size_t fadeDec = this->fadeSource->decode(fadeBuf, this->audio->bufferSize());
+
+                            // Pad whichever buffer is shorter with silence so stale audio isn't mixed in
+                            size_t mixed = (fadeDec > dec ? fadeDec : dec);
+                            std::memset(buf + dec, 0, mixed - dec);
+                            std::memset(fadeBuf + fadeDec, 0, mixed - fadeDec);
+                            dec = mixed;
+                            int channels = this->source->channels();
+                            size_t samples = dec/sizeof(int16_t);
+                            Utils::Mix::crossfade(reinterpret_cast<int16_t *>(buf), reinterpret_cast<int16_t *>(fadeBuf), samples, channels, fadeGain, fadeStep);
+                            fadeGain += (samples/channels) * fadeStep;
+
+                            if (this->fadeSource->done()) {
+                                delete this->fadeSource;
+                                this->fadeSource = nullptr;
+                            }
+                        }
+
+                        // Run the result through any filters
+                        std::chrono::steady_clock::time_point dspStart = std::chrono::steady_clock::now();
+                        this->dsp->process(reinterpret_cast<int16_t *>(buf), dec/sizeof(int16_t));
+                        dspTime += std::chrono::steady_clock::now() - dspStart;
+                        dspBytes += dec;
+                        this->audio->queueBuffer(dec);
+                    }
+                    sMtx.unlock();
+                }
 
-            // If not valid attempt to move to change song
+            // Otherwise the source has either been completely decoded or is corrupt, so work out the next song
+            // (a decoded song's remaining buffers keep playing while the next one is opened and decoded)
             } else {
+                // Log how quickly the source was decoded (once per source)
+                if (decodedBytes > 0) {
+                    size_t samples = decodedBytes/(sizeof(int16_t) * this->source->channels());
+                    double secs = std::chrono::duration<double>(decodeTime).count();
+                    double nsPerSample = (secs * 1000000000.0)/samples;
+                    double realtime = (secs > 0 ? (static_cast<double>(samples)/this->source->sampleRate())/secs : 0);
+                    size_t dspSamples = dspBytes/(sizeof(int16_t) * this->source->channels());
+                    double dspNsPerSample = (dspSamples > 0 ? std::chrono::duration<double, std::nano>(dspTime).count()/dspSamples : 0);
+                    Log::writeInfo("[SERVICE] Decode stats: samples=" + std::to_string(samples) + " rate=" + std::to_string(this->source->sampleRate()) +
+                                   " channels=" + std::to_string(this->source->channels()) + " ns_per_sample=" + std::to_string(nsPerSample) +
+                                   " realtime_factor=" + std::to_string(realtime) + " dsp_ns_per_sample=" + std::to_string(dspNsPerSample));
+                    decodedBytes = 0;
+                    decodeTime = std::chrono::steady_clock::duration::zero();
+                    dspBytes = 0;
+                    dspTime = std::chrono::steady_clock::duration::zero();
+                }
+
                 sqMtx.lock();
                 qMtx.lock();
 
                 // Replay current song if repeat is set to one
                 if (this->repeatMode == RepeatMode::One && this->source->valid()) {
-                    this->songAction = SongAction::Replay;
+                    nextAction = SongAction::Replay;
 
                 // Don't go to next song if at the end and repeat is off
-                } else if (this->queue->currentIdx() >= this->queue->size() - 1 && this->repeatMode == RepeatMode::Off && this->subQueue.empty()) {
-                    this->songAction = SongAction::Nothing;
+                } else if (this->queue->currentIdx() + 1 >= this->queue->size() && this->repeatMode == RepeatMode::Off && this->subQueue->empty()) {
+                    nextAction = SongAction::Nothing;
 
                 // Otherwise advance to next song
                 } else {
-                    this->songAction = SongAction::Next;
+                    nextAction = SongAction::Next;
                 }
 
                 qMtx.unlock();
                 sqMtx.unlock();
 
-                if (this->songAction == SongAction::Nothing) {
+                // A corrupt source has nothing to play out, so treat it like a requested skip
+                if (!this->source->valid() && nextAction != SongAction::Nothing) {
+                    this->queueAction(nextAction);
+                    nextAction = SongAction::Nothing;
+                }
+
+                if (nextAction == SongAction::Nothing) {
                     sleep = true;
                 }
             }
         }
 
-        // Sleep if no action is required
+        // Sleep if no action is required (until a command is received)
         if (sleep) {
-            NX::Thread::sleepMilli(50);
+            this->waitForAction(50);
         }
     }
+
+    delete[] fadeBuf;
+    delete[] primeBuf;
 }
 
 void MainService::sleepEventThread() {
@@ -837,9 +1969,24 @@ void MainService::sleepEventThread() {
 }
 
 MainService::~MainService() {
+    // The server returns deferred requests to it's pool when deleted, so wait for the worker to finish with
+    // the one it's handling (if any) and drop those it hasn't started
+    {
+        std::unique_lock<std::mutex> mtx(this->deferredMutex);
+        this->deferredCond.wait(mtx, [this]() {
+            return !this->deferredBusy;
+        });
+        this->deferredCount = 0;
+    }
+
+    NX::Shmem::destroy();
     delete this->cfg;
-    delete this->db;
+    delete this->library;
+    delete this->dsp;
     delete this->ipcServer;
     delete this->queue;
+    delete this->fadeSource;
+    delete this->nextSource;
     delete this->source;
+    delete this->rewind;
 }
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include "ShuffleOrder.hpp"
+
+// Returns a well mixed hash of a 32-bit value
+static uint32_t mix(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352D;
+    x ^= x >> 15;
+    x *= 0x846CA68B;
+    x ^= x >> 16;
+    return x;
+}
+
+ShuffleOrder::ShuffleOrder(size_t count, size_t first, uint64_t seed) {
+    // Derive a key for each round from the seed (using SplitMix64)
+    this->seed_ = seed;
+    for (uint32_t & key : this->keys) {
+        seed += 0x9E3779B97F4A7C15;
+        uint64_t z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+        key = (z ^ (z >> 31));
+    }
+
+    // The network works on blocks of an even number of bits large enough to hold every position,
+    // and positions it maps outside of the domain are fed back in until they land inside ('cycle walking')
+    this->domain = (count > 0 ? count - 1 : 0);
+    this->halfBits = 1;
+    while ((static_cast<uint64_t>(1) << (2 * this->halfBits)) < this->domain) {
+        this->halfBits++;
+    }
+    this->first = first;
+
+    // Start with the first index followed by every permuted position
+    this->runs.push_back(Run{0, 0, 0, 0, 0, false});
+    this->root = 0;
+    if (count > 0) {
+        this->root = this->merge(this->newRun(first, 1, true), (this->domain > 0 ? this->newRun(0, this->domain, false) : 0));
+    }
+    this->nextIndex = count;
+}
+
+uint32_t ShuffleOrder::permute(uint32_t x) {
+    const uint32_t mask = (static_cast<uint32_t>(1) << this->halfBits) - 1;
+    do {
+        uint32_t l = x >> this->halfBits;
+        uint32_t r = x & mask;
+        for (const uint32_t key : this->keys) {
+            uint32_t tmp = l ^ (mix(r ^ key) & mask);
+            l = r;
+            r = tmp;
+        }
+        x = (l << this->halfBits) | r;
+    } while (x >= this->domain);
+    return x;
+}
+
+uint32_t ShuffleOrder::virtualAt(size_t pos) {
+    uint32_t t = this->root;
+    while (true) {
+        const Run & n = this->runs[t];
+        size_t leftTotal = this->runs[n.left].total;
+        if (pos < leftTotal) {
+            t = n.left;
+        } else if (pos < leftTotal + n.length) {
+            if (n.direct) {
+                return n.value;
+            }
+
+            // Skip over the first index as it's not part of the permutation
+            uint32_t v = this->permute(n.value + (pos - leftTotal));
+            return (v < this->first ? v : v + 1);
+        } else {
+            pos -= leftTotal + n.length;
+            t = n.right;
+        }
+    }
+}
+
+size_t ShuffleOrder::actualIndex(uint32_t v) {
+    return v - (std::lower_bound(this->removed.begin(), this->removed.end(), v) - this->removed.begin());
+}
+
+uint32_t ShuffleOrder::newRun(uint32_t value, uint32_t length, bool direct) {
+    uint32_t i;
+    if (!this->freed.empty()) {
+        i = this->freed.back();
+        this->freed.pop_back();
+    } else {
+        i = this->runs.size();
+        this->runs.emplace_back();
+    }
+
+    this->runs[i] = Run{value, length, 0, 0, length, direct};
+    return i;
+}
+
+void ShuffleOrder::update(uint32_t i) {
+    Run & n = this->runs[i];
+    n.total = n.length + this->runs[n.left].total + this->runs[n.right].total;
+}
+
+void ShuffleOrder::split(uint32_t t, size_t pos, uint32_t & l, uint32_t & r) {
+    if (t == 0) {
+        l = 0;
+        r = 0;
+        return;
+    }
+
+    size_t leftTotal = this->runs[this->runs[t].left].total;
+    if (pos <= leftTotal) {
+        uint32_t tmp;
+        this->split(this->runs[t].left, pos, l, tmp);
+        this->runs[t].left = tmp;
+        r = t;
+
+    } else if (pos >= leftTotal + this->runs[t].length) {
+        uint32_t tmp;
+        this->split(this->runs[t].right, pos - leftTotal - this->runs[t].length, tmp, r);
+        this->runs[t].right = tmp;
+        l = t;
+
+    } else {
+        // The split point is inside this run, so the rest of it becomes a new run at the start of the right side
+        // (creating it may move the runs in memory so nothing is held by reference)
+        uint32_t cut = pos - leftTotal;
+        uint32_t tail = this->newRun(this->runs[t].value + cut, this->runs[t].length - cut, false);
+        this->runs[t].length = cut;
+        r = this->merge(tail, this->runs[t].right);
+        this->runs[t].right = 0;
+        l = t;
+    }
+    this->update(t);
+}
+
+uint32_t ShuffleOrder::merge(uint32_t l, uint32_t r) {
+    if (l == 0 || r == 0) {
+        return (l == 0 ? r : l);
+    }
+
+    // The run with the higher priority becomes the root
+    if (mix(l) > mix(r)) {
+        uint32_t tmp = this->merge(this->runs[l].right, r);
+        this->runs[l].right = tmp;
+        this->update(l);
+        return l;
+    }
+    uint32_t tmp = this->merge(l, this->runs[r].left);
+    this->runs[r].left = tmp;
+    this->update(r);
+    return r;
+}
+
+uint64_t ShuffleOrder::seed() {
+    return this->seed_;
+}
+
+size_t ShuffleOrder::size() {
+    return this->runs[this->root].total;
+}
+
+size_t ShuffleOrder::index(size_t pos) {
+    return this->actualIndex(this->virtualAt(pos));
+}
+
+void ShuffleOrder::insert(size_t pos) {
+    if (pos > this->size()) {
+        pos = this->size();
+    }
+
+    uint32_t l, r;
+    this->split(this->root, pos, l, r);
+    uint32_t run = this->newRun(this->nextIndex++, 1, true);
+    this->root = this->merge(this->merge(l, run), r);
+}
+
+size_t ShuffleOrder::erase(size_t pos) {
+    uint32_t v = this->virtualAt(pos);
+    size_t index = this->actualIndex(v);
+
+    // Cut out the position and join what's either side of it
+    uint32_t l, mid, r;
+    this->split(this->root, pos, l, r);
+    this->split(r, 1, mid, r);
+    this->root = this->merge(l, r);
+    this->freed.push_back(mid);
+
+    this->removed.insert(std::lower_bound(this->removed.begin(), this->removed.end(), v), v);
+    return index;
+}
+
+void ShuffleOrder::move(size_t from, size_t to) {
+    if (from == to || from >= this->size() || to >= this->size()) {
+        return;
+    }
+
+    // Cut out the position, then insert it's index at the new position in the remaining tree
+    uint32_t v = this->virtualAt(from);
+    uint32_t l, mid, r;
+    this->split(this->root, from, l, r);
+    this->split(r, 1, mid, r);
+    this->freed.push_back(mid);
+
+    this->split(this->merge(l, r), to, l, r);
+    uint32_t run = this->newRun(v, 1, true);
+    this->root = this->merge(this->merge(l, run), r);
+}
\ No newline at end of file
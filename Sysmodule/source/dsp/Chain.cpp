@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <cmath>
+#include "dsp/Chain.hpp"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+constexpr size_t blockFrames = 256;         // Number of frames converted to floats at once (2kB on the stack for stereo)
+constexpr float limitThreshold = 0.98f;     // Level which the limiter keeps peaks under (about -0.2dBFS)
+constexpr float limitReleaseSecs = 0.05f;   // Time taken for the limiter to mostly recover after a peak
+
+namespace Dsp {
+    // Converts 16-bit samples to floats, applying the given gain
+    static void toFloat(const int16_t * in, float * out, const size_t samples, const float gain) {
+        size_t i = 0;
+#if defined(__ARM_NEON)
+        const float32x4_t vGain = vdupq_n_f32(gain);
+        for (; i + 4 <= samples; i += 4) {
+            vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vld1_s16(in + i))), vGain));
+        }
+#elif defined(__SSE2__)
+        const __m128 vGain = _mm_set1_ps(gain);
+        for (; i + 4 <= samples; i += 4) {
+            __m128i s = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(in + i));
+            _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16)), vGain));
+        }
+#endif
+        for (; i < samples; i++) {
+            out[i] = in[i] * gain;
+        }
+    }
+
+    // Converts floats (nominally -1.0 to 1.0) back to 16-bit samples, clipping any which are out of range
+    static void toInt(const float * in, int16_t * out, const size_t samples) {
+        size_t i = 0;
+#if defined(__ARM_NEON)
+        const float32x4_t vScale = vdupq_n_f32(32768.0f);
+        for (; i + 4 <= samples; i += 4) {
+            vst1_s16(out + i, vqmovn_s32(vcvtq_s32_f32(vmulq_f32(vld1q_f32(in + i), vScale))));
+        }
+#elif defined(__SSE2__)
+        const __m128 vScale = _mm_set1_ps(32768.0f);
+        const __m128 vMax = _mm_set1_ps(32767.0f);
+        const __m128 vMin = _mm_set1_ps(-32768.0f);
+        for (; i + 4 <= samples; i += 4) {
+            __m128 v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), vScale), vMin), vMax);
+            __m128i v32 = _mm_cvttps_epi32(v);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(out + i), _mm_packs_epi32(v32, v32));
+        }
+#endif
+        for (; i < samples; i++) {
+            float v = in[i] * 32768.0f;
+            out[i] = (v > 32767.0f ? 32767 : (v < -32768.0f ? -32768 : static_cast<int16_t>(v)));
+        }
+    }
+
+    Chain::Chain() {
+        this->channels = 0;
+        this->limiter = false;
+        this->limitGain = 1.0f;
+        this->limitRelease = 0.0f;
+        this->preamp = 1.0f;
+        this->gain = 1.0f;
+        this->rate = 0;
+    }
+
+    void Chain::updateCoefficients() {
+        if (this->rate <= 0) {
+            return;
+        }
+
+        // See Robert Bristow-Johnson's 'Audio EQ Cookbook' for where these come from
+        for (size_t i = 0; i < this->filters.size(); i++) {
+            const Filter & f = this->filters[i];
+            const float freq = std::min(f.freq, 0.45f * this->rate);
+            const float w0 = 2.0f * M_PI * freq/this->rate;
+            const float cosW = std::cos(w0);
+            const float alpha = std::sin(w0)/(2.0f * f.q);
+            const float A = std::pow(10.0f, f.gain/40.0f);
+            const float sqrtA2Alpha = 2.0f * std::sqrt(A) * alpha;
+
+            float b0, b1, b2, a0, a1, a2;
+            switch (f.type) {
+                case Filter::Type::Peak:
+                    b0 = 1.0f + alpha * A;
+                    b1 = -2.0f * cosW;
+                    b2 = 1.0f - alpha * A;
+                    a0 = 1.0f + alpha/A;
+                    a1 = -2.0f * cosW;
+                    a2 = 1.0f - alpha/A;
+                    break;
+
+                case Filter::Type::LowShelf:
+                    b0 = A * ((A + 1.0f) - (A - 1.0f) * cosW + sqrtA2Alpha);
+                    b1 = 2.0f * A * ((A - 1.0f) - (A + 1.0f) * cosW);
+                    b2 = A * ((A + 1.0f) - (A - 1.0f) * cosW - sqrtA2Alpha);
+                    a0 = (A + 1.0f) + (A - 1.0f) * cosW + sqrtA2Alpha;
+                    a1 = -2.0f * ((A - 1.0f) + (A + 1.0f) * cosW);
+                    a2 = (A + 1.0f) + (A - 1.0f) * cosW - sqrtA2Alpha;
+                    break;
+
+                case Filter::Type::HighShelf:
+                    b0 = A * ((A + 1.0f) + (A - 1.0f) * cosW + sqrtA2Alpha);
+                    b1 = -2.0f * A * ((A - 1.0f) + (A + 1.0f) * cosW);
+                    b2 = A * ((A + 1.0f) + (A - 1.0f) * cosW - sqrtA2Alpha);
+                    a0 = (A + 1.0f) - (A - 1.0f) * cosW + sqrtA2Alpha;
+                    a1 = 2.0f * ((A - 1.0f) - (A + 1.0f) * cosW);
+                    a2 = (A + 1.0f) - (A - 1.0f) * cosW - sqrtA2Alpha;
+                    break;
+
+                case Filter::Type::LowPass:
+                    b0 = (1.0f - cosW)/2.0f;
+                    b1 = 1.0f - cosW;
+                    b2 = (1.0f - cosW)/2.0f;
+                    a0 = 1.0f + alpha;
+                    a1 = -2.0f * cosW;
+                    a2 = 1.0f - alpha;
+                    break;
+
+                case Filter::Type::HighPass:
+                default:
+                    b0 = (1.0f + cosW)/2.0f;
+                    b1 = -(1.0f + cosW);
+                    b2 = (1.0f + cosW)/2.0f;
+                    a0 = 1.0f + alpha;
+                    a1 = -2.0f * cosW;
+                    a2 = 1.0f - alpha;
+                    break;
+            }
+
+            Biquad & bq = this->biquads[i];
+            bq.b0 = b0/a0;
+            bq.b1 = b1/a0;
+            bq.b2 = b2/a0;
+            bq.a1 = a1/a0;
+            bq.a2 = a2/a0;
+        }
+
+        this->limitRelease = 1.0f - std::exp(-1.0f/(limitReleaseSecs * this->rate));
+    }
+
+    void Chain::processBlock(float * buf, size_t frames) {
+        // Filters are recursive, so each one runs over the whole block with both channels side by side
+        for (Biquad & bq : this->biquads) {
+            size_t i = 0;
+            if (this->channels == 2) {
+#if defined(__ARM_NEON)
+                const float32x2_t b0 = vdup_n_f32(bq.b0);
+                const float32x2_t b1 = vdup_n_f32(bq.b1);
+                const float32x2_t b2 = vdup_n_f32(bq.b2);
+                const float32x2_t a1 = vdup_n_f32(bq.a1);
+                const float32x2_t a2 = vdup_n_f32(bq.a2);
+                float32x2_t z1 = vld1_f32(bq.z1);
+                float32x2_t z2 = vld1_f32(bq.z2);
+                for (; i < frames; i++) {
+                    float32x2_t x = vld1_f32(buf + 2*i);
+                    float32x2_t y = vmla_f32(z1, b0, x);
+                    z1 = vmls_f32(vmla_f32(z2, b1, x), a1, y);
+                    z2 = vmls_f32(vmul_f32(b2, x), a2, y);
+                    vst1_f32(buf + 2*i, y);
+                }
+                vst1_f32(bq.z1, z1);
+                vst1_f32(bq.z2, z2);
+#elif defined(__SSE2__)
+                const __m128 b0 = _mm_set1_ps(bq.b0);
+                const __m128 b1 = _mm_set1_ps(bq.b1);
+                const __m128 b2 = _mm_set1_ps(bq.b2);
+                const __m128 a1 = _mm_set1_ps(bq.a1);
+                const __m128 a2 = _mm_set1_ps(bq.a2);
+                __m128 z1 = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(bq.z1)));
+                __m128 z2 = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(bq.z2)));
+                for (; i < frames; i++) {
+                    __m128 x = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(buf + 2*i)));
+                    __m128 y = _mm_add_ps(z1, _mm_mul_ps(b0, x));
+                    z1 = _mm_sub_ps(_mm_add_ps(z2, _mm_mul_ps(b1, x)), _mm_mul_ps(a1, y));
+                    z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+                    _mm_store_sd(reinterpret_cast<double *>(buf + 2*i), _mm_castps_pd(y));
+                }
+                _mm_store_sd(reinterpret_cast<double *>(bq.z1), _mm_castps_pd(z1));
+                _mm_store_sd(reinterpret_cast<double *>(bq.z2), _mm_castps_pd(z2));
+#endif
+            }
+
+            // Scalar version for mono (or stereo without SIMD)
+            for (; i < frames; i++) {
+                for (int c = 0; c < this->channels; c++) {
+                    float x = buf[i * this->channels + c];
+                    float y = bq.b0 * x + bq.z1[c];
+                    bq.z1[c] = bq.b1 * x - bq.a1 * y + bq.z2[c];
+                    bq.z2[c] = bq.b2 * x - bq.a2 * y;
+                    buf[i * this->channels + c] = y;
+                }
+            }
+        }
+
+        // Reduce gain instantly on a peak and let it recover slowly, keeping channels linked
+        if (this->limiter) {
+            for (size_t i = 0; i < frames; i++) {
+                float peak = std::fabs(buf[i * this->channels]);
+                if (this->channels == 2) {
+                    peak = std::max(peak, std::fabs(buf[i * this->channels + 1]));
+                }
+
+                float target = (peak > limitThreshold ? limitThreshold/peak : 1.0f);
+                if (target < this->limitGain) {
+                    this->limitGain = target;
+                } else {
+                    this->limitGain += (target - this->limitGain) * this->limitRelease;
+                }
+
+                for (int c = 0; c < this->channels; c++) {
+                    buf[i * this->channels + c] *= this->limitGain;
+                }
+            }
+        }
+    }
+
+    void Chain::setFilters(const std::vector<Filter> & filters, float preamp, bool limiter) {
+        // Keep the state of filters which are only being adjusted so changes don't click, but clear it if a slot
+        // now holds a different filter (i.e. one was removed), as another filter's history would be wrong for it
+        this->biquads.resize(filters.size(), Biquad{1.0f, 0.0f, 0.0f, 0.0f, 0.0f, {0.0f, 0.0f}, {0.0f, 0.0f}});
+        for (size_t i = 0; i < std::min(this->filters.size(), filters.size()); i++) {
+            if (this->filters[i].type != filters[i].type || this->filters[i].freq != filters[i].freq) {
+                Biquad & bq = this->biquads[i];
+                bq.z1[0] = bq.z1[1] = 0.0f;
+                bq.z2[0] = bq.z2[1] = 0.0f;
+            }
+        }
+        this->filters = filters;
+        this->preamp = std::pow(10.0f, preamp/20.0f);
+        this->limiter = limiter;
+        if (!limiter) {
+            this->limitGain = 1.0f;
+        }
+        this->updateCoefficients();
+    }
+
+    void Chain::setFormat(long rate, int channels) {
+        if (rate == this->rate && channels == this->channels) {
+            return;
+        }
+
+        // Old state doesn't make sense for the new format
+        this->rate = rate;
+        this->channels = (channels > 2 ? 0 : channels);
+        for (Biquad & bq : this->biquads) {
+            bq.z1[0] = bq.z1[1] = 0.0f;
+            bq.z2[0] = bq.z2[1] = 0.0f;
+        }
+        this->limitGain = 1.0f;
+        this->updateCoefficients();
+    }
+
+    void Chain::setGain(float gain) {
+        this->gain = std::pow(10.0f, gain/20.0f);
+    }
+
+    bool Chain::active() {
+        return (!this->biquads.empty() || this->preamp * this->gain != 1.0f || this->limiter);
+    }
+
+    void Chain::process(int16_t * buf, size_t samples) {
+        if (!this->active() || this->channels == 0 || this->rate <= 0) {
+            return;
+        }
+
+        // Work on a block at a time to avoid needing a float copy of the whole buffer
+        float block[blockFrames * 2];
+        const float gain = (this->preamp * this->gain)/32768.0f;
+        size_t frames = samples/this->channels;
+        for (size_t pos = 0; pos < frames; pos += blockFrames) {
+            size_t num = std::min(blockFrames, frames - pos);
+            int16_t * ptr = buf + pos * this->channels;
+            toFloat(ptr, block, num * this->channels, gain);
+            this->processBlock(block, num);
+            toInt(block, ptr, num * this->channels);
+        }
+    }
+};
\ No newline at end of file
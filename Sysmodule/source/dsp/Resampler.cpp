@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "dsp/Resampler.hpp"
+#include "Log.hpp"
+#include <numeric>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+constexpr size_t maxPhases = 640;           // Most phases that are stored (11.025kHz to 48kHz needs 640)
+constexpr size_t blockFrames = 1024;        // Frames that can be pushed in addition to the history
+
+namespace Dsp {
+    // Returns the dot product of two arrays (the length must be a multiple of four)
+    static float dot(const float * a, const float * b, const size_t n) {
+        size_t i = 0;
+        float sum = 0.0f;
+#if defined(__ARM_NEON)
+        float32x4_t vSum = vdupq_n_f32(0.0f);
+        for (; i < n; i += 4) {
+            vSum = vmlaq_f32(vSum, vld1q_f32(a + i), vld1q_f32(b + i));
+        }
+        sum = vaddvq_f32(vSum);
+#elif defined(__SSE2__)
+        __m128 vSum = _mm_setzero_ps();
+        for (; i < n; i += 4) {
+            vSum = _mm_add_ps(vSum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        }
+        float tmp[4];
+        _mm_storeu_ps(tmp, vSum);
+        sum = (tmp[0] + tmp[1]) + (tmp[2] + tmp[3]);
+#endif
+        for (; i < n; i++) {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+
+    // Converts one channel of interleaved 16-bit samples to floats (keeping the same scale)
+    static void deinterleave(const int16_t * in, float * out, const size_t frames, const int channels, const int channel) {
+        size_t i = 0;
+#if defined(__ARM_NEON)
+        if (channels == 2) {
+            for (; i + 4 <= frames; i += 4) {
+                int16x4x2_t v = vld2_s16(in + 2*i);
+                vst1q_f32(out + i, vcvtq_f32_s32(vmovl_s16(v.val[channel])));
+            }
+        } else if (channels == 1) {
+            for (; i + 4 <= frames; i += 4) {
+                vst1q_f32(out + i, vcvtq_f32_s32(vmovl_s16(vld1_s16(in + i))));
+            }
+        }
+#endif
+        for (; i < frames; i++) {
+            out[i] = in[i * channels + channel];
+        }
+    }
+
+    Resampler::Resampler(long inRate, long outRate, int channels, Quality quality) {
+        this->channels = channels;
+
+        // Reduce the ratio, approximating it if too many phases would be needed
+        size_t div = std::gcd(inRate, outRate);
+        this->phases = outRate/div;
+        this->step = inRate/div;
+        if (this->phases > maxPhases) {
+            this->step = std::max<size_t>(std::lround(static_cast<double>(this->step) * maxPhases/this->phases), 1);
+            this->phases = maxPhases;
+            Log::writeInfo("[RESAMPLE] Approximating " + std::to_string(inRate) + "Hz as " + std::to_string(this->step) + "/" + std::to_string(this->phases) + " of the output rate");
+        }
+
+        // The cutoff drops when lowering the rate, so more taps are needed to keep the same transition
+        size_t baseTaps;
+        float rolloff;
+        switch (quality) {
+            case Quality::Low:
+                baseTaps = 8;
+                rolloff = 0.85f;
+                break;
+
+            case Quality::Medium:
+                baseTaps = 16;
+                rolloff = 0.91f;
+                break;
+
+            case Quality::High:
+            default:
+                baseTaps = 32;
+                rolloff = 0.95f;
+                break;
+        }
+        size_t factor = (this->step + this->phases - 1)/this->phases;
+        this->taps = baseTaps * std::max<size_t>(factor, 1);
+        this->half = this->taps/2;
+        const double cutoff = rolloff * std::min(1.0, static_cast<double>(this->phases)/this->step);
+
+        // Each phase is a Blackman windowed sinc centred at it's position between two input samples,
+        // normalized so there's unity gain at DC
+        this->coeffs.resize(this->phases * this->taps);
+        for (size_t p = 0; p < this->phases; p++) {
+            float * h = this->coeffs.data() + p * this->taps;
+            double frac = static_cast<double>(p)/this->phases;
+            double sum = 0.0;
+            for (size_t k = 0; k < this->taps; k++) {
+                double t = (static_cast<double>(k) - (this->half - 1)) - frac;
+                double x = M_PI * cutoff * t;
+                double sinc = (x == 0.0 ? 1.0 : std::sin(x)/x);
+                double w = t/this->half;
+                double window = 0.42 + 0.5 * std::cos(M_PI * w) + 0.08 * std::cos(2.0 * M_PI * w);
+                h[k] = sinc * window;
+                sum += h[k];
+            }
+            for (size_t k = 0; k < this->taps; k++) {
+                h[k] /= sum;
+            }
+        }
+
+        this->input.assign(this->channels, std::vector<float>(this->taps + blockFrames, 0.0f));
+        this->reset();
+    }
+
+    void Resampler::reset() {
+        // Start with enough silence that the first output frame lines up with the first input frame
+        for (std::vector<float> & in : this->input) {
+            std::fill(in.begin(), in.end(), 0.0f);
+        }
+        this->fill = this->half - 1;
+        this->pos = this->half - 1;
+        this->phase = 0;
+    }
+
+    size_t Resampler::capacity() {
+        // Drop samples which are no longer needed
+        size_t start = this->pos - (this->half - 1);
+        if (start > 0) {
+            for (std::vector<float> & in : this->input) {
+                std::memmove(in.data(), in.data() + start, (this->fill - start) * sizeof(float));
+            }
+            this->fill -= start;
+            this->pos -= start;
+        }
+
+        return (this->input.empty() ? 0 : this->input[0].size() - this->fill);
+    }
+
+    void Resampler::push(const int16_t * in, size_t frames) {
+        frames = std::min(frames, this->capacity());
+        for (int c = 0; c < this->channels; c++) {
+            deinterleave(in, this->input[c].data() + this->fill, frames, this->channels, c);
+        }
+        this->fill += frames;
+    }
+
+    void Resampler::flush() {
+        size_t frames = std::min(this->half, this->capacity());
+        for (std::vector<float> & in : this->input) {
+            std::fill(in.begin() + this->fill, in.begin() + this->fill + frames, 0.0f);
+        }
+        this->fill += frames;
+    }
+
+    size_t Resampler::pull(int16_t * out, size_t frames) {
+        size_t count = 0;
+        while (count < frames && this->pos + this->half < this->fill) {
+            const float * h = this->coeffs.data() + this->phase * this->taps;
+            for (int c = 0; c < this->channels; c++) {
+                float v = std::round(dot(h, this->input[c].data() + this->pos - (this->half - 1), this->taps));
+                out[count * this->channels + c] = (v > 32767.0f ? 32767 : (v < -32768.0f ? -32768 : static_cast<int16_t>(v)));
+            }
+            count++;
+
+            // Move along by the input rate's share of a phase
+            this->phase += this->step;
+            this->pos += this->phase/this->phases;
+            this->phase %= this->phases;
+        }
+        return count;
+    }
+};
\ No newline at end of file
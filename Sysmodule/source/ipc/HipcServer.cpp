@@ -0,0 +1,313 @@
+#include <algorithm>
+#include "ipc/HipcServer.hpp"
+#include "Log.hpp"
+
+// This was heavily inspired by sys-clk's ipc server, a big thanks to those
+// who wrote the original C version:
+// --------------------------------------------------------------------------
+// "THE BEER-WARE LICENSE" (Revision 42):
+// <p-sam@d3vs.net>, <natinusala@gmail.com>, <m4x@m4xw.net>
+// wrote this file. As long as you retain this notice you can do whatever you
+// want with this stuff. If you meet any of us some day, and you think this
+// stuff is worth it, you can buy us a beer in return.  - The sys-clk authors
+// --------------------------------------------------------------------------
+
+// IPC request header structure
+struct Header {
+    uint64_t magic;
+    union {
+        uint64_t cmdId;
+        uint64_t result;
+    };
+};
+
+namespace Ipc {
+    constexpr size_t maxReplyBytes = 0x90 - sizeof(Header);     // Max bytes that fit in 'header'
+
+    // Fill a request from the thread-local storage, pointing it at the client's mapped buffers
+    // Returns false on a fatal error
+    static bool requestFromTLS(Request * request) {
+        // Read structure from thread-local storage
+        uint8_t * base = static_cast<uint8_t *>(armGetTls());
+        HipcParsedRequest hipc = hipcParseRequest(base);
+
+        // Determine type, finding the command id and 'arguments' if it's a request
+        Request::Type type = Request::Type::Other;
+        uint64_t cmd = 0;
+        const uint8_t * args = nullptr;
+        size_t argsSize = 0;
+        if (hipc.meta.type == CmifCommandType_Request) {
+            type = Request::Type::Request;
+
+            // Validate header
+            Header * header = static_cast<Header *>(cmifGetAlignedDataStart(hipc.data.data_words, base));
+            size_t headerSize = hipc.meta.num_data_words * 4;
+            if (!header || headerSize < sizeof(Header) || header->magic != CMIF_IN_HEADER_MAGIC) {
+                // Return false as a bad header is an error
+                return false;
+            }
+
+            // We appear to have a valid request
+            cmd = header->cmdId;
+            args = reinterpret_cast<uint8_t *>(header) + sizeof(Header);
+            argsSize = headerSize - sizeof(Header);
+
+        } else if (hipc.meta.type == CmifCommandType_Close) {
+            type = Request::Type::Close;
+        }
+
+        // The buffers stay mapped until we reply, so they're used in place
+        const uint8_t * data = nullptr;
+        size_t dataSize = 0;
+        if (hipc.meta.num_send_buffers > 0) {
+            data = static_cast<const uint8_t *>(hipcGetBufferAddress(hipc.data.send_buffers));
+            dataSize = hipcGetBufferSize(hipc.data.send_buffers);
+        }
+        uint8_t * reply = nullptr;
+        size_t replySize = 0;
+        if (hipc.meta.num_recv_buffers > 0) {
+            reply = static_cast<uint8_t *>(hipcGetBufferAddress(hipc.data.recv_buffers));
+            replySize = hipcGetBufferSize(hipc.data.recv_buffers);
+        }
+
+        return request->reset(type, cmd, args, argsSize, data, dataSize, reply, replySize);
+    }
+
+    // Use the request's reply to construct a response on thread-local storage
+    // (the reply data has already been written to the client's buffer)
+    static void responseToTLS(Request * request) {
+        // Create response on thread-local storage
+        uint8_t * base = static_cast<uint8_t *>(armGetTls());
+        bool ok = R_SUCCEEDED(request->result());
+        size_t valueSize = (ok ? std::min(request->replyValueSize(), maxReplyBytes) : 0);
+        size_t handleCount = (ok ? request->replyHandleCount() : 0);
+        HipcRequest hipc = hipcMakeRequestInline(base,
+            .type = CmifCommandType_Request,
+            .num_data_words = static_cast<uint32_t>(sizeof(Header) + valueSize + 0x10)/4,
+            .num_copy_handles = static_cast<uint32_t>(handleCount),
+        );
+
+        // Copy handles
+        for (size_t i = 0; i < handleCount; i++) {
+            hipc.copy_handles[i] = request->replyHandles()[i];
+        }
+
+        // Create header
+        Header * header = static_cast<Header *>(cmifGetAlignedDataStart(hipc.data_words, base));
+        header->magic = CMIF_OUT_HEADER_MAGIC;
+        header->result = request->result();
+
+        // Append reply 'value'
+        if (valueSize > 0) {
+            std::memcpy(reinterpret_cast<uint8_t *>(header) + sizeof(Header), request->replyValue(), valueSize);
+        }
+    }
+
+    HipcServer::HipcServer(const std::string & name, const size_t maxClients) : Server(maxClients) {
+        // Set status variables
+        this->maxHandles = maxClients + 2;
+        this->handles.reserve(this->maxHandles);
+
+        // Exit if invalid session count given
+        if (maxClients < 1 || maxClients > MAX_WAIT_OBJECTS - 2) {
+            Log::writeError("[IPC] Invalid number of sessions requested");
+            this->error_ = true;
+            return;
+        }
+
+        // Create server
+        Handle serverHandle;
+        this->serverName = smEncodeName(name.c_str());
+        ::Result rc = smRegisterService(&serverHandle, this->serverName, false, maxClients);
+        if (R_FAILED(rc)) {
+            Log::writeError("[IPC] Couldn't create server: " + std::to_string(rc));
+            return;
+        }
+
+        // Create event used to wake the server
+        rc = eventCreate(&this->wakeEvent, false);
+        if (R_FAILED(rc)) {
+            Log::writeError("[IPC] Couldn't create wake event: " + std::to_string(rc));
+            svcCloseHandle(serverHandle);
+            smUnregisterService(this->serverName);
+            this->error_ = true;
+            return;
+        }
+
+        Log::writeSuccess("[IPC] Server started");
+        this->handles.push_back(serverHandle);
+        this->handles.push_back(this->wakeEvent.revent);
+    }
+
+    ::Result HipcServer::reply(Handle session) {
+        int tmp;
+        ::Result rc = svcReplyAndReceive(&tmp, &session, 0, session, 0);
+        if (rc == KERNELRESULT(TimedOut)) {
+            rc = 0;
+        }
+        return rc;
+    }
+
+    bool HipcServer::processSession(const int32_t index) {
+        int tmp;
+
+        // Wait for request
+        ::Result rc = svcReplyAndReceive(&tmp, &this->handles[index], 1, 0, UINT64_MAX);
+        if (R_FAILED(rc)) {
+            Log::writeError("[IPC] Couldn't receive request (closing handle): " + std::to_string(rc));
+            svcCloseHandle(this->handles[index]);
+            this->handles.erase(this->handles.begin() + index);
+            return true;        // Return true as closing a session is valid behaviour
+        }
+
+        // Fill a request with the received data
+        Request * request = this->takeRequest();
+        if (!request || !requestFromTLS(request)) {
+            Log::writeError("[IPC] An error occurred creating the request object (most likely bad header magic)");
+            if (request) {
+                this->returnRequest(request);
+            }
+            return false;
+        }
+
+        // Take action based on request type
+        bool closeSession = false;
+        switch (request->type()) {
+            // Call handler to prepare response
+            case Request::Type::Request:
+                // Stop waiting on the session if the reply is held, as the client can't send anything until it's replied to
+                if (this->handleRequest(this->handles[index], request)) {
+                    this->handles.erase(this->handles.begin() + index);
+                    return true;
+                }
+                break;
+
+            // Prepare default response
+            case Request::Type::Close:
+                request->setResult(0);
+                closeSession = true;
+                break;
+
+            // Otherwise prepare error response
+            default:
+                Log::writeInfo("[IPC] Received unexpected CmifCommand");
+                request->setResult(MAKERESULT(11, 403));
+                break;
+        }
+
+        // Send response and return object
+        responseToTLS(request);
+        rc = this->reply(this->handles[index]);
+        this->returnRequest(request);
+
+        // Close session on error or close request
+        if (R_FAILED(rc) || closeSession) {
+            Log::writeInfo("Closing session " + std::to_string(index) + " due to error/request");
+            svcCloseHandle(this->handles[index]);
+            this->handles.erase(this->handles.begin() + index);
+        }
+
+        return (R_SUCCEEDED(rc));
+    }
+
+    bool HipcServer::processNewSession() {
+        Handle session;
+        ::Result rc = svcAcceptSession(&session, this->handles[0]);
+        if (R_SUCCEEDED(rc)) {
+            // Check we have room
+            if (this->handles.size() + this->heldCount() >= this->maxHandles) {
+                Log::writeWarning("[IPC] Couldn't handle new session due to limit");
+                svcCloseHandle(session);
+
+            // Add session to vector
+            } else {
+                this->handles.push_back(session);
+            }
+
+            return true;
+        }
+
+        return false;
+    }
+
+    bool HipcServer::sendReply(const uint32_t client, Request * request) {
+        responseToTLS(request);
+        return R_SUCCEEDED(this->reply(client));
+    }
+
+    void HipcServer::resumeClient(const uint32_t client) {
+        this->handles.push_back(client);
+    }
+
+    void HipcServer::closeClient(const uint32_t client) {
+        svcCloseHandle(client);
+    }
+
+    bool HipcServer::process() {
+        if (this->error_) {
+            return false;
+        }
+
+        // Wait for a client to send a request/message, or until the first held reply is due
+        int32_t handleIndex;
+        ::Result rc = svcWaitSynchronization(&handleIndex, &this->handles[0], this->handles.size(), this->heldTimeout());
+        if (R_VALUE(rc) == KERNELRESULT(TimedOut)) {
+            this->processHeld();
+            return !this->error_;
+        }
+
+        if (R_SUCCEEDED(rc)) {
+            // Check we're within range
+            if (handleIndex < 0 || static_cast<uint32_t>(handleIndex) >= this->handles.size()) {
+                Log::writeError("[IPC] svcWaitSynchronization returned out of range index: " + std::to_string(handleIndex));
+                this->error_ = true;
+                return false;
+            }
+
+            // If the index is past the wake event then we need to handle that client's request
+            bool ok = true;
+            if (handleIndex > 1) {
+                ok = this->processSession(handleIndex);
+
+            // Recheck held requests if woken
+            } else if (handleIndex == 1) {
+                eventClear(&this->wakeEvent);
+                this->processHeld();
+
+            // Otherwise prepare for a new session
+            } else {
+                ok = this->processNewSession();
+            }
+
+            // Exit on an error
+            if (!ok) {
+                Log::writeInfo("[IPC] Failed to handle " + std::string(handleIndex == 0 ? "server" : "client " + std::to_string(handleIndex)) + " request");
+                this->error_ = true;
+            }
+        }
+
+        return !this->error_;
+    }
+
+    void HipcServer::wake() {
+        eventFire(&this->wakeEvent);
+    }
+
+    HipcServer::~HipcServer() {
+        // Close all client handles (including those with a held reply)
+        for (size_t i = 2; i < this->handles.size(); i++) {
+            svcCloseHandle(this->handles[i]);
+        }
+        this->closeHeld();
+
+        // Finally close the wake event and server handle
+        if (!this->handles.empty()) {
+            eventClose(&this->wakeEvent);
+            svcCloseHandle(this->handles[0]);
+            ::Result rc = smUnregisterService(this->serverName);
+            if (R_FAILED(rc)) {
+                Log::writeError("[IPC] Couldn't unregister server: " + std::to_string(rc));
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -1,112 +1,34 @@
 #include "ipc/Request.hpp"
 
-// IPC request header structure
-struct Header {
-    uint64_t magic;
-    union {
-        uint64_t cmdId;
-        uint64_t result;
-    };
-};
-
 namespace Ipc {
-    // Max bytes that fit in 'header'
-    constexpr size_t maxReplyBytes = 0x90 - sizeof(Header);
-
     Request::Request() {
-        // For my sanity
-        this->inArgs.clear();
-        this->inData.clear();
-        this->outArgs.clear();
-        this->outData.clear();
-        this->outMeta.clear();
-
-        // Set start positions to beginning of vectors
-        this->inArgsPos = 0;
-        this->inDataPos = 0;
-
-        // Set default attributes
-        this->cmd_ = 0;
-        this->result = 0;
-        this->type_ = Type::Other;
-    }
-
-    Request * Request::fromTLS() {
-        // Read structure from thread-local storage
-        uint8_t * base = static_cast<uint8_t *>(armGetTls());
-        HipcParsedRequest hipc = hipcParseRequest(base);
-
-        // Create object and set data/type
-        Request * req = new Request();
-        if (hipc.meta.type == CmifCommandType_Request) {
-            req->type_ = Type::Request;
-
-            // Validate header
-            Header * header = static_cast<Header *>(cmifGetAlignedDataStart(hipc.data.data_words, base));
-            size_t headerSize = hipc.meta.num_data_words * 4;
-            if (!header || headerSize < sizeof(Header) || header->magic != CMIF_IN_HEADER_MAGIC) {
-                // Delete object and return nullptr as a bad header is an error
-                delete req;
-                return nullptr;
-            }
-
-            // We appear to have a valid request, so copy relevant data
-            req->cmd_ = header->cmdId;
-            if (headerSize > sizeof(Header)) {
-                uint8_t * ptr = reinterpret_cast<uint8_t *>(header) + sizeof(Header);
-                size_t size = headerSize - sizeof(Header);
-                req->inArgs = std::vector<uint8_t>(ptr, ptr + size);
-            }
-
-        } else if (hipc.meta.type == CmifCommandType_Close) {
-            req->type_ = Type::Close;
-
-        } else {
-            req->type_ = Type::Other;
-        }
-
-        // Copy received data if there is some
-        if (hipc.meta.num_send_buffers > 0) {
-            uint8_t * ptr = static_cast<uint8_t *>(hipcGetBufferAddress(hipc.data.send_buffers));
-            size_t size = hipcGetBufferSize(hipc.data.send_buffers);
-            req->inData = std::vector<uint8_t>(ptr, ptr + size);
-        }
-
-        // Copy metadata about receiving buffers (avoid issues due to TLS overwrites)
-        for (size_t i = 0; i < hipc.meta.num_recv_buffers; i++) {
-            req->outMeta.push_back(hipc.data.recv_buffers[i]);
-        }
-
-        return req;
+        this->reset(Type::Other, 0, nullptr, 0, nullptr, 0, nullptr, 0);
     }
 
-    void Request::toResponseTLS() {
-        // First copy any reply data if it is present
-        if (!this->outData.empty() && !this->outMeta.empty()) {
-            size_t size = hipcGetBufferSize(&this->outMeta[0]);
-            if (this->outData.size() < size) {
-                size = this->outData.size();
-            }
-            std::memcpy(hipcGetBufferAddress(&this->outMeta[0]), &this->outData[0], size);
+    bool Request::reset(const Type type, const uint64_t cmd, const uint8_t * args, const size_t argsSize, const uint8_t * data, const size_t dataSize, uint8_t * reply, const size_t replySize) {
+        if (argsSize > this->inArgs.size()) {
+            return false;
         }
 
-        // Create response on thread-local storage
-        uint8_t * base = static_cast<uint8_t *>(armGetTls());
-        HipcRequest hipc = hipcMakeRequestInline(base,
-            .type = CmifCommandType_Request,
-            .num_data_words = static_cast<uint32_t>(sizeof(Header) + this->outArgs.size() + 0x10)/4,
-        );
-
-        // Create header
-        Header * header = static_cast<Header *>(cmifGetAlignedDataStart(hipc.data_words, base));
-        header->magic = CMIF_OUT_HEADER_MAGIC;
-        header->result = this->result;
-
-        // Append reply 'value'
-        if (R_SUCCEEDED(this->result) && !this->outArgs.empty()) {
-            size_t size = (maxReplyBytes < this->outArgs.size() ? maxReplyBytes : this->outArgs.size());
-            std::memcpy(reinterpret_cast<uint8_t *>(header) + sizeof(Header), &this->outArgs[0], size);
+        // Copy 'arguments' (as their memory may be reused) and point at the buffers
+        if (argsSize > 0) {
+            std::memcpy(this->inArgs.data(), args, argsSize);
         }
+        this->inArgsSize = argsSize;
+        this->inData = data;
+        this->inDataSize = dataSize;
+        this->outData = reply;
+        this->outDataCapacity = (reply == nullptr ? 0 : replySize);
+
+        // Set default attributes
+        this->cmd_ = cmd;
+        this->result_ = 0;
+        this->type_ = type;
+        this->hasDeadline = false;
+        this->deferred_ = false;
+        this->completed_ = false;
+        this->restart();
+        return true;
     }
 
     uint64_t Request::cmd() {
@@ -114,22 +36,92 @@ namespace Ipc {
     }
 
     void Request::setResult(const uint32_t r) {
-        this->result = r;
+        this->result_ = r;
+    }
+
+    uint32_t Request::result() {
+        return this->result_;
     }
 
     Request::Type Request::type() {
         return this->type_;
     }
 
-    const std::vector<uint8_t> & Request::getRequestBuffer() {
+    bool Request::hold(const uint64_t ms) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (!this->hasDeadline) {
+            this->deadline_ = now + std::chrono::milliseconds(ms);
+            this->hasDeadline = true;
+        }
+
+        this->held_ = (now < this->deadline_);
+        return this->held_;
+    }
+
+    bool Request::held() {
+        return this->held_;
+    }
+
+    std::chrono::steady_clock::time_point Request::deadline() {
+        return this->deadline_;
+    }
+
+    void Request::restart() {
+        this->inArgsPos = 0;
+        this->inDataPos = 0;
+        this->outArgsSize = 0;
+        this->outDataSize = 0;
+        this->outHandlesCount = 0;
+        this->held_ = false;
+    }
+
+    void Request::defer() {
+        this->deferred_ = true;
+        this->completed_ = false;
+    }
+
+    bool Request::deferred() {
+        return this->deferred_;
+    }
+
+    void Request::complete(const uint32_t r) {
+        this->result_ = r;
+        this->completed_.store(true, std::memory_order_release);
+    }
+
+    bool Request::completed() {
+        return this->completed_.load(std::memory_order_acquire);
+    }
+
+    const uint8_t * Request::requestData() {
         return this->inData;
     }
 
-    const std::vector<uint8_t> & Request::getReplyBuffer() {
-        return this->outData;
+    size_t Request::requestDataSize() {
+        return this->inDataSize;
+    }
+
+    size_t Request::replyBufferSize() {
+        return this->outDataCapacity;
+    }
+
+    size_t Request::replyDataSize() {
+        return this->outDataSize;
     }
 
-    Request::~Request() {
+    const uint8_t * Request::replyValue() {
+        return this->outArgs.data();
+    }
+
+    size_t Request::replyValueSize() {
+        return this->outArgsSize;
+    }
+
+    const uint32_t * Request::replyHandles() {
+        return this->outHandles.data();
+    }
 
+    size_t Request::replyHandleCount() {
+        return this->outHandlesCount;
     }
 };
\ No newline at end of file
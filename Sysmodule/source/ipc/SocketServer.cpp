@@ -0,0 +1,246 @@
+// Unix domain sockets are only used when running on a regular computer
+#ifndef __SWITCH__
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include "ipc/SocketServer.hpp"
+#include "Log.hpp"
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Ipc {
+    SocketServer::SocketServer(const std::string & path, const size_t maxClients) : Server(maxClients) {
+        this->path = path;
+        this->listenFd = -1;
+        this->wakeFds[0] = -1;
+        this->wakeFds[1] = -1;
+        this->maxClients = maxClients;
+
+        // Create pipe used to wake the server (non-blocking, as only whether it has data matters)
+        if (pipe(this->wakeFds) != 0) {
+            Log::writeError("[IPC] Couldn't create wake pipe: " + std::string(std::strerror(errno)));
+            this->error_ = true;
+            return;
+        }
+        fcntl(this->wakeFds[0], F_SETFL, O_NONBLOCK);
+        fcntl(this->wakeFds[1], F_SETFL, O_NONBLOCK);
+
+        // Create socket, replacing any left behind by a previous run
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.length() >= sizeof(addr.sun_path)) {
+            Log::writeError("[IPC] Socket path is too long: " + path);
+            this->error_ = true;
+            return;
+        }
+        std::strcpy(addr.sun_path, path.c_str());
+        unlink(path.c_str());
+
+        this->listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (this->listenFd < 0 || bind(this->listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(this->listenFd, maxClients) != 0) {
+            Log::writeError("[IPC] Couldn't create socket: " + std::string(std::strerror(errno)));
+            this->error_ = true;
+            return;
+        }
+
+        Log::writeSuccess("[IPC] Server started on " + path);
+    }
+
+    bool SocketServer::readAll(const int fd, void * buf, const size_t size) {
+        uint8_t * ptr = static_cast<uint8_t *>(buf);
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = read(fd, ptr + done, size - done);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            done += n;
+        }
+        return true;
+    }
+
+    bool SocketServer::writeAll(const int fd, const void * buf, const size_t size) {
+        const uint8_t * ptr = static_cast<const uint8_t *>(buf);
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = send(fd, ptr + done, size - done, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            done += n;
+        }
+        return true;
+    }
+
+    bool SocketServer::processClient(const size_t index) {
+        int fd = this->clients[index];
+
+        // Read header, closing the connection if the client has gone or sent something unexpected
+        SocketRequestHeader header;
+        if (!this->readAll(fd, &header, sizeof(header)) || header.magic != SocketRequestMagic || header.close) {
+            this->clients.erase(this->clients.begin() + index);
+            this->closeClient(fd);
+            return true;
+        }
+        if (header.argsSize > SocketMaxArgsSize || header.dataSize > SocketMaxDataSize) {
+            Log::writeError("[IPC] Received oversized request (closing socket)");
+            this->clients.erase(this->clients.begin() + index);
+            this->closeClient(fd);
+            return true;
+        }
+
+        // Read 'arguments' and data into the client's buffers (which only allocate when a message is larger than before)
+        Buffers & buf = this->buffers[fd];
+        buf.args.resize(header.argsSize);
+        buf.data.resize(header.dataSize);
+        buf.reply.resize(std::min(header.replySize, SocketMaxDataSize));
+        if (!this->readAll(fd, buf.args.data(), buf.args.size()) || !this->readAll(fd, buf.data.data(), buf.data.size())) {
+            this->clients.erase(this->clients.begin() + index);
+            this->closeClient(fd);
+            return true;
+        }
+
+        Request * request = this->takeRequest();
+        if (!request) {
+            Log::writeError("[IPC] No request available for client (closing socket)");
+            this->clients.erase(this->clients.begin() + index);
+            this->closeClient(fd);
+            return true;
+        }
+        request->reset(Request::Type::Request, header.cmd, buf.args.data(), buf.args.size(), buf.data.data(), buf.data.size(), buf.reply.data(), buf.reply.size());
+
+        // Stop waiting on the client if the reply is held, as it can't send anything until it's replied to
+        if (this->handleRequest(fd, request)) {
+            this->clients.erase(this->clients.begin() + index);
+            return true;
+        }
+
+        bool ok = this->sendReply(fd, request);
+        this->returnRequest(request);
+        if (!ok) {
+            this->clients.erase(this->clients.begin() + index);
+            this->closeClient(fd);
+        }
+        return true;
+    }
+
+    void SocketServer::processNewClient() {
+        int fd = accept(this->listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+
+        // Check we have room
+        if (this->clients.size() + this->heldCount() >= this->maxClients) {
+            Log::writeWarning("[IPC] Couldn't handle new client due to limit");
+            close(fd);
+            return;
+        }
+        this->clients.push_back(fd);
+    }
+
+    bool SocketServer::sendReply(const uint32_t client, Request * request) {
+        // Handles only mean something on the console
+        if (request->replyHandleCount() > 0) {
+            request->setResult(static_cast<uint32_t>(Result::Unknown));
+        }
+
+        // Only send the 'value' and data if successful
+        bool ok = (request->result() == 0);
+        SocketReplyHeader header;
+        header.magic = SocketReplyMagic;
+        header.result = request->result();
+        header.valueSize = (ok ? request->replyValueSize() : 0);
+        header.dataSize = (ok ? request->replyDataSize() : 0);
+        return (this->writeAll(client, &header, sizeof(header)) && this->writeAll(client, request->replyValue(), header.valueSize) && this->writeAll(client, this->buffers[client].reply.data(), header.dataSize));
+    }
+
+    void SocketServer::resumeClient(const uint32_t client) {
+        this->clients.push_back(client);
+    }
+
+    void SocketServer::closeClient(const uint32_t client) {
+        this->buffers.erase(client);
+        close(client);
+    }
+
+    bool SocketServer::process() {
+        if (this->error_) {
+            return false;
+        }
+
+        // Wait for a client to send a request, or until the first held reply is due
+        std::vector<pollfd> fds;
+        fds.push_back(pollfd{this->listenFd, POLLIN, 0});
+        fds.push_back(pollfd{this->wakeFds[0], POLLIN, 0});
+        for (int fd : this->clients) {
+            fds.push_back(pollfd{fd, POLLIN, 0});
+        }
+        uint64_t ns = this->heldTimeout();
+        int timeout = (ns == UINT64_MAX ? -1 : static_cast<int>(std::min<uint64_t>((ns + 999999)/1000000, INT32_MAX)));
+        int count = poll(fds.data(), fds.size(), timeout);
+        if (count < 0) {
+            if (errno != EINTR) {
+                Log::writeError("[IPC] poll failed: " + std::string(std::strerror(errno)));
+                this->error_ = true;
+            }
+            return !this->error_;
+        }
+
+        // Recheck held requests if woken or one is due
+        if (count == 0 || fds[1].revents) {
+            uint8_t tmp[64];
+            while (read(this->wakeFds[0], tmp, sizeof(tmp)) > 0);
+            this->processHeld();
+        }
+
+        // Handle clients' requests, going backwards as they're removed from the vector when closed/held
+        for (size_t i = fds.size(); i > 2; i--) {
+            if (fds[i-1].revents) {
+                this->processClient(i-3);
+            }
+        }
+
+        // Finally accept new clients
+        if (fds[0].revents) {
+            this->processNewClient();
+        }
+        return !this->error_;
+    }
+
+    void SocketServer::wake() {
+        uint8_t tmp = 0;
+        if (write(this->wakeFds[1], &tmp, 1) < 0) {
+            // Pipe is full, so the server will be woken anyway
+        }
+    }
+
+    SocketServer::~SocketServer() {
+        for (int fd : this->clients) {
+            close(fd);
+        }
+        this->closeHeld();
+
+        if (this->listenFd >= 0) {
+            close(this->listenFd);
+            unlink(this->path.c_str());
+        }
+        if (this->wakeFds[0] >= 0) {
+            close(this->wakeFds[0]);
+            close(this->wakeFds[1]);
+        }
+    }
+};
+
+#endif
\ No newline at end of file
@@ -1,89 +1,66 @@
-#include <cstdlib>
-#include <cstring>
 #include "Log.hpp"
 #include "nx/Audio.hpp"
 #include "nx/NX.hpp"
-#include <switch.h>
+#ifdef __SWITCH__
+#include "sinks/AudrenSink.hpp"
+#else
+#include "sinks/NullSink.hpp"
+#endif
 
-constexpr size_t bufferSize = 0xC800;       // Size of each buffer (50kB)
-constexpr size_t maxBuffers = 6;            // Maximum number of buffer slots (50KB * 6 = 300KB)
-constexpr size_t outputChannels = 2;        // Number of channels to output (should always be 2)
+constexpr size_t maxBufferMemory = 0x96000; // Maximum memory used by all buffers combined (600kB)
+constexpr size_t minBuffers = 2;            // Minimum number of buffer slots (one playing while the other is filled)
 
 Audio * Audio::instance = nullptr;          // Our singleton instance
-static AudioDriver drv;                     // Audio output driver (should be safe as this is a singleton class)
-
-// Real size of a buffer due to alignment
-constexpr size_t realSize = ((bufferSize + (AUDREN_MEMPOOL_ALIGNMENT - 1)) &~ (AUDREN_MEMPOOL_ALIGNMENT - 1));
+AudioSink * Audio::nextSink = nullptr;      // Sink provided before creation
+size_t Audio::nextBufferCount = 6;          // Number of buffer slots (50kB * 6 = 300kB)
+size_t Audio::nextBufferSize = 0xC800;      // Size of each buffer (50kB)
 
 Audio::Audio() {
+    this->bufferCount_ = Audio::nextBufferCount;
+    this->channels = 0;
+    this->claimedBuf = -1;
+    this->gap = 0;
+    this->minQueued = -1;
     this->nextBuf = 0;
-    this->waveBuf = nullptr;
+    this->queuedSamples = 0;
+    this->rate = 0;
+    this->transition = false;
     this->action = Status::Stopped;
     this->exit_ = true;
-    this->memPool = nullptr;
     this->sampleOffset = 0;
-    this->sink = -1;
+    this->songStart = 0;
+    this->starved = false;
     this->status_ = Status::Stopped;
     this->success = true;
-    this->voice = -1;
+    this->underruns_ = 0;
+    this->voice = false;
     this->vol = 100.0;
 
-    // Create the driver
-    constexpr AudioRendererConfig audrenCfg = {
-        .output_rate     = AudioRendererOutputRate_48kHz,
-        .num_voices      = 4,
-        .num_effects     = 0,
-        .num_sinks       = 1,
-        .num_mix_objs    = 1,
-        .num_mix_buffers = 2,
-    };
-    Result rc = audrvCreate(&drv, &audrenCfg, outputChannels);
-    if (R_FAILED(rc)) {
-        this->success = false;
-        Log::writeError("[AUDIO] Unable to create driver!");
+    // Use the provided sink, otherwise output to the device
+    this->sink = Audio::nextSink;
+    Audio::nextSink = nullptr;
+    if (this->sink == nullptr) {
+#ifdef __SWITCH__
+        this->sink = new AudrenSink();
+#else
+        this->sink = new NullSink();
+#endif
     }
-
-    // Create wave buffers
-    this->waveBuf = new AudioDriverWaveBuf[maxBuffers];
-    if (this->waveBuf == nullptr) {
-        delete[] this->waveBuf;
+    if (!this->sink->valid()) {
         this->success = false;
-        Log::writeError("[AUDIO] Unable to allocate memory for buffers!");
+        Log::writeError("[AUDIO] Unable to prepare output!");
     }
 
-    // Allocate memory pool and align
+    // Create buffers
     if (this->success) {
-        this->memPool = new uint8_t *[maxBuffers];
-        bool error = false;
-        for (size_t i = 0; i < maxBuffers; i++) {
-            this->memPool[i] = static_cast<uint8_t *>(aligned_alloc(AUDREN_MEMPOOL_ALIGNMENT, realSize));
-            if (this->memPool[i] == nullptr) {
-                error = true;
-                break;
-            }
-        }
-
-        if (error) {
+        if (!this->sink->createBuffers(this->bufferCount_, Audio::nextBufferSize)) {
             this->success = false;
-            for (size_t i = 0; i < maxBuffers; i++) {
-                free(this->memPool[i]);
-            }
-            delete[] this->memPool;
-            delete[] this->waveBuf;
-            audrvClose(&drv);
-            Log::writeError("[AUDIO] Unable to allocate memory pool (size: " + std::to_string(maxBuffers) + "x" + std::to_string(realSize) + ")");
+            Log::writeError("[AUDIO] Unable to allocate memory for buffers!");
         }
+        Log::writeInfo("[AUDIO] Using " + std::to_string(this->bufferCount_) + " buffers of " + std::to_string(Audio::nextBufferSize) + " bytes");
     }
 
-    // Register memory pools with driver and set sink
     if (this->success) {
-        for (size_t i = 0; i < maxBuffers; i++) {
-            int id = audrvMemPoolAdd(&drv, this->memPool[i], realSize);
-            audrvMemPoolAttach(&drv, id);
-        }
-        const uint8_t sinkChannels[outputChannels] = {0, 1};
-        this->sink = audrvDeviceSinkAdd(&drv, AUDREN_DEFAULT_DEVICE_NAME, 2, sinkChannels);
-        audrvUpdate(&drv);
         this->exit_ = false;
         Log::writeSuccess("[AUDIO] Audio object created successfully");
     }
@@ -96,6 +73,48 @@ Audio * Audio::getInstance() {
     return Audio::instance;
 }
 
+void Audio::setSink(AudioSink * sink) {
+    if (Audio::instance != nullptr) {
+        Log::writeWarning("[AUDIO] Sink provided after creation, ignoring");
+        delete sink;
+        return;
+    }
+
+    delete Audio::nextSink;
+    Audio::nextSink = sink;
+}
+
+void Audio::setBuffers(size_t count, size_t size) {
+    if (Audio::instance != nullptr) {
+        Log::writeWarning("[AUDIO] Buffers set after creation, ignoring");
+        return;
+    }
+
+    // Buffers must hold whole stereo samples
+    size -= size % (2 * sizeof(int16_t));
+    if (size == 0) {
+        Log::writeWarning("[AUDIO] Invalid buffer size, ignoring");
+        return;
+    }
+
+    // Drop buffers until they fit within the memory limit
+    if (count < minBuffers) {
+        count = minBuffers;
+    }
+    if (count * size > maxBufferMemory) {
+        size_t fit = maxBufferMemory/size;
+        if (fit < minBuffers) {
+            Log::writeWarning("[AUDIO] Buffers are too large (" + std::to_string(size) + " bytes), ignoring");
+            return;
+        }
+        Log::writeWarning("[AUDIO] Too much memory required for " + std::to_string(count) + " buffers, using " + std::to_string(fit));
+        count = fit;
+    }
+
+    Audio::nextBufferCount = count;
+    Audio::nextBufferSize = size;
+}
+
 bool Audio::initialized() {
     return this->success;
 }
@@ -104,79 +123,125 @@ void Audio::exit() {
     this->exit_ = true;
 }
 
-void Audio::newSong(long rate, int channels) {
+void Audio::newSong(long rate, int channels, bool gapless) {
+    // Keep the voice (and any queued buffers) if possible
+    if (gapless && this->sameFormat(rate, channels)) {
+        std::scoped_lock<std::mutex> mtx(this->mutex);
+        this->sampleOffset = 0;
+        this->songStart = this->queuedSamples;
+        this->transition = true;
+        Log::writeInfo("[AUDIO] Continuing with current voice");
+        return;
+    }
+
+    // Only mark the time of the switch if the previous song was cut off
     this->stop();
     std::scoped_lock<std::mutex> mtx(this->mutex);
+    if (!gapless) {
+        this->drainTime = std::chrono::steady_clock::now();
+    }
     this->sampleOffset = 0;
+    this->transition = true;
 
     // Drop previous voice
-    if (this->voice >= 0) {
-        audrvVoiceDrop(&drv, this->voice);
-        audrvUpdate(&drv);
-        this->voice = -1;
+    if (this->voice) {
+        this->sink->closeVoice();
+        this->voice = false;
     }
 
     // Create voice matching rate and channels
     this->channels = channels;
-    this->voice = 0;
-    bool b = audrvVoiceInit(&drv, this->voice, this->channels, PcmFormat_Int16, rate);
-    if (!b) {
-        this->voice = -1;
+    this->rate = rate;
+    this->voice = this->sink->openVoice(rate, channels);
+    if (!this->voice) {
         Log::writeError("[AUDIO] Failed to init a new voice!");
     } else {
-        // Set volume levels
-        audrvVoiceSetDestinationMix(&drv, this->voice, AUDREN_FINAL_MIX_ID);
-        if (this->channels == 1) {
-            // Mono audio
-            audrvVoiceSetMixFactor(&drv, this->voice, 1.0f, 0, 0);
-            audrvVoiceSetMixFactor(&drv, this->voice, 1.0f, 0, 1);
-        } else {
-            // Stereo-o-o
-            audrvVoiceSetMixFactor(&drv, this->voice, 1.0f, 0, 0);
-            audrvVoiceSetMixFactor(&drv, this->voice, 0.0f, 0, 1);
-            audrvVoiceSetMixFactor(&drv, this->voice, 0.0f, 1, 0);
-            audrvVoiceSetMixFactor(&drv, this->voice, 1.0f, 1, 1);
-        }
         Log::writeInfo("[AUDIO] Created a new voice");
     }
     Log::writeInfo("[AUDIO] Rate: " + std::to_string(rate) +  ", Channels: " + std::to_string(channels));
 }
 
-void Audio::addBuffer(uint8_t * buf, size_t sz) {
-    // Ensure appropriate size and a buffer is available
-    if (sz > realSize || sz == 0 || !this->bufferAvailable()) {
-        return;
+bool Audio::sameFormat(long rate, int channels) {
+    std::scoped_lock<std::mutex> mtx(this->mutex);
+    return (this->voice && this->rate == rate && this->channels == channels);
+}
+
+int Audio::transitionGap() {
+    return this->gap;
+}
+
+uint8_t * Audio::claimBuffer() {
+    // Hand out the next slot only if it isn't queued
+    std::scoped_lock<std::mutex> mtx(this->mutex);
+    if (!this->sink->bufferDone(this->nextBuf)) {
+        this->claimedBuf = -1;
+        return nullptr;
     }
 
-    // Copy contents into mempool
+    this->claimedBuf = this->nextBuf;
+    return this->sink->buffer(this->claimedBuf);
+}
+
+void Audio::queueBuffer(size_t sz) {
+    // Ensure appropriate size and a buffer was claimed
     std::scoped_lock<std::mutex> mtx(this->mutex);
-    std::memcpy(this->memPool[this->nextBuf], buf, sz);
-    armDCacheFlush(this->memPool[this->nextBuf], sz);
+    if (sz > this->sink->bufferSize() || sz == 0 || this->claimedBuf < 0 || !this->voice) {
+        this->claimedBuf = -1;
+        return;
+    }
+
+    // Data was decoded in place, so it only needs to be handed to the sink
+    int idx = this->claimedBuf;
+    this->claimedBuf = -1;
+
+    // Track how close the voice came to running out before this buffer arrived
+    if (this->status_ == Status::Playing) {
+        int left = static_cast<int32_t>(this->queuedSamples - this->sink->playedSamples());
+        if (this->minQueued < 0 || left < this->minQueued) {
+            this->minQueued = left;
+        }
 
-    // Fill relevant waveBuf
-    this->waveBuf[this->nextBuf].data_raw = this->memPool[nextBuf];
-    this->waveBuf[this->nextBuf].size = sz;
-    this->waveBuf[this->nextBuf].start_sample_offset = 0;
-    this->waveBuf[this->nextBuf].end_sample_offset = sz/(2 * this->channels);
-    audrvVoiceAddWaveBuf(&drv, this->voice, &this->waveBuf[this->nextBuf]);
+    // Running out before the first buffer of a new song is expected, otherwise audio was interrupted
+    } else if (this->status_ == Status::Stopped && this->starved && !this->transition) {
+        this->underruns_++;
+        Log::writeWarning("[AUDIO] Ran out of buffers during playback (underruns: " + std::to_string(this->underruns_) + ")");
+    }
+    this->starved = false;
+    this->sink->queueBuffer(idx, sz);
+    this->queuedSamples += sz/(2 * this->channels);
+
+    // Measure the silence between songs if this is the first buffer of a new one
+    if (this->transition) {
+        this->gap = 0;
+        if (this->status_ == Status::Stopped) {
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->drainTime).count();
+            this->gap = secs * this->rate;
+        }
+        this->transition = false;
+        Log::writeInfo("[AUDIO] Transition gap: " + std::to_string(this->gap) + " samples");
+    }
 
-    // Move to next buffer
-    this->nextBuf = (this->nextBuf + 1) % maxBuffers;
+    // Move to next buffer (relative to the claimed one in case stop() reset the index)
+    this->nextBuf = (idx + 1) % this->bufferCount_;
 
     // Indicate playing
     if (this->status_ == Status::Stopped) {
-        audrvVoiceStart(&drv, this->voice);
+        this->sink->start();
         this->status_ = Status::Playing;
     }
 }
 
 bool Audio::bufferAvailable() {
     std::scoped_lock<std::mutex> mtx(this->mutex);
-    return (this->waveBuf[this->nextBuf].state == AudioDriverWaveBufState_Done);
+    return this->sink->bufferDone(this->nextBuf);
 }
 
 size_t Audio::bufferSize() {
-    return realSize;
+    return this->sink->bufferSize();
+}
+
+size_t Audio::bufferCount() {
+    return this->bufferCount_;
 }
 
 void Audio::resume() {
@@ -189,17 +254,17 @@ void Audio::pause() {
 
 void Audio::stop() {
     std::scoped_lock<std::mutex> mtx(this->mutex);
-    if (this->voice >= 0) {
-        this->sampleOffset += audrvVoiceGetPlayedSampleCount(&drv, this->voice);
-        audrvVoiceStop(&drv, this->voice);
-        audrvUpdate(&drv);
+    if (this->voice) {
+        this->sampleOffset += static_cast<int32_t>(this->sink->playedSamples() - this->songStart);
     }
-
-    // Indicate buffers are 'empty'
-    for (size_t i = 0; i < maxBuffers; i++) {
-        this->waveBuf[i].state = AudioDriverWaveBufState_Done;
+    this->songStart = 0;
+    this->sink->stop();
+    if (this->status_ != Status::Stopped) {
+        this->drainTime = std::chrono::steady_clock::now();
     }
+    this->queuedSamples = 0;
     this->nextBuf = 0;
+    this->starved = false;
     this->status_ = Status::Stopped;
 }
 
@@ -208,17 +273,28 @@ Audio::Status Audio::status() {
 }
 
 int Audio::samplesPlayed() {
-    if (this->voice < 0) {
-        return this->sampleOffset;
+    if (!this->voice) {
+        return (this->sampleOffset < 0 ? 0 : this->sampleOffset.load());
     }
 
+    // Offset is negative while the end of the previous song is still playing
     std::scoped_lock<std::mutex> mtx(this->mutex);
-    return (this->sampleOffset + audrvVoiceGetPlayedSampleCount(&drv, this->voice));
+    int played = this->sampleOffset + static_cast<int32_t>(this->sink->playedSamples() - this->songStart);
+    return (played < 0 ? 0 : played);
 }
 
 void Audio::setSamplesPlayed(int s) {
     std::scoped_lock<std::mutex> mtx(this->mutex);
     this->sampleOffset = s;
+    this->songStart = 0;
+}
+
+size_t Audio::underruns() {
+    return this->underruns_;
+}
+
+int Audio::minQueuedSamples() {
+    return this->minQueued;
 }
 
 double Audio::volume() {
@@ -233,7 +309,7 @@ void Audio::setVolume(double v) {
 
     std::scoped_lock<std::mutex> mtx(this->mutex);
     this->vol = v;
-    audrvMixSetVolume(&drv, this->sink, this->vol/100.0);
+    this->sink->setVolume(this->vol/100.0);
     Log::writeInfo("[AUDIO] Volume set to " + std::to_string(this->vol));
 }
 
@@ -243,22 +319,24 @@ void Audio::process() {
             case Status::Playing: {
                 // Check if we actually need to update
                 std::unique_lock<std::mutex> mtx(this->mutex);
-                int lastBuf = ((this->nextBuf - 1) < 0 ? maxBuffers-1 : this->nextBuf - 1);
-                if (this->waveBuf[lastBuf].state != AudioDriverWaveBufState_Done) {
-                    audrvUpdate(&drv);
-                    audrenWaitFrame();
+                int lastBuf = ((this->nextBuf - 1) < 0 ? this->bufferCount_ - 1 : this->nextBuf - 1);
+                if (!this->sink->bufferDone(lastBuf)) {
+                    this->sink->update();
                 }
 
                 // Check if we need to move to stopped state (no more buffers)
-                if (this->waveBuf[lastBuf].state == AudioDriverWaveBufState_Done) {
+                if (this->sink->bufferDone(lastBuf)) {
                     mtx.unlock();
                     this->stop();
+                    this->starved = true;
                 }
 
                 // Check if we need to pause
                 if (this->action == Status::Paused) {
-                    audrvVoiceSetPaused(&drv, this->voice, true);
-                    audrvUpdate(&drv);
+                    if (!mtx.owns_lock()) {
+                        mtx.lock();
+                    }
+                    this->sink->setPaused(true);
                     this->status_ = Status::Paused;
                     this->action = Status::Stopped;
                 }
@@ -269,8 +347,7 @@ void Audio::process() {
                 // Check if we need to resume
                 if (this->action == Status::Playing) {
                     std::unique_lock<std::mutex> mtx(this->mutex);
-                    audrvVoiceSetPaused(&drv, this->voice, false);
-                    audrvUpdate(&drv);
+                    this->sink->setPaused(false);
                     this->status_ = Status::Playing;
                     this->action = Status::Stopped;
                     break;
@@ -285,20 +362,6 @@ void Audio::process() {
 }
 
 Audio::~Audio() {
-    if (this->success) {
-        // Drop voice
-        if (this->voice >= 0) {
-            audrvVoiceStop(&drv, this->voice);
-            audrvVoiceDrop(&drv, this->voice);
-        }
-
-        // Free stuff
-        for (size_t i = 0; i < maxBuffers; i++) {
-            free(this->memPool[i]);
-        }
-        delete[] this->memPool;
-        audrvClose(&drv);
-        delete[] this->waveBuf;
-    }
+    delete this->sink;
     Audio::instance = nullptr;
 }
\ No newline at end of file
@@ -230,6 +230,20 @@ namespace NX {
         return this->offset;
     }
 
+    off_t File::tell() {
+        if (this->error) {
+            return -1;
+        }
+        return this->offset;
+    }
+
+    int64_t File::length() {
+        if (this->error) {
+            return -1;
+        }
+        return this->size;
+    }
+
     File::~File() {
         // Join fill thread
         this->stopThread = true;
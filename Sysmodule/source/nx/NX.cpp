@@ -1,8 +1,10 @@
+#include "Config.hpp"
 #include "Log.hpp"
 #include "nx/Audio.hpp"
 #include "nx/File.hpp"
 #include "nx/NX.hpp"
 #include <mutex>
+#include "Paths.hpp"
 #include <switch.h>
 #include <thread>
 #include <unordered_map>
@@ -74,6 +76,11 @@ namespace NX {
         };
         rc = audrenInitialize(&audrenCfg);
         if (R_SUCCEEDED(rc)) {
+            // Buffers can't be resized once created, so they're read from the config here
+            Config * cfg = new Config(Path::Sys::ConfigFile);
+            Audio::setBuffers(cfg->bufferCount(), cfg->bufferSize() * 1024);
+            delete cfg;
+
             Audio * audio = Audio::getInstance();
             audrenStartAudioRenderer();
             audrenInitialized = audio->initialized();
@@ -344,6 +351,42 @@ namespace NX {
         }
     };
 
+    namespace Shmem {
+        static SharedMemory shmem;                                  // Created memory
+        static bool shmemCreated = false;                           // Set true once created and mapped
+
+        void * create(const size_t size, uint32_t & handle) {
+            // Prevent creating twice
+            if (shmemCreated) {
+                handle = shmemGetHandle(&shmem);
+                return shmemGetAddr(&shmem);
+            }
+
+            Result rc = shmemCreate(&shmem, size, Perm_Rw, Perm_R);
+            if (R_FAILED(rc)) {
+                logError("shared memory", rc);
+                return nullptr;
+            }
+            rc = shmemMap(&shmem);
+            if (R_FAILED(rc)) {
+                logError("shared memory", rc);
+                shmemClose(&shmem);
+                return nullptr;
+            }
+
+            shmemCreated = true;
+            handle = shmemGetHandle(&shmem);
+            return shmemGetAddr(&shmem);
+        }
+
+        void destroy() {
+            if (shmemCreated) {
+                shmemClose(&shmem);
+                shmemCreated = false;
+            }
+        }
+    };
+
     // I wanted to use libnx's API for threads but apparently that causes a Data Abort when a thread's
     // function returns (like literally after the last line)
     namespace Thread {
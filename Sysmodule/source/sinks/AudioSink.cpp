@@ -0,0 +1,13 @@
+#include "sinks/AudioSink.hpp"
+
+AudioSink::AudioSink() {
+    this->valid_ = true;
+}
+
+bool AudioSink::valid() {
+    return this->valid_;
+}
+
+AudioSink::~AudioSink() {
+
+}
\ No newline at end of file
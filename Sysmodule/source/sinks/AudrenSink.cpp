@@ -0,0 +1,204 @@
+#include <cstdlib>
+#include "Log.hpp"
+#include "sinks/AudrenSink.hpp"
+#include <string>
+#include <switch.h>
+
+constexpr size_t outputChannels = 2;        // Number of channels to output (should always be 2)
+
+static AudioDriver drv;                     // Audio output driver (only one object should exist)
+
+AudrenSink::AudrenSink() : AudioSink() {
+    this->channels = 0;
+    this->memPool = nullptr;
+    this->numBuffers = 0;
+    this->realSize = 0;
+    this->sink = -1;
+    this->voice = -1;
+    this->waveBuf = nullptr;
+
+    // Create the driver
+    constexpr AudioRendererConfig audrenCfg = {
+        .output_rate     = AudioRendererOutputRate_48kHz,
+        .num_voices      = 4,
+        .num_effects     = 0,
+        .num_sinks       = 1,
+        .num_mix_objs    = 1,
+        .num_mix_buffers = 2,
+    };
+    Result rc = audrvCreate(&drv, &audrenCfg, outputChannels);
+    if (R_FAILED(rc)) {
+        this->valid_ = false;
+        Log::writeError("[AUDIO] Unable to create driver!");
+    }
+}
+
+void AudrenSink::freeBuffers() {
+    if (this->memPool != nullptr) {
+        for (size_t i = 0; i < this->numBuffers; i++) {
+            free(this->memPool[i]);
+        }
+    }
+    delete[] this->memPool;
+    delete[] this->waveBuf;
+    this->memPool = nullptr;
+    this->waveBuf = nullptr;
+    this->numBuffers = 0;
+}
+
+bool AudrenSink::createBuffers(size_t count, size_t size) {
+    if (!this->valid_ || this->memPool != nullptr) {
+        return false;
+    }
+
+    // Create wave buffers
+    this->waveBuf = new AudioDriverWaveBuf[count];
+    if (this->waveBuf == nullptr) {
+        Log::writeError("[AUDIO] Unable to allocate memory for buffers!");
+        return false;
+    }
+
+    // Allocate memory pool and align
+    this->realSize = ((size + (AUDREN_MEMPOOL_ALIGNMENT - 1)) &~ (AUDREN_MEMPOOL_ALIGNMENT - 1));
+    this->memPool = new uint8_t *[count]();
+    this->numBuffers = count;
+    for (size_t i = 0; i < count; i++) {
+        this->memPool[i] = static_cast<uint8_t *>(aligned_alloc(AUDREN_MEMPOOL_ALIGNMENT, this->realSize));
+        if (this->memPool[i] == nullptr) {
+            this->freeBuffers();
+            Log::writeError("[AUDIO] Unable to allocate memory pool (size: " + std::to_string(count) + "x" + std::to_string(this->realSize) + ")");
+            return false;
+        }
+        this->waveBuf[i].state = AudioDriverWaveBufState_Done;
+    }
+
+    // Register memory pools with driver and set sink
+    for (size_t i = 0; i < count; i++) {
+        int id = audrvMemPoolAdd(&drv, this->memPool[i], this->realSize);
+        audrvMemPoolAttach(&drv, id);
+    }
+    const uint8_t sinkChannels[outputChannels] = {0, 1};
+    this->sink = audrvDeviceSinkAdd(&drv, AUDREN_DEFAULT_DEVICE_NAME, 2, sinkChannels);
+    audrvUpdate(&drv);
+    return true;
+}
+
+uint8_t * AudrenSink::buffer(size_t idx) {
+    return this->memPool[idx];
+}
+
+size_t AudrenSink::bufferSize() {
+    return this->realSize;
+}
+
+bool AudrenSink::openVoice(long rate, int channels) {
+    this->closeVoice();
+
+    // Create voice matching rate and channels
+    this->channels = channels;
+    this->voice = 0;
+    bool b = audrvVoiceInit(&drv, this->voice, channels, PcmFormat_Int16, rate);
+    if (!b) {
+        this->voice = -1;
+        Log::writeError("[AUDIO] Failed to init a new voice!");
+        return false;
+    }
+
+    // Set volume levels
+    audrvVoiceSetDestinationMix(&drv, this->voice, AUDREN_FINAL_MIX_ID);
+    if (channels == 1) {
+        // Mono audio
+        audrvVoiceSetMixFactor(&drv, this->voice, 1.0f, 0, 0);
+        audrvVoiceSetMixFactor(&drv, this->voice, 1.0f, 0, 1);
+    } else {
+        // Stereo-o-o
+        audrvVoiceSetMixFactor(&drv, this->voice, 1.0f, 0, 0);
+        audrvVoiceSetMixFactor(&drv, this->voice, 0.0f, 0, 1);
+        audrvVoiceSetMixFactor(&drv, this->voice, 0.0f, 1, 0);
+        audrvVoiceSetMixFactor(&drv, this->voice, 1.0f, 1, 1);
+    }
+    return true;
+}
+
+void AudrenSink::closeVoice() {
+    if (this->voice >= 0) {
+        audrvVoiceDrop(&drv, this->voice);
+        audrvUpdate(&drv);
+        this->voice = -1;
+    }
+}
+
+void AudrenSink::queueBuffer(size_t idx, size_t sz) {
+    if (this->voice < 0) {
+        return;
+    }
+
+    // Data was decoded in place, so it only needs to be flushed
+    armDCacheFlush(this->memPool[idx], sz);
+
+    // Fill relevant waveBuf (samples are always 16 bit)
+    this->waveBuf[idx].data_raw = this->memPool[idx];
+    this->waveBuf[idx].size = sz;
+    this->waveBuf[idx].start_sample_offset = 0;
+    this->waveBuf[idx].end_sample_offset = sz/(2 * this->channels);
+    audrvVoiceAddWaveBuf(&drv, this->voice, &this->waveBuf[idx]);
+}
+
+bool AudrenSink::bufferDone(size_t idx) {
+    return (this->waveBuf[idx].state == AudioDriverWaveBufState_Done);
+}
+
+void AudrenSink::start() {
+    if (this->voice >= 0) {
+        audrvVoiceStart(&drv, this->voice);
+    }
+}
+
+void AudrenSink::stop() {
+    if (this->voice >= 0) {
+        audrvVoiceStop(&drv, this->voice);
+        audrvUpdate(&drv);
+    }
+
+    // Indicate buffers are 'empty'
+    for (size_t i = 0; i < this->numBuffers; i++) {
+        this->waveBuf[i].state = AudioDriverWaveBufState_Done;
+    }
+}
+
+void AudrenSink::setPaused(bool paused) {
+    if (this->voice >= 0) {
+        audrvVoiceSetPaused(&drv, this->voice, paused);
+        audrvUpdate(&drv);
+    }
+}
+
+uint32_t AudrenSink::playedSamples() {
+    if (this->voice < 0) {
+        return 0;
+    }
+    return audrvVoiceGetPlayedSampleCount(&drv, this->voice);
+}
+
+void AudrenSink::setVolume(double v) {
+    audrvMixSetVolume(&drv, this->sink, v);
+}
+
+void AudrenSink::update() {
+    audrvUpdate(&drv);
+    audrenWaitFrame();
+}
+
+AudrenSink::~AudrenSink() {
+    if (this->valid_) {
+        // Drop voice
+        if (this->voice >= 0) {
+            audrvVoiceStop(&drv, this->voice);
+            audrvVoiceDrop(&drv, this->voice);
+        }
+
+        // Free stuff
+        this->freeBuffers();
+        audrvClose(&drv);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cstdint>
+#include "sinks/NullSink.hpp"
+#include <thread>
+
+constexpr long frameMs = 5;                 // Length of an update (close to an audren frame)
+
+NullSink::NullSink() : AudioSink() {
+    this->carry = 0.0;
+    this->channels = 0;
+    this->paced = true;
+    this->paused = false;
+    this->played = 0;
+    this->playedFront = 0;
+    this->playing = false;
+    this->rate = 0;
+    this->size = 0;
+}
+
+void NullSink::advance(size_t samples) {
+    while (samples > 0 && !this->order.empty()) {
+        // Play as much of the oldest buffer as possible
+        std::pair<size_t, size_t> & front = this->order.front();
+        size_t total = front.second/(2 * this->channels);
+        size_t take = std::min(samples, total - this->playedFront);
+        this->played += take;
+        this->playedFront += take;
+        samples -= take;
+
+        // Mark it as done once played
+        if (static_cast<size_t>(this->playedFront) >= total) {
+            this->consume(this->buffers[front.first], front.second);
+            this->queued[front.first] = false;
+            this->playedFront = 0;
+            this->order.pop_front();
+        }
+    }
+}
+
+void NullSink::consume(const uint8_t * buf, size_t sz) {
+    // Nothing to do with the audio
+}
+
+bool NullSink::createBuffers(size_t count, size_t size) {
+    if (!this->buffers.empty()) {
+        return false;
+    }
+
+    this->size = size;
+    for (size_t i = 0; i < count; i++) {
+        this->buffers.push_back(new uint8_t[size]);
+    }
+    this->queued.assign(count, false);
+    return true;
+}
+
+uint8_t * NullSink::buffer(size_t idx) {
+    return this->buffers[idx];
+}
+
+size_t NullSink::bufferSize() {
+    return this->size;
+}
+
+bool NullSink::openVoice(long rate, int channels) {
+    this->closeVoice();
+    this->channels = channels;
+    this->rate = rate;
+    return true;
+}
+
+void NullSink::closeVoice() {
+    this->stop();
+    this->channels = 0;
+    this->rate = 0;
+}
+
+void NullSink::queueBuffer(size_t idx, size_t sz) {
+    if (this->channels == 0) {
+        return;
+    }
+
+    this->queued[idx] = true;
+    this->order.push_back(std::make_pair(idx, sz));
+}
+
+bool NullSink::bufferDone(size_t idx) {
+    return !this->queued[idx];
+}
+
+void NullSink::start() {
+    this->last = std::chrono::steady_clock::now();
+    this->playing = true;
+}
+
+void NullSink::stop() {
+    this->order.clear();
+    this->queued.assign(this->queued.size(), false);
+    this->carry = 0.0;
+    this->paused = false;
+    this->played = 0;
+    this->playedFront = 0;
+    this->playing = false;
+}
+
+void NullSink::setPaused(bool paused) {
+    this->last = std::chrono::steady_clock::now();
+    this->paused = paused;
+}
+
+uint32_t NullSink::playedSamples() {
+    return this->played;
+}
+
+void NullSink::setVolume(double v) {
+    // Volume doesn't affect discarded audio
+}
+
+void NullSink::update() {
+    // Finish everything immediately if not pacing
+    if (!this->paced) {
+        if (this->playing && !this->paused) {
+            this->advance(SIZE_MAX);
+        }
+        return;
+    }
+
+    // Otherwise wait for a 'frame' and play however many samples that took
+    std::this_thread::sleep_for(std::chrono::milliseconds(frameMs));
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (this->playing && !this->paused) {
+        double samples = std::chrono::duration<double>(now - this->last).count() * this->rate + this->carry;
+        this->carry = samples - static_cast<size_t>(samples);
+        this->advance(static_cast<size_t>(samples));
+    }
+    this->last = now;
+}
+
+NullSink::~NullSink() {
+    for (uint8_t * buf : this->buffers) {
+        delete[] buf;
+    }
+}
\ No newline at end of file
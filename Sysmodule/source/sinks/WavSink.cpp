@@ -0,0 +1,72 @@
+#include "Log.hpp"
+#include "sinks/WavSink.hpp"
+
+// Write a value to the file in little endian order
+static void writeLE(FILE * file, uint32_t val, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        std::fputc((val >> (8 * i)) & 0xFF, file);
+    }
+}
+
+WavSink::WavSink(const std::string & path) : NullSink() {
+    this->fileChannels = 0;
+    this->fileRate = 0;
+    this->paced = false;
+    this->written = 0;
+
+    this->file = std::fopen(path.c_str(), "wb");
+    if (this->file == nullptr) {
+        Log::writeError("[AUDIO] Unable to open " + path + " for writing");
+        this->valid_ = false;
+        return;
+    }
+
+    // Reserve space for the header (it's rewritten once the format is known)
+    this->writeHeader();
+    Log::writeInfo("[AUDIO] Writing output to " + path);
+}
+
+void WavSink::writeHeader() {
+    std::fseek(this->file, 0, SEEK_SET);
+    std::fwrite("RIFF", 1, 4, this->file);
+    writeLE(this->file, 36 + this->written, 4);
+    std::fwrite("WAVEfmt ", 1, 8, this->file);
+    writeLE(this->file, 16, 4);                                         // Size of fmt chunk
+    writeLE(this->file, 1, 2);                                          // PCM
+    writeLE(this->file, this->fileChannels, 2);
+    writeLE(this->file, this->fileRate, 4);
+    writeLE(this->file, this->fileRate * this->fileChannels * 2, 4);    // Bytes per second
+    writeLE(this->file, this->fileChannels * 2, 2);                     // Bytes per frame
+    writeLE(this->file, 16, 2);                                         // Bits per sample
+    std::fwrite("data", 1, 4, this->file);
+    writeLE(this->file, this->written, 4);
+    std::fseek(this->file, 0, SEEK_END);
+}
+
+void WavSink::consume(const uint8_t * buf, size_t sz) {
+    if (this->file == nullptr) {
+        return;
+    }
+
+    this->written += std::fwrite(buf, 1, sz, this->file);
+}
+
+bool WavSink::openVoice(long rate, int channels) {
+    // Only accept the format of the first voice
+    if (this->fileRate != 0 && (this->fileRate != rate || this->fileChannels != channels)) {
+        Log::writeWarning("[AUDIO] Can't change format of .wav output, ignoring song");
+        NullSink::closeVoice();
+        return false;
+    }
+
+    this->fileChannels = channels;
+    this->fileRate = rate;
+    return NullSink::openVoice(rate, channels);
+}
+
+WavSink::~WavSink() {
+    if (this->file != nullptr) {
+        this->writeHeader();
+        std::fclose(this->file);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <cstring>
+#include <FLAC/stream_decoder.h>
+#include "Log.hpp"
+#include "sources/FLAC.hpp"
+
+#ifdef USE_FILE_BUFFER
+#include "nx/File.hpp"
+#endif
+
+// Wrappers passed to libFLAC which forward to the object
+struct FLAC::Callbacks {
+#ifdef USE_FILE_BUFFER
+    static FLAC__StreamDecoderReadStatus read(const FLAC__StreamDecoder * dec, FLAC__byte buf[], size_t * bytes, void * data) {
+        FLAC * flac = static_cast<FLAC *>(data);
+        if (*bytes == 0) {
+            return FLAC__STREAM_DECODER_READ_STATUS_ABORT;
+        }
+
+        ssize_t read = flac->file->read(buf, *bytes);
+        if (read < 0) {
+            *bytes = 0;
+            return FLAC__STREAM_DECODER_READ_STATUS_ABORT;
+        }
+
+        *bytes = read;
+        return (read == 0 ? FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM : FLAC__STREAM_DECODER_READ_STATUS_CONTINUE);
+    }
+
+    static FLAC__StreamDecoderSeekStatus seek(const FLAC__StreamDecoder * dec, FLAC__uint64 offset, void * data) {
+        FLAC * flac = static_cast<FLAC *>(data);
+        off_t res = flac->file->seek(offset, NX::File::Position::Start);
+        return (res < 0 ? FLAC__STREAM_DECODER_SEEK_STATUS_ERROR : FLAC__STREAM_DECODER_SEEK_STATUS_OK);
+    }
+
+    static FLAC__StreamDecoderTellStatus tell(const FLAC__StreamDecoder * dec, FLAC__uint64 * offset, void * data) {
+        FLAC * flac = static_cast<FLAC *>(data);
+        off_t pos = flac->file->tell();
+        if (pos < 0) {
+            return FLAC__STREAM_DECODER_TELL_STATUS_ERROR;
+        }
+
+        *offset = pos;
+        return FLAC__STREAM_DECODER_TELL_STATUS_OK;
+    }
+
+    static FLAC__StreamDecoderLengthStatus length(const FLAC__StreamDecoder * dec, FLAC__uint64 * len, void * data) {
+        FLAC * flac = static_cast<FLAC *>(data);
+        int64_t size = flac->file->length();
+        if (size < 0) {
+            return FLAC__STREAM_DECODER_LENGTH_STATUS_ERROR;
+        }
+
+        *len = size;
+        return FLAC__STREAM_DECODER_LENGTH_STATUS_OK;
+    }
+
+    static FLAC__bool eof(const FLAC__StreamDecoder * dec, void * data) {
+        FLAC * flac = static_cast<FLAC *>(data);
+        return (flac->file->tell() < 0 || flac->file->tell() >= flac->file->length());
+    }
+#endif
+
+    static FLAC__StreamDecoderWriteStatus write(const FLAC__StreamDecoder * dec, const FLAC__Frame * frame, const FLAC__int32 * const buf[], void * data) {
+        FLAC * flac = static_cast<FLAC *>(data);
+
+        // Convert to interleaved 16 bit samples
+        const int shift = frame->header.bits_per_sample - 16;
+        const size_t channels = std::min<size_t>(frame->header.channels, flac->channels_);
+        flac->pending.resize(frame->header.blocksize * channels);
+        flac->pendingPos = 0;
+        for (size_t i = 0; i < frame->header.blocksize; i++) {
+            for (size_t c = 0; c < channels; c++) {
+                FLAC__int32 sample = buf[c][i];
+                flac->pending[i * channels + c] = (shift >= 0 ? sample >> shift : sample << -shift);
+            }
+        }
+
+        return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+    }
+
+    static void metadata(const FLAC__StreamDecoder * dec, const FLAC__StreamMetadata * meta, void * data) {
+        FLAC * flac = static_cast<FLAC *>(data);
+        if (meta->type == FLAC__METADATA_TYPE_STREAMINFO) {
+            flac->channels_ = meta->data.stream_info.channels;
+            flac->sampleRate_ = meta->data.stream_info.sample_rate;
+            flac->totalSamples_ = (meta->data.stream_info.total_samples > 0 ? meta->data.stream_info.total_samples : 1);
+        }
+    }
+
+    static void error(const FLAC__StreamDecoder * dec, FLAC__StreamDecoderErrorStatus status, void * data) {
+        Log::writeWarning("[FLAC] " + std::string(FLAC__StreamDecoderErrorStatusString[status]));
+    }
+};
+
+FLAC::FLAC(const std::string & path) : Source() {
+    Log::writeInfo("[FLAC] Opening file: " + path);
+    this->file = nullptr;
+    this->pendingPos = 0;
+    this->position = 0;
+
+    this->decoder = FLAC__stream_decoder_new();
+    if (this->decoder == nullptr) {
+        Log::writeError("[FLAC] Failed to create decoder");
+        this->valid_ = false;
+        return;
+    }
+
+    // Attempt to open file
+#ifdef USE_FILE_BUFFER
+    this->file = new NX::File(path);
+    FLAC__StreamDecoderInitStatus result = FLAC__stream_decoder_init_stream(this->decoder, Callbacks::read, Callbacks::seek, Callbacks::tell, Callbacks::length,
+                                                                            Callbacks::eof, Callbacks::write, Callbacks::metadata, Callbacks::error, this);
+#else
+    FLAC__StreamDecoderInitStatus result = FLAC__stream_decoder_init_file(this->decoder, path.c_str(), Callbacks::write, Callbacks::metadata, Callbacks::error, this);
+#endif
+
+    if (result != FLAC__STREAM_DECODER_INIT_STATUS_OK) {
+        Log::writeError("[FLAC] Unable to open file: " + std::to_string(result));
+        this->valid_ = false;
+        return;
+    }
+
+    // Read the stream info to get the format
+    if (!FLAC__stream_decoder_process_until_end_of_metadata(this->decoder) || this->sampleRate_ == 0) {
+        Log::writeError("[FLAC] Unable to get format from file");
+        this->valid_ = false;
+        return;
+    }
+
+    // Audio can only play mono or stereo
+    if (this->channels_ > 2) {
+        Log::writeError("[FLAC] Unsupported number of channels: " + std::to_string(this->channels_));
+        this->valid_ = false;
+        return;
+    }
+
+    Log::writeInfo("[FLAC] File opened successfully");
+}
+
+size_t FLAC::decode(unsigned char * buf, size_t sz) {
+    if (!this->valid_) {
+        return 0;
+    }
+
+    // Copy whole samples from decoded frames until the buffer is full
+    int16_t * out = reinterpret_cast<int16_t *>(buf);
+    size_t count = (sz/(sizeof(int16_t) * this->channels_)) * this->channels_;
+    size_t decoded = 0;
+    while (decoded < count) {
+        if (this->pendingPos >= this->pending.size()) {
+            // Decode the next frame, stopping at the end of the file
+            this->pending.clear();
+            this->pendingPos = 0;
+            if (!FLAC__stream_decoder_process_single(this->decoder) || FLAC__stream_decoder_get_state(this->decoder) == FLAC__STREAM_DECODER_END_OF_STREAM) {
+                if (this->pending.empty()) {
+                    break;
+                }
+            }
+            continue;
+        }
+
+        size_t copy = std::min(count - decoded, this->pending.size() - this->pendingPos);
+        std::memcpy(out + decoded, this->pending.data() + this->pendingPos, copy * sizeof(int16_t));
+        this->pendingPos += copy;
+        decoded += copy;
+    }
+
+    this->position += decoded/this->channels_;
+    if (decoded == 0) {
+        Log::writeInfo("[FLAC] Finished decoding file");
+        this->done_ = true;
+    }
+
+    return decoded * sizeof(int16_t);
+}
+
+void FLAC::seek(size_t pos) {
+    if (!this->valid_) {
+        return;
+    }
+
+    // libFLAC passes the frame containing the target sample (starting at it) to the write callback
+    this->pending.clear();
+    this->pendingPos = 0;
+    if (!FLAC__stream_decoder_seek_absolute(this->decoder, pos)) {
+        Log::writeError("[FLAC] An error occurred attempting to seek to: " + std::to_string(pos));
+        if (FLAC__stream_decoder_get_state(this->decoder) == FLAC__STREAM_DECODER_SEEK_ERROR) {
+            FLAC__stream_decoder_flush(this->decoder);
+        }
+        return;
+    }
+    this->position = pos;
+    this->done_ = false;
+}
+
+size_t FLAC::tell() {
+    return this->position;
+}
+
+FLAC::~FLAC() {
+    if (this->decoder != nullptr) {
+        FLAC__stream_decoder_finish(this->decoder);
+        FLAC__stream_decoder_delete(this->decoder);
+    }
+
+    // Delete file handle
+#ifdef USE_FILE_BUFFER
+    delete this->file;
+#endif
+}
\ No newline at end of file
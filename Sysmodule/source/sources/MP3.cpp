@@ -1,20 +1,61 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
 #include "Log.hpp"
 #include <mpg123.h>
+#include "Paths.hpp"
 #include "sources/MP3.hpp"
+#include <sys/stat.h>
+#include "utils/FS.hpp"
 
 #ifdef USE_FILE_BUFFER
 #include "nx/File.hpp"
 #endif
 
-mpg123_handle * MP3::mpg = nullptr;
+// Number of entries in a handle's frame index (the gap between entries grows to fit the file)
+constexpr long indexSize = 4000;
+// Identifies a seek index file (and it's version)
+constexpr uint32_t indexMagic = 0x31495054;     // "TPI1"
+
+// Header of a seek index file, which is followed by the offset of each
+// indexed frame (stored as the difference from the previous one)
+struct IndexHeader {
+    uint32_t magic;         // Always indexMagic
+    uint32_t fill;          // Number of offsets
+    uint64_t fileSize;      // Size of the file the index is for
+    int64_t step;           // Number of frames between offsets
+};
+
+std::vector<mpg123_handle *> MP3::freeHandles;
+std::vector<mpg123_handle *> MP3::handles;
+std::vector<mpg123_handle *> MP3::indexedHandles;
+size_t MP3::maxHandles = 2;
+std::mutex MP3::poolMutex;
+
+bool MP3::accurateSeek = false;
+std::array<float, 32> MP3::equalizer = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+                                        1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+                                        1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+                                        1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f};
 
 MP3::MP3(const std::string & path) : Source() {
     Log::writeInfo("[MP3] Opening file: " + path);
+    this->file = nullptr;
+    this->path = path;
+    this->fileSize = 0;
+    this->indexed = false;
+    this->seeked = false;
+
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) {
+        this->fileSize = st.st_size;
+    }
 
-    // Check the library is initialized
+    // Get a handle to decode with
+    this->mpg = MP3::acquireHandle();
     if (this->mpg == nullptr) {
-        Log::writeError("[MP3] Couldn't open file as library is not initialized!");
+        Log::writeError("[MP3] Couldn't open file as no handle is available!");
         this->valid_ = false;
         return;
     }
@@ -24,12 +65,11 @@ MP3::MP3(const std::string & path) : Source() {
     this->file = new NX::File(path);
     int result = mpg123_open_handle(this->mpg, this->file);
 #else
-    this->file = nullptr;
     int result = mpg123_open(this->mpg, path.c_str());
 #endif
 
     if (result != MPG123_OK) {
-        MP3::logErrorMsg();
+        this->logErrorMsg();
         Log::writeError("[MP3] Unable to open file");
         this->valid_ = false;
         return;
@@ -39,7 +79,7 @@ MP3::MP3(const std::string & path) : Source() {
     int encoding;
     result = mpg123_getformat(this->mpg, &this->sampleRate_, &this->channels_, &encoding);
     if (result != MPG123_OK) {
-        MP3::logErrorMsg();
+        this->logErrorMsg();
         Log::writeError("[MP3] Unable to get format from file");
         this->valid_ = false;
         return;
@@ -52,15 +92,188 @@ MP3::MP3(const std::string & path) : Source() {
         this->totalSamples_ = 1;
     }
 
+    // Use the stored index if there is one, which makes accurate seeking cheap
+    // (the handle is marked so changing the setting doesn't turn fuzzy seeking back on for it)
+    this->indexed = this->loadIndex();
+    if (this->indexed) {
+        std::scoped_lock<std::mutex> mtx(MP3::poolMutex);
+        MP3::indexedHandles.push_back(this->mpg);
+        mpg123_param(this->mpg, MPG123_REMOVE_FLAGS, MPG123_FUZZY, 0.0f);
+    }
+
     Log::writeInfo("[MP3] File opened successfully");
 }
 
 void MP3::logErrorMsg() {
-    const char * msg = mpg123_strerror(MP3::mpg);
+    const char * msg = mpg123_strerror(this->mpg);
     std::string str(msg);
     Log::writeError("[MP3] " + str);
 }
 
+std::string MP3::indexPath() {
+    // Name the index after a hash of the path (FNV-1a)
+    uint64_t hash = 0xCBF29CE484222325;
+    for (const char c : this->path) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001B3;
+    }
+
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+    return Path::Sys::SeekIndexFolder + name + ".idx";
+}
+
+bool MP3::loadIndex() {
+    std::vector<unsigned char> data;
+    if (this->fileSize == 0 || !Utils::Fs::readFile(this->indexPath(), data) || data.size() < sizeof(IndexHeader)) {
+        return false;
+    }
+
+    // Ensure the index is for this version of the file
+    IndexHeader header;
+    std::memcpy(&header, data.data(), sizeof(IndexHeader));
+    if (header.magic != indexMagic || header.fileSize != this->fileSize || data.size() != sizeof(IndexHeader) + header.fill * sizeof(uint32_t)) {
+        Log::writeWarning("[MP3] Ignoring outdated seek index");
+        return false;
+    }
+
+    // Convert the differences back to offsets
+    std::vector<off_t> offsets(header.fill);
+    off_t offset = 0;
+    for (size_t i = 0; i < header.fill; i++) {
+        uint32_t delta;
+        std::memcpy(&delta, data.data() + sizeof(IndexHeader) + i * sizeof(uint32_t), sizeof(uint32_t));
+        offset += delta;
+        offsets[i] = offset;
+    }
+
+    if (mpg123_set_index(this->mpg, offsets.data(), header.step, header.fill) != MPG123_OK) {
+        this->logErrorMsg();
+        return false;
+    }
+
+    Log::writeInfo("[MP3] Loaded seek index (" + std::to_string(header.fill) + " entries)");
+    return true;
+}
+
+void MP3::saveIndex() {
+    off_t * offsets;
+    off_t step;
+    size_t fill;
+    if (this->fileSize == 0 || mpg123_index(this->mpg, &offsets, &step, &fill) != MPG123_OK || fill == 0) {
+        return;
+    }
+
+    // Store each offset as the difference from the last as frames are small
+    IndexHeader header = {indexMagic, static_cast<uint32_t>(fill), this->fileSize, step};
+    std::vector<unsigned char> data(sizeof(IndexHeader) + fill * sizeof(uint32_t));
+    std::memcpy(data.data(), &header, sizeof(IndexHeader));
+    off_t last = 0;
+    for (size_t i = 0; i < fill; i++) {
+        uint32_t delta = offsets[i] - last;
+        std::memcpy(data.data() + sizeof(IndexHeader) + i * sizeof(uint32_t), &delta, sizeof(uint32_t));
+        last = offsets[i];
+    }
+
+    Utils::Fs::createPath(Path::Sys::SeekIndexFolder);
+    if (Utils::Fs::writeFile(this->indexPath(), data)) {
+        Log::writeInfo("[MP3] Stored seek index (" + std::to_string(fill) + " entries)");
+    }
+}
+
+mpg123_handle * MP3::acquireHandle() {
+    std::scoped_lock<std::mutex> mtx(MP3::poolMutex);
+
+    // Reuse a handle if possible
+    if (!MP3::freeHandles.empty()) {
+        mpg123_handle * mpg = MP3::freeHandles.back();
+        MP3::freeHandles.pop_back();
+        return mpg;
+    }
+
+    // Otherwise create a new one if we're under the limit
+    if (MP3::handles.size() >= MP3::maxHandles) {
+        Log::writeWarning("[MP3] Handle limit reached (" + std::to_string(MP3::maxHandles) + ")");
+        return nullptr;
+    }
+
+    int result;
+    mpg123_handle * mpg = mpg123_new(nullptr, &result);
+    if (mpg == nullptr) {
+        Log::writeError("[MP3] Failed to create instance: " + std::to_string(result));
+        return nullptr;
+    }
+
+    // Enable support for custom file object
+#ifdef USE_FILE_BUFFER
+    result = mpg123_replace_reader_handle(mpg, NX::File::readFile, NX::File::seekFile, nullptr);
+    if (result != MPG123_OK) {
+        Log::writeError("[MP3] Unable to enable custom file object support: " + std::to_string(result));
+        mpg123_delete(mpg);
+        return nullptr;
+    }
+#endif
+
+    // Enable gapless decoding
+    result = mpg123_param(mpg, MPG123_FLAGS, MPG123_QUIET | MPG123_GAPLESS, 0.0f);
+    if (result != MPG123_OK) {
+        Log::writeWarning("[MP3] Unable to set quiet + gapless flags: " + std::to_string(result));
+    }
+
+    // Limit the size of the frame index (it's stored and reused for seeking)
+    result = mpg123_param(mpg, MPG123_INDEX_SIZE, indexSize, 0.0f);
+    if (result != MPG123_OK) {
+        Log::writeWarning("[MP3] Unable to set index size: " + std::to_string(result));
+    }
+
+    // Match the other handles
+    MP3::applyAccurateSeek(mpg);
+    MP3::applyEqualizer(mpg);
+
+    MP3::handles.push_back(mpg);
+    Log::writeInfo("[MP3] Created handle " + std::to_string(MP3::handles.size()) + "/" + std::to_string(MP3::maxHandles));
+    return mpg;
+}
+
+void MP3::releaseHandle(mpg123_handle * mpg) {
+    std::scoped_lock<std::mutex> mtx(MP3::poolMutex);
+    MP3::indexedHandles.erase(std::remove(MP3::indexedHandles.begin(), MP3::indexedHandles.end(), mpg), MP3::indexedHandles.end());
+
+    // Delete the handle if the limit was lowered while it was in use
+    if (MP3::handles.size() > MP3::maxHandles) {
+        MP3::handles.erase(std::remove(MP3::handles.begin(), MP3::handles.end(), mpg), MP3::handles.end());
+        mpg123_delete(mpg);
+        return;
+    }
+
+    // Undo any change made for an indexed file
+    MP3::applyAccurateSeek(mpg);
+    MP3::freeHandles.push_back(mpg);
+}
+
+bool MP3::applyAccurateSeek(mpg123_handle * mpg) {
+    int result = mpg123_param(mpg, (MP3::accurateSeek ? MPG123_REMOVE_FLAGS : MPG123_ADD_FLAGS), MPG123_FUZZY, 0.0f);
+    if (result != MPG123_OK) {
+        Log::writeWarning("[MP3] Unable to toggle fuzzy seeking: " + std::string(mpg123_strerror(mpg)));
+        return false;
+    }
+
+    return true;
+}
+
+bool MP3::applyEqualizer(mpg123_handle * mpg) {
+    // Iterate over array and set each eq band
+    int result;
+    for (size_t i = 0; i < MP3::equalizer.size(); i++) {
+        result = mpg123_eq(mpg, MPG123_LR, i, MP3::equalizer[i]);
+        if (result != MPG123_OK) {
+            Log::writeError("[MP3] Failed to adjust equalizer band " + std::to_string(i) + ": " + std::string(mpg123_strerror(mpg)));
+            return false;
+        }
+    }
+
+    return true;
+}
+
 size_t MP3::decode(unsigned char * buf, size_t sz) {
     if (!this->valid_) {
         return 0;
@@ -68,7 +281,7 @@ size_t MP3::decode(unsigned char * buf, size_t sz) {
 
     size_t decoded = 0;
     std::memset(buf, 0, sz);
-    mpg123_read(mpg, buf, sz, &decoded);
+    mpg123_read(this->mpg, buf, sz, &decoded);
     if (decoded == 0) {
         Log::writeInfo("[MP3] Finished decoding file");
         this->done_ = true;
@@ -82,10 +295,18 @@ void MP3::seek(size_t pos) {
         return;
     }
 
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     off_t res = mpg123_seek(this->mpg, pos, SEEK_SET);
+    this->seeked = true;
     if (res < 0) {
         Log::writeError("[MP3] An error occurred attempting to seek to: " + std::to_string(pos));
+        return;
     }
+    this->done_ = false;
+
+    // Log time taken so seeking with/without an index can be compared
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    Log::writeInfo("[MP3] Seeked to " + std::to_string(pos) + " in " + std::to_string(ms) + "ms" + (this->indexed ? " (indexed)" : ""));
 }
 
 size_t MP3::tell() {
@@ -102,7 +323,12 @@ size_t MP3::tell() {
 
 MP3::~MP3() {
     if (this->mpg != nullptr) {
+        // Keep the index for next time if it covers the whole file
+        if (this->valid_ && this->done_ && !this->seeked && !this->indexed) {
+            this->saveIndex();
+        }
         mpg123_close(this->mpg);
+        MP3::releaseHandle(this->mpg);
     }
 
     // Delete file handle
@@ -112,85 +338,70 @@ MP3::~MP3() {
 }
 
 bool MP3::initLib() {
-    // Initialize library
+    // Initialize library (handles are created when needed)
     int result = mpg123_init();
     if (result != MPG123_OK) {
         Log::writeError("[MP3] Failed to initialize library" + std::to_string(result));
         return false;
     }
 
-    // Create handle
-    MP3::mpg = mpg123_new(nullptr, &result);
-    if (MP3::mpg == nullptr) {
-        Log::writeError("[MP3] Failed to create instance: " + std::to_string(result));
-        return false;
-    }
-
-    // Enable support for custom file object
-#ifdef USE_FILE_BUFFER
-    result = mpg123_replace_reader_handle(MP3::mpg, NX::File::readFile, NX::File::seekFile, nullptr);
-    if (result != MPG123_OK) {
-        Log::writeError("[MP3] Unable to enable custom file object support: " + std::to_string(result));
-        return false;
-    }
-#endif
-
-    // Enable gapless decoding
-    result = mpg123_param(MP3::mpg, MPG123_FLAGS, MPG123_QUIET | MPG123_GAPLESS, 0.0f);
-    if (result != MPG123_OK) {
-        MP3::logErrorMsg();
-        Log::writeWarning("[MP3] Unable to set quiet + gapless flags: " + std::to_string(result));
-    }
-
-    // Use fuzzy seeking by default
-    MP3::setAccurateSeek(false);
-
     Log::writeSuccess("[MP3] Initialized successfully");
     return true;
 }
 
 
 void MP3::freeLib() {
-    // Delete handle
-    if (MP3::mpg != nullptr) {
-        Log::writeSuccess("[MP3] Library tidied up!");
-        mpg123_delete(MP3::mpg);
-        MP3::mpg = nullptr;
+    // Delete handles
+    std::scoped_lock<std::mutex> mtx(MP3::poolMutex);
+    if (MP3::freeHandles.size() != MP3::handles.size()) {
+        Log::writeWarning("[MP3] Freeing library while handles are in use!");
     }
+    for (mpg123_handle * mpg : MP3::handles) {
+        mpg123_delete(mpg);
+    }
+    MP3::freeHandles.clear();
+    MP3::indexedHandles.clear();
+    MP3::handles.clear();
+
+    mpg123_exit();
+    Log::writeSuccess("[MP3] Library tidied up!");
 }
 
-bool MP3::setAccurateSeek(bool b) {
-    // Sanity check
-    if (MP3::mpg == nullptr) {
-        return false;
-    }
+void MP3::setHandleLimit(const size_t max) {
+    std::scoped_lock<std::mutex> mtx(MP3::poolMutex);
+    MP3::maxHandles = (max < 2 ? 2 : max);
 
-    int result = mpg123_param(MP3::mpg, (b ? MPG123_REMOVE_FLAGS : MPG123_ADD_FLAGS), MPG123_FUZZY, 0.0f);
-    if (result != MPG123_OK) {
-        MP3::logErrorMsg();
-        Log::writeWarning("[MP3] Unable to toggle fuzzy seeking");
-        return false;
+    // Delete unused handles over the limit
+    while (MP3::handles.size() > MP3::maxHandles && !MP3::freeHandles.empty()) {
+        mpg123_handle * mpg = MP3::freeHandles.back();
+        MP3::freeHandles.pop_back();
+        MP3::handles.erase(std::remove(MP3::handles.begin(), MP3::handles.end(), mpg), MP3::handles.end());
+        mpg123_delete(mpg);
     }
-
-    return true;
 }
 
-bool MP3::setEqualizer(const std::array<float, 32> & eq) {
-    // Sanity check
-    if (MP3::mpg == nullptr) {
-        return false;
-    }
+bool MP3::setAccurateSeek(const bool b) {
+    std::scoped_lock<std::mutex> mtx(MP3::poolMutex);
+    MP3::accurateSeek = b;
 
-    // Iterate over array and set each eq band
-    int result;
-    for (size_t i = 0; i < eq.size(); i++) {
-        result = mpg123_eq(MP3::mpg, MPG123_LR, i, eq[i]);
-        if (result != MPG123_OK) {
-            MP3::logErrorMsg();
-            Log::writeError("[MP3] Failed to adjust equalizer band " + std::to_string(i));
-            return false;
+    // Update all handles (including those in use), except those using a seek index as they're already accurate
+    bool ok = true;
+    for (mpg123_handle * mpg : MP3::handles) {
+        if (std::find(MP3::indexedHandles.begin(), MP3::indexedHandles.end(), mpg) == MP3::indexedHandles.end()) {
+            ok = MP3::applyAccurateSeek(mpg) && ok;
         }
     }
+    return ok;
+}
 
-    return true;
+bool MP3::setEqualizer(const std::array<float, 32> & eq) {
+    std::scoped_lock<std::mutex> mtx(MP3::poolMutex);
+    MP3::equalizer = eq;
+
+    // Update all handles (including those in use)
+    bool ok = true;
+    for (mpg123_handle * mpg : MP3::handles) {
+        ok = MP3::applyEqualizer(mpg) && ok;
+    }
+    return ok;
 }
\ No newline at end of file
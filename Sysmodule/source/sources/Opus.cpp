@@ -0,0 +1,117 @@
+#include "Log.hpp"
+#include <opusfile.h>
+#include "sources/Opus.hpp"
+
+#ifdef USE_FILE_BUFFER
+#include "nx/File.hpp"
+
+// Wrappers passed to opusfile which forward to the file object
+struct Opus::Callbacks {
+    static int read(void * data, unsigned char * buf, int count) {
+        return static_cast<NX::File *>(data)->read(buf, count);
+    }
+
+    static int seek(void * data, opus_int64 offset, int whence) {
+        return (NX::File::seekFile(data, offset, whence) < 0 ? -1 : 0);
+    }
+
+    static opus_int64 tell(void * data) {
+        return static_cast<NX::File *>(data)->tell();
+    }
+};
+#endif
+
+Opus::Opus(const std::string & path) : Source() {
+    Log::writeInfo("[OPUS] Opening file: " + path);
+    this->file = nullptr;
+
+    // Attempt to open file
+    int result;
+#ifdef USE_FILE_BUFFER
+    this->file = new NX::File(path);
+    const OpusFileCallbacks callbacks = {Callbacks::read, Callbacks::seek, Callbacks::tell, nullptr};
+    this->of = op_open_callbacks(this->file, &callbacks, nullptr, 0, &result);
+#else
+    this->of = op_open_file(path.c_str(), &result);
+#endif
+
+    if (this->of == nullptr) {
+        Log::writeError("[OPUS] Unable to open file: " + std::to_string(result));
+        this->valid_ = false;
+        return;
+    }
+
+    // Output is always 48kHz stereo
+    this->channels_ = 2;
+    this->sampleRate_ = 48000;
+
+    // Get length
+    opus_int64 total = op_pcm_total(this->of, -1);
+    if (total <= 0) {
+        Log::writeWarning("[OPUS] Unable to determine length of song");
+        total = 1;
+    }
+    this->totalSamples_ = total;
+
+    Log::writeInfo("[OPUS] File opened successfully");
+}
+
+size_t Opus::decode(unsigned char * buf, size_t sz) {
+    if (!this->valid_) {
+        return 0;
+    }
+
+    // op_read_stereo() returns at most one packet, so keep reading until the buffer is full
+    opus_int16 * out = reinterpret_cast<opus_int16 *>(buf);
+    size_t count = sz/sizeof(opus_int16);
+    size_t decoded = 0;
+    while (decoded < count) {
+        int read = op_read_stereo(this->of, out + decoded, count - decoded);
+        if (read <= 0) {
+            if (read < 0) {
+                Log::writeWarning("[OPUS] Error while decoding: " + std::to_string(read));
+            }
+            break;
+        }
+        decoded += read * 2;
+    }
+
+    if (decoded == 0) {
+        Log::writeInfo("[OPUS] Finished decoding file");
+        this->done_ = true;
+    }
+
+    return decoded * sizeof(opus_int16);
+}
+
+void Opus::seek(size_t pos) {
+    if (!this->valid_) {
+        return;
+    }
+
+    if (op_pcm_seek(this->of, pos) != 0) {
+        Log::writeError("[OPUS] An error occurred attempting to seek to: " + std::to_string(pos));
+        return;
+    }
+    this->done_ = false;
+}
+
+size_t Opus::tell() {
+    if (!this->valid_) {
+        return 0;
+    }
+
+    opus_int64 pos = op_pcm_tell(this->of);
+    return (pos < 0 ? 0 : pos);
+}
+
+Opus::~Opus() {
+    if (this->of != nullptr) {
+        op_free(this->of);
+    }
+
+    // Delete file handle
+#ifdef USE_FILE_BUFFER
+    delete this->file;
+#endif
+}
\ No newline at end of file
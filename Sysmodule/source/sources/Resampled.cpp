@@ -0,0 +1,94 @@
+#include <algorithm>
+#include "Log.hpp"
+#include "sources/Resampled.hpp"
+
+constexpr size_t stagingFrames = 1024;      // Most frames decoded from the source at once
+
+Resampled::Resampled(Source * source, long rate, Dsp::Resampler::Quality quality) : Source() {
+    this->source = source;
+    this->channels_ = source->channels();
+    this->sampleRate_ = rate;
+    this->totalSamples_ = std::max<long long>(static_cast<long long>(source->totalSamples()) * rate/source->sampleRate(), 1);
+    this->valid_ = source->valid();
+
+    this->resampler = new Dsp::Resampler(source->sampleRate(), rate, this->channels_, quality);
+    this->staging = new int16_t[stagingFrames * this->channels_];
+    this->flushed = false;
+    this->position = 0;
+    this->time = std::chrono::steady_clock::duration::zero();
+    this->produced = 0;
+    Log::writeInfo("[RESAMPLE] Resampling from " + std::to_string(source->sampleRate()) + "Hz to " + std::to_string(rate) + "Hz");
+}
+
+size_t Resampled::decode(unsigned char * buf, size_t sz) {
+    if (!this->valid_) {
+        return 0;
+    }
+
+    // Pull as much as possible, feeding in more of the source whenever the resampler runs dry
+    int16_t * out = reinterpret_cast<int16_t *>(buf);
+    size_t frames = sz/(this->channels_ * sizeof(int16_t));
+    size_t written = 0;
+    while (written < frames) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        size_t num = this->resampler->pull(out + written * this->channels_, frames - written);
+        this->time += std::chrono::steady_clock::now() - start;
+        written += num;
+        if (num > 0) {
+            continue;
+        }
+
+        // Nothing more can be output once the end has been pushed
+        if (this->flushed) {
+            break;
+        }
+        size_t space = std::min(this->resampler->capacity(), stagingFrames);
+        size_t bytes = this->source->decode(reinterpret_cast<unsigned char *>(this->staging), space * this->channels_ * sizeof(int16_t));
+        start = std::chrono::steady_clock::now();
+        if (bytes == 0) {
+            this->resampler->flush();
+            this->flushed = true;
+        } else {
+            this->resampler->push(this->staging, bytes/(this->channels_ * sizeof(int16_t)));
+        }
+        this->time += std::chrono::steady_clock::now() - start;
+    }
+
+    if (written == 0) {
+        this->done_ = true;
+    }
+    this->position += written;
+    this->produced += written;
+    return written * this->channels_ * sizeof(int16_t);
+}
+
+void Resampled::seek(size_t pos) {
+    if (!this->valid_) {
+        return;
+    }
+
+    // Seek the source to the matching position, and start resampling afresh from wherever it lands
+    this->source->seek(static_cast<unsigned long long>(pos) * this->source->sampleRate()/this->sampleRate_);
+    this->position = static_cast<unsigned long long>(this->source->tell()) * this->sampleRate_/this->source->sampleRate();
+    this->resampler->reset();
+    this->flushed = false;
+    this->done_ = false;
+}
+
+size_t Resampled::tell() {
+    return this->position;
+}
+
+Resampled::~Resampled() {
+    // Log the cost of resampling for comparing quality settings
+    if (this->produced > 0) {
+        double secs = static_cast<double>(this->produced)/this->sampleRate_;
+        double usPerSec = std::chrono::duration<double, std::micro>(this->time).count()/secs;
+        Log::writeInfo("[RESAMPLE] Resample stats: frames=" + std::to_string(this->produced) + " in_rate=" + std::to_string(this->source->sampleRate()) +
+                       " channels=" + std::to_string(this->channels_) + " us_per_second=" + std::to_string(usPerSec));
+    }
+
+    delete[] this->staging;
+    delete this->resampler;
+    delete this->source;
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "Log.hpp"
+#include "sources/Vorbis.hpp"
+#include <vorbis/vorbisfile.h>
+
+#ifdef USE_FILE_BUFFER
+#include "nx/File.hpp"
+
+// Wrappers passed to libvorbisfile which forward to the file object
+struct Vorbis::Callbacks {
+    static size_t read(void * buf, size_t size, size_t count, void * data) {
+        ssize_t read = static_cast<NX::File *>(data)->read(buf, size * count);
+        return (read < 0 ? 0 : read/size);
+    }
+
+    static int seek(void * data, ogg_int64_t offset, int whence) {
+        return (NX::File::seekFile(data, offset, whence) < 0 ? -1 : 0);
+    }
+
+    static long tell(void * data) {
+        return static_cast<NX::File *>(data)->tell();
+    }
+};
+#endif
+
+Vorbis::Vorbis(const std::string & path) : Source() {
+    Log::writeInfo("[VORBIS] Opening file: " + path);
+    this->file = nullptr;
+    this->vf = new OggVorbis_File;
+
+    // Attempt to open file
+#ifdef USE_FILE_BUFFER
+    this->file = new NX::File(path);
+    ov_callbacks callbacks = {Callbacks::read, Callbacks::seek, nullptr, Callbacks::tell};
+    int result = ov_open_callbacks(this->file, this->vf, nullptr, 0, callbacks);
+#else
+    int result = ov_fopen(path.c_str(), this->vf);
+#endif
+
+    if (result != 0) {
+        Log::writeError("[VORBIS] Unable to open file: " + std::to_string(result));
+        delete this->vf;
+        this->vf = nullptr;
+        this->valid_ = false;
+        return;
+    }
+
+    // Get format
+    vorbis_info * info = ov_info(this->vf, -1);
+    if (info == nullptr || info->channels > 2) {
+        Log::writeError("[VORBIS] Unsupported format");
+        this->valid_ = false;
+        return;
+    }
+    this->channels_ = info->channels;
+    this->sampleRate_ = info->rate;
+
+    // Get length
+    ogg_int64_t total = ov_pcm_total(this->vf, -1);
+    if (total <= 0) {
+        Log::writeWarning("[VORBIS] Unable to determine length of song");
+        total = 1;
+    }
+    this->totalSamples_ = total;
+
+    Log::writeInfo("[VORBIS] File opened successfully");
+}
+
+size_t Vorbis::decode(unsigned char * buf, size_t sz) {
+    if (!this->valid_) {
+        return 0;
+    }
+
+    // ov_read() returns at most one packet, so keep reading until the buffer is full
+    size_t decoded = 0;
+    int section;
+    while (decoded < sz) {
+        long read = ov_read(this->vf, reinterpret_cast<char *>(buf) + decoded, sz - decoded, 0, 2, 1, &section);
+        if (read == OV_HOLE) {
+            Log::writeWarning("[VORBIS] Skipping corrupt data");
+            continue;
+        } else if (read <= 0) {
+            break;
+        }
+        decoded += read;
+    }
+
+    if (decoded == 0) {
+        Log::writeInfo("[VORBIS] Finished decoding file");
+        this->done_ = true;
+    }
+
+    return decoded;
+}
+
+void Vorbis::seek(size_t pos) {
+    if (!this->valid_) {
+        return;
+    }
+
+    if (ov_pcm_seek(this->vf, pos) != 0) {
+        Log::writeError("[VORBIS] An error occurred attempting to seek to: " + std::to_string(pos));
+        return;
+    }
+    this->done_ = false;
+}
+
+size_t Vorbis::tell() {
+    if (!this->valid_) {
+        return 0;
+    }
+
+    ogg_int64_t pos = ov_pcm_tell(this->vf);
+    return (pos < 0 ? 0 : pos);
+}
+
+Vorbis::~Vorbis() {
+    if (this->vf != nullptr) {
+        ov_clear(this->vf);
+        delete this->vf;
+    }
+
+    // Delete file handle
+#ifdef USE_FILE_BUFFER
+    delete this->file;
+#endif
+}
\ No newline at end of file
@@ -1,23 +1,31 @@
-#include <cstring>
 #include "utils/Buffer.hpp"
 
 namespace Utils::Buffer {
-    bool appendString(std::vector<uint8_t> & buf, const std::string & str) {
-        // Iterate over string
-        for (size_t i = 0; i < str.size(); i++) {
-            buf.push_back(str[i]);
+    bool writeString(uint8_t * buf, const size_t size, size_t & pos, const std::string & str) {
+        // Check we have room for the string and it's terminator
+        if (pos + str.size() + 1 > size) {
+            return false;
         }
-        buf.push_back('\0');
+
+        std::memcpy(buf + pos, str.c_str(), str.size() + 1);
+        pos += str.size() + 1;
         return true;
     }
 
-    bool readString(const std::vector<uint8_t> & buf, size_t & pos, std::string & str) {
-        if (pos >= buf.size()) {
+    bool readString(const uint8_t * buf, const size_t size, size_t & pos, std::string & str) {
+        if (pos >= size) {
+            return false;
+        }
+
+        // Don't read past the end if the string isn't terminated
+        const char * start = reinterpret_cast<const char *>(buf + pos);
+        size_t len = strnlen(start, size - pos);
+        if (pos + len >= size) {
             return false;
         }
 
-        str = std::string(reinterpret_cast<const char *>(&buf[pos]));
-        pos += str.length() + 1;
+        str = std::string(start, len);
+        pos += len + 1;
         return true;
     }
 };
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "utils/Mix.hpp"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace Utils::Mix {
+    // Gains are calculated from the frame number rather than summed, so rounding errors don't build up
+    void crossfadeScalar(int16_t * in, const int16_t * out, const size_t samples, const int channels, const float gain, const float step) {
+        float frame = 0.0f;
+        for (size_t i = 0; i < samples; i++) {
+            float g = gain + frame * step;
+            g = (g < 0.0f ? 0.0f : (g > 1.0f ? 1.0f : g));
+            float v = out[i] + g * (in[i] - out[i]);
+            in[i] = (v > 32767.0f ? 32767 : (v < -32768.0f ? -32768 : static_cast<int16_t>(v)));
+            if ((i + 1) % channels == 0) {
+                frame += 1.0f;
+            }
+        }
+    }
+
+    void crossfade(int16_t * in, const int16_t * out, const size_t samples, const int channels, const float gain, const float step) {
+        // Only mono and stereo are vectorized (4 samples = whole frames)
+        size_t i = 0;
+        float g = gain;
+#if defined(__ARM_NEON) || defined(__SSE2__)
+        if (channels == 1 || channels == 2) {
+            // Gain of each lane for the first iteration and the amount they increase by each iteration
+            const float laneStep = (channels == 1 ? step : 0.0f);
+            const float lanes[4] = {0.0f, laneStep, (channels == 1 ? 2.0f : 1.0f) * step, (channels == 1 ? 3.0f : 1.0f) * step};
+            const float iterStep = (4/channels) * step;
+#if defined(__ARM_NEON)
+            const float32x4_t vBase = vaddq_f32(vdupq_n_f32(g), vld1q_f32(lanes));
+            const float32x4_t vStep = vdupq_n_f32(iterStep);
+            const float32x4_t vZero = vdupq_n_f32(0.0f);
+            const float32x4_t vOne = vdupq_n_f32(1.0f);
+            float iter = 0.0f;
+            for (; i + 4 <= samples; i += 4) {
+                float32x4_t a = vcvtq_f32_s32(vmovl_s16(vld1_s16(in + i)));
+                float32x4_t b = vcvtq_f32_s32(vmovl_s16(vld1_s16(out + i)));
+                float32x4_t c = vminq_f32(vmaxq_f32(vmlaq_n_f32(vBase, vStep, iter), vZero), vOne);
+                float32x4_t r = vmlaq_f32(b, c, vsubq_f32(a, b));
+                vst1_s16(in + i, vqmovn_s32(vcvtq_s32_f32(r)));
+                iter += 1.0f;
+            }
+#else
+            const __m128 vBase = _mm_add_ps(_mm_set1_ps(g), _mm_loadu_ps(lanes));
+            const __m128 vStep = _mm_set1_ps(iterStep);
+            const __m128 vZero = _mm_setzero_ps();
+            const __m128 vOne = _mm_set1_ps(1.0f);
+            float iter = 0.0f;
+            for (; i + 4 <= samples; i += 4) {
+                __m128i a16 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(in + i));
+                __m128i b16 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(out + i));
+                __m128 a = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(a16, a16), 16));
+                __m128 b = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(b16, b16), 16));
+                __m128 vGain = _mm_add_ps(vBase, _mm_mul_ps(vStep, _mm_set1_ps(iter)));
+                __m128 c = _mm_min_ps(_mm_max_ps(vGain, vZero), vOne);
+                __m128 r = _mm_add_ps(b, _mm_mul_ps(c, _mm_sub_ps(a, b)));
+                __m128i r32 = _mm_cvttps_epi32(r);
+                _mm_storel_epi64(reinterpret_cast<__m128i *>(in + i), _mm_packs_epi32(r32, r32));
+                iter += 1.0f;
+            }
+#endif
+            g += (i/channels) * step;
+        }
+#endif
+
+        // Handle whatever is left
+        crossfadeScalar(in + i, out + i, samples - i, channels, g, step);
+    }
+};
\ No newline at end of file
@@ -0,0 +1,53 @@
+// Checks and benchmarks for the parts of the sysmodule which don't need a console. Each area is first
+// checked against a simple reference implementation (using random operations from the given seed), then
+// timed. Results are printed one per line as key=value pairs so runs can be compared by a script (see
+// Bench.hpp). The exit code is non-zero if any check fails.
+//
+// Build (from this directory): make
+//
+// Usage: bench [-r seed] [-c 1 (only run checks)]
+
+#include "Bench.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+// Number of failed checks
+static size_t failures = 0;
+
+namespace Bench {
+    volatile size_t sink = 0;
+
+    void report(const char * name, const bool passed, const std::string & detail) {
+        std::printf("check=%s result=%s%s%s\n", name, (passed ? "pass" : "fail"), (detail.empty() ? "" : " "), detail.c_str());
+        if (!passed) {
+            failures++;
+        }
+    }
+};
+
+int main(int argc, char * argv[]) {
+    unsigned int seed = 1;
+    bool benchmark = true;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string opt = argv[i];
+        if (opt == "-r") {
+            seed = std::strtoul(argv[i+1], nullptr, 10);
+        } else if (opt == "-c") {
+            benchmark = (std::strtoul(argv[i+1], nullptr, 10) == 0);
+        }
+    }
+    std::mt19937 rng(seed);
+
+    Bench::queue(rng, benchmark);
+    Bench::shuffle(rng, benchmark);
+    Bench::idList(rng, benchmark);
+    Bench::mix(rng, benchmark);
+    Bench::resampler(rng, benchmark);
+    Bench::chain(rng, benchmark);
+    Bench::rewindCache(rng, benchmark);
+
+    std::printf("checks_failed=%zu\n", failures);
+    return (failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,46 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <random>
+#include <string>
+
+// Number of random operations made by each check
+constexpr size_t checkOps = 200000;
+// Number of songs in the queues used for benchmarks
+constexpr size_t benchQueueSize = 100000;
+// Number of operations timed by each queue benchmark
+constexpr size_t benchOps = 200000;
+// Seconds of audio passed through each audio benchmark
+constexpr size_t audioSecs = 20;
+
+// Helpers shared by each area's checks and benchmarks. Results are printed one per line
+// as key=value pairs: 'check=<name> result=pass|fail ...' for checks and 'bench=<name> ...'
+// for timings, so runs can be compared by a script.
+namespace Bench {
+    // Results of timed lookups are stored here so they aren't optimized away
+    extern volatile size_t sink;
+
+    // Print the result of a check, counting it if it failed
+    void report(const char *, const bool, const std::string & = "");
+
+    // Returns the seconds taken to call the given function
+    template <typename F>
+    double timeIt(F f) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        f();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Each area's checks, followed by it's benchmarks if the bool is true (see the file named after the area)
+    void chain(std::mt19937 &, const bool);
+    void queue(std::mt19937 &, const bool);
+    void shuffle(std::mt19937 &, const bool);
+    void idList(std::mt19937 &, const bool);
+    void mix(std::mt19937 &, const bool);
+    void resampler(std::mt19937 &, const bool);
+    void rewindCache(std::mt19937 &, const bool);
+};
+
+#endif
\ No newline at end of file
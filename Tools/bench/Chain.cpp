@@ -0,0 +1,144 @@
+// Checks and benchmarks for the DSP chain (equalizer and limiter)
+
+#include <algorithm>
+#include "Bench.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include "dsp/Chain.hpp"
+#include <vector>
+
+using Bench::report;
+using Bench::timeIt;
+
+// Number of samples in each buffer passed to the chain (matches the sysmodule's default buffer size)
+constexpr size_t chainSamples = 4096;
+// Centre of each band of a 10 band graphic equalizer (in Hz)
+static const float bands[] = {31.0f, 62.0f, 125.0f, 250.0f, 500.0f, 1000.0f, 2000.0f, 4000.0f, 8000.0f, 16000.0f};
+
+// Returns a 10 band equalizer with all bands set to the given gain
+static std::vector<Dsp::Filter> makeEqualizer(const float gain) {
+    std::vector<Dsp::Filter> filters;
+    for (const float freq : bands) {
+        filters.push_back(Dsp::Filter{Dsp::Filter::Type::Peak, freq, gain, 1.41f});
+    }
+    return filters;
+}
+
+// Returns a stereo sine wave of the given frequency and amplitude at 48kHz
+static std::vector<int16_t> sine(const double freq, const double amplitude, const size_t frames) {
+    std::vector<int16_t> buf(2 * frames);
+    for (size_t i = 0; i < frames; i++) {
+        buf[2*i] = buf[2*i + 1] = std::lround(amplitude * std::sin(2.0 * M_PI * freq * i/48000.0));
+    }
+    return buf;
+}
+
+// Runs a whole buffer through the chain a block at a time (as the sysmodule does)
+static void process(Dsp::Chain & chain, std::vector<int16_t> & buf) {
+    for (size_t i = 0; i < buf.size(); i += chainSamples) {
+        chain.process(buf.data() + i, std::min(chainSamples, buf.size() - i));
+    }
+}
+
+// Returns the RMS level of the given samples, skipping the first second (while filters settle)
+static double rms(const std::vector<int16_t> & buf) {
+    double sum = 0;
+    size_t count = 0;
+    for (size_t i = 2 * 48000; i < buf.size(); i++) {
+        sum += static_cast<double>(buf[i]) * buf[i];
+        count++;
+    }
+    return std::sqrt(sum/std::max<size_t>(count, 1));
+}
+
+// Check a flat equalizer leaves audio alone, a low pass removes high frequencies, and the limiter keeps peaks
+// under full scale without clipping
+static void checkChain() {
+    const size_t frames = 3 * 48000;
+    Dsp::Chain chain;
+    chain.setFormat(48000, 2);
+    chain.setFilters(makeEqualizer(0.0f), 0.0f, false);
+    std::vector<int16_t> input = sine(1000.0, 16384.0, frames);
+    std::vector<int16_t> output = input;
+    process(chain, output);
+    for (size_t i = 0; i < output.size(); i++) {
+        if (std::abs(output[i] - input[i]) > 2) {
+            report("chain", false, "op=flat index=" + std::to_string(i));
+            return;
+        }
+    }
+
+    Dsp::Chain lowPass;
+    lowPass.setFormat(48000, 2);
+    lowPass.setFilters({Dsp::Filter{Dsp::Filter::Type::LowPass, 1000.0f, 0.0f, 0.707f}}, 0.0f, false);
+    input = sine(10000.0, 16384.0, frames);
+    output = input;
+    process(lowPass, output);
+    double attenuation = 20.0 * std::log10(rms(input)/std::max(rms(output), 1e-9));
+    if (attenuation < 30.0) {
+        report("chain", false, "op=low_pass attenuation_db=" + std::to_string(attenuation));
+        return;
+    }
+
+    // +12dB would clip a half scale sine without the limiter
+    Dsp::Chain limited;
+    limited.setFormat(48000, 2);
+    limited.setFilters(makeEqualizer(0.0f), 12.0f, true);
+    output = sine(1000.0, 16384.0, frames);
+    process(limited, output);
+    int peak = 0;
+    for (const int16_t s : output) {
+        peak = std::max(peak, std::abs(static_cast<int>(s)));
+    }
+    if (peak > 0.98 * 32768 + 1 || peak < 0.9 * 32768) {
+        report("chain", false, "op=limiter peak=" + std::to_string(peak));
+        return;
+    }
+    report("chain", true);
+}
+
+// Time the chain on stereo 48kHz noise: a 10 band equalizer with the limiter, then each on it's own
+static void benchChain(std::mt19937 & rng) {
+    std::vector<int16_t> input(2 * audioSecs * 48000);
+    for (int16_t & s : input) {
+        s = static_cast<int16_t>(rng() >> 16)/4;
+    }
+
+    struct Config {
+        const char * name;
+        std::vector<Dsp::Filter> filters;
+        bool limiter;
+    };
+    std::vector<float> gains = {4.0f, 3.0f, 1.5f, 0.0f, -1.0f, -2.0f, 0.0f, 1.5f, 3.0f, 4.5f};
+    std::vector<Dsp::Filter> eq = makeEqualizer(0.0f);
+    for (size_t i = 0; i < eq.size(); i++) {
+        eq[i].gain = gains[i];
+    }
+    const Config configs[] = {
+        {"eq10_limiter", eq, true},
+        {"eq10", eq, false},
+        {"limiter", {}, true}
+    };
+
+    for (const Config & config : configs) {
+        Dsp::Chain chain;
+        chain.setFormat(48000, 2);
+        chain.setFilters(config.filters, -3.0f, config.limiter);
+        std::vector<int16_t> buf = input;
+        double secs = timeIt([&]() {
+            process(chain, buf);
+        });
+        std::printf("bench=chain config=%s bands=%zu limiter=%d ns_per_sample=%.3f us_per_audio_sec=%.1f\n", config.name, config.filters.size(),
+                    (config.limiter ? 1 : 0), secs * 1e9/buf.size(), secs * 1e6/audioSecs);
+    }
+}
+
+namespace Bench {
+    void chain(std::mt19937 & rng, const bool benchmark) {
+        checkChain();
+        if (benchmark) {
+            benchChain(rng);
+        }
+    }
+};
\ No newline at end of file
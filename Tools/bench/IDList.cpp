@@ -0,0 +1,164 @@
+// Checks and benchmarks for the compact encoding of ID lists sent over IPC
+
+#include <algorithm>
+#include "Bench.hpp"
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include "ipc/IDList.hpp"
+#include <utility>
+#include <vector>
+
+using Bench::report;
+using Bench::timeIt;
+
+// Returns IDs shaped like a queue (mostly runs from albums, with jumps between them)
+static std::vector<int> makeIDs(std::mt19937 & rng, const size_t count) {
+    std::vector<int> ids;
+    int id = rng() % 10000;
+    while (ids.size() < count) {
+        switch (rng() % 4) {
+            case 0:
+                id = rng() % INT_MAX;
+                break;
+            case 1:
+                id = -static_cast<int>(rng() % 1000);
+                break;
+            default:
+                id += static_cast<int>(rng() % 200) - 100;
+                break;
+        }
+        size_t run = 1 + rng() % 15;
+        for (size_t i = 0; i < run && ids.size() < count; i++) {
+            ids.push_back(id++);
+        }
+    }
+    return ids;
+}
+
+// Check IDs are decoded exactly as they were encoded, that limiting the size keeps a valid prefix, and that bad input is rejected
+static void checkIDList(std::mt19937 & rng) {
+    for (size_t i = 0; i < 2000; i++) {
+        std::vector<int> ids = makeIDs(rng, rng() % 500);
+        if (i == 0) {
+            ids = {INT_MIN, INT_MAX, INT_MIN, 0, -1, 1, INT_MAX - 1, INT_MAX};
+        }
+
+        std::vector<uint8_t> data;
+        std::vector<int> decoded;
+        if (Ipc::IDList::encode(ids, data) != ids.size() || !Ipc::IDList::decode(data.data(), data.size(), ids.size(), decoded) || decoded != ids) {
+            report("id_list", false, "op=round_trip count=" + std::to_string(ids.size()));
+            return;
+        }
+
+        // Wrong counts and cut off data must fail
+        decoded.clear();
+        bool bad = Ipc::IDList::decode(data.data(), data.size(), ids.size() + 1, decoded);
+        decoded.clear();
+        bad = bad || (!data.empty() && Ipc::IDList::decode(data.data(), data.size() - 1, ids.size(), decoded));
+        if (bad) {
+            report("id_list", false, "op=malformed count=" + std::to_string(ids.size()));
+            return;
+        }
+
+        // A limited encoding must fit and decode to the start of the list
+        size_t limit = rng() % (data.size() + 1);
+        std::vector<uint8_t> limited;
+        size_t encoded = Ipc::IDList::encode(ids, limited, limit);
+        decoded.clear();
+        if (limited.size() > limit || !Ipc::IDList::decode(limited.data(), limited.size(), encoded, decoded) ||
+            !std::equal(decoded.begin(), decoded.end(), ids.begin()))
+        {
+            report("id_list", false, "op=limit count=" + std::to_string(ids.size()) + " limit=" + std::to_string(limit));
+            return;
+        }
+    }
+    report("id_list", true);
+}
+
+// Returns the IDs of a library's songs in the order they were scanned: each album's songs get consecutive IDs in track
+// order, with gaps left by songs which have since been removed. The album each song is on is written to the second vector.
+static std::vector<int> makeLibrary(std::mt19937 & rng, const size_t count, std::vector<size_t> & albums) {
+    std::vector<int> ids;
+    int id = 1;
+    size_t album = 0;
+    while (ids.size() < count) {
+        size_t songs = 8 + rng() % 9;
+        for (size_t i = 0; i < songs && ids.size() < count; i++) {
+            id += (rng() % 20 == 0 ? 2 : 1);
+            ids.push_back(id);
+            albums.push_back(album);
+        }
+        album++;
+    }
+    return ids;
+}
+
+// Time encoding and decoding a queue in each order the app builds them in, comparing the size to the 4 bytes per ID sent without encoding:
+//   album: every album in name order (which isn't the order they were scanned in), each in track order
+//   title: every song in title order (unrelated to the order they were scanned in, so IDs are effectively random)
+//   shuffled: the library in a random order
+//   mixed: mostly runs from albums, with jumps between them (as used for the check above)
+static void benchIDList(std::mt19937 & rng) {
+    std::vector<size_t> albums;
+    std::vector<int> library = makeLibrary(rng, benchQueueSize, albums);
+
+    std::vector<uint32_t> albumNames(albums.back() + 1);
+    for (uint32_t & name : albumNames) {
+        name = rng();
+    }
+    std::vector<size_t> order(library.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b) {
+        return albumNames[albums[a]] < albumNames[albums[b]];
+    });
+    std::vector<int> byAlbum;
+    for (const size_t i : order) {
+        byAlbum.push_back(library[i]);
+    }
+
+    std::vector<uint32_t> titles(library.size());
+    for (uint32_t & title : titles) {
+        title = rng();
+    }
+    std::sort(order.begin(), order.end(), [&](const size_t a, const size_t b) {
+        return titles[a] < titles[b];
+    });
+    std::vector<int> byTitle;
+    for (const size_t i : order) {
+        byTitle.push_back(library[i]);
+    }
+
+    std::vector<int> shuffled = library;
+    std::shuffle(shuffled.begin(), shuffled.end(), rng);
+
+    const std::pair<const char *, std::vector<int>> orderings[] = {
+        {"album", byAlbum}, {"title", byTitle}, {"shuffled", shuffled}, {"mixed", makeIDs(rng, benchQueueSize)}
+    };
+    for (const std::pair<const char *, std::vector<int>> & ordering : orderings) {
+        const std::vector<int> & ids = ordering.second;
+        std::vector<uint8_t> data;
+        std::vector<int> decoded;
+        double encodeSecs = timeIt([&]() {
+            Ipc::IDList::encode(ids, data);
+        });
+        double decodeSecs = timeIt([&]() {
+            Ipc::IDList::decode(data.data(), data.size(), ids.size(), decoded);
+        });
+        double bytesPerID = static_cast<double>(data.size())/ids.size();
+        std::printf("bench=id_list order=%s n=%zu bytes_per_id=%.3f raw_bytes_per_id=%zu saved_pct=%.1f encode_ns_per_id=%.1f decode_ns_per_id=%.1f\n",
+                    ordering.first, ids.size(), bytesPerID, sizeof(int32_t), 100.0 * (1.0 - bytesPerID/sizeof(int32_t)),
+                    encodeSecs * 1e9/ids.size(), decodeSecs * 1e9/ids.size());
+    }
+}
+
+namespace Bench {
+    void idList(std::mt19937 & rng, const bool benchmark) {
+        checkIDList(rng);
+        if (benchmark) {
+            benchIDList(rng);
+        }
+    }
+};
\ No newline at end of file
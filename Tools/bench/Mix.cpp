@@ -0,0 +1,96 @@
+// Checks and benchmarks for the crossfade mixer
+
+#include <algorithm>
+#include "Bench.hpp"
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include "utils/Mix.hpp"
+#include <vector>
+
+using Bench::report;
+using Bench::timeIt;
+
+// Number of samples in each buffer passed to the mixer (matches the sysmodule's default buffer size)
+constexpr size_t mixSamples = 4096;
+
+// Fill a buffer with random samples, with some at the extremes to check saturation
+static void randomSamples(std::mt19937 & rng, std::vector<int16_t> & buf) {
+    for (int16_t & s : buf) {
+        uint32_t r = rng();
+        s = (r % 16 == 0 ? (r & 16 ? INT16_MAX : INT16_MIN) : static_cast<int16_t>(r >> 16));
+    }
+}
+
+// Check the vectorized and scalar crossfades against a plain version, allowing for rounding, for all lengths and gains
+static void checkMix(std::mt19937 & rng) {
+    std::vector<int16_t> in(mixSamples + 7), out(mixSamples + 7), mixed;
+    for (size_t i = 0; i < 3000; i++) {
+        int channels = 1 + rng() % 2;
+        size_t samples = (rng() % (in.size()/channels)) * channels;
+        float gain = static_cast<float>(rng() % 1400)/1000.0f - 0.2f;
+        float step = static_cast<float>(rng() % 1000)/(1000.0f * (samples > 0 ? samples : 1));
+        randomSamples(rng, in);
+        randomSamples(rng, out);
+        mixed = in;
+        if (i % 2 == 0) {
+            Utils::Mix::crossfade(mixed.data(), out.data(), samples, channels, gain, step);
+        } else {
+            Utils::Mix::crossfadeScalar(mixed.data(), out.data(), samples, channels, gain, step);
+        }
+
+        for (size_t j = 0; j < in.size(); j++) {
+            // Anything past the given number of samples must be left alone
+            double expected = in[j];
+            if (j < samples) {
+                double g = std::clamp(static_cast<double>(gain) + (j/channels) * static_cast<double>(step), 0.0, 1.0);
+                expected = std::clamp(out[j] + g * (in[j] - out[j]), -32768.0, 32767.0);
+            }
+            if (std::abs(mixed[j] - expected) > 1.5) {
+                report("mix", false, std::string("kernel=") + (i % 2 == 0 ? "vector" : "scalar") + " channels=" + std::to_string(channels) +
+                                     " samples=" + std::to_string(samples) + " index=" + std::to_string(j));
+                return;
+            }
+        }
+    }
+    report("mix", true);
+}
+
+// Time the vectorized crossfade against the scalar one on full buffers, for mono and stereo
+static void benchMix(std::mt19937 & rng) {
+#if defined(__ARM_NEON)
+    const char * simd = "neon";
+#elif defined(__SSE2__)
+    const char * simd = "sse2";
+#else
+    const char * simd = "none";
+#endif
+    std::vector<int16_t> in(mixSamples), out(mixSamples);
+    randomSamples(rng, in);
+    randomSamples(rng, out);
+    const size_t buffers = 20000;
+    for (int channels = 1; channels <= 2; channels++) {
+        double vectorSecs = timeIt([&]() {
+            for (size_t i = 0; i < buffers; i++) {
+                Utils::Mix::crossfade(in.data(), out.data(), mixSamples, channels, 0.5f, 1.0f/(buffers * mixSamples));
+            }
+        });
+        double scalarSecs = timeIt([&]() {
+            for (size_t i = 0; i < buffers; i++) {
+                Utils::Mix::crossfadeScalar(in.data(), out.data(), mixSamples, channels, 0.5f, 1.0f/(buffers * mixSamples));
+            }
+        });
+        std::printf("bench=mix simd=%s channels=%d samples=%zu scalar_ns_per_sample=%.3f vector_ns_per_sample=%.3f speedup=%.2f\n", simd, channels,
+                    buffers * mixSamples, scalarSecs * 1e9/(buffers * mixSamples), vectorSecs * 1e9/(buffers * mixSamples), scalarSecs/vectorSecs);
+    }
+}
+
+namespace Bench {
+    void mix(std::mt19937 & rng, const bool benchmark) {
+        checkMix(rng);
+        if (benchmark) {
+            benchMix(rng);
+        }
+    }
+};
\ No newline at end of file
@@ -0,0 +1,134 @@
+// Checks and benchmarks for the play queue's IndexedList
+
+#include <algorithm>
+#include "Bench.hpp"
+#include <climits>
+#include <cstdio>
+#include "IndexedList.hpp"
+#include <vector>
+
+using Bench::report;
+using Bench::timeIt;
+
+// Apply random inserts, erases and moves to an IndexedList and a vector, comparing them after each
+static void checkIndexedList(std::mt19937 & rng) {
+    const size_t max = 5000;
+    IndexedList list(max);
+    std::vector<SongID> ref;
+    for (size_t i = 0; i < checkOps; i++) {
+        size_t op = rng() % 100;
+        if (op < 50) {
+            size_t pos = rng() % (ref.size() + 2);
+            SongID id = rng() % INT_MAX;
+            bool added = list.insert(pos, id);
+            if (added != (ref.size() < max)) {
+                report("indexed_list", false, "op=insert size=" + std::to_string(ref.size()));
+                return;
+            }
+            if (added) {
+                ref.insert(ref.begin() + std::min(pos, ref.size()), id);
+            }
+
+        } else if (op < 80) {
+            size_t pos = rng() % (ref.size() + 1);
+            if (list.erase(pos) != (pos < ref.size())) {
+                report("indexed_list", false, "op=erase size=" + std::to_string(ref.size()));
+                return;
+            }
+            if (pos < ref.size()) {
+                ref.erase(ref.begin() + pos);
+            }
+
+        } else if (op < 99) {
+            if (!ref.empty()) {
+                size_t from = rng() % ref.size();
+                size_t to = rng() % ref.size();
+                list.move(from, to);
+                SongID id = ref[from];
+                ref.erase(ref.begin() + from);
+                ref.insert(ref.begin() + to, id);
+            }
+
+        } else if (rng() % 20 == 0) {
+            list.clear();
+            ref.clear();
+        }
+
+        // Compare the size and a random position each time, and everything occasionally
+        bool same = (list.size() == ref.size() && list.empty() == ref.empty() && list.at(ref.size()) == -1);
+        if (same && !ref.empty()) {
+            size_t pos = rng() % ref.size();
+            same = (list.at(pos) == ref[pos]);
+        }
+        for (size_t j = 0; same && i % 10000 == 0 && j < ref.size(); j++) {
+            same = (list.at(j) == ref[j]);
+        }
+        if (!same) {
+            report("indexed_list", false, "op=compare size=" + std::to_string(ref.size()));
+            return;
+        }
+    }
+    report("indexed_list", true);
+}
+
+// Time positional operations on a full queue, along with a vector for comparison
+static void benchIndexedList(std::mt19937 & rng) {
+    IndexedList list(benchQueueSize + benchOps);
+    std::vector<SongID> vec;
+    double secs = timeIt([&]() {
+        for (size_t i = 0; i < benchQueueSize; i++) {
+            list.insert(i, i);
+        }
+    });
+    std::printf("bench=indexed_list op=append n=%zu ns_per_op=%.1f\n", benchQueueSize, secs * 1e9/benchQueueSize);
+    for (size_t i = 0; i < benchQueueSize; i++) {
+        vec.push_back(i);
+    }
+
+    // Use the same positions for both
+    std::vector<size_t> positions(benchOps * 2);
+    for (size_t & pos : positions) {
+        pos = rng() % benchQueueSize;
+    }
+    size_t sum = 0;
+    secs = timeIt([&]() {
+        for (size_t i = 0; i < benchOps; i++) {
+            sum += list.at(positions[i]);
+        }
+    });
+    std::printf("bench=indexed_list op=at n=%zu ns_per_op=%.1f\n", benchOps, secs * 1e9/benchOps);
+    secs = timeIt([&]() {
+        for (size_t i = 0; i < benchOps; i++) {
+            list.move(positions[2*i], positions[2*i + 1]);
+        }
+    });
+    std::printf("bench=indexed_list op=move n=%zu ns_per_op=%.1f\n", benchOps, secs * 1e9/benchOps);
+
+    // The vector is much slower, so fewer operations are timed
+    const size_t vecOps = benchOps/100;
+    secs = timeIt([&]() {
+        for (size_t i = 0; i < vecOps; i++) {
+            SongID id = vec[positions[2*i]];
+            vec.erase(vec.begin() + positions[2*i]);
+            vec.insert(vec.begin() + positions[2*i + 1], id);
+        }
+    });
+    std::printf("bench=vector op=move n=%zu ns_per_op=%.1f\n", vecOps, secs * 1e9/vecOps);
+    secs = timeIt([&]() {
+        for (size_t i = 0; i < benchOps; i++) {
+            list.erase(positions[i] % list.size());
+            list.insert(positions[benchOps + i], i);
+        }
+    });
+    std::printf("bench=indexed_list op=erase_insert n=%zu ns_per_op=%.1f\n", benchOps, secs * 1e9/benchOps);
+    Bench::sink = sum;
+}
+
+namespace Bench {
+    void queue(std::mt19937 & rng, const bool benchmark) {
+        checkIndexedList(rng);
+        if (benchmark) {
+            benchIndexedList(rng);
+        }
+    }
+};
\ No newline at end of file
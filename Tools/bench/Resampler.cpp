@@ -0,0 +1,142 @@
+// Checks and benchmarks for the resampler
+
+#include <algorithm>
+#include "Bench.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include "dsp/Resampler.hpp"
+#include <iterator>
+#include <vector>
+
+using Bench::report;
+
+// Resample a stereo sine wave, returning the output frames (the input must be pushed in blocks no larger than capacity())
+static std::vector<int16_t> resample(Dsp::Resampler & resampler, const std::vector<int16_t> & input, const size_t block) {
+    std::vector<int16_t> output;
+    std::vector<int16_t> buf(2 * 4096);
+    size_t pushed = 0;
+    bool flushed = false;
+    while (true) {
+        size_t frames = resampler.pull(buf.data(), buf.size()/2);
+        output.insert(output.end(), buf.begin(), buf.begin() + 2 * frames);
+        if (frames > 0) {
+            continue;
+        }
+
+        if (pushed < input.size()/2) {
+            size_t num = std::min({block, resampler.capacity(), input.size()/2 - pushed});
+            resampler.push(input.data() + 2 * pushed, num);
+            pushed += num;
+        } else if (!flushed) {
+            resampler.flush();
+            flushed = true;
+        } else {
+            break;
+        }
+    }
+    return output;
+}
+
+// Returns a stereo sine wave of the given frequency, rate and length
+static std::vector<int16_t> sine(const double freq, const long rate, const size_t frames) {
+    std::vector<int16_t> buf(2 * frames);
+    for (size_t i = 0; i < frames; i++) {
+        buf[2*i] = buf[2*i + 1] = std::lround(16384.0 * std::sin(2.0 * M_PI * freq * i/rate));
+    }
+    return buf;
+}
+
+// Returns the signal to noise ratio (in dB) of the left channel, measured against the best fitting sine wave of the given frequency
+static double sineSNR(const std::vector<int16_t> & buf, const double freq, const long rate, const size_t skip) {
+    // Least squares fit of a * sin + b * cos (the frequency is known, so only the amplitude and phase are needed)
+    double ss = 0, cc = 0, sc = 0, xs = 0, xc = 0;
+    size_t frames = buf.size()/2;
+    for (size_t i = skip; i + skip < frames; i++) {
+        double s = std::sin(2.0 * M_PI * freq * i/rate);
+        double c = std::cos(2.0 * M_PI * freq * i/rate);
+        ss += s * s;
+        cc += c * c;
+        sc += s * c;
+        xs += buf[2*i] * s;
+        xc += buf[2*i] * c;
+    }
+    double det = ss * cc - sc * sc;
+    double a = (xs * cc - xc * sc)/det;
+    double b = (xc * ss - xs * sc)/det;
+
+    double signal = 0, noise = 0;
+    for (size_t i = skip; i + skip < frames; i++) {
+        double fit = a * std::sin(2.0 * M_PI * freq * i/rate) + b * std::cos(2.0 * M_PI * freq * i/rate);
+        signal += fit * fit;
+        noise += (buf[2*i] - fit) * (buf[2*i] - fit);
+    }
+    return 10.0 * std::log10(signal/std::max(noise, 1e-9));
+}
+
+// Rates converted by the checks and benchmark
+static const long rates[] = {44100, 32000, 22050};
+// Each quality preset, along with it's name and the lowest signal to noise ratio it must keep a sine wave at
+static const Dsp::Resampler::Quality qualities[] = {Dsp::Resampler::Quality::Low, Dsp::Resampler::Quality::Medium, Dsp::Resampler::Quality::High};
+static const char * names[] = {"low", "medium", "high"};
+static const double minSNR[] = {40.0, 55.0, 60.0};
+// Number of times each benchmark is repeated (the fastest is reported, as it's least disturbed by anything else running)
+constexpr size_t benchRuns = 5;
+
+// Check common rates are converted to 48kHz at the right length and without noticeably changing a sine wave
+static void checkResampler() {
+    bool passed = true;
+    for (const long rate : rates) {
+        std::vector<int16_t> input = sine(1000.0, rate, audioSecs * rate);
+        for (size_t q = 0; q < 3; q++) {
+            Dsp::Resampler resampler(rate, 48000, 2, qualities[q]);
+            std::vector<int16_t> output = resample(resampler, input, 1000);
+
+            // Allow for the filter's delay and the silence flushed through it
+            double expected = static_cast<double>(input.size()/2) * 48000/rate;
+            double frames = output.size()/2;
+            double snr = sineSNR(output, 1000.0, 48000, 4800);
+            if (std::abs(frames - expected) > 64 || snr < minSNR[q]) {
+                report("resampler", false, "rate=" + std::to_string(rate) + " quality=" + names[q] + " frames=" + std::to_string(output.size()/2) +
+                                           " expected=" + std::to_string(expected) + " snr_db=" + std::to_string(snr));
+                passed = false;
+            }
+        }
+    }
+    if (passed) {
+        report("resampler", true);
+    }
+}
+
+// Time each quality preset converting each rate to 48kHz, reporting the cost of each second of audio (and the share of one core that is)
+static void benchResampler() {
+    for (size_t q = 0; q < 3; q++) {
+        double totalSecs = 0;
+        for (const long rate : rates) {
+            std::vector<int16_t> input = sine(1000.0, rate, audioSecs * rate);
+            std::vector<int16_t> output;
+            double secs = 0;
+            for (size_t i = 0; i < benchRuns; i++) {
+                Dsp::Resampler resampler(rate, 48000, 2, qualities[q]);
+                double runSecs = Bench::timeIt([&]() {
+                    output = resample(resampler, input, 1000);
+                });
+                secs = (i == 0 ? runSecs : std::min(secs, runSecs));
+            }
+            totalSecs += secs;
+            std::printf("bench=resampler quality=%s rate=%ld snr_db=%.1f us_per_audio_sec=%.1f ns_per_frame=%.2f realtime_factor=%.1f\n", names[q], rate,
+                        sineSNR(output, 1000.0, 48000, 4800), secs * 1e6/audioSecs, secs * 1e9/(output.size()/2), audioSecs/secs);
+        }
+        double perSec = totalSecs/(audioSecs * std::size(rates));
+        std::printf("bench=resampler quality=%s rate=all us_per_audio_sec=%.1f core_pct=%.3f\n", names[q], perSec * 1e6, perSec * 100.0);
+    }
+}
+
+namespace Bench {
+    void resampler(std::mt19937 & rng, const bool benchmark) {
+        checkResampler();
+        if (benchmark) {
+            benchResampler();
+        }
+    }
+};
\ No newline at end of file
@@ -0,0 +1,87 @@
+// Checks and benchmarks for the rewind cache
+
+#include <algorithm>
+#include "Bench.hpp"
+#include <cstdint>
+#include <cstdio>
+#include "RewindCache.hpp"
+#include <vector>
+
+using Bench::report;
+using Bench::timeIt;
+
+// Record a ramp into the cache in uneven chunks (as decoded buffers arrive), then check what can be rewound to and read back
+static void checkRewindCache(std::mt19937 & rng, const bool benchmark) {
+    const long rate = 48000;
+    const size_t frames = audioSecs * rate;
+    std::vector<int16_t> ramp(2 * frames);
+    for (size_t i = 0; i < frames; i++) {
+        ramp[2*i] = static_cast<int16_t>(i);
+        ramp[2*i + 1] = static_cast<int16_t>(~i);
+    }
+
+    RewindCache cache;
+    cache.setLength(1, 2);
+    cache.reset(rate, 2);
+    size_t recorded = 0;
+    double secs = timeIt([&]() {
+        while (recorded < frames) {
+            size_t num = std::min<size_t>(1 + rng() % 4096, frames - recorded);
+            cache.record(reinterpret_cast<const uint8_t *>(ramp.data() + 2 * recorded), num * 2 * sizeof(int16_t));
+            recorded += num;
+        }
+    });
+    if (benchmark) {
+        std::printf("bench=rewind_cache op=record ns_per_frame=%.3f\n", secs * 1e9/frames);
+    }
+
+    // The first second and last two seconds are cached, and reading stops at the gap between them
+    struct Case {
+        size_t pos;
+        bool cached;
+        size_t readable;
+    };
+    const Case cases[] = {
+        {0, true, rate},
+        {rate/2, true, rate/2},
+        {rate, false, 0},
+        {frames/2, false, 0},
+        {frames - 2*rate - 1, false, 0},
+        {frames - 2*rate, true, 2*rate},
+        {frames - 1, true, 1},
+        {frames, true, 0}
+    };
+    std::vector<int16_t> buf(2 * 3 * rate);
+    for (const Case & c : cases) {
+        bool cached = cache.rewind(c.pos);
+        size_t read = 0;
+        if (cached) {
+            // Read in odd sizes to cross the end of the ring
+            size_t bytes;
+            while ((bytes = cache.read(reinterpret_cast<uint8_t *>(buf.data() + 2 * read), (1 + rng() % 3000) * 2 * sizeof(int16_t))) > 0) {
+                read += bytes/(2 * sizeof(int16_t));
+            }
+        }
+        bool ok = (cached == c.cached && read == c.readable && std::equal(buf.begin(), buf.begin() + 2 * read, ramp.begin() + 2 * c.pos));
+        ok = ok && (!cached || cache.position() == c.pos + read) && cache.synced() == (!cached || c.pos + read == frames);
+        if (!ok) {
+            report("rewind_cache", false, "pos=" + std::to_string(c.pos) + " cached=" + std::to_string(cached) + " read=" + std::to_string(read));
+            return;
+        }
+        cache.rewind(frames);
+    }
+
+    // Seeking discards recent audio but keeps the start
+    cache.seeked(frames/2);
+    if (cache.rewind(frames - 1) || !cache.rewind(0) || !cache.rewind(frames/2)) {
+        report("rewind_cache", false, "op=seeked");
+        return;
+    }
+    report("rewind_cache", true);
+}
+
+namespace Bench {
+    void rewindCache(std::mt19937 & rng, const bool benchmark) {
+        checkRewindCache(rng, benchmark);
+    }
+};
\ No newline at end of file
@@ -0,0 +1,115 @@
+// Checks and benchmarks for the play queue's ShuffleOrder
+
+#include "Bench.hpp"
+#include <cstdio>
+#include "ShuffleOrder.hpp"
+#include <vector>
+
+using Bench::report;
+using Bench::timeIt;
+
+// Check shuffle orders are permutations which start with the chosen index and depend only on the seed,
+// then apply random edits to one and a vector holding the same order, comparing them after each
+static void checkShuffleOrder(std::mt19937 & rng) {
+    const size_t sizes[] = {1, 2, 3, 7, 64, 1000, 25000};
+    for (const size_t size : sizes) {
+        size_t first = rng() % size;
+        uint64_t seed = (static_cast<uint64_t>(rng()) << 32) | rng();
+        ShuffleOrder order(size, first, seed);
+        ShuffleOrder same(size, first, seed);
+        ShuffleOrder other(size, first, seed + 1);
+        std::vector<bool> seen(size, false);
+        bool ok = (order.size() == size && order.index(0) == first && order.seed() == seed);
+        size_t differences = 0;
+        for (size_t i = 0; ok && i < size; i++) {
+            size_t idx = order.index(i);
+            ok = (idx < size && !seen[idx] && same.index(i) == idx);
+            seen[idx] = true;
+            differences += (other.index(i) != idx ? 1 : 0);
+        }
+        if (!ok || (size >= 64 && differences == 0)) {
+            report("shuffle_order", false, "op=create size=" + std::to_string(size));
+            return;
+        }
+    }
+
+    // Start empty (as when every song is removed from a shuffled queue), so songs added while shuffled are covered too
+    ShuffleOrder order(0, 0, rng());
+    std::vector<size_t> ref;
+    size_t unshuffled = 0;
+    for (size_t i = 0; i < checkOps/4; i++) {
+        size_t op = rng() % 100;
+        if (op < 50 || ref.empty()) {
+            // New songs are appended to the unshuffled queue
+            size_t pos = rng() % (ref.size() + 1);
+            order.insert(pos);
+            ref.insert(ref.begin() + pos, unshuffled++);
+
+        } else if (op < 80) {
+            // The returned index is removed from the unshuffled queue, moving those after it up
+            size_t pos = rng() % ref.size();
+            size_t idx = order.erase(pos);
+            if (idx != ref[pos]) {
+                report("shuffle_order", false, "op=erase size=" + std::to_string(ref.size()));
+                return;
+            }
+            ref.erase(ref.begin() + pos);
+            for (size_t & r : ref) {
+                r -= (r > idx ? 1 : 0);
+            }
+            unshuffled--;
+
+        } else {
+            size_t from = rng() % ref.size();
+            size_t to = rng() % ref.size();
+            order.move(from, to);
+            size_t idx = ref[from];
+            ref.erase(ref.begin() + from);
+            ref.insert(ref.begin() + to, idx);
+        }
+
+        bool same = (order.size() == ref.size());
+        if (same && !ref.empty()) {
+            size_t pos = rng() % ref.size();
+            same = (order.index(pos) == ref[pos]);
+        }
+        if (!same) {
+            report("shuffle_order", false, "op=compare size=" + std::to_string(ref.size()));
+            return;
+        }
+    }
+    report("shuffle_order", true);
+}
+
+// Time the shuffle order on a full queue
+static void benchShuffleOrder(std::mt19937 & rng) {
+    std::vector<size_t> positions(benchOps * 2);
+    for (size_t & pos : positions) {
+        pos = rng() % benchQueueSize;
+    }
+    size_t sum = 0;
+    ShuffleOrder order(benchQueueSize, 0, rng());
+    double secs = timeIt([&]() {
+        for (size_t i = 0; i < benchOps; i++) {
+            sum += order.index(positions[i]);
+        }
+    });
+    std::printf("bench=shuffle_order op=index n=%zu ns_per_op=%.1f\n", benchOps, secs * 1e9/benchOps);
+    secs = timeIt([&]() {
+        for (size_t i = 0; i < benchOps/10; i++) {
+            order.move(positions[2*i], positions[2*i + 1]);
+            sum += order.index(positions[2*i + 1]);
+        }
+    });
+    std::printf("bench=shuffle_order op=move n=%zu ns_per_op=%.1f\n", benchOps/10, secs * 1e9/(benchOps/10));
+    Bench::sink = sum;
+}
+
+namespace Bench {
+    void shuffle(std::mt19937 & rng, const bool benchmark) {
+        checkShuffleOrder(rng);
+        if (benchmark) {
+            benchShuffleOrder(rng);
+        }
+    }
+};
\ No newline at end of file
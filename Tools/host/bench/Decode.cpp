@@ -0,0 +1,251 @@
+// Measures how quickly the sysmodule's sources decode a corpus of songs, so regressions can be caught before
+// they become underruns on the console. Each file is decoded from start to finish through Source::decode() in
+// buffers of the default size, and is also seeked around in. MP3s (which have the most options) are decoded
+// again with the 32-band equalizer on, and seeked with fuzzy seeking, accurate seeking from scratch and
+// accurate seeking using the stored index. A useful corpus covers CBR and VBR MP3s at 44.1kHz and 48kHz, in
+// mono and stereo, along with a file of each other format.
+//
+// Results are printed one per line as key=value pairs so runs can be compared by a script:
+//   bench=decode ... realtime_factor, ns_per_sample (per sample of each channel output)
+//   bench=seek ...   us_per_seek (including decoding the first buffer after each seek)
+// Along with allocations (made with new, during one run), heap_peak_bytes (most allocated with new at once by
+// the source, see Heap.hpp) and rss_peak_kb (the process's peak resident size so far, which includes memory the codec
+// libraries allocate themselves). Timings are the fastest of the given number of runs.
+//
+// Build (from Tools/host): make decode-bench (needs the codec libraries to decode anything but raw PCM)
+//
+// Usage: decode-bench [-d directory (default: bench)] [-r runs (default: 3)] files or folders...
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include "Heap.hpp"
+#include "Log.hpp"
+#include "Paths.hpp"
+#include <random>
+#include "sources/FLAC.hpp"
+#include "sources/MP3.hpp"
+#include "sources/Opus.hpp"
+#include "sources/Vorbis.hpp"
+#include <string>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "utils/FS.hpp"
+#include <vector>
+
+// Bytes decoded at a time (matches the default buffer_size in sys_config.ini)
+constexpr size_t bufferSize = 50 * 1024;
+// Number of random positions seeked to in each file
+constexpr size_t seekCount = 20;
+
+// Returns the codec used for the file (as chosen by MainService::openSource())
+static std::string codec(const std::string & path) {
+    std::string ext = Utils::Fs::getExtension(path);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) {
+        return std::tolower(c);
+    });
+    if (ext == ".flac") {
+        return "flac";
+    } else if (ext == ".ogg" || ext == ".oga") {
+        return "vorbis";
+    } else if (ext == ".opus") {
+        return "opus";
+    }
+    return "mp3";
+}
+
+// Opens the file with the source for it's codec
+static Source * openSource(const std::string & path) {
+    std::string type = codec(path);
+    if (type == "flac") {
+        return new FLAC(path);
+    } else if (type == "vorbis") {
+        return new Vorbis(path);
+    } else if (type == "opus") {
+        return new Opus(path);
+    }
+    return new MP3(path);
+}
+
+// Returns the process's peak resident size in kB
+static long peakRSS() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Returns the seconds since the given time
+static double since(const std::chrono::steady_clock::time_point & start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Decodes the whole file the given number of times, printing the fastest (returns false if it can't be opened)
+static bool benchDecode(const std::string & path, const std::string & name, const size_t runs, const bool eq) {
+    std::vector<unsigned char> buf(bufferSize);
+    double best = 0;
+    size_t bytes = 0;
+    size_t allocations = 0;
+    size_t peak = 0;
+    int channels = 0;
+    long rate = 0;
+    for (size_t run = 0; run < runs; run++) {
+        Heap::resetPeak();
+        size_t startBytes = Heap::current();
+        size_t startAllocs = Heap::allocations();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Source * source = openSource(path);
+        if (!source->valid()) {
+            delete source;
+            return false;
+        }
+        channels = source->channels();
+        rate = source->sampleRate();
+        bytes = 0;
+        while (!source->done()) {
+            size_t dec = source->decode(buf.data(), buf.size());
+            if (dec == 0 && !source->done()) {
+                break;
+            }
+            bytes += dec;
+        }
+        delete source;
+
+        double secs = since(start);
+        best = (run == 0 ? secs : std::min(best, secs));
+        allocations = Heap::allocations() - startAllocs;
+        peak = Heap::peak() - startBytes;
+    }
+
+    size_t samples = bytes/sizeof(int16_t);
+    double audioSecs = static_cast<double>(samples)/(channels * rate);
+    std::printf("bench=decode file=%s codec=%s rate=%ld channels=%d eq=%d audio_secs=%.2f decode_ms=%.2f realtime_factor=%.1f ns_per_sample=%.2f "
+                "allocations=%zu heap_peak_bytes=%zu rss_peak_kb=%ld\n", name.c_str(), codec(path).c_str(), rate, channels, (eq ? 1 : 0), audioSecs,
+                best * 1e3, audioSecs/best, best * 1e9/std::max<size_t>(samples, 1), allocations, peak, peakRSS());
+    return true;
+}
+
+// Seeks to random positions in a newly opened source (decoding a buffer after each), printing the fastest of the given number of runs.
+// The stored index is removed first unless the mode is 'indexed'.
+static void benchSeek(const std::string & path, const std::string & name, const size_t runs, const std::string & mode) {
+    std::vector<unsigned char> buf(bufferSize);
+    double best = 0;
+    double bestOpen = 0;
+    size_t allocations = 0;
+    size_t peak = 0;
+    for (size_t run = 0; run < runs; run++) {
+        if (mode != "indexed") {
+            std::filesystem::remove_all(Path::Sys::SeekIndexFolder);
+        }
+
+        // Use the same positions each run
+        std::mt19937 rng(1);
+        Heap::resetPeak();
+        size_t startBytes = Heap::current();
+        size_t startAllocs = Heap::allocations();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Source * source = openSource(path);
+        double openSecs = since(start);
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < seekCount && source->valid(); i++) {
+            source->seek(rng() % std::max(source->totalSamples(), 1));
+            source->decode(buf.data(), buf.size());
+        }
+        double secs = since(start);
+        delete source;
+
+        best = (run == 0 ? secs : std::min(best, secs));
+        bestOpen = (run == 0 ? openSecs : std::min(bestOpen, openSecs));
+        allocations = Heap::allocations() - startAllocs;
+        peak = Heap::peak() - startBytes;
+    }
+
+    std::printf("bench=seek file=%s codec=%s mode=%s seeks=%zu open_us=%.1f us_per_seek=%.1f allocations=%zu heap_peak_bytes=%zu rss_peak_kb=%ld\n",
+                name.c_str(), codec(path).c_str(), mode.c_str(), seekCount, bestOpen * 1e6, best * 1e6/seekCount, allocations, peak, peakRSS());
+}
+
+int main(int argc, char * argv[]) {
+    std::string dir = "bench";
+    size_t runs = 3;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        std::string opt = argv[i];
+        if (opt == "-d" && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (opt == "-r" && i + 1 < argc) {
+            runs = std::max<size_t>(std::strtoul(argv[++i], nullptr, 10), 1);
+
+        // Find every song in folders (paths are made absolute as the working directory changes below)
+        } else if (std::filesystem::is_directory(opt)) {
+            for (const std::filesystem::directory_entry & entry : std::filesystem::recursive_directory_iterator(opt)) {
+                std::string ext = entry.path().extension().string();
+                std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) {
+                    return std::tolower(c);
+                });
+                if (entry.is_regular_file() && (ext == ".mp3" || ext == ".flac" || ext == ".ogg" || ext == ".oga" || ext == ".opus")) {
+                    files.push_back(std::filesystem::absolute(entry.path()).string());
+                }
+            }
+        } else {
+            files.push_back(std::filesystem::absolute(opt).string());
+        }
+    }
+    if (files.empty()) {
+        std::fprintf(stderr, "Usage: %s [-d directory (default: bench)] [-r runs (default: 3)] files or folders...\n", argv[0]);
+        return 1;
+    }
+    std::sort(files.begin(), files.end());
+
+    // Seek indexes and the log are written inside the given directory, as if it were the SD card
+    if (!Utils::Fs::createPath(dir) || chdir(dir.c_str()) != 0) {
+        std::fprintf(stderr, "Unable to use directory: %s\n", dir.c_str());
+        return 1;
+    }
+    Utils::Fs::createPath(Path::Common::SwitchFolder);
+    Log::openFile(Path::Sys::LogFile, Log::Level::Warning);
+    MP3::initLib();
+    MP3::setHandleLimit(2);
+
+    // Boosts the bass and treble, so every band is used
+    std::array<float, 32> eq;
+    for (size_t i = 0; i < eq.size(); i++) {
+        eq[i] = (i < 4 ? 1.5f : (i >= 24 ? 1.3f : 1.0f));
+    }
+    std::array<float, 32> flat;
+    flat.fill(1.0f);
+
+    size_t failed = 0;
+    for (const std::string & path : files) {
+        std::string name = std::filesystem::path(path).filename().string();
+        bool mp3 = (codec(path) == "mp3");
+
+        // Seek before anything is decoded, so there's no stored index unless asked for
+        if (mp3) {
+            MP3::setAccurateSeek(false);
+            benchSeek(path, name, runs, "fuzzy");
+            MP3::setAccurateSeek(true);
+        }
+        benchSeek(path, name, runs, "accurate");
+
+        // Decoding the whole file stores it's index (for MP3s)
+        MP3::setEqualizer(flat);
+        if (!benchDecode(path, name, runs, false)) {
+            std::printf("bench=decode file=%s codec=%s result=fail\n", name.c_str(), codec(path).c_str());
+            failed++;
+            continue;
+        }
+        if (mp3) {
+            benchSeek(path, name, runs, "indexed");
+            MP3::setEqualizer(eq);
+            benchDecode(path, name, runs, true);
+            MP3::setEqualizer(flat);
+        }
+    }
+
+    MP3::freeLib();
+    Log::closeFile();
+    std::printf("files=%zu failed=%zu\n", files.size(), failed);
+    return (failed == 0 ? 0 : 1);
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+unsigned char sys_config_ini[] = {
+  0x3b, 0x50, 0x6c, 0x65, 0x61, 0x73, 0x65, 0x20, 0x64, 0x6f, 0x6e, 0x27,
+  0x74, 0x20, 0x63, 0x68, 0x61, 0x6e, 0x67, 0x65, 0x20, 0x74, 0x68, 0x65,
+  0x73, 0x65, 0x20, 0x76, 0x61, 0x6c, 0x75, 0x65, 0x73, 0x20, 0x6d, 0x61,
+  0x6e, 0x75, 0x61, 0x6c, 0x6c, 0x79, 0x21, 0x0d, 0x0a, 0x3b, 0x54, 0x68,
+  0x65, 0x20, 0x6f, 0x6e, 0x6c, 0x79, 0x20, 0x76, 0x61, 0x6c, 0x75, 0x65,
+  0x20, 0x79, 0x6f, 0x75, 0x20, 0x6d, 0x61, 0x79, 0x20, 0x6e, 0x65, 0x65,
+  0x64, 0x20, 0x74, 0x6f, 0x20, 0x63, 0x68, 0x61, 0x6e, 0x67, 0x65, 0x20,
+  0x6f, 0x75, 0x74, 0x73, 0x69, 0x64, 0x65, 0x0d, 0x0a, 0x3b, 0x6f, 0x66,
+  0x20, 0x74, 0x68, 0x65, 0x20, 0x61, 0x70, 0x70, 0x6c, 0x69, 0x63, 0x61,
+  0x74, 0x69, 0x6f, 0x6e, 0x20, 0x69, 0x73, 0x20, 0x27, 0x6c, 0x6f, 0x67,
+  0x5f, 0x6c, 0x65, 0x76, 0x65, 0x6c, 0x27, 0x2e, 0x2e, 0x2e, 0x0d, 0x0a,
+  0x3b, 0x50, 0x6f, 0x73, 0x73, 0x69, 0x62, 0x6c, 0x65, 0x20, 0x76, 0x61,
+  0x6c, 0x75, 0x65, 0x73, 0x20, 0x61, 0x72, 0x65, 0x20, 0x45, 0x72, 0x72,
+  0x6f, 0x72, 0x2c, 0x20, 0x57, 0x61, 0x72, 0x6e, 0x69, 0x6e, 0x67, 0x2c,
+  0x20, 0x53, 0x75, 0x63, 0x63, 0x65, 0x73, 0x73, 0x2c, 0x20, 0x49, 0x6e,
+  0x66, 0x6f, 0x2c, 0x20, 0x4e, 0x6f, 0x6e, 0x65, 0x0d, 0x0a, 0x0d, 0x0a,
+  0x5b, 0x56, 0x65, 0x72, 0x73, 0x69, 0x6f, 0x6e, 0x5d, 0x0d, 0x0a, 0x76,
+  0x65, 0x72, 0x73, 0x69, 0x6f, 0x6e, 0x20, 0x3d, 0x20, 0x31, 0x0d, 0x0a,
+  0x0d, 0x0a, 0x5b, 0x47, 0x65, 0x6e, 0x65, 0x72, 0x61, 0x6c, 0x5d, 0x0d,
+  0x0a, 0x62, 0x75, 0x66, 0x66, 0x65, 0x72, 0x5f, 0x63, 0x6f, 0x75, 0x6e,
+  0x74, 0x20, 0x3d, 0x20, 0x36, 0x0d, 0x0a, 0x62, 0x75, 0x66, 0x66, 0x65,
+  0x72, 0x5f, 0x73, 0x69, 0x7a, 0x65, 0x20, 0x3d, 0x20, 0x35, 0x30, 0x0d,
+  0x0a, 0x63, 0x72, 0x6f, 0x73, 0x73, 0x66, 0x61, 0x64, 0x65, 0x20, 0x3d,
+  0x20, 0x30, 0x0d, 0x0a, 0x6b, 0x65, 0x79, 0x5f, 0x63, 0x6f, 0x6d, 0x62,
+  0x6f, 0x5f, 0x65, 0x6e, 0x61, 0x62, 0x6c, 0x65, 0x64, 0x20, 0x3d, 0x20,
+  0x59, 0x65, 0x73, 0x0d, 0x0a, 0x6b, 0x65, 0x79, 0x5f, 0x63, 0x6f, 0x6d,
+  0x62, 0x6f, 0x5f, 0x6e, 0x65, 0x78, 0x74, 0x20, 0x3d, 0x20, 0x4c, 0x2b,
+  0x44, 0x52, 0x49, 0x47, 0x48, 0x54, 0x2b, 0x52, 0x53, 0x54, 0x49, 0x43,
+  0x4b, 0x0d, 0x0a, 0x6b, 0x65, 0x79, 0x5f, 0x63, 0x6f, 0x6d, 0x62, 0x6f,
+  0x5f, 0x70, 0x6c, 0x61, 0x79, 0x20, 0x3d, 0x20, 0x4c, 0x2b, 0x44, 0x55,
+  0x50, 0x2b, 0x52, 0x53, 0x54, 0x49, 0x43, 0x4b, 0x0d, 0x0a, 0x6b, 0x65,
+  0x79, 0x5f, 0x63, 0x6f, 0x6d, 0x62, 0x6f, 0x5f, 0x70, 0x72, 0x65, 0x76,
+  0x20, 0x3d, 0x20, 0x4c, 0x2b, 0x44, 0x4c, 0x45, 0x46, 0x54, 0x2b, 0x52,
+  0x53, 0x54, 0x49, 0x43, 0x4b, 0x0d, 0x0a, 0x6c, 0x6f, 0x67, 0x5f, 0x6c,
+  0x65, 0x76, 0x65, 0x6c, 0x20, 0x3d, 0x20, 0x57, 0x61, 0x72, 0x6e, 0x69,
+  0x6e, 0x67, 0x0d, 0x0a, 0x70, 0x61, 0x75, 0x73, 0x65, 0x5f, 0x6f, 0x6e,
+  0x5f, 0x73, 0x6c, 0x65, 0x65, 0x70, 0x20, 0x3d, 0x20, 0x59, 0x65, 0x73,
+  0x0d, 0x0a, 0x70, 0x61, 0x75, 0x73, 0x65, 0x5f, 0x6f, 0x6e, 0x5f, 0x75,
+  0x6e, 0x70, 0x6c, 0x75, 0x67, 0x20, 0x3d, 0x20, 0x59, 0x65, 0x73, 0x0d,
+  0x0a, 0x70, 0x72, 0x65, 0x6c, 0x6f, 0x61, 0x64, 0x20, 0x3d, 0x20, 0x35,
+  0x0d, 0x0a, 0x72, 0x65, 0x77, 0x69, 0x6e, 0x64, 0x5f, 0x72, 0x65, 0x63,
+  0x65, 0x6e, 0x74, 0x20, 0x3d, 0x20, 0x34, 0x0d, 0x0a, 0x72, 0x65, 0x77,
+  0x69, 0x6e, 0x64, 0x5f, 0x73, 0x74, 0x61, 0x72, 0x74, 0x20, 0x3d, 0x20,
+  0x31, 0x0d, 0x0a, 0x0d, 0x0a, 0x5b, 0x44, 0x53, 0x50, 0x5d, 0x0d, 0x0a,
+  0x6c, 0x69, 0x6d, 0x69, 0x74, 0x65, 0x72, 0x20, 0x3d, 0x20, 0x4e, 0x6f,
+  0x0d, 0x0a, 0x6e, 0x6f, 0x72, 0x6d, 0x61, 0x6c, 0x69, 0x7a, 0x65, 0x20,
+  0x3d, 0x20, 0x4f, 0x66, 0x66, 0x0d, 0x0a, 0x6e, 0x6f, 0x72, 0x6d, 0x61,
+  0x6c, 0x69, 0x7a, 0x65, 0x5f, 0x74, 0x61, 0x72, 0x67, 0x65, 0x74, 0x20,
+  0x3d, 0x20, 0x2d, 0x31, 0x38, 0x2e, 0x30, 0x0d, 0x0a, 0x70, 0x72, 0x65,
+  0x61, 0x6d, 0x70, 0x20, 0x3d, 0x20, 0x30, 0x2e, 0x30, 0x0d, 0x0a, 0x72,
+  0x65, 0x73, 0x61, 0x6d, 0x70, 0x6c, 0x65, 0x5f, 0x71, 0x75, 0x61, 0x6c,
+  0x69, 0x74, 0x79, 0x20, 0x3d, 0x20, 0x4d, 0x65, 0x64, 0x69, 0x75, 0x6d,
+  0x0d, 0x0a, 0x0d, 0x0a, 0x5b, 0x4d, 0x50, 0x33, 0x5d, 0x0d, 0x0a, 0x61,
+  0x63, 0x63, 0x75, 0x72, 0x61, 0x74, 0x65, 0x5f, 0x73, 0x65, 0x65, 0x6b,
+  0x20, 0x3d, 0x20, 0x4e, 0x6f, 0x0d, 0x0a, 0x64, 0x65, 0x63, 0x6f, 0x64,
+  0x65, 0x72, 0x73, 0x20, 0x3d, 0x20, 0x32, 0x0d, 0x0a, 0x65, 0x71, 0x75,
+  0x61, 0x6c, 0x69, 0x7a, 0x65, 0x72, 0x5f, 0x31, 0x5f, 0x38, 0x20, 0x3d,
+  0x20, 0x31, 0x2e, 0x30, 0x2c, 0x20, 0x31, 0x2e, 0x30, 0x2c, 0x20, 0x31,
+  0x2e, 0x30, 0x2c, 0x20, 0x31, 0x2e, 0x30, 0x2c, 0x20, 0x31, 0x2e, 0x30,
+  0x2c, 0x20, 0x31, 0x2e, 0x30, 0x2c, 0x20, 0x31, 0x2e, 0x30, 0x2c, 0x20,
+  0x31, 0x2e, 0x30, 0x0d, 0x0a, 0x65, 0x71, 0x75, 0x61, 0x6c, 0x69, 0x7a,
+  0x65, 0x72, 0x5f, 0x39, 0x5f, 0x31, 0x36, 0x20, 0x3d, 0x20, 0x31, 0x2e,
+  0x30, 0x2c, 0x20, 0x31, 0x2e, 0x30, 0x2c, 0x20, 0x31, 0x2e, 0x30, 0x2c,
+  0x20, 0x31, 0x2e, 0x30, 0x2c, 0x20, 0x31, 0x2e, 0x30, 0x2c, 0x20, 0x31,
+  0x2e, 0x30, 0x2c, 0x20, 0x31, 0x2e, 0x30, 0x2c, 0x20, 0x31, 0x2e, 0x30,
+  0x0d, 0x0a, 0x65, 0x71, 0x75, 0x61, 0x6c, 0x69, 0x7a, 0x65, 0x72, 0x5f,
+  0x31, 0x37, 0x5f, 0x32, 0x34, 0x20, 0x3d, 0x20, 0x31, 0x2e, 0x30, 0x2c,
+  0x20, 0x31, 0x2e, 0x30, 0x2c, 0x20, 0x31, 0x2e, 0x30, 0x2c, 0x20, 0x31,
+  0x2e, 0x30, 0x2c, 0x20, 0x31, 0x2e, 0x30, 0x2c, 0x20, 0x31, 0x2e, 0x30,
+  0x2c, 0x20, 0x31, 0x2e, 0x30, 0x2c, 0x20, 0x31, 0x2e, 0x30, 0x0d, 0x0a,
+  0x65, 0x71, 0x75, 0x61, 0x6c, 0x69, 0x7a, 0x65, 0x72, 0x5f, 0x32, 0x35,
+  0x5f, 0x33, 0x32, 0x20, 0x3d, 0x20, 0x31, 0x2e, 0x30, 0x2c, 0x20, 0x31,
+  0x2e, 0x30, 0x2c, 0x20, 0x31, 0x2e, 0x30, 0x2c, 0x20, 0x31, 0x2e, 0x30,
+  0x2c, 0x20, 0x31, 0x2e, 0x30, 0x2c, 0x20, 0x31, 0x2e, 0x30, 0x2c, 0x20,
+  0x31, 0x2e, 0x30, 0x2c, 0x20, 0x31, 0x2e, 0x30
+};
+unsigned int sys_config_ini_size = 896;
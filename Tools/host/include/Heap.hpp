@@ -0,0 +1,20 @@
+// Counts the memory allocated with new, which is how nearly everything in the sysmodule is allocated,
+// so the peak can be used to size the console's heap (see INNER_HEAP_SIZE in Sysmodule/source/main.cpp).
+// Memory the codec libraries allocate with malloc isn't counted.
+#ifndef HEAP_HPP
+#define HEAP_HPP
+
+#include <cstddef>
+
+namespace Heap {
+    // Returns the number of bytes currently allocated
+    size_t current();
+    // Returns the most bytes allocated at once since the last reset
+    size_t peak();
+    // Returns the number of allocations made
+    size_t allocations();
+    // Resets the peak to what's currently allocated
+    void resetPeak();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,73 @@
+// Stand-in for minIni's C++ class, providing only the functions the sysmodule's Config uses. As with
+// minIni, the file is read again on every call (so changes are seen without reopening it), sections
+// and keys are compared ignoring case, and lines starting with ';' or '#' are comments.
+#ifndef MININI_H
+#define MININI_H
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <strings.h>
+
+class minIni {
+    private:
+        std::string filename;
+
+        // Returns the string without surrounding whitespace
+        static std::string trim(const std::string & str) {
+            size_t start = str.find_first_not_of(" \t\r\n");
+            if (start == std::string::npos) {
+                return "";
+            }
+            return str.substr(start, str.find_last_not_of(" \t\r\n") - start + 1);
+        }
+
+    public:
+        minIni(const std::string & filename) : filename(filename) {
+
+        }
+
+        std::string gets(const std::string & section, const std::string & key, const std::string & def = "") const {
+            std::ifstream file(this->filename);
+            std::string line;
+            bool inSection = false;
+            while (std::getline(file, line)) {
+                line = trim(line);
+                if (line.empty() || line[0] == ';' || line[0] == '#') {
+                    continue;
+                }
+
+                // Check whether each section is the one we want
+                if (line[0] == '[') {
+                    size_t end = line.find(']');
+                    inSection = (end != std::string::npos && strcasecmp(trim(line.substr(1, end - 1)).c_str(), section.c_str()) == 0);
+                    continue;
+                }
+
+                size_t eq = line.find('=');
+                if (inSection && eq != std::string::npos && strcasecmp(trim(line.substr(0, eq)).c_str(), key.c_str()) == 0) {
+                    return trim(line.substr(eq + 1));
+                }
+            }
+            return def;
+        }
+
+        long geti(const std::string & section, const std::string & key, long def = 0) const {
+            std::string str = this->gets(section, key);
+            return (str.empty() ? def : std::strtol(str.c_str(), nullptr, 0));
+        }
+
+        bool getbool(const std::string & section, const std::string & key, bool def = false) const {
+            std::string str = this->gets(section, key);
+            char c = (str.empty() ? '\0' : std::toupper(str[0]));
+            if (c == 'Y' || c == 'T' || c == '1') {
+                return true;
+            } else if (c == 'N' || c == 'F' || c == '0') {
+                return false;
+            }
+            return def;
+        }
+};
+
+#endif
\ No newline at end of file
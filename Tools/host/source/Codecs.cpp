@@ -0,0 +1,164 @@
+// Stand-in for the codec sources (MP3, FLAC, Opus and Vorbis), used when the codec libraries aren't installed.
+// Every file is read as headerless 16-bit stereo PCM at 44.1kHz whatever it's extension, so songs still take
+// the same path through the service (including being resampled to the output rate).
+#include <cstdint>
+#include "Log.hpp"
+#include "nx/File.hpp"
+#include "sources/FLAC.hpp"
+#include "sources/MP3.hpp"
+#include "sources/Opus.hpp"
+#include "sources/Vorbis.hpp"
+
+constexpr int rawChannels = 2;                                  // Channels in every file
+constexpr long rawRate = 44100;                                 // Sample rate of every file
+constexpr size_t rawFrameSize = rawChannels * sizeof(int16_t);  // Bytes per sample of every channel
+
+// Opens the file and sets the source's format, returning nullptr if it can't be read
+static NX::File * openRaw(const std::string & path, int & channels, long & rate, int & total, bool & valid) {
+    NX::File * file = new NX::File(path);
+    if (file->length() < 0) {
+        delete file;
+        valid = false;
+        return nullptr;
+    }
+
+    channels = rawChannels;
+    rate = rawRate;
+    total = (file->length()/rawFrameSize > 0 ? file->length()/rawFrameSize : 1);
+    return file;
+}
+
+// Reads whole frames into the buffer, setting done at the end of the file
+static size_t decodeRaw(NX::File * file, unsigned char * buf, size_t sz, bool & done) {
+    if (file == nullptr || done) {
+        return 0;
+    }
+
+    ssize_t read = file->read(buf, sz - (sz % rawFrameSize));
+    if (read <= 0) {
+        done = true;
+        return 0;
+    }
+    return read - (read % rawFrameSize);
+}
+
+static void seekRaw(NX::File * file, size_t pos, bool & done) {
+    if (file != nullptr && file->seek(pos * rawFrameSize, NX::File::Position::Start) >= 0) {
+        done = false;
+    }
+}
+
+static size_t tellRaw(NX::File * file) {
+    return (file == nullptr ? 0 : file->tell()/rawFrameSize);
+}
+
+FLAC::FLAC(const std::string & path) : Source() {
+    this->decoder = nullptr;
+    this->pendingPos = 0;
+    this->position = 0;
+    this->file = openRaw(path, this->channels_, this->sampleRate_, this->totalSamples_, this->valid_);
+}
+
+size_t FLAC::decode(unsigned char * buf, size_t sz) {
+    return decodeRaw(this->file, buf, sz, this->done_);
+}
+
+void FLAC::seek(size_t pos) {
+    seekRaw(this->file, pos, this->done_);
+}
+
+size_t FLAC::tell() {
+    return tellRaw(this->file);
+}
+
+FLAC::~FLAC() {
+    delete this->file;
+}
+
+MP3::MP3(const std::string & path) : Source() {
+    this->mpg = nullptr;
+    this->path = path;
+    this->fileSize = 0;
+    this->indexed = false;
+    this->seeked = false;
+    this->file = openRaw(path, this->channels_, this->sampleRate_, this->totalSamples_, this->valid_);
+}
+
+size_t MP3::decode(unsigned char * buf, size_t sz) {
+    return decodeRaw(this->file, buf, sz, this->done_);
+}
+
+void MP3::seek(size_t pos) {
+    seekRaw(this->file, pos, this->done_);
+}
+
+size_t MP3::tell() {
+    return tellRaw(this->file);
+}
+
+MP3::~MP3() {
+    delete this->file;
+}
+
+bool MP3::initLib() {
+    Log::writeWarning("[MP3] Built without codecs, reading every file as raw PCM");
+    return true;
+}
+
+void MP3::freeLib() {
+
+}
+
+void MP3::setHandleLimit(const size_t max) {
+
+}
+
+bool MP3::setAccurateSeek(const bool b) {
+    return true;
+}
+
+bool MP3::setEqualizer(const std::array<float, 32> & eq) {
+    return true;
+}
+
+Opus::Opus(const std::string & path) : Source() {
+    this->of = nullptr;
+    this->file = openRaw(path, this->channels_, this->sampleRate_, this->totalSamples_, this->valid_);
+}
+
+size_t Opus::decode(unsigned char * buf, size_t sz) {
+    return decodeRaw(this->file, buf, sz, this->done_);
+}
+
+void Opus::seek(size_t pos) {
+    seekRaw(this->file, pos, this->done_);
+}
+
+size_t Opus::tell() {
+    return tellRaw(this->file);
+}
+
+Opus::~Opus() {
+    delete this->file;
+}
+
+Vorbis::Vorbis(const std::string & path) : Source() {
+    this->vf = nullptr;
+    this->file = openRaw(path, this->channels_, this->sampleRate_, this->totalSamples_, this->valid_);
+}
+
+size_t Vorbis::decode(unsigned char * buf, size_t sz) {
+    return decodeRaw(this->file, buf, sz, this->done_);
+}
+
+void Vorbis::seek(size_t pos) {
+    seekRaw(this->file, pos, this->done_);
+}
+
+size_t Vorbis::tell() {
+    return tellRaw(this->file);
+}
+
+Vorbis::~Vorbis() {
+    delete this->file;
+}
\ No newline at end of file
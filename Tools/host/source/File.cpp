@@ -0,0 +1,120 @@
+// Stand-in for Sysmodule/source/nx/File.cpp, which reads with stdio instead of libnx's fs calls.
+// A computer's disk doesn't stall like the SD card, so there's no read buffer (or thread to fill it).
+#include <cstdio>
+#include "Log.hpp"
+#include "nx/File.hpp"
+
+namespace NX {
+    struct File::FFile {
+        std::FILE * fp;
+    };
+
+    File::FFileSystem * File::filesystem = nullptr;
+    size_t File::fileID = 0;
+
+    File::File(const std::string & path) {
+        this->buffer = nullptr;
+        this->error = true;
+        this->id = this->fileID++;
+        this->offset = 0;
+        this->size = -1;
+
+        std::FILE * fp = std::fopen(path.c_str(), "rb");
+        if (fp == nullptr) {
+            Log::writeError("[FS] Failed to open file: " + path);
+            this->file = nullptr;
+            return;
+        }
+        this->file = new FFile{fp};
+
+        // Get file size in order to seek
+        if (std::fseek(fp, 0, SEEK_END) == 0) {
+            this->size = std::ftell(fp);
+            std::fseek(fp, 0, SEEK_SET);
+            this->error = (this->size < 0);
+        }
+        if (this->error) {
+            Log::writeError("[FS] Couldn't get file size for: " + path);
+        }
+    }
+
+    ssize_t File::read(void * buf, const size_t bytes) {
+        if (this->error) {
+            return -1;
+        }
+
+        size_t read = std::fread(buf, 1, bytes, this->file->fp);
+        this->offset += read;
+        return read;
+    }
+
+    off_t File::seek(const off_t pos, const Position rel) {
+        if (this->error) {
+            return -1;
+        }
+
+        off_t target = pos;
+        if (rel == Position::Current) {
+            target += this->offset;
+        } else if (rel == Position::End) {
+            target += this->size;
+        }
+        if (target < 0 || target > this->size || std::fseek(this->file->fp, target, SEEK_SET) != 0) {
+            return -1;
+        }
+
+        this->offset = target;
+        return this->offset;
+    }
+
+    off_t File::tell() {
+        return (this->error ? -1 : this->offset);
+    }
+
+    int64_t File::length() {
+        return (this->error ? -1 : this->size);
+    }
+
+    File::~File() {
+        if (this->file != nullptr) {
+            std::fclose(this->file->fp);
+            delete this->file;
+        }
+    }
+
+    bool File::initializeService() {
+        return true;
+    }
+
+    void File::closeService() {
+
+    }
+
+    ssize_t File::readFile(void * file, void * buffer, size_t count) {
+        return static_cast<File *>(file)->read(buffer, count);
+    }
+
+    off_t File::seekFile(void * file, const off_t offset, const int type) {
+        Position position;
+        switch (type) {
+            case SEEK_SET:
+                position = Position::Start;
+                break;
+
+            case SEEK_CUR:
+                position = Position::Current;
+                break;
+
+            case SEEK_END:
+                position = Position::End;
+                break;
+
+            // If we can't handle the given type return -1 as it's an error
+            default:
+                Log::writeError("[FS] Unknown seek type");
+                return -1;
+        }
+
+        return static_cast<File *>(file)->seek(offset, position);
+    }
+};
\ No newline at end of file
@@ -0,0 +1,98 @@
+// Replaces the global new and delete with versions which count the bytes allocated. Each allocation
+// is prefixed with it's size, keeping the alignment malloc gives.
+#include <atomic>
+#include <cstdlib>
+#include "Heap.hpp"
+#include <new>
+
+static std::atomic<size_t> currentBytes = 0;    // Bytes allocated now
+static std::atomic<size_t> peakBytes = 0;       // Most bytes allocated at once
+static std::atomic<size_t> allocCount = 0;      // Number of allocations
+
+constexpr size_t headerSize = alignof(std::max_align_t);
+
+static void * allocate(size_t size) {
+    unsigned char * ptr = static_cast<unsigned char *>(std::malloc(headerSize + size));
+    if (ptr == nullptr) {
+        return nullptr;
+    }
+    *reinterpret_cast<size_t *>(ptr) = size;
+
+    size_t now = (currentBytes += size);
+    size_t peak = peakBytes;
+    while (now > peak && !peakBytes.compare_exchange_weak(peak, now));
+    allocCount++;
+    return ptr + headerSize;
+}
+
+static void deallocate(void * ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    unsigned char * base = static_cast<unsigned char *>(ptr) - headerSize;
+    currentBytes -= *reinterpret_cast<size_t *>(base);
+    std::free(base);
+}
+
+namespace Heap {
+    size_t current() {
+        return currentBytes;
+    }
+
+    size_t peak() {
+        return peakBytes;
+    }
+
+    size_t allocations() {
+        return allocCount;
+    }
+
+    void resetPeak() {
+        peakBytes = currentBytes.load();
+    }
+};
+
+// Without exceptions a failed allocation can only abort, as on the console
+void * operator new(size_t size) {
+    void * ptr = allocate(size);
+    if (ptr == nullptr) {
+        std::abort();
+    }
+    return ptr;
+}
+
+void * operator new[](size_t size) {
+    return operator new(size);
+}
+
+void * operator new(size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void * operator new[](size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void * ptr) noexcept {
+    deallocate(ptr);
+}
+
+void operator delete[](void * ptr) noexcept {
+    deallocate(ptr);
+}
+
+void operator delete(void * ptr, size_t) noexcept {
+    deallocate(ptr);
+}
+
+void operator delete[](void * ptr, size_t) noexcept {
+    deallocate(ptr);
+}
+
+void operator delete(void * ptr, const std::nothrow_t &) noexcept {
+    deallocate(ptr);
+}
+
+void operator delete[](void * ptr, const std::nothrow_t &) noexcept {
+    deallocate(ptr);
+}
\ No newline at end of file
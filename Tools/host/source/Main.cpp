@@ -0,0 +1,186 @@
+// Runs the sysmodule on a regular computer, using the stand-ins in this folder for the parts which need a
+// console (see the Makefile). Clients connect through the Unix domain socket at /tmp/triplayer.sock, which
+// is what Tools/loadgen uses.
+//
+// The SD card's folders are created inside the given directory, along with a library snapshot (usually written
+// by the application) of the given number of songs which all use the same file. If no file is given, a tone is
+// written for them instead, which is only playable when built without the codec libraries (as it's raw PCM).
+// Audio is discarded at the rate it would play unless a .wav file is given to write it to, in which case it
+// isn't paced. The service runs until it's sent the Quit command or interrupted (i.e. Ctrl+C), and then prints
+// the most memory it had allocated at once (see Heap.hpp).
+//
+// Usage: sys-triplayer-host [-d directory (default: sd)] [-n songs (default: 10000)] [-m file] [-w output.wav]
+
+#include <atomic>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "Heap.hpp"
+#include "LibrarySnapshot.hpp"
+#include "nx/Audio.hpp"
+#include "nx/NX.hpp"
+#include "Paths.hpp"
+#include "Service.hpp"
+#include "sinks/WavSink.hpp"
+#include "sources/MP3.hpp"
+#include <string>
+#include <unistd.h>
+#include "utils/FS.hpp"
+#include <vector>
+
+// Length of the generated tone in seconds
+constexpr size_t toneSecs = 30;
+// Number of songs on each generated album
+constexpr size_t albumSongs = 12;
+
+// Set when the service should exit
+static std::atomic<bool> stop = false;
+
+// Writes a stereo 440Hz tone to the given file as raw 16-bit PCM at 44.1kHz (the format read by the codec stand-in)
+static bool writeTone(const std::string & path) {
+    const long rate = 44100;
+    std::vector<unsigned char> data(toneSecs * rate * 2 * sizeof(int16_t));
+    int16_t * samples = reinterpret_cast<int16_t *>(data.data());
+    for (size_t i = 0; i < toneSecs * rate; i++) {
+        samples[2*i] = samples[2*i + 1] = std::lround(8192.0 * std::sin(2.0 * M_PI * 440.0 * i/rate));
+    }
+    return Utils::Fs::writeFile(path, data);
+}
+
+// Writes a library snapshot containing the given number of songs, which all point to the given file
+static bool writeLibrary(const size_t count, const std::string & file) {
+    std::vector<LibrarySnapshot::Song> songs;
+    for (size_t i = 0; i < count; i++) {
+        LibrarySnapshot::Song song = {};
+        song.id = i + 1;
+        song.albumID = 1 + i/albumSongs;
+        song.path = file;
+        song.title = "Song " + std::to_string(song.id);
+        song.artist = "Artist " + std::to_string(1 + song.albumID/4);
+        song.album = "Album " + std::to_string(song.albumID);
+        song.duration = toneSecs;
+        songs.push_back(song);
+    }
+
+    LibrarySnapshot library(Path::Common::LibraryFile);
+    return library.write(songs);
+}
+
+// Wrappers to call methods on MainService object (as in the sysmodule's main.cpp)
+void audioThread(void * arg) {
+    static_cast<Audio *>(arg)->process();
+}
+
+void serviceGpioThread(void * arg) {
+    static_cast<MainService *>(arg)->gpioEventThread();
+}
+
+void serviceHidThread(void * arg) {
+    static_cast<MainService *>(arg)->hidEventThread();
+}
+
+void serviceIpcThread(void * arg) {
+    static_cast<MainService *>(arg)->ipcThread();
+}
+
+void serviceIpcWorkerThread(void * arg) {
+    static_cast<MainService *>(arg)->ipcWorkerThread();
+}
+
+void servicePowerThread(void * arg) {
+    static_cast<MainService *>(arg)->sleepEventThread();
+}
+
+// Tells the service to exit once interrupted, or returns once it's exited by itself
+void serviceStopThread(void * arg) {
+    while (!stop) {
+        NX::Thread::sleepMilli(50);
+    }
+    static_cast<MainService *>(arg)->exit();
+}
+
+int main(int argc, char * argv[]) {
+    std::string dir = "sd";
+    size_t count = 10000;
+    std::string file;
+    std::string wav;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string opt = argv[i];
+        if (opt == "-d") {
+            dir = argv[i+1];
+        } else if (opt == "-n") {
+            count = std::strtoul(argv[i+1], nullptr, 10);
+        } else if (opt == "-m") {
+            file = argv[i+1];
+        } else if (opt == "-w") {
+            wav = argv[i+1];
+        }
+    }
+
+    // Everything is relative to the 'SD card'
+    if (!Utils::Fs::createPath(dir) || chdir(dir.c_str()) != 0) {
+        std::fprintf(stderr, "Unable to use directory: %s\n", dir.c_str());
+        return 1;
+    }
+    Utils::Fs::createPath(Path::Common::ConfigFolder);
+    Utils::Fs::createPath(Path::Common::SwitchFolder);
+    if (file.empty()) {
+        file = "music/tone.pcm";
+        Utils::Fs::createPath("music");
+        if (!writeTone(file)) {
+            std::fprintf(stderr, "Unable to write tone to: %s/%s\n", dir.c_str(), file.c_str());
+            return 1;
+        }
+    }
+    if (!writeLibrary(count, file)) {
+        std::fprintf(stderr, "Unable to write library to: %s/%s\n", dir.c_str(), Path::Common::LibraryFile.c_str());
+        return 1;
+    }
+
+    // Set up as __appInit() does (only counting memory from here)
+    Heap::resetPeak();
+    if (!wav.empty()) {
+        Audio::setSink(new WavSink(wav));
+    }
+    if (!NX::startServices()) {
+        std::fprintf(stderr, "Unable to start services (see %s/%s)\n", dir.c_str(), Path::Sys::LogFile.c_str());
+        return 1;
+    }
+    MP3::initLib();
+    std::printf("Running in %s with %zu songs, clients can connect to /tmp/triplayer.sock\n", dir.c_str(), count);
+    std::fflush(stdout);
+
+    // Create service and threads as main() does
+    MainService * service = new MainService();
+    NX::Thread::create("audio", audioThread, Audio::getInstance());
+    NX::Thread::create("gpio", serviceGpioThread, service);
+    NX::Thread::create("hid", serviceHidThread, service);
+    NX::Thread::create("ipc", serviceIpcThread, service);
+    NX::Thread::create("ipcwork", serviceIpcWorkerThread, service);
+    NX::Thread::create("power", servicePowerThread, service);
+    std::signal(SIGINT, [](int) { stop = true; });
+    std::signal(SIGTERM, [](int) { stop = true; });
+    NX::Thread::create("stop", serviceStopThread, service);
+
+    service->playbackThread();
+
+    // Join threads (the stop thread is told to return if the service exited by itself)
+    stop = true;
+    NX::Thread::join("stop");
+    Audio::getInstance()->exit();
+    NX::Thread::join("power");
+    NX::Thread::join("ipcwork");
+    NX::Thread::join("ipc");
+    NX::Thread::join("hid");
+    NX::Thread::join("gpio");
+    NX::Thread::join("audio");
+    std::printf("heap_peak_bytes=%zu heap_current_bytes=%zu heap_allocations=%zu\n", Heap::peak(), Heap::current(), Heap::allocations());
+    delete service;
+
+    // Clean up as __appExit() does
+    MP3::freeLib();
+    NX::stopServices();
+    return 0;
+}
\ No newline at end of file
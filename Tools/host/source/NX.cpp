@@ -0,0 +1,146 @@
+// Stand-in for Sysmodule/source/nx/NX.cpp. Threads and sleeping use the standard library, shared
+// memory is allocated normally (nothing else can map it) and gpio, hid and psc never have an event.
+#include <chrono>
+#include "Config.hpp"
+#include <cstdlib>
+#include "Log.hpp"
+#include "nx/Audio.hpp"
+#include "nx/NX.hpp"
+#include <mutex>
+#include "Paths.hpp"
+#include <thread>
+#include <unordered_map>
+
+namespace NX {
+    static bool audioInitialized = false;
+
+    bool startServices() {
+        // Prevent starting twice
+        if (audioInitialized) {
+            return true;
+        }
+
+        Log::openFile(Path::Sys::LogFile, Log::Level::Warning);
+
+        // Buffers can't be resized once created, so they're read from the config here (as on the console)
+        Config * cfg = new Config(Path::Sys::ConfigFile);
+        Audio::setBuffers(cfg->bufferCount(), cfg->bufferSize() * 1024);
+        delete cfg;
+
+        audioInitialized = Audio::getInstance()->initialized();
+        return audioInitialized;
+    }
+
+    void stopServices() {
+        if (audioInitialized) {
+            delete Audio::getInstance();
+            audioInitialized = false;
+        }
+
+        Log::closeFile();
+    }
+
+    namespace Fs {
+        void setHighPriority(const bool b) {
+
+        }
+    };
+
+    namespace Gpio {
+        bool prepare() {
+            return true;
+        }
+
+        void cleanup() {
+
+        }
+
+        bool headsetUnplugged() {
+            return false;
+        }
+    };
+
+    namespace Hid {
+        bool comboPressed(const std::vector<Button> & buttons) {
+            return false;
+        }
+    };
+
+    namespace Psc {
+        bool prepare() {
+            return true;
+        }
+
+        void cleanup() {
+
+        }
+
+        void setSleepFunc(const std::function<void()> & f) {
+
+        }
+
+        void setWakeFunc(const std::function<void()> & f) {
+
+        }
+
+        void monitor(const size_t ms) {
+            Thread::sleepMilli(ms);
+        }
+    };
+
+    namespace Shmem {
+        static void * shmem = nullptr;          // Allocated memory
+
+        // Shared memory isn't part of the console's heap, so it's allocated without new (which is counted)
+        void * create(const size_t size, uint32_t & handle) {
+            if (shmem == nullptr) {
+                shmem = std::calloc(1, size);
+            }
+            handle = 0;
+            return shmem;
+        }
+
+        void destroy() {
+            std::free(shmem);
+            shmem = nullptr;
+        }
+    };
+
+    namespace Thread {
+        static std::unordered_map<std::string, std::thread> threads;    // Map from name/id to thread object
+        static std::mutex threadMutex;                                  // Mutex protecting map
+
+        bool create(const std::string & id, void(*func)(void *), void * arg, const size_t size) {
+            std::scoped_lock<std::mutex> mtx(threadMutex);
+
+            // Don't start if thread exists
+            if (threads.count(id) > 0) {
+                return false;
+            }
+
+            threads.emplace(id, std::thread(func, arg));
+            return true;
+        }
+
+        void join(const std::string & id) {
+            // Take the thread out of the map first, so others can be created while waiting
+            std::unique_lock<std::mutex> mtx(threadMutex);
+            if (threads.count(id) == 0) {
+                return;
+            }
+            std::thread thread = std::move(threads[id]);
+            threads.erase(id);
+            mtx.unlock();
+
+            thread.join();
+        }
+
+        void sleepNano(const size_t ns) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+        }
+
+        void sleepMilli(const size_t ms) {
+            sleepNano(ms * 1000000);
+        }
+    };
+};
\ No newline at end of file
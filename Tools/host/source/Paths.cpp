@@ -0,0 +1,22 @@
+// Stand-in for Common/source/Paths.cpp, which places the SD card's folders relative to the
+// current directory instead of at the root (only the sysmodule's paths are used).
+#include "Paths.hpp"
+
+namespace Path {
+    namespace Common {
+        const std::string ConfigFolder = "config/TriPlayer/";
+        const std::string SwitchFolder = "switch/TriPlayer/";
+
+        const std::string DatabaseFile = Common::SwitchFolder + "data.sqlite3";
+        const std::string DatabaseBackupFile = Common::SwitchFolder + "data_old.sqlite3";
+        const std::string LibraryFile = Common::SwitchFolder + "library.bin";
+    };
+
+    namespace Sys {
+        const std::string ConfigFile = Common::ConfigFolder + "sys_config.ini";
+        const std::string LogFile = Common::SwitchFolder + "sysmodule.log";
+        const std::string StateFile = Common::ConfigFolder + "sys_state.bin";
+
+        const std::string SeekIndexFolder = Common::SwitchFolder + "seek/";
+    };
+};
\ No newline at end of file
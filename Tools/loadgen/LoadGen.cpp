@@ -0,0 +1,614 @@
+// Load generator for the sysmodule's IPC commands, used when the sysmodule is running on a
+// regular computer (where it listens on a Unix domain socket instead of registering a service).
+// Several simulated clients replay a random mix of polling, queue edits and seeks, while another
+// waits for changes like the app does. Optionally one more client repeatedly asks the sysmodule to reload
+// it's config, which is slow as it reads from disk and waits for the source, to check it doesn't stall the
+// others. Once finished the latency of each command is printed as percentiles and a histogram, along
+// with how much each of the sysmodule's locks was waited on.
+//
+// Alternatively (with -a), the time taken to queue a number of songs (i.e. an album) one command at a
+// time is compared against sending them all in one EditQueue, and nothing else is run.
+//
+// Build (from this directory):
+//   g++ -O2 -std=c++17 -pthread -I../../Common/include -I../../Sysmodule/include LoadGen.cpp ../../Common/source/ipc/IDList.cpp -o loadgen
+//
+// Run against the host build of the sysmodule (see Tools/host/Makefile), which creates a library of
+// 10000 songs to match the IDs used here:
+//   make -C ../host && (cd ../host && ./sys-triplayer-host &) && ./loadgen -t 30
+//
+// Usage: loadgen [-s socket] [-c clients] [-t seconds] [-r seed] [-b 1 (add slow client)] [-q songs (initially queued)]
+//                [-a songs (compare queueing them one at a time and batched, e.g. 1000)]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include "ipc/Command.hpp"
+#include "ipc/IDList.hpp"
+#include "ipc/SocketServer.hpp"
+#include "ipc/TriPlayer.hpp"
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Number of (power of two) microsecond buckets in each histogram
+constexpr size_t histogramBuckets = 24;
+// Number of songs in the queue each run starts with (unless given)
+constexpr size_t defaultQueueSize = 2000;
+// Number of times each way of queueing songs is timed when comparing them (the median is reported)
+constexpr size_t batchRounds = 5;
+
+// A connection to the sysmodule
+class Client {
+    private:
+        int fd;
+
+        bool readAll(void * buf, size_t size) {
+            uint8_t * ptr = static_cast<uint8_t *>(buf);
+            while (size > 0) {
+                ssize_t n = read(this->fd, ptr, size);
+                if (n <= 0) {
+                    return false;
+                }
+                ptr += n;
+                size -= n;
+            }
+            return true;
+        }
+
+        bool writeAll(const void * buf, size_t size) {
+            const uint8_t * ptr = static_cast<const uint8_t *>(buf);
+            while (size > 0) {
+                ssize_t n = send(this->fd, ptr, size, MSG_NOSIGNAL);
+                if (n <= 0) {
+                    return false;
+                }
+                ptr += n;
+                size -= n;
+            }
+            return true;
+        }
+
+    public:
+        Client() {
+            this->fd = -1;
+        }
+
+        bool connect(const std::string & path) {
+            sockaddr_un addr;
+            std::memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+            this->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            return (this->fd >= 0 && ::connect(this->fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0);
+        }
+
+        // Send a command and wait for the reply, returning false if the connection failed
+        // The result is set to the sysmodule's result (zero on success)
+        bool call(const Ipc::Command cmd, const std::vector<uint8_t> & args, const std::vector<uint8_t> & data, const size_t replySize,
+                  uint32_t & result, std::vector<uint8_t> & value, std::vector<uint8_t> & reply)
+        {
+            Ipc::SocketRequestHeader header{Ipc::SocketRequestMagic, 0, static_cast<uint64_t>(cmd), static_cast<uint32_t>(args.size()),
+                                            static_cast<uint32_t>(data.size()), static_cast<uint32_t>(replySize), 0};
+            if (!this->writeAll(&header, sizeof(header)) || !this->writeAll(args.data(), args.size()) || !this->writeAll(data.data(), data.size())) {
+                return false;
+            }
+
+            Ipc::SocketReplyHeader rHeader;
+            if (!this->readAll(&rHeader, sizeof(rHeader)) || rHeader.magic != Ipc::SocketReplyMagic) {
+                return false;
+            }
+            value.resize(rHeader.valueSize);
+            reply.resize(rHeader.dataSize);
+            result = rHeader.result;
+            return (this->readAll(value.data(), value.size()) && this->readAll(reply.data(), reply.size()));
+        }
+
+        ~Client() {
+            if (this->fd >= 0) {
+                close(this->fd);
+            }
+        }
+};
+
+// Append a value's bytes to a buffer
+template <typename T>
+static void append(std::vector<uint8_t> & buf, const T & val) {
+    const uint8_t * ptr = reinterpret_cast<const uint8_t *>(&val);
+    buf.insert(buf.end(), ptr, ptr + sizeof(T));
+}
+
+// Read a value from the start of a buffer (zero if it's too short)
+template <typename T>
+static T first(const std::vector<uint8_t> & buf) {
+    T val{};
+    if (buf.size() >= sizeof(T)) {
+        std::memcpy(&val, buf.data(), sizeof(T));
+    }
+    return val;
+}
+
+// Latencies recorded for one command
+struct Samples {
+    std::vector<uint32_t> us;       // Latency of each call (in microseconds)
+    size_t errors = 0;              // Number of calls the sysmodule returned an error for
+
+    void merge(const Samples & other) {
+        this->us.insert(this->us.end(), other.us.begin(), other.us.end());
+        this->errors += other.errors;
+    }
+};
+
+// Shared between all clients
+struct Shared {
+    std::string path;
+    std::atomic<bool> stop{false};
+    size_t initialQueueSize = defaultQueueSize;
+    std::atomic<size_t> queueSize{defaultQueueSize};
+    std::atomic<size_t> subQueueSize{0};
+    std::mutex mutex;
+    std::map<std::string, Samples> samples;
+};
+
+// Runs a command, recording it's latency under the given name
+static bool timedCall(Client & client, std::map<std::string, Samples> & samples, const std::string & name, const Ipc::Command cmd,
+                      const std::vector<uint8_t> & args, const std::vector<uint8_t> & data, const size_t replySize, std::vector<uint8_t> & value)
+{
+    uint32_t result;
+    std::vector<uint8_t> reply;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool ok = client.call(cmd, args, data, replySize, result, value, reply);
+    uint32_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    Samples & s = samples[name];
+    s.us.push_back(us);
+    if (ok && result != 0) {
+        s.errors++;
+    }
+    return ok;
+}
+
+// Simulates a client making a random mix of requests until told to stop
+static void clientThread(Shared * shared, const unsigned int seed) {
+    Client client;
+    if (!client.connect(shared->path)) {
+        std::printf("Client couldn't connect to %s\n", shared->path.c_str());
+        return;
+    }
+
+    // Relative weight of each type of request
+    enum class Op {GetState, GetPosition, GetStatus, QueueIdx, QueueSize, SubQueueSize, GetQueue, GetQueueChanges,
+                   EditInsert, EditRemove, EditMove, AddToSubQueue, RemoveFromSubQueue, SetPosition, SetQueueIdx};
+    const std::vector<std::pair<Op, unsigned int> > weights = {
+        {Op::GetState, 25}, {Op::GetPosition, 10}, {Op::GetStatus, 5}, {Op::QueueIdx, 5}, {Op::QueueSize, 5}, {Op::SubQueueSize, 5},
+        {Op::GetQueue, 4}, {Op::GetQueueChanges, 8}, {Op::EditInsert, 6}, {Op::EditRemove, 5}, {Op::EditMove, 4},
+        {Op::AddToSubQueue, 4}, {Op::RemoveFromSubQueue, 3}, {Op::SetPosition, 9}, {Op::SetQueueIdx, 2}
+    };
+    unsigned int total = 0;
+    for (const std::pair<Op, unsigned int> & w : weights) {
+        total += w.second;
+    }
+
+    std::mt19937 rng(seed);
+    std::map<std::string, Samples> samples;
+    std::vector<uint8_t> args, data, value;
+    uint64_t version = 0;
+    while (!shared->stop) {
+        // Pick an operation
+        unsigned int pick = rng() % total;
+        Op op = weights[0].first;
+        for (const std::pair<Op, unsigned int> & w : weights) {
+            if (pick < w.second) {
+                op = w.first;
+                break;
+            }
+            pick -= w.second;
+        }
+
+        args.clear();
+        data.clear();
+        size_t qSize = std::max<size_t>(shared->queueSize, 1);
+        bool ok = true;
+        switch (op) {
+            case Op::GetState:
+                ok = timedCall(client, samples, "GetState", Ipc::Command::GetState, args, data, 0, value);
+                break;
+
+            case Op::GetPosition:
+                ok = timedCall(client, samples, "GetPosition", Ipc::Command::GetPosition, args, data, 0, value);
+                break;
+
+            case Op::GetStatus:
+                ok = timedCall(client, samples, "GetStatus", Ipc::Command::GetStatus, args, data, 0, value);
+                break;
+
+            case Op::QueueIdx:
+                ok = timedCall(client, samples, "QueueIdx", Ipc::Command::QueueIdx, args, data, 0, value);
+                break;
+
+            case Op::QueueSize:
+                ok = timedCall(client, samples, "QueueSize", Ipc::Command::QueueSize, args, data, 0, value);
+                shared->queueSize = first<size_t>(value);
+                break;
+
+            case Op::SubQueueSize:
+                ok = timedCall(client, samples, "SubQueueSize", Ipc::Command::SubQueueSize, args, data, 0, value);
+                shared->subQueueSize = first<size_t>(value);
+                break;
+
+            case Op::GetQueue:
+                append(args, static_cast<size_t>(rng() % qSize));
+                append(args, static_cast<size_t>(100));
+                append(args, Ipc::IDFormat::Compact);
+                ok = timedCall(client, samples, "GetQueue", Ipc::Command::GetQueue, args, data, 100 * sizeof(int), value);
+                break;
+
+            case Op::GetQueueChanges:
+                append(args, version);
+                append(args, static_cast<size_t>(64));
+                ok = timedCall(client, samples, "GetQueueChanges", Ipc::Command::GetQueueChanges, args, data, 64 * sizeof(TriPlayer::QueueChange), value);
+                version = first<uint64_t>(value);
+                break;
+
+            case Op::EditInsert: {
+                uint32_t count = 1 + rng() % 8;
+                append(data, TriPlayer::QueueEdit{TriPlayer::QueueEditType::Insert, count, rng() % qSize, 0});
+                for (uint32_t i = 0; i < count; i++) {
+                    append(data, static_cast<int>(1 + rng() % 10000));
+                }
+                ok = timedCall(client, samples, "EditQueue (insert)", Ipc::Command::EditQueue, args, data, 0, value);
+                break;
+            }
+
+            case Op::EditRemove: {
+                // Keep the queue from shrinking away
+                uint32_t count = 1 + rng() % 4;
+                if (qSize > shared->initialQueueSize/2 + count) {
+                    append(data, TriPlayer::QueueEdit{TriPlayer::QueueEditType::Remove, count, rng() % (qSize - count), 0});
+                    ok = timedCall(client, samples, "EditQueue (remove)", Ipc::Command::EditQueue, args, data, 0, value);
+                }
+                break;
+            }
+
+            case Op::EditMove: {
+                uint32_t count = 1 + rng() % 4;
+                if (qSize > count) {
+                    append(data, TriPlayer::QueueEdit{TriPlayer::QueueEditType::Move, count, rng() % (qSize - count), rng() % (qSize - count)});
+                    ok = timedCall(client, samples, "EditQueue (move)", Ipc::Command::EditQueue, args, data, 0, value);
+                }
+                break;
+            }
+
+            case Op::AddToSubQueue:
+                append(args, static_cast<int>(1 + rng() % 10000));
+                ok = timedCall(client, samples, "AddToSubQueue", Ipc::Command::AddToSubQueue, args, data, 0, value);
+                break;
+
+            case Op::RemoveFromSubQueue:
+                if (shared->subQueueSize > 0) {
+                    append(args, static_cast<size_t>(rng() % shared->subQueueSize));
+                    ok = timedCall(client, samples, "RemoveFromSubQueue", Ipc::Command::RemoveFromSubQueue, args, data, 0, value);
+                }
+                break;
+
+            case Op::SetPosition:
+                append(args, static_cast<double>(rng() % 1000) / 10.0);
+                ok = timedCall(client, samples, "SetPosition", Ipc::Command::SetPosition, args, data, 0, value);
+                break;
+
+            case Op::SetQueueIdx:
+                append(args, static_cast<size_t>(rng() % qSize));
+                ok = timedCall(client, samples, "SetQueueIdx", Ipc::Command::SetQueueIdx, args, data, 0, value);
+                break;
+        }
+
+        if (!ok) {
+            std::printf("Client lost connection\n");
+            break;
+        }
+    }
+
+    std::scoped_lock<std::mutex> mtx(shared->mutex);
+    for (const std::pair<const std::string, Samples> & s : samples) {
+        shared->samples[s.first].merge(s.second);
+    }
+}
+
+// Waits for changes like the app does (its latency is mostly time spent held, so it's reported separately)
+static void watchThread(Shared * shared) {
+    Client client;
+    if (!client.connect(shared->path)) {
+        return;
+    }
+
+    std::map<std::string, Samples> samples;
+    std::vector<uint8_t> args, data, value;
+    uint64_t sequence = 0;
+    while (!shared->stop) {
+        args.clear();
+        append(args, sequence);
+        append(args, static_cast<uint64_t>(250));
+        append(args, TriPlayer::Change::All);
+        if (!timedCall(client, samples, "WaitForChange (held)", Ipc::Command::WaitForChange, args, data, 0, value)) {
+            break;
+        }
+        sequence = first<uint64_t>(value);
+    }
+
+    std::scoped_lock<std::mutex> mtx(shared->mutex);
+    for (const std::pair<const std::string, Samples> & s : samples) {
+        shared->samples[s.first].merge(s.second);
+    }
+}
+
+// Reloads the config like the app does after changing settings (its latency depends on the disk and playback, so it's reported separately)
+static void slowThread(Shared * shared) {
+    Client client;
+    if (!client.connect(shared->path)) {
+        return;
+    }
+
+    std::map<std::string, Samples> samples;
+    std::vector<uint8_t> args, data, value;
+    while (!shared->stop) {
+        if (!timedCall(client, samples, "ReloadConfig (slow)", Ipc::Command::ReloadConfig, args, data, 0, value)) {
+            break;
+        }
+    }
+
+    std::scoped_lock<std::mutex> mtx(shared->mutex);
+    for (const std::pair<const std::string, Samples> & s : samples) {
+        shared->samples[s.first].merge(s.second);
+    }
+}
+
+// Print percentiles and a histogram for each command
+static void printLatencies(std::map<std::string, Samples> & samples, const double seconds) {
+    std::printf("\n%-22s %9s %8s %7s %8s %8s %8s %8s\n", "Command", "Calls", "Calls/s", "Errors", "p50(us)", "p95(us)", "p99(us)", "max(us)");
+    for (std::pair<const std::string, Samples> & s : samples) {
+        std::vector<uint32_t> & us = s.second.us;
+        if (us.empty()) {
+            continue;
+        }
+        std::sort(us.begin(), us.end());
+        size_t n = us.size();
+        std::printf("%-22s %9zu %8.0f %7zu %8u %8u %8u %8u\n", s.first.c_str(), n, n / seconds, s.second.errors,
+                    us[(n - 1) * 50/100], us[(n - 1) * 95/100], us[(n - 1) * 99/100], us[n - 1]);
+    }
+
+    std::printf("\nHistogram (calls taking under each number of microseconds)\n");
+    for (const std::pair<const std::string, Samples> & s : samples) {
+        std::vector<size_t> buckets(histogramBuckets, 0);
+        for (uint32_t us : s.second.us) {
+            size_t b = 0;
+            while (b + 1 < histogramBuckets && us >= (1u << b)) {
+                b++;
+            }
+            buckets[b]++;
+        }
+
+        std::printf("%s\n", s.first.c_str());
+        for (size_t b = 0; b < histogramBuckets; b++) {
+            if (buckets[b] == 0) {
+                continue;
+            }
+            int width = static_cast<int>(60.0 * buckets[b] / s.second.us.size() + 0.5);
+            std::printf("  <%9u %9zu %s\n", (1u << b), buckets[b], std::string(width, '#').c_str());
+        }
+    }
+}
+
+// Print how much each lock was waited on
+static void printLocks(Client & client) {
+    std::vector<uint8_t> args, data, value, reply;
+    uint32_t result;
+    append(args, static_cast<uint8_t>(0));
+    size_t count = static_cast<size_t>(TriPlayer::Lock::Count);
+    if (!client.call(Ipc::Command::GetLockStats, args, data, count * sizeof(TriPlayer::LockStats), result, value, reply) || result != 0) {
+        std::printf("\nCouldn't get lock stats\n");
+        return;
+    }
+
+    const char * names[] = {"Queue", "SubQueue", "Source", "Change", "Database", "Combos", "Stats"};
+    std::printf("\n%-10s %10s %10s %9s %12s %10s\n", "Lock", "Acquired", "Contended", "Rate", "Waited(ms)", "Max(us)");
+    for (size_t i = 0; i < count && (i + 1) * sizeof(TriPlayer::LockStats) <= reply.size(); i++) {
+        TriPlayer::LockStats stats;
+        std::memcpy(&stats, &reply[i * sizeof(TriPlayer::LockStats)], sizeof(stats));
+        std::printf("%-10s %10u %10u %8.2f%% %12.1f %10u\n", names[i], stats.acquired, stats.contended,
+                    (stats.acquired ? 100.0 * stats.contended / stats.acquired : 0.0), stats.waitTotal / 1000.0, stats.waitMax);
+    }
+}
+
+// Times queueing the given number of songs one command per song (as the app used to) against a single EditQueue, for
+// both the sub-queue and the end of the queue, and removing them again each way. Nothing else is connected, so only
+// the cost of the round trips and locking is measured. Returns false if a command fails.
+static bool benchBatch(Client & client, const size_t songs, const size_t queueSize) {
+    std::vector<int> ids;
+    for (size_t i = 0; i < songs; i++) {
+        ids.push_back(1 + i % 10000);
+    }
+
+    // Each way of making a change, with the number of calls it takes and the time taken by each round
+    struct Path {
+        const char * name;
+        size_t calls;
+        std::vector<double> ms;
+    };
+    std::vector<Path> paths = {
+        {"AddToSubQueue x1", songs, {}}, {"EditQueue (append)", 1, {}}, {"RemoveFromSubQueue x1", songs, {}}, {"EditQueue (remove sub)", 1, {}},
+        {"EditQueue (insert x1)", songs, {}}, {"EditQueue (insert)", 1, {}}, {"RemoveFromQueue x1", songs, {}}, {"EditQueue (remove)", 1, {}}
+    };
+
+    std::vector<uint8_t> args, data, value, reply;
+    uint32_t result;
+    bool ok = true;
+    auto call = [&](const Ipc::Command cmd) {
+        ok = ok && client.call(cmd, args, data, 0, result, value, reply) && result == 0;
+        args.clear();
+        data.clear();
+    };
+    auto time = [&](Path & path, const std::function<void()> & f) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        f();
+        path.ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    };
+
+    for (size_t round = 0; round < batchRounds && ok; round++) {
+        // Sub-queue: one at a time, then all at once
+        time(paths[0], [&]() {
+            for (const int id : ids) {
+                append(args, id);
+                call(Ipc::Command::AddToSubQueue);
+            }
+        });
+        time(paths[2], [&]() {
+            for (size_t i = 0; i < songs; i++) {
+                append(args, static_cast<size_t>(0));
+                call(Ipc::Command::RemoveFromSubQueue);
+            }
+        });
+        time(paths[1], [&]() {
+            append(data, TriPlayer::QueueEdit{TriPlayer::QueueEditType::AppendSubQueue, static_cast<uint32_t>(songs), 0, 0});
+            for (const int id : ids) {
+                append(data, id);
+            }
+            call(Ipc::Command::EditQueue);
+        });
+        time(paths[3], [&]() {
+            append(data, TriPlayer::QueueEdit{TriPlayer::QueueEditType::RemoveSubQueue, static_cast<uint32_t>(songs), 0, 0});
+            call(Ipc::Command::EditQueue);
+        });
+
+        // Queue: added after the songs already there (so the playing song isn't touched), then removed again
+        time(paths[4], [&]() {
+            for (size_t i = 0; i < songs; i++) {
+                append(data, TriPlayer::QueueEdit{TriPlayer::QueueEditType::Insert, 1, queueSize + i, 0});
+                append(data, ids[i]);
+                call(Ipc::Command::EditQueue);
+            }
+        });
+        time(paths[6], [&]() {
+            for (size_t i = 0; i < songs; i++) {
+                append(args, queueSize);
+                call(Ipc::Command::RemoveFromQueue);
+            }
+        });
+        time(paths[5], [&]() {
+            append(data, TriPlayer::QueueEdit{TriPlayer::QueueEditType::Insert, static_cast<uint32_t>(songs), queueSize, 0});
+            for (const int id : ids) {
+                append(data, id);
+            }
+            call(Ipc::Command::EditQueue);
+        });
+        time(paths[7], [&]() {
+            append(data, TriPlayer::QueueEdit{TriPlayer::QueueEditType::Remove, static_cast<uint32_t>(songs), queueSize, 0});
+            call(Ipc::Command::EditQueue);
+        });
+    }
+    if (!ok) {
+        std::printf("A command failed (result: %u)\n", result);
+        return false;
+    }
+
+    // Each batched path follows the one-at-a-time path it replaces
+    std::printf("\nQueueing %zu songs (median of %zu rounds)\n", songs, batchRounds);
+    std::printf("%-24s %7s %10s %13s %8s\n", "Path", "Calls", "Total(ms)", "Per song(us)", "Speedup");
+    double single = 0;
+    for (size_t i = 0; i < paths.size(); i++) {
+        std::vector<double> & ms = paths[i].ms;
+        std::sort(ms.begin(), ms.end());
+        double median = ms[ms.size()/2];
+        if (i % 2 == 0) {
+            single = median;
+            std::printf("%-24s %7zu %10.2f %13.2f %8s\n", paths[i].name, paths[i].calls, median, 1000.0 * median/songs, "");
+        } else {
+            std::printf("%-24s %7zu %10.2f %13.2f %7.1fx\n", paths[i].name, paths[i].calls, median, 1000.0 * median/songs, single/median);
+        }
+    }
+    return true;
+}
+
+int main(int argc, char * argv[]) {
+    Shared shared;
+    shared.path = "/tmp/triplayer.sock";
+    size_t clients = 3;
+    double seconds = 10;
+    unsigned int seed = 1;
+    bool slow = false;
+    size_t batch = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string opt = argv[i];
+        if (opt == "-s") {
+            shared.path = argv[i+1];
+        } else if (opt == "-c") {
+            clients = std::strtoul(argv[i+1], nullptr, 10);
+        } else if (opt == "-t") {
+            seconds = std::strtod(argv[i+1], nullptr);
+        } else if (opt == "-r") {
+            seed = std::strtoul(argv[i+1], nullptr, 10);
+        } else if (opt == "-b") {
+            slow = (std::strtoul(argv[i+1], nullptr, 10) != 0);
+        } else if (opt == "-q") {
+            shared.initialQueueSize = std::strtoul(argv[i+1], nullptr, 10);
+        } else if (opt == "-a") {
+            batch = std::strtoul(argv[i+1], nullptr, 10);
+        }
+    }
+
+    // Start with a known queue and reset the lock stats
+    Client setup;
+    if (!setup.connect(shared.path)) {
+        std::printf("Couldn't connect to %s\n", shared.path.c_str());
+        return 1;
+    }
+    std::vector<uint8_t> args, data, value, reply;
+    uint32_t result;
+    std::vector<int> ids;
+    for (size_t i = 0; i < shared.initialQueueSize; i++) {
+        ids.push_back(1 + i % 10000);
+    }
+    Ipc::IDList::encode(ids, data);
+    append(args, ids.size());
+    append(args, Ipc::IDFormat::Compact);
+    if (!setup.call(Ipc::Command::SetQueue, args, data, 0, result, value, reply) || result != 0) {
+        std::printf("Couldn't set a queue of %zu songs (result: %u)\n", ids.size(), result);
+        return 1;
+    }
+    shared.queueSize = ids.size();
+    if (batch > 0) {
+        return (benchBatch(setup, batch, ids.size()) ? 0 : 1);
+    }
+    args.clear();
+    data.clear();
+    append(args, static_cast<uint8_t>(1));
+    setup.call(Ipc::Command::GetLockStats, args, data, static_cast<size_t>(TriPlayer::Lock::Count) * sizeof(TriPlayer::LockStats), result, value, reply);
+
+    // Run clients for the given time
+    std::printf("Running %zu clients (plus one waiting for changes%s) for %.1fs against %s\n", clients, (slow ? " and a slow one" : ""), seconds, shared.path.c_str());
+    std::vector<std::thread> threads;
+    threads.emplace_back(watchThread, &shared);
+    if (slow) {
+        threads.emplace_back(slowThread, &shared);
+    }
+    for (size_t i = 0; i < clients; i++) {
+        threads.emplace_back(clientThread, &shared, seed + i);
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    shared.stop = true;
+    for (std::thread & t : threads) {
+        t.join();
+    }
+
+    printLatencies(shared.samples, seconds);
+    printLocks(setup);
+    return 0;
+}